@@ -10,6 +10,7 @@
 
 #include "ebpf_core.h"
 #include "ebpf_error.h"
+#include "ebpf_program.h"
 #include "ebpf_tracelog.h"
 #include "ebpf_version.h"
 #include "git_commit_id.h"
@@ -41,6 +42,8 @@ static const ULONG _ebpfsvc_sid_subauthorities[] = {
 
 // Function codes from 0x800 to 0xFFF are for customer use.
 #define IOCTL_EBPF_CTL_METHOD_BUFFERED CTL_CODE(EBPF_IOCTL_TYPE, 0x900, METHOD_BUFFERED, FILE_ANY_ACCESS)
+// Large messages. The output buffer is locked and mapped instead of being copied through the system buffer.
+#define IOCTL_EBPF_CTL_METHOD_OUT_DIRECT CTL_CODE(EBPF_IOCTL_TYPE, 0x901, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
 #define EBPF_EXECUTION_CONTEXT_PRIVILEGED_ACCESS ((ACCESS_MASK)0x1)
 
 const char ebpf_core_version[] = EBPF_VERSION " " GIT_COMMIT_ID;
@@ -724,6 +727,28 @@ Exit:
     return status;
 }
 
+// Apply optional configuration from the driver's Parameters registry key. Missing values keep their defaults.
+static void
+_ebpf_driver_read_configuration(WDFDRIVER driver_handle)
+{
+    NTSTATUS status;
+    WDFKEY parameters_key = NULL;
+    ULONG use_predecoded_interpreter = 0;
+    DECLARE_CONST_UNICODE_STRING(use_predecoded_interpreter_value_name, L"UsePredecodedInterpreter");
+
+    status = WdfDriverOpenParametersRegistryKey(driver_handle, KEY_READ, WDF_NO_OBJECT_ATTRIBUTES, &parameters_key);
+    if (!NT_SUCCESS(status)) {
+        return;
+    }
+
+    status = WdfRegistryQueryULong(parameters_key, &use_predecoded_interpreter_value_name, &use_predecoded_interpreter);
+    if (NT_SUCCESS(status)) {
+        ebpf_program_set_use_predecoded_interpreter(use_predecoded_interpreter != 0);
+    }
+
+    WdfRegistryClose(parameters_key);
+}
+
 // Create a basic WDF driver, set up the device object for a callout driver and set up the ioctl surface.
 static _Check_return_ NTSTATUS
 _ebpf_driver_initialize_objects(
@@ -780,6 +805,8 @@ _ebpf_driver_initialize_objects(
         goto Exit;
     }
 
+    _ebpf_driver_read_configuration(*driver_handle);
+
     status = ebpf_result_to_ntstatus(ebpf_core_initiate());
     if (!NT_SUCCESS(status)) {
         EBPF_LOG_NTSTATUS_API_FAILURE(EBPF_TRACELOG_KEYWORD_ERROR, ebpf_core_initiate, status);
@@ -864,6 +891,73 @@ _ebpf_driver_is_caller_privileged(ebpf_operation_id_t operation_id)
     return result && NT_SUCCESS(status);
 }
 
+static NTSTATUS
+_ebpf_driver_io_device_control_large(_In_ WDFREQUEST request, size_t output_buffer_length, size_t input_buffer_length)
+{
+    NTSTATUS status;
+    void* input_buffer = NULL;
+    void* output_buffer = NULL;
+    size_t actual_input_length = 0;
+    size_t actual_output_length = 0;
+    const ebpf_operation_large_header_t* user_request = NULL;
+    size_t minimum_request_size = 0;
+    size_t minimum_reply_size = 0;
+    bool async = false;
+    bool privileged = false;
+
+    if ((input_buffer_length > EBPF_MAX_LARGE_MESSAGE_LENGTH) ||
+        (output_buffer_length > EBPF_MAX_LARGE_MESSAGE_LENGTH)) {
+        EBPF_LOG_MESSAGE(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_ERROR,
+            "Input or output buffer length exceeds large protocol limit");
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    status = WdfRequestRetrieveInputBuffer(
+        request, sizeof(ebpf_operation_large_header_t), &input_buffer, &actual_input_length);
+    if (!NT_SUCCESS(status)) {
+        EBPF_LOG_NTSTATUS_API_FAILURE(EBPF_TRACELOG_KEYWORD_ERROR, WdfRequestRetrieveInputBuffer, status);
+        return status;
+    }
+    user_request = input_buffer;
+
+    status = ebpf_result_to_ntstatus(ebpf_core_get_protocol_handler_properties(
+        user_request->id, &minimum_request_size, &minimum_reply_size, &async, &privileged));
+    if (status != STATUS_SUCCESS) {
+        EBPF_LOG_NTSTATUS_API_FAILURE(EBPF_TRACELOG_KEYWORD_ERROR, ebpf_core_get_protocol_handler_properties, status);
+        return status;
+    }
+
+    // Only synchronous operations with a reply accept large messages.
+    if (async || (minimum_reply_size == 0)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (privileged && !_ebpf_driver_is_caller_privileged(user_request->id)) {
+        EBPF_LOG_MESSAGE(EBPF_TRACELOG_LEVEL_ERROR, EBPF_TRACELOG_KEYWORD_ERROR, "Caller is not privileged");
+        return STATUS_ACCESS_DENIED;
+    }
+
+    // The output buffer is described by an MDL, so it does not alias the input buffer.
+    status = WdfRequestRetrieveOutputBuffer(request, minimum_reply_size, &output_buffer, &actual_output_length);
+    if (!NT_SUCCESS(status)) {
+        EBPF_LOG_NTSTATUS_API_FAILURE(EBPF_TRACELOG_KEYWORD_ERROR, WdfRequestRetrieveOutputBuffer, status);
+        return status;
+    }
+
+    status = ebpf_result_to_ntstatus(ebpf_core_invoke_large_protocol_handler(
+        user_request->id,
+        user_request,
+        (uint32_t)actual_input_length,
+        output_buffer,
+        (uint32_t)actual_output_length));
+    if (status != STATUS_SUCCESS) {
+        EBPF_LOG_NTSTATUS_API_FAILURE(EBPF_TRACELOG_KEYWORD_ERROR, "ebpf_core_invoke_large_protocol_handler", status);
+    }
+    return status;
+}
+
 static VOID
 _ebpf_driver_io_device_control(
     _In_ WDFQUEUE queue,
@@ -1013,6 +1107,9 @@ _ebpf_driver_io_device_control(
             goto Done;
         }
         break;
+    case IOCTL_EBPF_CTL_METHOD_OUT_DIRECT:
+        status = _ebpf_driver_io_device_control_large(request, output_buffer_length, input_buffer_length);
+        break;
     default:
         status = STATUS_INVALID_DEVICE_REQUEST;
         break;
@@ -170,6 +170,28 @@ bpf_map_get_next_key(int fd, const void* key, void* next_key);
 int
 bpf_map_lookup_elem(int fd, const void* key, void* value);
 
+/**
+ * @brief Look up an element by key in a specified map and
+ * return its value.
+ *
+ * @param[in] fd File descriptor of map.
+ * @param[in] key Pointer to key to look up.
+ * @param[out] value Pointer to memory in which to write the
+ * value.
+ * @param[in] flags Zero, or one of EBPF_F_PERCPU_SUM,
+ * EBPF_F_PERCPU_MIN or EBPF_F_PERCPU_MAX to return a single value
+ * computed from the values of all CPUs of a per-CPU map.
+ *
+ * @retval 0 The operation was successful.
+ * @retval <0 An error occurred, and errno was set.
+ *
+ * @retval -EINVAL An invalid argument was provided.
+ * @retval -EBADF The file descriptor was not found.
+ * @retval -ENOMEM Out of memory.
+ */
+int
+bpf_map_lookup_elem_flags(int fd, const void* key, void* value, __u64 flags);
+
 /**
  * @brief Create or update an element (key/value pair) in a
  * specified map.
@@ -71,6 +71,18 @@ extern "C"
 
 #if !defined(UNREFERENCED_PARAMETER)
 #define UNREFERENCED_PARAMETER(P) (P)
+#endif
+
+// Hints emitted by bpf2c when laying out code using a branch profile. MSVC has no branch hints, so only cold
+// functions are kept from being inlined into the code that runs.
+#if defined(__clang__) || defined(__GNUC__)
+#define BPF2C_LIKELY(X) __builtin_expect(!!(X), 1)
+#define BPF2C_UNLIKELY(X) __builtin_expect(!!(X), 0)
+#define BPF2C_COLD __attribute__((cold, noinline))
+#else
+#define BPF2C_LIKELY(X) (X)
+#define BPF2C_UNLIKELY(X) (X)
+#define BPF2C_COLD __declspec(noinline)
 #endif
 
     typedef uint64_t (*helper_function_t)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, void*);
@@ -575,3 +575,51 @@ EBPF_HELPER(intptr_t, bpf_redirect_map, (void* map, uint64_t key, uint64_t flags
 #ifndef __doxygen
 #define bpf_redirect_map ((bpf_redirect_map_t)BPF_FUNC_redirect_map)
 #endif
+
+/**
+ * @brief Incrementally update a layer 3 (e.g., IPv4 header) checksum after a field covered by it was modified,
+ * without recomputing the checksum over the whole header. Unlike the Linux bpf_l3_csum_replace, which takes a packet
+ * and an offset, this helper updates a checksum that the program points to directly.
+ *
+ * @param[in, out] checksum Pointer to the 16-bit checksum field.
+ * @param[in] checksum_size Size in bytes of the checksum field. Must be 2.
+ * @param[in] from Old value of the modified field.
+ * @param[in] to New value of the modified field.
+ * @param[in] size Size in bytes of the modified field (2 or 4), or 0 if *to* is a checksum delta computed by
+ * \ref bpf_csum_diff, in which case *from* must be 0.
+ *
+ * @retval 0 The operation was successful.
+ * @retval <0 A failure occurred.
+ */
+EBPF_HELPER(
+    long,
+    bpf_l3_csum_replace_s,
+    (void* checksum, uint32_t checksum_size, uint64_t from, uint64_t to, uint64_t size));
+#ifndef __doxygen
+#define bpf_l3_csum_replace_s ((bpf_l3_csum_replace_s_t)BPF_FUNC_l3_csum_replace_s)
+#endif
+
+/**
+ * @brief Incrementally update a layer 4 (e.g., TCP or UDP) checksum after a field covered by it was modified,
+ * without recomputing the checksum over the whole segment. Unlike the Linux bpf_l4_csum_replace, which takes a packet
+ * and an offset, this helper updates a checksum that the program points to directly.
+ *
+ * @param[in, out] checksum Pointer to the 16-bit checksum field.
+ * @param[in] checksum_size Size in bytes of the checksum field. Must be 2.
+ * @param[in] from Old value of the modified field.
+ * @param[in] to New value of the modified field.
+ * @param[in] flags Size in bytes of the modified field (2 or 4, or 0 if *to* is a checksum delta computed by
+ * \ref bpf_csum_diff), masked by BPF_F_HDR_FIELD_MASK. BPF_F_MARK_MANGLED_0 leaves a zero (i.e., absent UDP)
+ * checksum as is and stores a zero result as 0xffff. BPF_F_PSEUDO_HDR is accepted for compatibility; since the
+ * checksum is updated in place, it has no effect.
+ *
+ * @retval 0 The operation was successful.
+ * @retval <0 A failure occurred.
+ */
+EBPF_HELPER(
+    long,
+    bpf_l4_csum_replace_s,
+    (void* checksum, uint32_t checksum_size, uint64_t from, uint64_t to, uint64_t flags));
+#ifndef __doxygen
+#define bpf_l4_csum_replace_s ((bpf_l4_csum_replace_s_t)BPF_FUNC_l4_csum_replace_s)
+#endif
@@ -615,6 +615,104 @@ extern "C"
     _Must_inspect_result_ ebpf_result_t
     ebpf_program_test_run(fd_t program_fd, _Inout_ ebpf_test_run_options_t* options) EBPF_NO_EXCEPT;
 
+    /**
+     * @brief Run the program concurrently on a set of CPUs to measure how it scales.
+     *
+     * A worker is started on each CPU in cpus. The workers wait for each other before
+     * invoking the program, then each invokes it options->repeat_count times on its own copy
+     * of the input, so shared state such as maps is contended for the whole run. On return,
+     * options holds the output of the first CPU and the mean duration across all CPUs.
+     *
+     * @param[in] program_fd File descriptor of the program to run.
+     * @param[in] cpus Indices of the CPUs to run the program on, in ascending order. Indices
+     * span all processor groups, from 0 to libbpf_num_possible_cpus() - 1.
+     * @param[in] cpu_count Number of entries in cpus. Must not be zero.
+     * @param[in,out] options Input and output of the test run.
+     * @param[out] cpu_results Receives one result per entry in cpus, in the same order.
+     * @param[out] runs_per_second Optionally receives the aggregate throughput across all CPUs.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are incorrect.
+     * @retval EBPF_INSUFFICIENT_BUFFER An output buffer is too small.
+     * @retval EBPF_INVALID_OBJECT Invalid object was passed.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_program_test_run_parallel(
+        fd_t program_fd,
+        _In_reads_(cpu_count) const uint32_t* cpus,
+        uint32_t cpu_count,
+        _Inout_ ebpf_test_run_options_t* options,
+        _Out_writes_(cpu_count) ebpf_test_run_cpu_result_t* cpu_results,
+        _Out_opt_ uint64_t* runs_per_second) EBPF_NO_EXCEPT;
+
+    typedef struct _ebpf_test_run_batch_summary
+    {
+        size_t input_count;     ///< Number of inputs that were run.
+        uint64_t min_duration;  ///< Shortest per-input duration in nanoseconds.
+        uint64_t p50_duration;  ///< Median per-input duration in nanoseconds.
+        uint64_t p99_duration;  ///< 99th percentile per-input duration in nanoseconds.
+        uint64_t max_duration;  ///< Longest per-input duration in nanoseconds.
+        uint64_t mean_duration; ///< Mean per-input duration in nanoseconds.
+    } ebpf_test_run_batch_summary_t;
+
+    /**
+     * @brief Run the program once per input in the eBPF VM and return per-input results.
+     *
+     * Each entry in the options array describes one input and receives that input's
+     * return value, output data, output context and duration, exactly as if it had been
+     * passed to \ref ebpf_program_test_run. Inputs are run in order and the batch stops
+     * at the first input that fails.
+     *
+     * @param[in] program_fd File descriptor of the program to run.
+     * @param[in] input_count Number of entries in the options array.
+     * @param[in,out] options Per-input options and results.
+     * @param[out] summary Optionally receives the distribution of per-input durations
+     *  over the inputs that were run.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are incorrect.
+     * @retval EBPF_INVALID_OBJECT Invalid object was passed.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_program_test_run_batch(
+        fd_t program_fd,
+        size_t input_count,
+        _Inout_updates_(input_count) ebpf_test_run_options_t* options,
+        _Out_opt_ ebpf_test_run_batch_summary_t* summary) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Build a set of test run inputs from the packets in a pcap or pcapng file.
+     *
+     * Each packet becomes one entry whose data_in holds the captured bytes and whose
+     * data_out is a buffer of data_size_out bytes, so that programs that grow the packet
+     * can return it. Contexts are left empty and repeat_count is set to 1; callers may
+     * adjust any field before running the batch.
+     *
+     * @param[in] file_name Path of the capture file.
+     * @param[in] data_size_out Size in bytes of each entry's data_out, or 0 for the largest
+     *  output data that \ref ebpf_program_test_run can return. Callers that also set
+     *  context_out must pass a size that leaves room for the output context.
+     * @param[out] options On success, points to the array of inputs.
+     *  The caller is responsible for freeing it via ebpf_free_test_run_options().
+     * @param[out] input_count On success, the number of inputs in the array.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_FILE_NOT_FOUND The file could not be opened.
+     * @retval EBPF_INVALID_ARGUMENT The file is not a well-formed capture file or contains no packets,
+     *  or data_size_out is larger than a test run can return.
+     * @retval EBPF_NO_MEMORY Out of memory.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_test_run_options_from_pcap(
+        _In_z_ const char* file_name,
+        size_t data_size_out,
+        _Outptr_result_buffer_maybenull_(*input_count) ebpf_test_run_options_t** options,
+        _Out_ size_t* input_count) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Free memory returned from \ref ebpf_test_run_options_from_pcap.
+     * @param[in] options Memory to free.
+     */
+    void
+    ebpf_free_test_run_options(_In_opt_ _Post_invalid_ ebpf_test_run_options_t* options) EBPF_NO_EXCEPT;
+
     /**
      * @brief Write data into the ring buffer map.
      *
@@ -668,6 +766,96 @@ extern "C"
     ebpf_ring_buffer_map_unmap_buffer(
         fd_t map_fd, _In_ void* consumer, _In_ const void* producer, _In_ const void* data) EBPF_NO_EXCEPT;
 
+    /**
+     * @brief Map the values of an array map into the calling process, so that they can be read and written without
+     * a call into the execution context. Value i starts at offset i * value_size of the mapping.
+     *
+     * The map must have been created with BPF_F_MMAPABLE. A map can be mapped more than once, by one or several
+     * processes. Frozen maps, such as the .rodata map of a program, can only be mapped read-only. A mapping is removed
+     * by ebpf_map_munmap, or when the last file descriptor or handle to the map is closed.
+     *
+     * @param[in] map_fd File descriptor of the array map.
+     * @param[in] writable Whether the values can be written through the mapping.
+     * @param[out] data Pointer to the first value of the map.
+     * @param[out] size Size of the mapping, which is the size of the values rounded up to a whole page.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_FD The file descriptor is not valid.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map was not created with BPF_F_MMAPABLE.
+     * @retval EBPF_ACCESS_DENIED A writable mapping was requested for a frozen map.
+     * @sa ebpf_map_munmap
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_mmap(fd_t map_fd, bool writable, _Outptr_result_bytes_(*size) void** data, _Out_ size_t* size)
+        EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Remove a mapping created by ebpf_map_mmap.
+     *
+     * @param[in] map_fd File descriptor of the array map.
+     * @param[in] data Pointer returned by ebpf_map_mmap.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_FD The file descriptor is not valid.
+     * @retval EBPF_INVALID_ARGUMENT The map is not mapped at this address.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_munmap(fd_t map_fd, _In_ void* data) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Iterator over the entries of a hash map, kept in the execution context.
+     *
+     * The iterator remembers its position in the map, so dumping a map costs one call per page of entries instead
+     * of one bpf_map_get_next_key and one bpf_map_lookup_elem call per entry, and the cost of each page does not
+     * grow with the position in the map. Entries that are updated or deleted while iterating do not cause the
+     * iteration to restart or fail.
+     */
+    typedef struct _ebpf_map_iterator ebpf_map_iterator_t;
+
+    /**
+     * @brief Create an iterator over the entries of a hash map.
+     *
+     * @param[in] map_fd File descriptor of the map.
+     * @param[in] snapshot If true, the entries of the map are copied when the iterator is created and later changes
+     * to the map are not seen. Each bucket of the map is copied atomically, but updates made while the copy is taken
+     * may or may not be included. The copy is limited to 16 MB of keys and values; the entries of a larger map that
+     * follow it are read as they are returned, as with a live iterator.
+     * @param[in] flags Zero or one of the EBPF_F_PERCPU_* flags to return one aggregated value per key from a per-CPU
+     * map.
+     * @param[out] iterator Pointer to memory that receives the iterator.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_FD The file descriptor is not valid.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are incorrect.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map is not a hash map.
+     * @retval EBPF_NO_MEMORY Out of memory.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_iterator_create(
+        fd_t map_fd, bool snapshot, uint64_t flags, _Outptr_ ebpf_map_iterator_t** iterator) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Get the next entries of the map. Each entry is a key immediately followed by its value.
+     *
+     * @param[in, out] iterator Iterator to advance.
+     * @param[out] entries Buffer that receives the entries.
+     * @param[in, out] size On input, the size of the buffer. On output, the number of bytes written, which is a
+     * multiple of the size of an entry.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MORE_KEYS All entries have been returned.
+     * @retval EBPF_INSUFFICIENT_BUFFER The buffer cannot hold a single entry.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_iterator_next(
+        _Inout_ ebpf_map_iterator_t* iterator,
+        _Out_writes_bytes_to_(*size, *size) void* entries,
+        _Inout_ size_t* size) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Destroy a map iterator.
+     *
+     * @param[in] iterator Iterator to destroy.
+     */
+    void
+    ebpf_map_iterator_destroy(_In_opt_ _Post_invalid_ ebpf_map_iterator_t* iterator) EBPF_NO_EXCEPT;
+
     /**
      * @brief Set the wait handle that will be signaled for new data.
      *
@@ -684,6 +872,152 @@ extern "C"
     _Must_inspect_result_ ebpf_result_t
     ebpf_map_set_wait_handle(fd_t map_fd, uint64_t index, ebpf_handle_t handle) EBPF_NO_EXCEPT;
 
+    /**
+     * @brief Queue of map operations that is shared with the execution context.
+     *
+     * Operations are written to a submission ring that is mapped into the process and their results are read from a
+     * completion ring, so a batch of operations costs at most one IOCTL instead of one per operation. The IOCTL is
+     * only sent when a submission finds the ring empty; while the execution context is still working through earlier
+     * submissions it picks up new ones without being notified.
+     */
+    typedef struct _ebpf_map_op_queue ebpf_map_op_queue_t;
+
+    /**
+     * @brief Result of an operation submitted to a map operation queue.
+     */
+    typedef struct _ebpf_map_op_result
+    {
+        uint64_t user_data;   ///< Value passed when the operation was queued.
+        ebpf_result_t result; ///< Result of the operation.
+        uint32_t value_size;  ///< Size of the value returned by a successful lookup.
+    } ebpf_map_op_result_t;
+
+    /**
+     * @brief Create a map operation queue.
+     *
+     * @param[in] ring_size Size in bytes of the submission ring and of the completion ring. Must be a power of two
+     * and a multiple of the page size.
+     * @param[out] queue Pointer to memory that receives the queue.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are incorrect.
+     * @retval EBPF_NO_MEMORY Out of memory.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_op_queue_create(size_t ring_size, _Outptr_ ebpf_map_op_queue_t** queue) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Destroy a map operation queue. Results that have not been retrieved are discarded.
+     *
+     * @param[in] queue Queue to destroy.
+     */
+    void
+    ebpf_map_op_queue_destroy(_In_opt_ _Post_invalid_ ebpf_map_op_queue_t* queue) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Queue a lookup of an element. The value is returned with the result of the operation.
+     *
+     * @param[in, out] queue Queue to add the operation to.
+     * @param[in] map_fd File descriptor of the map.
+     * @param[in] key Key to look up.
+     * @param[in] key_size Size of the key.
+     * @param[in] value_size Size of the value to return.
+     * @param[in] flags EBPF_F_PERCPU_* flags, as for ebpf_map_lookup_element_flags.
+     * @param[in] user_data Value returned with the result of the operation.
+     * @retval EBPF_SUCCESS The operation was queued.
+     * @retval EBPF_INVALID_FD The map file descriptor is not valid.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are incorrect.
+     * @retval EBPF_NO_MEMORY The submission ring is full. Submit the queue and retrieve results before retrying.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_op_queue_lookup_elem(
+        _Inout_ ebpf_map_op_queue_t* queue,
+        fd_t map_fd,
+        _In_reads_bytes_(key_size) const void* key,
+        uint32_t key_size,
+        uint32_t value_size,
+        uint64_t flags,
+        uint64_t user_data) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Queue an update of an element.
+     *
+     * @param[in, out] queue Queue to add the operation to.
+     * @param[in] map_fd File descriptor of the map.
+     * @param[in] key Key to update.
+     * @param[in] key_size Size of the key.
+     * @param[in] value Value to store.
+     * @param[in] value_size Size of the value.
+     * @param[in] flags BPF_ANY, BPF_NOEXIST or BPF_EXIST.
+     * @param[in] user_data Value returned with the result of the operation.
+     * @retval EBPF_SUCCESS The operation was queued.
+     * @retval EBPF_INVALID_FD The map file descriptor is not valid.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are incorrect.
+     * @retval EBPF_NO_MEMORY The submission ring is full. Submit the queue and retrieve results before retrying.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_op_queue_update_elem(
+        _Inout_ ebpf_map_op_queue_t* queue,
+        fd_t map_fd,
+        _In_reads_bytes_(key_size) const void* key,
+        uint32_t key_size,
+        _In_reads_bytes_(value_size) const void* value,
+        uint32_t value_size,
+        uint64_t flags,
+        uint64_t user_data) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Queue a deletion of an element.
+     *
+     * @param[in, out] queue Queue to add the operation to.
+     * @param[in] map_fd File descriptor of the map.
+     * @param[in] key Key to delete.
+     * @param[in] key_size Size of the key.
+     * @param[in] user_data Value returned with the result of the operation.
+     * @retval EBPF_SUCCESS The operation was queued.
+     * @retval EBPF_INVALID_FD The map file descriptor is not valid.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are incorrect.
+     * @retval EBPF_NO_MEMORY The submission ring is full. Submit the queue and retrieve results before retrying.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_op_queue_delete_elem(
+        _Inout_ ebpf_map_op_queue_t* queue,
+        fd_t map_fd,
+        _In_reads_bytes_(key_size) const void* key,
+        uint32_t key_size,
+        uint64_t user_data) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Make the operations queued since the last call visible to the execution context. The execution context
+     * is only notified if the submission ring was empty.
+     *
+     * @param[in, out] queue Queue to submit.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The execution context rejected the submission ring.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_op_queue_submit(_Inout_ ebpf_map_op_queue_t* queue) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Retrieve the result of the next completed operation. Results are returned in submission order.
+     *
+     * @param[in, out] queue Queue to retrieve the result from.
+     * @param[out] result Receives the result of the operation.
+     * @param[out] value Optionally receives the value returned by a lookup.
+     * @param[in] value_size Size of the value buffer.
+     * @param[in] timeout_ms Time in milliseconds to wait for a result, or 0 to return immediately.
+     * @retval EBPF_SUCCESS A result was retrieved.
+     * @retval EBPF_TIMEOUT No result is available.
+     * @retval EBPF_INSUFFICIENT_BUFFER The value buffer is too small. result->value_size holds the required size and
+     * the result is left in the queue.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_op_queue_get_result(
+        _Inout_ ebpf_map_op_queue_t* queue,
+        _Out_ ebpf_map_op_result_t* result,
+        _Out_writes_bytes_opt_(value_size) void* value,
+        uint32_t value_size,
+        uint32_t timeout_ms) EBPF_NO_EXCEPT;
+
     /**
      * @brief Get eBPF program type for the specified BPF program type.
      *
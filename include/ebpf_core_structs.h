@@ -33,6 +33,18 @@ typedef struct _ebpf_map_async_query_result
     size_t lost_count;
 } ebpf_map_async_query_result_t;
 
+/**
+ * @brief Result of the part of a program test run that executed on a single CPU.
+ */
+typedef struct _ebpf_test_run_cpu_result
+{
+    uint32_t cpu;             ///< CPU the program ran on.
+    uint64_t return_value;    ///< Return value of the last invocation on this CPU.
+    uint64_t run_count;       ///< Number of times the program was invoked on this CPU.
+    uint64_t duration;        ///< Time in nanoseconds spent executing the program on this CPU.
+    uint64_t runs_per_second; ///< Throughput on this CPU. Computed by the API library from run_count and duration.
+} ebpf_test_run_cpu_result_t;
+
 typedef enum _ebpf_object_type
 {
     EBPF_OBJECT_UNKNOWN,
@@ -80,16 +80,36 @@ typedef ebpf_result_t (*ebpf_program_batch_invoke_function_t)(
  */
 typedef ebpf_result_t (*ebpf_program_batch_end_invoke_function_t)(_Inout_ void* state);
 
+/**
+ * @brief Get the update generation of the maps used by the program. The generation changes after an entry of one of
+ * those maps is updated or deleted through the map APIs or helper functions, so an extension that caches the results
+ * of the program can discard the results produced before such a change. Values that programs write in place through a
+ * pointer returned by a map lookup are not tracked.
+ *
+ * @param[in] extension_client_binding_context The context provided by the extension client when the binding was
+ * created.
+ * @param[out] generation The current map update generation.
+ *
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_OPERATION_NOT_SUPPORTED The program uses a map whose contents can change without its generation
+ * changing, e.g. a map of maps or a map that is mapped writable into user mode. Results of the program must not be
+ * cached.
+ */
+typedef ebpf_result_t (*ebpf_program_get_map_update_generation_function_t)(
+    _In_ const void* extension_client_binding_context, _Out_ uint64_t* generation);
+
 typedef enum _ebpf_link_dispatch_table_version
 {
     EBPF_LINK_DISPATCH_TABLE_VERSION_1 = 1, ///< Initial version of the dispatch table.
+    EBPF_LINK_DISPATCH_TABLE_VERSION_2 = 2, ///< Adds ebpf_program_get_map_update_generation_function.
     EBPF_LINK_DISPATCH_TABLE_VERSION_CURRENT =
-        EBPF_LINK_DISPATCH_TABLE_VERSION_1, ///< Current version of the dispatch table.
+        EBPF_LINK_DISPATCH_TABLE_VERSION_2, ///< Current version of the dispatch table.
 } ebpf_link_dispatch_table_version_t;
 
 #define EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_1 4
+#define EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_2 5
 #define EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_CURRENT \
-    EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_1 ///< Current number of functions in the dispatch table.
+    EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_2 ///< Current number of functions in the dispatch table.
 
 typedef struct _ebpf_extension_program_dispatch_table
 {
@@ -99,6 +119,7 @@ typedef struct _ebpf_extension_program_dispatch_table
     ebpf_program_batch_begin_invoke_function_t ebpf_program_batch_begin_invoke_function;
     ebpf_program_batch_invoke_function_t ebpf_program_batch_invoke_function;
     ebpf_program_batch_end_invoke_function_t ebpf_program_batch_end_invoke_function;
+    ebpf_program_get_map_update_generation_function_t ebpf_program_get_map_update_generation_function;
 } ebpf_extension_program_dispatch_table_t;
 
 typedef struct _ebpf_extension_data
@@ -111,6 +111,23 @@ typedef enum _ebpf_sock_addr_verdict
     BPF_SOCK_ADDR_VERDICT_PROCEED_HARD
 } ebpf_sock_addr_verdict_t;
 
+/**
+ * @brief Flag that an EBPF_ATTACH_TYPE_CGROUP_INET4_CONNECT or EBPF_ATTACH_TYPE_CGROUP_INET6_CONNECT program can OR
+ * into its verdict to allow the verdict to be cached.
+ *
+ * A program should only set this flag if its verdict depends on nothing but the process, destination address,
+ * destination port, protocol and compartment of the connection, and the contents of maps. While a cached verdict is
+ * valid, later connections with the same values are given the cached verdict without invoking the attached programs.
+ * A verdict is only cached if every program invoked for the connection set this flag and the connection was not
+ * redirected. Cached verdicts are discarded when a program is attached or detached, and when an entry of a map used by
+ * an attached program is updated, deleted, pushed or popped. Writes through a pointer returned by bpf_map_lookup_elem
+ * are not observed. Verdicts are not cached while an attached program uses a map of maps, a program array, or a map
+ * that is mapped writable into user mode.
+ *
+ * The flag is not recognized at other attach types.
+ */
+#define BPF_SOCK_ADDR_VERDICT_CACHEABLE 0x100
+
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable : 4201)
@@ -261,7 +278,8 @@ EBPF_HELPER(int, bpf_sock_addr_get_network_context, (bpf_sock_addr_t * ctx, void
  * @retval BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT Allow the socket operation. Maps to a soft permit in WFP.
  * @retval BPF_SOCK_ADDR_VERDICT_PROCEED_HARD Allow the socket operation. Maps to a hard permit in WFP.
  *
- * Any return value other than the ones mentioned above is treated as BPF_SOCK_ADDR_VERDICT_REJECT.
+ * At EBPF_ATTACH_TYPE_CGROUP_INET4_CONNECT and EBPF_ATTACH_TYPE_CGROUP_INET6_CONNECT, the verdict may be combined with
+ * \ref BPF_SOCK_ADDR_VERDICT_CACHEABLE. Any other return value is treated as BPF_SOCK_ADDR_VERDICT_REJECT.
  */
 typedef ebpf_sock_addr_verdict_t
 sock_addr_hook_t(bpf_sock_addr_t* context);
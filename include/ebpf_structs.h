@@ -181,6 +181,8 @@ typedef enum
     BPF_FUNC_get_current_process_start_key = 33,  ///< \ref bpf_get_current_process_start_key
     BPF_FUNC_get_current_thread_create_time = 34, ///< \ref bpf_get_current_thread_create_time
     BPF_FUNC_redirect_map = 35,                   ///< \ref bpf_redirect_map
+    BPF_FUNC_l3_csum_replace_s = 36,              ///< \ref bpf_l3_csum_replace_s
+    BPF_FUNC_l4_csum_replace_s = 37,              ///< \ref bpf_l4_csum_replace_s
 } ebpf_helper_id_t;
 
 // Cross-platform BPF program types.
@@ -463,6 +465,21 @@ struct bpf_map_info
 #define BPF_NOEXIST 0x1
 #define BPF_EXIST 0x2
 
+// Map creation flags.
+#define BPF_F_MMAPABLE 0x400 ///< The values of the map can be mapped into user mode (see ebpf_map_mmap).
+
+// Windows-specific lookup flags that return a single value for an element of a per-CPU map, computed in the kernel
+// from the values of all CPUs. The value is treated as an array of uint64_t fields, each of which is aggregated.
+#define EBPF_F_PERCPU_SUM (1ULL << 32)            ///< Return the sum of the per-CPU values.
+#define EBPF_F_PERCPU_MIN (2ULL << 32)            ///< Return the minimum of the per-CPU values.
+#define EBPF_F_PERCPU_MAX (3ULL << 32)            ///< Return the maximum of the per-CPU values.
+#define EBPF_F_PERCPU_AGGREGATE_MASK (3ULL << 32) ///< Mask of the per-CPU aggregation.
+
+// Flags for bpf_l3_csum_replace_s and bpf_l4_csum_replace_s.
+#define BPF_F_HDR_FIELD_MASK 0xf         ///< Mask of the size in bytes of the modified field.
+#define BPF_F_PSEUDO_HDR (1ULL << 4)     ///< The modified field is part of the pseudo-header.
+#define BPF_F_MARK_MANGLED_0 (1ULL << 5) ///< Leave a zero checksum as is, and store a zero result as 0xffff.
+
 /**
  * @brief eBPF program information.  This structure can be retrieved by calling
  * \ref bpf_obj_get_info_by_fd on a program fd.
@@ -9,6 +9,7 @@
 #include "ebpf_shared_framework.h"
 #include "ebpf_tracelog.h"
 #include "ebpf_verifier_wrapper.hpp"
+#include "elf_image.h"
 #include "elfio_wrapper.hpp"
 #pragma warning(push)
 #pragma warning(disable : 4100)  // unreferenced formal parameter
@@ -32,7 +33,6 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
-#include <sys/stat.h>
 #include <vector>
 
 #define elf_everparse_error ElfEverParseError
@@ -191,73 +191,25 @@ _get_pin_type_for_btf_map(const libbtf::btf_type_data& btf_data, libbtf::btf_typ
     return LIBBPF_PIN_NONE;
 }
 
-/**
- * @brief Invoke the visitor for each symbol in the specified section.
- *
- * @param[in] symbols Symbol table.
- * @param[in] required_section_index Section index to match.
- * @param[in] visitor Visitor to invoke for each symbol. Return false to stop iteration.
- */
-static void
-_for_each_symbol(
-    const ELFIO::const_symbol_section_accessor& symbols,
-    ELFIO::Elf_Half required_section_index,
-    std::function<bool(const std::string&, ELFIO::Elf64_Addr)> visitor)
-{
-    for (ELFIO::Elf_Xword i = 0; i < symbols.get_symbols_num(); i++) {
-        string symbol_name;
-        ELFIO::Elf64_Addr symbol_value{};
-        unsigned char symbol_bind{};
-        unsigned char symbol_type{};
-        ELFIO::Elf_Half symbol_section_index{};
-        unsigned char symbol_other{};
-        ELFIO::Elf_Xword symbol_size{};
-
-        symbols.get_symbol(
-            i, symbol_name, symbol_value, symbol_size, symbol_bind, symbol_type, symbol_section_index, symbol_other);
-
-        if (symbol_section_index != required_section_index) {
-            continue;
-        }
-
-        if (!visitor(symbol_name, symbol_value)) {
-            break;
-        }
-    }
-}
-
-template <typename T>
-static vector<T>
-vector_of(const ELFIO::section& sec)
-{
-    auto data = sec.get_data();
-    auto size = sec.get_size();
-    if ((size % sizeof(T) != 0) || size > UINT32_MAX || !data) {
-        throw std::runtime_error("Invalid argument to vector_of");
-    }
-    return {(T*)data, (T*)(data + size)};
-}
-
 /**
  * @brief Parse the BTF data, gather the list of verifier map descriptors, and populate the cache.
  *
- * @param[in] reader Elf reader.
+ * @param[in] image ELF image.
  * @param[in] map_names Mapping from section offset to map name.
  */
 static void
-_parse_btf_map_info_and_populate_cache(const ELFIO::elfio& reader, const vector<section_offset_to_map_t>& map_names)
+_parse_btf_map_info_and_populate_cache(elf_image_t& image, const vector<section_offset_to_map_t>& map_names)
 {
-    ELFIO::section* btf_section = reader.sections[".BTF"];
-    if (!btf_section) {
+    const libbtf::btf_type_data* btf_data = image.btf();
+    if (btf_data == nullptr) {
         // It is an error if the BTF section is missing.
         throw std::runtime_error("BTF section is missing");
     }
-    std::optional<libbtf::btf_type_data> btf_data = vector_of<byte>(*btf_section);
 
     std::vector<prevail::EbpfMapDescriptor> btf_map_descriptors;
     std::map<std::string, size_t> btf_map_name_to_index;
 
-    auto map_data = parse_btf_map_section(btf_data.value());
+    auto map_data = parse_btf_map_section(*btf_data);
     std::map<std::string, size_t> map_offsets;
     for (auto& map : map_data) {
         map_offsets.insert({map.name, btf_map_descriptors.size()});
@@ -284,7 +236,7 @@ _parse_btf_map_info_and_populate_cache(const ELFIO::elfio& reader, const vector<
         int btf_type_id = btf_map_descriptor.original_fd;
         int btf_inner_type_id = btf_map_descriptor.inner_map_fd;
 
-        auto pin_type = _get_pin_type_for_btf_map(btf_data.value(), btf_type_id);
+        auto pin_type = _get_pin_type_for_btf_map(*btf_data, btf_type_id);
         cache_map_handle(
             ebpf_handle_invalid,
             map_idx_to_original_fd(idx),
@@ -308,7 +260,7 @@ _parse_btf_map_info_and_populate_cache(const ELFIO::elfio& reader, const vector<
             int btf_type_id = btf_map_descriptor.original_fd;
             int btf_inner_type_id = btf_map_descriptor.inner_map_fd;
 
-            auto pin_type = _get_pin_type_for_btf_map(btf_data.value(), btf_type_id);
+            auto pin_type = _get_pin_type_for_btf_map(*btf_data, btf_type_id);
             cache_map_handle(
                 ebpf_handle_invalid,
                 map_idx_to_original_fd(idx),
@@ -331,27 +283,23 @@ _parse_btf_map_info_and_populate_cache(const ELFIO::elfio& reader, const vector<
 
 // Parse symbols to get map names for all maps sections.
 static void
-_get_map_names(
-    _In_ const ELFIO::elfio& reader,
-    _In_ const ELFIO::const_symbol_section_accessor& symbols,
-    _Inout_ vector<section_offset_to_map_t>& map_names) noexcept(false)
+_get_map_names(elf_image_t& image, _Inout_ vector<section_offset_to_map_t>& map_names) noexcept(false)
 {
+    const ELFIO::elfio& reader = image.reader();
     std::string maps_prefix = "maps/";
     for (const auto& section : reader.sections) {
         std::string name = section->get_name();
         if (name == ".maps" || name == "maps" ||
             (name.length() > 5 && name.compare(0, maps_prefix.length(), maps_prefix) == 0)) {
-            _for_each_symbol(
-                symbols, section->get_index(), [&](const std::string& symbol_name, ELFIO::Elf64_Addr symbol_value) {
-                    map_names.emplace_back(symbol_value, symbol_name);
-                    return true;
-                });
+            for (const auto& symbol : image.symbols_in_section(section->get_index())) {
+                map_names.emplace_back(symbol.value, symbol.name);
+            }
         }
     }
 
     ELFIO::section* btf_maps_section = reader.sections[".maps"];
     if (btf_maps_section) {
-        _parse_btf_map_info_and_populate_cache(reader, map_names);
+        _parse_btf_map_info_and_populate_cache(image, map_names);
     }
 
     // Verify that returned map descriptors are a superset of map names referenced in the symbol section.
@@ -376,31 +324,7 @@ _get_map_names(
 }
 
 static void
-_get_map_names(
-    std::variant<std::string, std::vector<uint8_t>>& file_or_buffer,
-    _Inout_ vector<section_offset_to_map_t>& map_names) noexcept(false)
-{
-    ELFIO::elfio reader;
-
-    if (std::holds_alternative<std::string>(file_or_buffer)) {
-        if (!reader.load(std::get<std::string>(file_or_buffer))) {
-            throw std::runtime_error("Can't process ELF file " + std::get<std::string>(file_or_buffer));
-        }
-    } else {
-        std::stringstream buffer_stream(std::string(
-            std::get<std::vector<uint8_t>>(file_or_buffer).begin(),
-            std::get<std::vector<uint8_t>>(file_or_buffer).end()));
-        if (!reader.load(buffer_stream)) {
-            throw std::runtime_error("Can't process ELF file from memory");
-        }
-    }
-
-    ELFIO::const_symbol_section_accessor symbols{reader, reader.sections[".symtab"]};
-    _get_map_names(reader, symbols, map_names);
-}
-
-static void
-_preprocess_btf_resolved_functions(std::istream& stream, _In_z_ const char* stream_name);
+_preprocess_btf_resolved_functions(elf_image_t& image);
 
 _Must_inspect_result_ ebpf_result_t
 load_byte_code(
@@ -428,63 +352,41 @@ load_byte_code(
         }
 
         std::vector<prevail::RawProgram> raw_programs;
-        std::vector<uint8_t> elf_data;
-        std::string object_name;
+        std::unique_ptr<elf_image_t> image;
 
-        // Convert file path to buffer, or use the provided buffer directly.
+        // Map the file into memory, or use the provided buffer directly.
         if (std::holds_alternative<std::string>(file_or_buffer)) {
             const std::string& file_path = std::get<std::string>(file_or_buffer);
-            object_name = file_path;
-
-            std::ifstream file_stream(file_path, std::ios::binary | std::ios::ate);
-            if (!file_stream) {
-                *error_message = allocate_string(std::string("error: failed to open file: ") + file_path);
-                result = EBPF_FILE_NOT_FOUND;
-                goto Exit;
-            }
-            std::streamsize file_size = file_stream.tellg();
-            if (file_size < 0 || !file_stream) {
-                *error_message = allocate_string(std::string("error: failed to determine file size: ") + file_path);
-                result = EBPF_FILE_NOT_FOUND;
-                goto Exit;
-            }
-            file_stream.seekg(0, std::ios::beg);
-            if (!file_stream) {
-                *error_message = allocate_string(std::string("error: failed to seek in file: ") + file_path);
-                result = EBPF_FILE_NOT_FOUND;
-                goto Exit;
-            }
-            elf_data.resize(static_cast<size_t>(file_size));
-            if (!file_stream.read(reinterpret_cast<char*>(elf_data.data()), file_size)) {
-                *error_message = allocate_string(std::string("error: failed to read file: ") + file_path);
+            try {
+                image = elf_image_t::open_file(file_path.c_str());
+            } catch (const std::runtime_error& e) {
+                *error_message = allocate_string(std::string("error: ") + e.what());
                 result = EBPF_FILE_NOT_FOUND;
                 goto Exit;
             }
         } else {
-            elf_data = std::get<std::vector<uint8_t>>(file_or_buffer);
-            object_name = "memory";
+            const std::vector<uint8_t>& buffer = std::get<std::vector<uint8_t>>(file_or_buffer);
+            image = elf_image_t::open_memory(buffer.data(), buffer.size(), "memory");
         }
 
         // Validate the ELF structure before passing to ELFIO to prevent crashes
         // from malformed ELF files (e.g., invalid relocation sections).
-        if (elf_data.size() > UINT32_MAX) {
-            *error_message = allocate_string(std::string("error: ELF file ") + object_name + " is too large");
+        if (image->size() > UINT32_MAX) {
+            *error_message = allocate_string(std::string("error: ELF file ") + image->name() + " is too large");
             result = EBPF_ELF_PARSING_FAILED;
             goto Exit;
         }
-        if (!ElfCheckElf(elf_data.size(), elf_data.data(), static_cast<uint32_t>(elf_data.size()))) {
+        if (!ElfCheckElf(image->size(), const_cast<uint8_t*>(image->data()), static_cast<uint32_t>(image->size()))) {
             *error_message = allocate_string(
-                std::string("error: ELF file ") + object_name + " is malformed: " + _elf_everparse_error);
+                std::string("error: ELF file ") + image->name() + " is malformed: " + _elf_everparse_error);
             result = EBPF_ELF_PARSING_FAILED;
             goto Exit;
         }
 
-        std::stringstream elf_stream(std::string(elf_data.begin(), elf_data.end()));
-
         clear_program_info_cache();
-        _preprocess_btf_resolved_functions(elf_stream, object_name.c_str());
+        _preprocess_btf_resolved_functions(*image);
 
-        raw_programs = read_elf(elf_stream, object_name, section_name_string, "", verifier_options, platform);
+        raw_programs = read_elf(image->stream(), image->name(), section_name_string, "", verifier_options, platform);
 
         if (raw_programs.size() == 0) {
             result = EBPF_ELF_PARSING_FAILED;
@@ -539,7 +441,7 @@ load_byte_code(
             program = nullptr;
         }
 
-        _get_map_names(file_or_buffer, map_names);
+        _get_map_names(*image, map_names);
 
         auto map_descriptors = get_all_map_descriptors();
         size_t anonymous_map_count = 0;
@@ -674,15 +576,17 @@ ebpf_api_elf_enumerate_programs(
     ebpf_clear_thread_local_storage();
 
     try {
-        std::ifstream file_stream(file, std::ios::binary);
-        if (!file_stream) {
-            throw std::runtime_error(std::string("No such file or directory opening ") + file);
-        }
+        std::unique_ptr<elf_image_t> image = elf_image_t::open_file(file);
 
-        _preprocess_btf_resolved_functions(file_stream, file);
+        _preprocess_btf_resolved_functions(*image);
 
         auto raw_programs = prevail::read_elf(
-            file_stream, file, section ? std::string(section) : std::string(), string(), verifier_options, platform);
+            image->stream(),
+            file,
+            section ? std::string(section) : std::string(),
+            string(),
+            verifier_options,
+            platform);
         for (const auto& raw_program : raw_programs) {
             info = (ebpf_api_program_info_t*)ebpf_allocate_with_tag(sizeof(*info), EBPF_POOL_TAG_DEFAULT);
             if (info == nullptr) {
@@ -776,14 +680,11 @@ ebpf_api_elf_disassemble_program(
 
     try {
         std::string section(section_name ? section_name : "");
-        std::ifstream file_stream(file, std::ios::binary);
-        if (!file_stream) {
-            throw std::runtime_error(std::string("No such file or directory opening ") + file);
-        }
+        std::unique_ptr<elf_image_t> image = elf_image_t::open_file(file);
 
-        _preprocess_btf_resolved_functions(file_stream, file);
+        _preprocess_btf_resolved_functions(*image);
 
-        auto raw_programs = read_elf(file_stream, file, section, string(), verifier_options, platform);
+        auto raw_programs = read_elf(image->stream(), file, section, string(), verifier_options, platform);
         auto found_program =
             std::find_if(raw_programs.begin(), raw_programs.end(), [&program_name](const prevail::RawProgram& program) {
                 return (program_name == nullptr) || (program.function_name == program_name);
@@ -823,34 +724,16 @@ ebpf_api_elf_disassemble_program(
 }
 
 static void
-_preprocess_btf_resolved_functions(std::istream& stream, _In_z_ const char* stream_name)
+_preprocess_btf_resolved_functions(elf_image_t& image)
 {
-    stream.clear();
-    stream.seekg(0, std::ios::beg);
-    if (!stream) {
-        throw std::runtime_error(std::string("Failed to seek stream for BTF preprocessing: ") + stream_name);
-    }
-
-    ELFIO::elfio reader;
-    if (!reader.load(stream)) {
-        throw std::runtime_error(std::string("Failed to load ELF for BTF preprocessing: ") + stream_name);
-    }
-    ELFIO::section* btf_section = reader.sections[".BTF"];
-    if (btf_section != nullptr && btf_section->get_data() != nullptr) {
-        std::optional<libbtf::btf_type_data> btf_data = vector_of<byte>(*btf_section);
-        cache_btf_resolved_functions(btf_data.value());
-    }
-
-    stream.clear();
-    stream.seekg(0, std::ios::beg);
-    if (!stream) {
-        throw std::runtime_error(std::string("Failed to seek stream before verification: ") + stream_name);
+    const libbtf::btf_type_data* btf_data = image.btf();
+    if (btf_data != nullptr) {
+        cache_btf_resolved_functions(*btf_data);
     }
 }
 
-static _Success_(return == 0) uint32_t _ebpf_api_elf_verify_program_from_stream(
-    std::istream& stream,
-    _In_z_ const char* stream_name,
+static _Success_(return == 0) uint32_t _ebpf_api_elf_verify_program_from_image(
+    elf_image_t& image,
     _In_opt_z_ const char* section_name, // Section name, or null to look in all sections.
     _In_opt_z_ const char* program_name, // Program name, or null to use the first program.
     ebpf_verification_verbosity_t verbosity,
@@ -867,14 +750,16 @@ static _Success_(return == 0) uint32_t _ebpf_api_elf_verify_program_from_stream(
     try {
         const prevail::ebpf_platform_t* platform = &g_ebpf_platform_windows;
         prevail::VerifierOptions verifier_options = ebpf_get_default_verifier_options(verbosity);
-        if (!stream) {
-            throw std::runtime_error(std::string("No such file or directory opening ") + stream_name);
-        }
 
-        _preprocess_btf_resolved_functions(stream, stream_name);
+        _preprocess_btf_resolved_functions(image);
 
         auto raw_programs = read_elf(
-            stream, stream_name, (section_name != nullptr ? section_name : ""), string(), verifier_options, platform);
+            image.stream(),
+            image.name(),
+            (section_name != nullptr ? section_name : ""),
+            string(),
+            verifier_options,
+            platform);
         std::optional<prevail::RawProgram> found_program;
         for (auto& program : raw_programs) {
             if ((program_name == nullptr) || (program.function_name == program_name)) {
@@ -931,7 +816,7 @@ static _Success_(return == 0) uint32_t _ebpf_api_elf_verify_program_from_stream(
         *error_message = allocate_string(error.str());
         return 1;
     } catch (std::exception ex) {
-        error << "Failed to load eBPF program from " << stream_name;
+        error << "Failed to load eBPF program from " << image.name();
         *error_message = allocate_string(error.str());
         return 1;
     }
@@ -939,32 +824,8 @@ static _Success_(return == 0) uint32_t _ebpf_api_elf_verify_program_from_stream(
     return 0;
 }
 
-static uint32_t
-_load_file_to_memory(
-    _In_ const std::string& path,
-    _Out_ std::string& data,
-    _Outptr_result_maybenull_z_ const char** error_message) noexcept
-{
-    data = "";
-    struct stat st;
-    if (stat(path.c_str(), &st)) {
-        *error_message = allocate_string(std::string("error: No such file or directory opening ") + path);
-        return 1;
-    }
-    if (std::ifstream stream{path, std::ios::in | std::ios::binary}) {
-        data.resize(st.st_size);
-        if (stream.read(data.data(), data.size())) {
-            *error_message = nullptr;
-            return 0;
-        }
-    }
-    *error_message = allocate_string(std::string("error: Failed to read file: ") + path);
-    return 1;
-}
-
-static _Success_(return == 0) uint32_t _verify_program_from_string(
-    std::string data,
-    _In_z_ const char* name,
+static _Success_(return == 0) uint32_t _verify_program_from_image(
+    elf_image_t& image,
     _In_opt_z_ const char* section_name,
     _In_opt_z_ const char* program_name,
     _In_opt_ const ebpf_program_type_t* program_type,
@@ -976,26 +837,22 @@ static _Success_(return == 0) uint32_t _verify_program_from_string(
     *error_message = nullptr;
     *report = nullptr;
 
-    if (!ElfCheckElf(
-            data.size(),
-            const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(data.data())),
-            static_cast<uint32_t>(data.size()))) {
+    if (image.size() > UINT32_MAX ||
+        !ElfCheckElf(image.size(), const_cast<uint8_t*>(image.data()), static_cast<uint32_t>(image.size()))) {
 
         *error_message =
-            allocate_string(std::string("error: ELF file ") + name + " is malformed: " + _elf_everparse_error);
+            allocate_string(std::string("error: ELF file ") + image.name() + " is malformed: " + _elf_everparse_error);
         return 1;
     }
 
-    auto stream = std::stringstream(data);
-
     // Clear thread local storage before calling into the verifier.
     // Note that TLS should be cleared here *before* calling into the verifier, not after.
     // Post verification, bpf2c relies on the TLS cache to compute program info hash.
     ebpf_clear_thread_local_storage();
 
     set_global_program_and_attach_type(program_type, nullptr);
-    return _ebpf_api_elf_verify_program_from_stream(
-        stream, name, section_name, program_name, verbosity, report, error_message, stats);
+    return _ebpf_api_elf_verify_program_from_image(
+        image, section_name, program_name, verbosity, report, error_message, stats);
 }
 
 _Success_(return == 0) uint32_t ebpf_api_elf_verify_program_from_file(
@@ -1010,13 +867,17 @@ _Success_(return == 0) uint32_t ebpf_api_elf_verify_program_from_file(
 {
     *error_message = nullptr;
     *report = nullptr;
-    std::string data;
-    uint32_t error = _load_file_to_memory(file, data, error_message);
-    if (error) {
-        return error;
+    std::unique_ptr<elf_image_t> image;
+    try {
+        image = elf_image_t::open_file(file);
+    } catch (const std::runtime_error& e) {
+        *error_message = allocate_string(std::string("error: ") + e.what());
+        return 1;
+    } catch (const std::bad_alloc&) {
+        return 1;
     }
-    return _verify_program_from_string(
-        data, file, section_name, program_name, program_type, verbosity, report, error_message, stats);
+    return _verify_program_from_image(
+        *image, section_name, program_name, program_type, verbosity, report, error_message, stats);
 }
 
 _Success_(return == 0) uint32_t ebpf_api_elf_verify_program_from_memory(
@@ -1030,14 +891,14 @@ _Success_(return == 0) uint32_t ebpf_api_elf_verify_program_from_memory(
     _Outptr_result_maybenull_z_ const char** error_message,
     _Out_opt_ ebpf_api_verifier_stats_t* stats) noexcept
 {
-    return _verify_program_from_string(
-        std::string(data, data_length),
-        "memory",
-        section_name,
-        program_name,
-        program_type,
-        verbosity,
-        report,
-        error_message,
-        stats);
+    *error_message = nullptr;
+    *report = nullptr;
+    std::unique_ptr<elf_image_t> image;
+    try {
+        image = elf_image_t::open_memory(reinterpret_cast<const uint8_t*>(data), data_length, "memory");
+    } catch (const std::bad_alloc&) {
+        return 1;
+    }
+    return _verify_program_from_image(
+        *image, section_name, program_name, program_type, verbosity, report, error_message, stats);
 }
@@ -333,6 +333,21 @@ ebpf_map_delete_element_batch(fd_t map_fd, _In_ const void* keys, _Inout_ uint32
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_lookup_element(fd_t map_fd, _In_opt_ const void* key, _Out_ void* value) noexcept;
 
+/**
+ * @brief Look up an element in an eBPF map.
+ *
+ * @param[in] map_fd File descriptor for the eBPF map.
+ * @param[in] key Pointer to buffer containing key.
+ * @param[out] value Pointer to buffer that contains value on success.
+ * @param[in] flags Zero, or one of EBPF_F_PERCPU_SUM, EBPF_F_PERCPU_MIN or EBPF_F_PERCPU_MAX to reduce the per-CPU
+ *  values of a per-CPU map to a single value in the kernel; value then holds a single CPU's value.
+ *
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_INVALID_ARGUMENT One or more parameters are wrong, or the map does not support the flags.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_lookup_element_flags(fd_t map_fd, _In_opt_ const void* key, _Out_ void* value, uint64_t flags) noexcept;
+
 /**
  * @brief Fetch the next batch of keys and values from an eBPF map.
  *  For a singleton map, return the value for the given key.
@@ -345,7 +360,8 @@ ebpf_map_lookup_element(fd_t map_fd, _In_opt_ const void* key, _Out_ void* value
  * @param[out] values Pointer to buffer that contains values on success.
  * @param[in, out] count On input, contains the maximum number of elements to
  * return. On output, contains the actual number of elements returned.
- * @param[in] flags Flags to control the behavior of the API.
+ * @param[in] flags Zero, or one of EBPF_F_PERCPU_SUM, EBPF_F_PERCPU_MIN or EBPF_F_PERCPU_MAX to reduce the per-CPU
+ * values of a per-CPU map in the kernel, in which case each entry in values is a single CPU's value.
  *
  * @retval EBPF_SUCCESS The operation was successful.
  * @retval EBPF_NO_MORE_KEYS The end of the map has been reached.
@@ -389,7 +405,8 @@ ebpf_map_lookup_and_delete_element(fd_t map_fd, _In_opt_ const void* key, _Out_
  * @param[out] values Pointer to buffer that contains values on success.
  * @param[in, out] count On input, contains the maximum number of elements to
  * return. On output, contains the actual number of elements returned.
- * @param[in] flags Flags to control the behavior of the API.
+ * @param[in] flags Zero, or one of EBPF_F_PERCPU_SUM, EBPF_F_PERCPU_MIN or EBPF_F_PERCPU_MAX to reduce the per-CPU
+ * values of a per-CPU map in the kernel, in which case each entry in values is a single CPU's value.
  *
  * @retval EBPF_SUCCESS The operation was successful.
  * @retval EBPF_NO_MORE_KEYS The end of the map has been reached.
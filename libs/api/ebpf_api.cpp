@@ -25,6 +25,7 @@
 #include "libbpf.h"
 #pragma warning(pop)
 #include "map_descriptors.hpp"
+#include "pcap_reader.h"
 #define _PEPARSE_WINDOWS_CONFLICTS
 #include "pe-parse/parse.h"
 #include "rpc_client.h"
@@ -41,13 +42,16 @@ typedef unsigned char boolean;
 #include "windows_platform_common.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <codecvt>
 #include <cstdint>
 #include <fcntl.h>
 #include <functional>
 #include <io.h>
+#include <memory>
 #include <mutex>
 #include <rpc.h>
+#include <thread>
 
 using namespace peparse;
 using namespace Platform;
@@ -59,8 +63,121 @@ const GUID GUID_NULL = {0, 0, 0, {0, 0, 0, 0, 0, 0, 0, 0}};
 #define MAX_CODE_SIZE (32 * 1024) // 32 KB
 
 static std::mutex _ebpf_state_mutex;
-_Guarded_by_(_ebpf_state_mutex) static std::map<ebpf_handle_t, ebpf_program_t*> _ebpf_programs;
-_Guarded_by_(_ebpf_state_mutex) static std::map<ebpf_handle_t, ebpf_map_t*> _ebpf_maps;
+
+/**
+ * @brief Table of the programs or maps of this process, keyed by handle. Finding an object takes no lock, so threads
+ * that translate handles on every map or program operation do not contend with each other. Insertions and removals
+ * are rare and must hold _ebpf_state_mutex.
+ *
+ * Handle values are small and reused by the system, so the table is indexed directly by handle value through a
+ * directory of pages of atomic slots. Pages are allocated when first needed and kept until the table is destroyed,
+ * because readers may be accessing them at any time. The few handles beyond the range of the directory are kept in
+ * a map that is searched under _ebpf_state_mutex.
+ *
+ * @tparam T Type of the objects in the table.
+ */
+template <typename T> class _ebpf_handle_table
+{
+  public:
+    /**
+     * @brief Find the object with the given handle.
+     *
+     * @param[in] handle Handle of the object.
+     * @returns Pointer to the object, or nullptr if no object in the table has this handle.
+     */
+    _Requires_lock_not_held_(_ebpf_state_mutex) _Ret_maybenull_ T* find(ebpf_handle_t handle) const noexcept(false)
+    {
+        uintptr_t index = static_cast<uintptr_t>(handle);
+        if (index >= _page_count * _page_size) {
+            std::unique_lock lock(_ebpf_state_mutex);
+            auto it = _large_handles.find(handle);
+            return (it != _large_handles.end()) ? it->second : nullptr;
+        }
+        std::atomic<T*>* page = _directory[index / _page_size].load(std::memory_order_acquire);
+        if (page == nullptr) {
+            return nullptr;
+        }
+        return page[index % _page_size].load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Add an object to the table. An object whose handle is already in the table is ignored.
+     *
+     * @param[in] handle Handle of the object.
+     * @param[in] object Object to add.
+     * @exception std::bad_alloc Memory for the slot could not be allocated.
+     */
+    _Requires_lock_held_(_ebpf_state_mutex) void insert(ebpf_handle_t handle, _In_ T* object) noexcept(false)
+    {
+        std::atomic<T*>* slot = _get_slot(handle, true);
+        if (slot == nullptr) {
+            if (_large_handles.insert(std::pair<ebpf_handle_t, T*>(handle, object)).second) {
+                _count++;
+            }
+        } else if (slot->load(std::memory_order_relaxed) == nullptr) {
+            slot->store(object, std::memory_order_release);
+            _count++;
+        }
+    }
+
+    /**
+     * @brief Remove the object with the given handle from the table, if any.
+     *
+     * @param[in] handle Handle of the object.
+     */
+    _Requires_lock_held_(_ebpf_state_mutex) void erase(ebpf_handle_t handle) noexcept
+    {
+        std::atomic<T*>* slot = _get_slot(handle, false);
+        if (slot == nullptr) {
+            _count -= _large_handles.erase(handle);
+        } else if (slot->load(std::memory_order_relaxed) != nullptr) {
+            slot->store(nullptr, std::memory_order_release);
+            _count--;
+        }
+    }
+
+    /**
+     * @brief Get the number of objects in the table.
+     */
+    _Requires_lock_held_(_ebpf_state_mutex) size_t size() const noexcept { return _count; }
+
+  private:
+    // 4096 pages of 4096 slots cover every handle value below 2^24.
+    static const size_t _page_size = 4096;
+    static const size_t _page_count = 4096;
+
+    // Returns nullptr if the handle is beyond the directory, or if it is within a missing page and allocate is false.
+    _Ret_maybenull_ std::atomic<T*>*
+    _get_slot(ebpf_handle_t handle, bool allocate) noexcept(false)
+    {
+        uintptr_t index = static_cast<uintptr_t>(handle);
+        if (index >= _page_count * _page_size) {
+            return nullptr;
+        }
+        std::atomic<T*>* page = _directory[index / _page_size].load(std::memory_order_relaxed);
+        if (page == nullptr) {
+            if (!allocate) {
+                return nullptr;
+            }
+            auto new_page = std::make_unique<std::atomic<T*>[]>(_page_size);
+            for (size_t i = 0; i < _page_size; i++) {
+                new_page[i].store(nullptr, std::memory_order_relaxed);
+            }
+            _pages.push_back(std::move(new_page));
+            page = _pages.back().get();
+            _directory[index / _page_size].store(page, std::memory_order_release);
+        }
+        return &page[index % _page_size];
+    }
+
+    std::atomic<std::atomic<T*>*> _directory[_page_count] = {};
+    std::vector<std::unique_ptr<std::atomic<T*>[]>> _pages;
+    std::map<ebpf_handle_t, T*> _large_handles;
+    size_t _count = 0;
+};
+
+static _ebpf_handle_table<ebpf_program_t> _ebpf_programs;
+static _ebpf_handle_table<ebpf_map_t> _ebpf_maps;
 _Guarded_by_(_ebpf_state_mutex) static std::vector<ebpf_object_t*> _ebpf_objects;
 
 #define DEFAULT_PIN_ROOT_PATH "/ebpf/global"
@@ -221,12 +338,7 @@ _Requires_lock_not_held_(_ebpf_state_mutex) inline static ebpf_map_t* _get_ebpf_
 
     ebpf_assert(map_handle != ebpf_handle_invalid);
 
-    ebpf_map_t* map = nullptr;
-    std::unique_lock lock(_ebpf_state_mutex);
-    std::map<ebpf_handle_t, ebpf_map_t*>::iterator it = _ebpf_maps.find(map_handle);
-    if (it != _ebpf_maps.end()) {
-        map = it->second;
-    }
+    ebpf_map_t* map = _ebpf_maps.find(map_handle);
 
     EBPF_RETURN_POINTER(ebpf_map_t*, map);
 }
@@ -238,12 +350,7 @@ _Requires_lock_not_held_(_ebpf_state_mutex) inline static ebpf_program_t* _get_e
     EBPF_LOG_ENTRY();
     ebpf_assert(program_handle != ebpf_handle_invalid);
 
-    std::unique_lock lock(_ebpf_state_mutex);
-    ebpf_program_t* program = nullptr;
-    std::map<ebpf_handle_t, ebpf_program_t*>::iterator it = _ebpf_programs.find(program_handle);
-    if (it != _ebpf_programs.end()) {
-        program = it->second;
-    }
+    ebpf_program_t* program = _ebpf_programs.find(program_handle);
 
     EBPF_RETURN_POINTER(ebpf_program_t*, program);
 }
@@ -283,6 +390,7 @@ static ebpf_result_t
 _create_map(
     _In_opt_z_ const char* name,
     _In_ const ebpf_map_definition_in_memory_t* map_definition,
+    uint32_t map_flags,
     ebpf_handle_t inner_map_handle,
     _Out_ ebpf_handle_t* map_handle) NO_EXCEPT_TRY
 {
@@ -291,10 +399,9 @@ _create_map(
     ebpf_result_t result = EBPF_SUCCESS;
     uint32_t return_value = ERROR_SUCCESS;
     ebpf_protocol_buffer_t request_buffer;
-    _ebpf_operation_create_map_request* request;
-    ebpf_operation_create_map_reply_t reply;
     std::string map_name;
     size_t map_name_size;
+    size_t data_offset;
 
     ebpf_assert(map_definition);
     ebpf_assert(map_handle);
@@ -305,32 +412,56 @@ _create_map(
     *map_handle = ebpf_handle_invalid;
     map_name_size = map_name.size();
 
+    // Maps without flags use the original operation, so they can still be created with older drivers.
+    data_offset = (map_flags == 0) ? offsetof(ebpf_operation_create_map_request_t, data)
+                                   : offsetof(ebpf_operation_create_map_with_flags_request_t, data);
     size_t buffer_size = 0;
-    result = ebpf_safe_size_t_add(offsetof(ebpf_operation_create_map_request_t, data), map_name_size, &buffer_size);
+    result = ebpf_safe_size_t_add(data_offset, map_name_size, &buffer_size);
     if (result != EBPF_SUCCESS) {
         goto Exit;
     }
 
     request_buffer.resize(buffer_size);
+    std::copy(map_name.begin(), map_name.end(), request_buffer.begin() + data_offset);
 
-    request = reinterpret_cast<ebpf_operation_create_map_request_t*>(request_buffer.data());
-    request->header.id = ebpf_operation_id_t::EBPF_OPERATION_CREATE_MAP;
-    result = ebpf_safe_size_t_to_uint16(request_buffer.size(), &request->header.length);
-    if (result != EBPF_SUCCESS) {
-        goto Exit;
-    }
-    request->ebpf_map_definition = *map_definition;
-    request->inner_map_handle = (uint64_t)inner_map_handle;
-    std::copy(
-        map_name.begin(), map_name.end(), request_buffer.begin() + offsetof(ebpf_operation_create_map_request_t, data));
+    if (map_flags == 0) {
+        auto request = reinterpret_cast<ebpf_operation_create_map_request_t*>(request_buffer.data());
+        ebpf_operation_create_map_reply_t reply;
+        request->header.id = ebpf_operation_id_t::EBPF_OPERATION_CREATE_MAP;
+        result = ebpf_safe_size_t_to_uint16(request_buffer.size(), &request->header.length);
+        if (result != EBPF_SUCCESS) {
+            goto Exit;
+        }
+        request->ebpf_map_definition = *map_definition;
+        request->inner_map_handle = (uint64_t)inner_map_handle;
 
-    return_value = invoke_ioctl(request_buffer, reply);
-    if (return_value != ERROR_SUCCESS) {
-        result = win32_error_code_to_ebpf_result(return_value);
-        goto Exit;
+        return_value = invoke_ioctl(request_buffer, reply);
+        if (return_value != ERROR_SUCCESS) {
+            result = win32_error_code_to_ebpf_result(return_value);
+            goto Exit;
+        }
+        ebpf_assert(reply.header.id == ebpf_operation_id_t::EBPF_OPERATION_CREATE_MAP);
+        *map_handle = reply.handle;
+    } else {
+        auto request = reinterpret_cast<ebpf_operation_create_map_with_flags_request_t*>(request_buffer.data());
+        ebpf_operation_create_map_with_flags_reply_t reply;
+        request->header.id = ebpf_operation_id_t::EBPF_OPERATION_CREATE_MAP_WITH_FLAGS;
+        result = ebpf_safe_size_t_to_uint16(request_buffer.size(), &request->header.length);
+        if (result != EBPF_SUCCESS) {
+            goto Exit;
+        }
+        request->ebpf_map_definition = *map_definition;
+        request->inner_map_handle = (uint64_t)inner_map_handle;
+        request->map_flags = map_flags;
+
+        return_value = invoke_ioctl(request_buffer, reply);
+        if (return_value != ERROR_SUCCESS) {
+            result = win32_error_code_to_ebpf_result(return_value);
+            goto Exit;
+        }
+        ebpf_assert(reply.header.id == ebpf_operation_id_t::EBPF_OPERATION_CREATE_MAP_WITH_FLAGS);
+        *map_handle = reply.handle;
     }
-    ebpf_assert(reply.header.id == ebpf_operation_id_t::EBPF_OPERATION_CREATE_MAP);
-    *map_handle = reply.handle;
 
 Exit:
     EBPF_RETURN_RESULT(result);
@@ -355,7 +486,12 @@ ebpf_map_create(
 
     ebpf_assert(map_fd);
 
-    if (opts && (opts->map_flags != 0 || opts->numa_node != 0 || opts->map_ifindex != 0)) {
+    if (opts && (opts->numa_node != 0 || opts->map_ifindex != 0)) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Exit;
+    }
+    // Only the values of array maps can be mapped into user mode.
+    if (opts && opts->map_flags != 0 && (opts->map_flags != BPF_F_MMAPABLE || map_type != BPF_MAP_TYPE_ARRAY)) {
         result = EBPF_INVALID_ARGUMENT;
         goto Exit;
     }
@@ -372,7 +508,7 @@ ebpf_map_create(
         inner_map_handle = (opts && opts->inner_map_fd != 0) ? _get_handle_from_file_descriptor(opts->inner_map_fd)
                                                              : ebpf_handle_invalid;
 
-        result = _create_map(map_name, &map_definition, inner_map_handle, &map_handle);
+        result = _create_map(map_name, &map_definition, opts ? opts->map_flags : 0, inner_map_handle, &map_handle);
         if (result != EBPF_SUCCESS) {
             goto Exit;
         }
@@ -399,10 +535,33 @@ Exit:
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+/**
+ * @brief Convert the EBPF_F_PERCPU_* lookup flags to the EBPF_MAP_FIND_ELEMENT_FLAG_* flags of a request.
+ */
+static uint8_t
+_get_find_flags(uint64_t flags)
+{
+    uint8_t find_flags = 0;
+    switch (flags & EBPF_F_PERCPU_AGGREGATE_MASK) {
+    case EBPF_F_PERCPU_SUM:
+        find_flags |= EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_SUM;
+        break;
+    case EBPF_F_PERCPU_MIN:
+        find_flags |= EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MIN;
+        break;
+    case EBPF_F_PERCPU_MAX:
+        find_flags |= EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MAX;
+        break;
+    default:
+        break;
+    }
+    return find_flags;
+}
+
 static ebpf_result_t
 _map_lookup_element(
     ebpf_handle_t handle,
-    bool find_and_delete,
+    uint8_t find_flags,
     uint32_t key_size,
     _In_reads_opt_(key_size) const uint8_t* key,
     uint32_t value_size,
@@ -436,7 +595,7 @@ _map_lookup_element(
             goto Exit;
         }
         request->header.id = ebpf_operation_id_t::EBPF_OPERATION_MAP_FIND_ELEMENT;
-        request->find_and_delete = find_and_delete;
+        request->flags = find_flags;
         request->handle = handle;
         if (key_size > 0) {
             std::copy(key, key + key_size, request->key);
@@ -506,7 +665,7 @@ Exit:
 CATCH_NO_MEMORY_EBPF_RESULT
 
 static ebpf_result_t
-_ebpf_map_lookup_element_helper(fd_t map_fd, bool find_and_delete, _In_opt_ const void* key, _Out_ void* value)
+_ebpf_map_lookup_element_helper(fd_t map_fd, uint8_t find_flags, _In_opt_ const void* key, _Out_ void* value)
     NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
@@ -536,7 +695,8 @@ _ebpf_map_lookup_element_helper(fd_t map_fd, bool find_and_delete, _In_opt_ cons
         goto Exit;
     }
     assert(value_size != 0);
-    if (BPF_MAP_TYPE_PER_CPU(type)) {
+    // An aggregated value is the size of the value of a single CPU.
+    if (BPF_MAP_TYPE_PER_CPU(type) && !(find_flags & EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MASK)) {
         if (ebpf_safe_uint32_t_multiply(EBPF_PAD_8(value_size), libbpf_num_possible_cpus(), &value_size) !=
             EBPF_SUCCESS) {
             result = EBPF_ARITHMETIC_OVERFLOW;
@@ -544,7 +704,7 @@ _ebpf_map_lookup_element_helper(fd_t map_fd, bool find_and_delete, _In_opt_ cons
         }
     }
 
-    result = _map_lookup_element(map_handle, find_and_delete, key_size, (uint8_t*)key, value_size, (uint8_t*)value);
+    result = _map_lookup_element(map_handle, find_flags, key_size, (uint8_t*)key, value_size, (uint8_t*)value);
     if (result != EBPF_SUCCESS) {
         goto Exit;
     }
@@ -554,6 +714,32 @@ Exit:
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+/**
+ * @brief Store the length of a batch request in its header. A request or reply that does not fit in a 16-bit length
+ * is sent as a large message, which carries the upper bits of the length in the header padding.
+ *
+ * @param[in, out] request_buffer The request to update.
+ * @param[in] reply_size Size of the reply buffer.
+ * @param[out] large_message Set to true if the request must be sent as a large message.
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_INVALID_ARGUMENT The request or reply is larger than EBPF_MAX_LARGE_MESSAGE_LENGTH.
+ */
+static _Must_inspect_result_ ebpf_result_t
+_set_batch_request_length(_Inout_ ebpf_protocol_buffer_t& request_buffer, size_t reply_size, _Out_ bool* large_message)
+{
+    auto header = reinterpret_cast<ebpf_operation_large_header_t*>(request_buffer.data());
+    size_t request_size = request_buffer.size();
+
+    if (request_size > EBPF_MAX_LARGE_MESSAGE_LENGTH || reply_size > EBPF_MAX_LARGE_MESSAGE_LENGTH) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    header->length = static_cast<uint16_t>(request_size & UINT16_MAX);
+    header->length_high = static_cast<uint16_t>(request_size >> 16);
+    *large_message = (header->length_high != 0) || (reply_size > UINT16_MAX);
+    return EBPF_SUCCESS;
+}
+
 static _Must_inspect_result_ ebpf_result_t
 _ebpf_map_lookup_element_batch_helper(
     fd_t map_fd,
@@ -562,10 +748,11 @@ _ebpf_map_lookup_element_batch_helper(
     _Out_ void* keys,
     _Out_ void* values,
     _Inout_ uint32_t* count,
-    bool find_and_delete) NO_EXCEPT_TRY
+    uint8_t find_flags) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
     ebpf_result_t result = EBPF_SUCCESS;
+    bool find_and_delete = (find_flags & EBPF_MAP_FIND_ELEMENT_FLAG_DELETE) != 0;
     ebpf_handle_t map_handle = ebpf_handle_invalid;
     uint32_t key_size_u32 = 0;
     uint32_t value_size_u32 = 0;
@@ -610,7 +797,8 @@ _ebpf_map_lookup_element_batch_helper(
         goto Exit;
     }
 
-    if (BPF_MAP_TYPE_PER_CPU(type)) {
+    // An aggregated value is the size of the value of a single CPU.
+    if (BPF_MAP_TYPE_PER_CPU(type) && !(find_flags & EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MASK)) {
         result = ebpf_safe_size_t_multiply(EBPF_PAD_8(value_size), libbpf_num_possible_cpus(), &value_size);
         if (result != EBPF_SUCCESS) {
             goto Exit;
@@ -623,7 +811,8 @@ _ebpf_map_lookup_element_batch_helper(
     }
 
     // Compute the maximum number of entries that can be updated in a single batch.
-    max_entries_per_batch = UINT16_MAX - EBPF_OFFSET_OF(_ebpf_operation_map_get_next_key_value_batch_reply, data);
+    max_entries_per_batch =
+        EBPF_MAX_LARGE_MESSAGE_LENGTH - EBPF_OFFSET_OF(_ebpf_operation_map_get_next_key_value_batch_reply, data);
     max_entries_per_batch /= entry_size;
     if (max_entries_per_batch == 0) {
         result = EBPF_INVALID_ARGUMENT;
@@ -634,6 +823,7 @@ _ebpf_map_lookup_element_batch_helper(
         // Fetch the next batch of entries.
         size_t entries_to_fetch = std::min(input_count - count_returned, max_entries_per_batch);
         size_t request_buffer_size = 0;
+        size_t reply_length = 0;
         size_t reply_data_length = 0;
         size_t reply_buffer_size = 0;
         size_t entries_byte_count = 0;
@@ -663,25 +853,35 @@ _ebpf_map_lookup_element_batch_helper(
         auto request = reinterpret_cast<_ebpf_operation_map_get_next_key_value_batch_request*>(request_buffer.data());
         ebpf_protocol_buffer_t reply_buffer(reply_buffer_size);
         auto reply = reinterpret_cast<_ebpf_operation_map_get_next_key_value_batch_reply*>(reply_buffer.data());
+        bool large_message = false;
 
-        result = ebpf_safe_size_t_to_uint16(request_buffer.size(), &request->header.length);
+        result = _set_batch_request_length(request_buffer, reply_buffer.size(), &large_message);
         if (result != EBPF_SUCCESS) {
             goto Exit;
         }
         request->header.id = ebpf_operation_id_t::EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH;
         request->handle = map_handle;
-        request->find_and_delete = find_and_delete;
+        request->flags = find_flags;
         if (previous_key) {
             std::copy(previous_key, previous_key + key_size, request->previous_key);
         }
 
-        result = win32_error_code_to_ebpf_result(invoke_ioctl(request_buffer, reply_buffer));
+        uint32_t error = large_message ? invoke_large_ioctl(request_buffer, reply_buffer)
+                                       : invoke_ioctl(request_buffer, reply_buffer);
+        result = win32_error_code_to_ebpf_result(error);
         if (result != EBPF_SUCCESS) {
             goto Exit;
         }
 
+        // A large reply carries the upper bits of its length in the header padding.
+        reply_length = reply->header.length;
+        if (large_message) {
+            reply_length |= static_cast<size_t>(reinterpret_cast<ebpf_operation_large_header_t*>(reply)->length_high)
+                            << 16;
+        }
+
         result = ebpf_safe_size_t_subtract(
-            reply->header.length,
+            reply_length,
             EBPF_OFFSET_OF(_ebpf_operation_map_get_next_key_value_batch_reply, data),
             &reply_data_length);
         if (result != EBPF_SUCCESS) {
@@ -775,7 +975,20 @@ ebpf_map_lookup_element(fd_t map_fd, _In_opt_ const void* key, _Out_ void* value
 {
     EBPF_LOG_ENTRY();
     ebpf_assert(value);
-    auto result = _ebpf_map_lookup_element_helper(map_fd, false, key, value);
+    auto result = _ebpf_map_lookup_element_helper(map_fd, 0, key, value);
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_lookup_element_flags(fd_t map_fd, _In_opt_ const void* key, _Out_ void* value, uint64_t flags) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(value);
+    if ((flags & ~EBPF_F_PERCPU_AGGREGATE_MASK) != 0) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+    auto result = _ebpf_map_lookup_element_helper(map_fd, _get_find_flags(flags), key, value);
     EBPF_RETURN_RESULT(result);
 }
 CATCH_NO_MEMORY_EBPF_RESULT
@@ -784,7 +997,7 @@ _Must_inspect_result_ ebpf_result_t
 ebpf_map_lookup_and_delete_element(fd_t map_fd, _In_opt_ const void* key, _Out_ void* value) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
-    auto result = _ebpf_map_lookup_element_helper(map_fd, true, key, value);
+    auto result = _ebpf_map_lookup_element_helper(map_fd, EBPF_MAP_FIND_ELEMENT_FLAG_DELETE, key, value);
     EBPF_RETURN_RESULT(result);
 }
 CATCH_NO_MEMORY_EBPF_RESULT
@@ -800,11 +1013,11 @@ ebpf_map_lookup_element_batch(
     uint64_t flags) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
-    if (flags != 0) {
+    if ((flags & ~EBPF_F_PERCPU_AGGREGATE_MASK) != 0) {
         EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
     }
-    ebpf_result_t result =
-        _ebpf_map_lookup_element_batch_helper(map_fd, in_batch, out_batch, keys, values, count, false);
+    ebpf_result_t result = _ebpf_map_lookup_element_batch_helper(
+        map_fd, in_batch, out_batch, keys, values, count, _get_find_flags(flags));
     EBPF_RETURN_RESULT(result);
 }
 CATCH_NO_MEMORY_EBPF_RESULT
@@ -820,11 +1033,11 @@ ebpf_map_lookup_and_delete_element_batch(
     uint64_t flags) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
-    if (flags != 0) {
+    if ((flags & ~EBPF_F_PERCPU_AGGREGATE_MASK) != 0) {
         EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
     }
-    ebpf_result_t result =
-        _ebpf_map_lookup_element_batch_helper(map_fd, in_batch, out_batch, keys, values, count, true);
+    ebpf_result_t result = _ebpf_map_lookup_element_batch_helper(
+        map_fd, in_batch, out_batch, keys, values, count, _get_find_flags(flags) | EBPF_MAP_FIND_ELEMENT_FLAG_DELETE);
     EBPF_RETURN_RESULT(result);
 }
 CATCH_NO_MEMORY_EBPF_RESULT
@@ -900,6 +1113,7 @@ _update_map_element_batch(
     ebpf_protocol_buffer_t request_buffer;
     ebpf_operation_map_update_element_batch_request_t* request;
     ebpf_operation_map_update_element_batch_reply_t reply;
+    bool large_message = false;
     size_t input_count = *count;
     size_t max_entries_per_batch = 0;
     size_t entry_size = 0;
@@ -918,7 +1132,8 @@ _update_map_element_batch(
     }
 
     // Compute the maximum number of entries that can be updated in a single batch.
-    max_entries_per_batch = UINT16_MAX - EBPF_OFFSET_OF(ebpf_operation_map_update_element_batch_request_t, data);
+    max_entries_per_batch =
+        EBPF_MAX_LARGE_MESSAGE_LENGTH - EBPF_OFFSET_OF(ebpf_operation_map_update_element_batch_request_t, data);
     max_entries_per_batch /= entry_size;
     if (max_entries_per_batch == 0) {
         result = EBPF_INVALID_ARGUMENT;
@@ -943,7 +1158,7 @@ _update_map_element_batch(
             request_buffer.resize(request_buffer_size);
             request = reinterpret_cast<ebpf_operation_map_update_element_batch_request_t*>(request_buffer.data());
 
-            result = ebpf_safe_size_t_to_uint16(request_buffer.size(), &request->header.length);
+            result = _set_batch_request_length(request_buffer, sizeof(reply), &large_message);
             if (result != EBPF_SUCCESS) {
                 goto Exit;
             }
@@ -992,7 +1207,8 @@ _update_map_element_batch(
                 std::copy(source_value, source_value + value_size, destination_value);
             }
 
-            result = win32_error_code_to_ebpf_result(invoke_ioctl(request_buffer, reply));
+            result = win32_error_code_to_ebpf_result(
+                large_message ? invoke_large_ioctl(request_buffer, reply) : invoke_ioctl(request_buffer, reply));
             if (result != EBPF_SUCCESS) {
                 goto Exit;
             }
@@ -1269,6 +1485,7 @@ ebpf_map_delete_element_batch(fd_t map_fd, _In_ const void* keys, _Inout_ uint32
     ebpf_protocol_buffer_t request_buffer;
     ebpf_operation_map_delete_element_batch_request_t* request;
     ebpf_operation_map_delete_element_batch_reply_t reply;
+    bool large_message = false;
     size_t key_size;
     size_t value_size;
     size_t input_count = *count;
@@ -1303,7 +1520,8 @@ ebpf_map_delete_element_batch(fd_t map_fd, _In_ const void* keys, _Inout_ uint32
     assert(value_size != 0);
 
     // Compute the maximum number of entries that can be updated in a single batch.
-    max_entries_per_batch = UINT16_MAX - EBPF_OFFSET_OF(ebpf_operation_map_delete_element_batch_request_t, keys);
+    max_entries_per_batch =
+        EBPF_MAX_LARGE_MESSAGE_LENGTH - EBPF_OFFSET_OF(ebpf_operation_map_delete_element_batch_request_t, keys);
     max_entries_per_batch /= key_size;
 
     if (max_entries_per_batch == 0) {
@@ -1331,7 +1549,7 @@ ebpf_map_delete_element_batch(fd_t map_fd, _In_ const void* keys, _Inout_ uint32
             request_buffer.resize(request_buffer_size);
             request = reinterpret_cast<ebpf_operation_map_delete_element_batch_request_t*>(request_buffer.data());
 
-            result = ebpf_safe_size_t_to_uint16(request_buffer.size(), &request->header.length);
+            result = _set_batch_request_length(request_buffer, sizeof(reply), &large_message);
             if (result != EBPF_SUCCESS) {
                 goto Exit;
             }
@@ -1351,7 +1569,8 @@ ebpf_map_delete_element_batch(fd_t map_fd, _In_ const void* keys, _Inout_ uint32
 
             memcpy(request->keys, (uint8_t*)keys + key_offset, copy_length);
 
-            result = win32_error_code_to_ebpf_result(invoke_ioctl(request_buffer, reply));
+            result = win32_error_code_to_ebpf_result(
+                large_message ? invoke_large_ioctl(request_buffer, reply) : invoke_ioctl(request_buffer, reply));
             if (result == EBPF_INVALID_OBJECT) {
                 result = EBPF_INVALID_FD;
             }
@@ -2645,7 +2864,7 @@ _initialize_ebpf_object_native(
     try {
         std::unique_lock lock(_ebpf_state_mutex);
         for (auto& map : object.maps) {
-            _ebpf_maps.insert(std::pair<ebpf_handle_t, ebpf_map_t*>(map->map_handle, map));
+            _ebpf_maps.insert(map->map_handle, map);
         }
     } catch (const std::bad_alloc&) {
         result = EBPF_NO_MEMORY;
@@ -3637,7 +3856,7 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
         }
 
         ebpf_handle_t inner_map_handle = (map->inner_map) ? map->inner_map->map_handle : ebpf_handle_invalid;
-        result = _create_map(map->name, &map->map_definition, inner_map_handle, &map->map_handle);
+        result = _create_map(map->name, &map->map_definition, 0, inner_map_handle, &map->map_handle);
         if (result != EBPF_SUCCESS) {
             break;
         }
@@ -3656,7 +3875,7 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
         if (result == EBPF_SUCCESS) {
             std::unique_lock lock(_ebpf_state_mutex);
             for (auto& map : object->maps) {
-                _ebpf_maps.insert(std::pair<ebpf_handle_t, ebpf_map_t*>(map->map_handle, map));
+                _ebpf_maps.insert(map->map_handle, map);
             }
         }
     } catch (const std::bad_alloc&) {
@@ -3827,6 +4046,95 @@ catch (const std::runtime_error& ex)
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+/**
+ * @brief Verify a program and load its code into the program object created for it.
+ *
+ * @param[in] object Object that contains the program.
+ * @param[in, out] program Program to verify and load. Receives the verifier log.
+ * @param[in] handle_map Handles of the maps of the object.
+ * @returns Result of the verification and load.
+ */
+static ebpf_result_t
+_ebpf_program_verify_and_load(
+    _In_ const struct bpf_object* object,
+    _Inout_ ebpf_program_t* program,
+    std::vector<original_fd_handle_map_t>& handle_map) noexcept
+{
+    ebpf_program_load_info load_info = {0};
+    load_info.object_name = const_cast<char*>(object->object_name);
+    load_info.section_name = const_cast<char*>(program->section_name);
+    load_info.program_name = const_cast<char*>(program->program_name);
+    load_info.program_type = program->program_type;
+    load_info.program_handle = reinterpret_cast<file_handle_t>(program->handle);
+    load_info.execution_type = object->execution_type;
+    load_info.instructions = reinterpret_cast<ebpf_instruction_t*>(program->instructions);
+    load_info.instruction_count = program->instruction_count;
+    load_info.execution_context = execution_context_kernel_mode;
+    load_info.map_count = (uint32_t)handle_map.size();
+    load_info.handle_map = handle_map.empty() ? nullptr : handle_map.data();
+
+    return ebpf_rpc_load_program(&load_info, &program->log_buffer, &program->log_buffer_size);
+}
+
+/**
+ * @brief Verify and load a set of programs on a pool of threads. Verification dominates the time taken to load an
+ * object, and the programs of an object are independent of each other once its maps exist, so each program is
+ * verified and loaded on its own as soon as a thread is free.
+ *
+ * The result is the result of the first program that failed, in the order of the programs in the object,
+ * regardless of the order in which the threads ran. Programs after a failed one may not be loaded.
+ *
+ * @param[in] object Object that contains the programs.
+ * @param[in] programs Programs to verify and load, in object order.
+ * @param[in] handle_map Handles of the maps of the object.
+ * @returns Result of the first program that failed, or EBPF_SUCCESS.
+ */
+static ebpf_result_t
+_ebpf_programs_verify_and_load(
+    _In_ const struct bpf_object* object,
+    const std::vector<ebpf_program_t*>& programs,
+    std::vector<original_fd_handle_map_t>& handle_map) noexcept(false)
+{
+    std::vector<ebpf_result_t> results(programs.size(), EBPF_SUCCESS);
+    std::atomic<size_t> next_index = 0;
+    std::atomic<size_t> first_failed_index = programs.size();
+
+    auto load_programs = [&]() noexcept {
+        for (;;) {
+            size_t index = next_index++;
+            if (index >= programs.size() || index > first_failed_index) {
+                break;
+            }
+            results[index] = _ebpf_program_verify_and_load(object, programs[index], handle_map);
+            if (results[index] != EBPF_SUCCESS) {
+                size_t failed_index = first_failed_index;
+                while (index < failed_index && !first_failed_index.compare_exchange_weak(failed_index, index)) {
+                }
+            }
+        }
+    };
+
+    size_t thread_count = std::min<size_t>(programs.size(), std::max(1u, std::thread::hardware_concurrency()));
+    {
+        // This thread is one of the workers.
+        std::vector<std::jthread> threads;
+        for (size_t i = 1; i < thread_count; i++) {
+            try {
+                threads.emplace_back([&]() {
+                    load_programs();
+                    ebpf_api_thread_local_cleanup();
+                });
+            } catch (const std::system_error&) {
+                // Continue with the threads that were started.
+                break;
+            }
+        }
+        load_programs();
+    }
+
+    return (first_failed_index < programs.size()) ? results[first_failed_index] : EBPF_SUCCESS;
+}
+
 _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
     _ebpf_object_load_programs(_Inout_ struct bpf_object* object) noexcept(false)
 {
@@ -3834,6 +4142,17 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
     ebpf_assert(object);
     ebpf_result_t result = EBPF_SUCCESS;
     std::vector<original_fd_handle_map_t> handle_map;
+    std::vector<ebpf_program_t*> programs;
+
+    for (auto& map : object->maps) {
+        ebpf_id_t inner_map_id = (map->inner_map) ? map->inner_map->map_id : EBPF_ID_NONE;
+        handle_map.emplace_back(
+            map->original_fd,
+            map->map_id,
+            map->inner_map_original_fd,
+            inner_map_id,
+            reinterpret_cast<file_handle_t>(map->map_handle));
+    }
 
     for (ebpf_program_t* program : object->programs) {
         if (!program->autoload) {
@@ -3857,44 +4176,18 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
             }
         }
 
-        // Populate load_info.
-        ebpf_program_load_info load_info = {0};
-        load_info.object_name = const_cast<char*>(object->object_name);
-        load_info.section_name = const_cast<char*>(program->section_name);
-        load_info.program_name = const_cast<char*>(program->program_name);
-        load_info.program_type = program->program_type;
-        load_info.program_handle = reinterpret_cast<file_handle_t>(program->handle);
-        load_info.execution_type = object->execution_type;
-        load_info.instructions = reinterpret_cast<ebpf_instruction_t*>(program->instructions);
-        load_info.instruction_count = program->instruction_count;
-        load_info.execution_context = execution_context_kernel_mode;
-        load_info.map_count = (uint32_t)object->maps.size();
-
-        if (load_info.map_count > 0) {
-            for (auto& map : object->maps) {
-                ebpf_id_t inner_map_id = (map->inner_map) ? map->inner_map->map_id : EBPF_ID_NONE;
-                handle_map.emplace_back(
-                    map->original_fd,
-                    map->map_id,
-                    map->inner_map_original_fd,
-                    inner_map_id,
-                    reinterpret_cast<file_handle_t>(map->map_handle));
-            }
-
-            load_info.handle_map = handle_map.data();
-        }
+        programs.push_back(program);
+    }
 
-        result = ebpf_rpc_load_program(&load_info, &program->log_buffer, &program->log_buffer_size);
-        if (result != EBPF_SUCCESS) {
-            break;
-        }
+    if (result == EBPF_SUCCESS) {
+        result = _ebpf_programs_verify_and_load(object, programs, handle_map);
     }
 
     if (result == EBPF_SUCCESS) {
         std::unique_lock lock(_ebpf_state_mutex);
         for (auto& program : object->programs) {
             if (program->handle != ebpf_handle_invalid) {
-                _ebpf_programs.insert(std::pair<ebpf_handle_t, ebpf_program_t*>(program->handle, program));
+                _ebpf_programs.insert(program->handle, program);
             }
         }
     }
@@ -5721,19 +6014,81 @@ ebpf_program_test_run(fd_t program_fd, _Inout_ ebpf_test_run_options_t* options)
 CATCH_NO_MEMORY_EBPF_RESULT
 
 _Must_inspect_result_ ebpf_result_t
-ebpf_program_synchronize() NO_EXCEPT_TRY
+ebpf_program_test_run_parallel(
+    fd_t program_fd,
+    _In_reads_(cpu_count) const uint32_t* cpus,
+    uint32_t cpu_count,
+    _Inout_ ebpf_test_run_options_t* options,
+    _Out_writes_(cpu_count) ebpf_test_run_cpu_result_t* cpu_results,
+    _Out_opt_ uint64_t* runs_per_second) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
-    ebpf_operation_epoch_synchronize_request_t request;
+
+    ebpf_result_t result;
+    size_t cpus_size = cpu_count * sizeof(uint32_t);
+    size_t input_buffer_size;
+    size_t output_buffer_size;
     ebpf_signal_t completion_event;
     OVERLAPPED overlapped;
     memset(&overlapped, 0, sizeof(overlapped));
     overlapped.hEvent = completion_event.get();
 
-    request.header.id = ebpf_operation_id_t::EBPF_OPERATION_EPOCH_SYNCHRONIZE;
-    request.header.length = sizeof(request);
-    ebpf_result_t result = win32_error_code_to_ebpf_result(invoke_ioctl(request, _empty_reply, &overlapped));
+    if (runs_per_second != nullptr) {
+        *runs_per_second = 0;
+    }
+
+    if (cpu_count == 0) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    result = _ebpf_safe_size_t_add3(
+        EBPF_OFFSET_OF(ebpf_operation_program_test_run_parallel_request_t, data),
+        options->data_size_in,
+        options->context_size_in,
+        &input_buffer_size);
+    if (result == EBPF_SUCCESS) {
+        result = ebpf_safe_size_t_add(input_buffer_size, cpus_size, &input_buffer_size);
+    }
+    if (result != EBPF_SUCCESS || input_buffer_size > MAXUINT16) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    result = _ebpf_safe_size_t_add3(
+        EBPF_OFFSET_OF(ebpf_operation_program_test_run_parallel_reply_t, data),
+        options->data_size_out,
+        options->context_size_out,
+        &output_buffer_size);
+    if (result == EBPF_SUCCESS) {
+        result = ebpf_safe_size_t_add(
+            output_buffer_size, cpu_count * sizeof(ebpf_test_run_cpu_result_t), &output_buffer_size);
+    }
+    if (result != EBPF_SUCCESS || output_buffer_size > MAXUINT16) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    ebpf_protocol_buffer_t request_buffer(input_buffer_size);
+    ebpf_protocol_buffer_t reply_buffer(output_buffer_size);
+
+    ebpf_operation_program_test_run_parallel_request_t* request =
+        reinterpret_cast<ebpf_operation_program_test_run_parallel_request_t*>(request_buffer.data());
+    ebpf_operation_program_test_run_parallel_reply_t* reply =
+        reinterpret_cast<ebpf_operation_program_test_run_parallel_reply_t*>(reply_buffer.data());
+
+    request->header.id = EBPF_OPERATION_PROGRAM_TEST_RUN_PARALLEL;
+    request->header.length = static_cast<uint16_t>(request_buffer.size());
+    request->program_handle = _get_handle_from_file_descriptor(program_fd);
+    request->repeat_count = options->repeat_count;
+    request->batch_size = options->batch_size;
+    request->flags = options->flags;
+    request->cpu_count = cpu_count;
+    request->context_offset = static_cast<uint32_t>(cpus_size + options->data_size_in);
+
+    memcpy(request->data, cpus, cpus_size);
+    std::copy(options->data_in, options->data_in + options->data_size_in, request->data + cpus_size);
+    std::copy(
+        options->context_in, options->context_in + options->context_size_in, request->data + request->context_offset);
 
+    result = win32_error_code_to_ebpf_result(invoke_ioctl(request_buffer, reply_buffer, &overlapped));
     if (result == EBPF_PENDING) {
         unsigned long bytes_returned;
         completion_event.wait();
@@ -5744,67 +6099,282 @@ ebpf_program_synchronize() NO_EXCEPT_TRY
             result = win32_error_code_to_ebpf_result(GetLastError());
         }
     }
-    EBPF_RETURN_RESULT(result);
-}
-CATCH_NO_MEMORY_EBPF_RESULT
 
-void
-ebpf_api_thread_local_cleanup() noexcept
-{
-    clean_up_sync_device_handle();
-}
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
 
-void
-ebpf_api_thread_local_initialize() noexcept
-{
-    // Nothing to do.
-    // Added for symmetry with ebpf_api_thread_local_cleanup.
-}
+    size_t cpu_results_size = cpu_count * sizeof(ebpf_test_run_cpu_result_t);
+    size_t reply_data_size;
+    result = ebpf_safe_size_t_subtract(
+        reply->header.length,
+        EBPF_OFFSET_OF(ebpf_operation_program_test_run_parallel_reply_t, data),
+        &reply_data_size);
+    if (result != EBPF_SUCCESS || reply->cpu_result_count != cpu_count || reply->context_offset < cpu_results_size ||
+        reply->context_offset > reply_data_size) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
 
-_Must_inspect_result_ ebpf_result_t
-ebpf_program_set_flags(fd_t program_fd, uint64_t flags) noexcept
-{
-    ebpf_handle_t program_handle = _get_handle_from_file_descriptor(program_fd);
-    if (program_handle == ebpf_handle_invalid) {
-        return EBPF_INVALID_FD;
+    if (options->data_out) {
+        size_t data_size_out = reply->context_offset - cpu_results_size;
+        if (data_size_out > options->data_size_out) {
+            EBPF_RETURN_RESULT(EBPF_INSUFFICIENT_BUFFER);
+        }
+        std::copy(reply->data + cpu_results_size, reply->data + reply->context_offset, options->data_out);
+        options->data_size_out = data_size_out;
+    }
+    if (options->context_out) {
+        size_t context_size_out = reply_data_size - reply->context_offset;
+        if (context_size_out > options->context_size_out) {
+            options->context_size_out = context_size_out;
+            EBPF_RETURN_RESULT(EBPF_INSUFFICIENT_BUFFER);
+        }
+        std::copy(reply->data + reply->context_offset, reply->data + reply_data_size, options->context_out);
+        options->context_size_out = context_size_out;
     }
+    options->duration = reply->duration;
+    options->return_value = reply->return_value;
 
-    ebpf_operation_program_set_flags_request_t request;
-    request.header.id = ebpf_operation_id_t::EBPF_OPERATION_PROGRAM_SET_FLAGS;
-    request.header.length = sizeof(request);
-    request.program_handle = program_handle;
-    request.flags = flags;
+    // The CPUs run concurrently, so the aggregate throughput is the sum of the per-CPU throughputs.
+    uint64_t total_runs_per_second = 0;
+    memcpy(cpu_results, reply->data, cpu_results_size);
+    for (size_t i = 0; i < cpu_count; i++) {
+        ebpf_test_run_cpu_result_t* cpu_result = &cpu_results[i];
+        cpu_result->runs_per_second =
+            cpu_result->duration ? static_cast<uint64_t>(
+                                       static_cast<double>(cpu_result->run_count) * 1000000000.0 /
+                                       static_cast<double>(cpu_result->duration))
+                                 : 0;
+        total_runs_per_second += cpu_result->runs_per_second;
+    }
+    if (runs_per_second != nullptr) {
+        *runs_per_second = total_runs_per_second;
+    }
 
-    return win32_error_code_to_ebpf_result(invoke_ioctl(request));
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+// Nearest-rank percentile of a sorted, non-empty set of durations.
+static uint64_t
+_ebpf_test_run_percentile(_In_ const std::vector<uint64_t>& sorted_durations, size_t percentile) noexcept
+{
+    size_t rank = (sorted_durations.size() * percentile + 99) / 100;
+    return sorted_durations[(rank == 0) ? 0 : rank - 1];
 }
 
 _Must_inspect_result_ ebpf_result_t
-ebpf_ring_buffer_map_map_buffer_with_index(
-    fd_t map_fd,
-    uint64_t index,
-    _Outptr_result_maybenull_ void** consumer,
-    _Outptr_result_maybenull_ const void** producer,
-    _Outptr_result_buffer_maybenull_(*data_size) const uint8_t** data,
-    _Out_ size_t* data_size) NO_EXCEPT_TRY
+ebpf_program_test_run_batch(
+    fd_t program_fd,
+    size_t input_count,
+    _Inout_updates_(input_count) ebpf_test_run_options_t* options,
+    _Out_opt_ ebpf_test_run_batch_summary_t* summary) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
+
     ebpf_result_t result = EBPF_SUCCESS;
-    ebpf_handle_t map_handle = ebpf_handle_invalid;
+    std::vector<uint64_t> durations;
 
-    if (!consumer || !producer || !data || !data_size) {
-        result = EBPF_INVALID_ARGUMENT;
-        EBPF_RETURN_RESULT(result);
+    if (summary != nullptr) {
+        memset(summary, 0, sizeof(*summary));
     }
 
-    map_handle = _get_handle_from_file_descriptor(map_fd);
-    if (map_handle == ebpf_handle_invalid) {
-        result = EBPF_INVALID_FD;
-        EBPF_RETURN_RESULT(result);
+    if (input_count == 0 || options == nullptr) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
     }
 
-    ebpf_operation_ring_buffer_map_map_buffer_request_t request{
-        sizeof(request), ebpf_operation_id_t::EBPF_OPERATION_RING_BUFFER_MAP_MAP_BUFFER, map_handle, index};
-    ebpf_operation_ring_buffer_map_map_buffer_reply_t reply{};
+    durations.reserve(input_count);
+    for (size_t i = 0; i < input_count; i++) {
+        // Each input gets its own program context in the execution context, so verdicts and output
+        // data are independent of the other inputs in the batch.
+        result = ebpf_program_test_run(program_fd, &options[i]);
+        if (result != EBPF_SUCCESS) {
+            EBPF_LOG_MESSAGE_UINT64(
+                EBPF_TRACELOG_LEVEL_ERROR, EBPF_TRACELOG_KEYWORD_API, "Test run failed for batch input", i);
+            break;
+        }
+        durations.push_back(options[i].duration);
+    }
+
+    if (summary != nullptr && !durations.empty()) {
+        uint64_t total_duration = 0;
+        for (uint64_t duration : durations) {
+            total_duration += duration;
+        }
+        std::sort(durations.begin(), durations.end());
+        summary->input_count = durations.size();
+        summary->min_duration = durations.front();
+        summary->p50_duration = _ebpf_test_run_percentile(durations, 50);
+        summary->p99_duration = _ebpf_test_run_percentile(durations, 99);
+        summary->max_duration = durations.back();
+        summary->mean_duration = total_duration / durations.size();
+    }
+
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_test_run_options_from_pcap(
+    _In_z_ const char* file_name,
+    size_t data_size_out,
+    _Outptr_result_buffer_maybenull_(*input_count) ebpf_test_run_options_t** options,
+    _Out_ size_t* input_count) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+
+    std::vector<std::vector<uint8_t>> packets;
+    size_t allocation_size;
+    *options = nullptr;
+    *input_count = 0;
+
+    // A test run reply carries the output data and context in a single protocol message.
+    const size_t maximum_data_size_out = MAXUINT16 - EBPF_OFFSET_OF(ebpf_operation_program_test_run_reply_t, data);
+    if (data_size_out == 0) {
+        data_size_out = maximum_data_size_out;
+    } else if (data_size_out > maximum_data_size_out) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    ebpf_result_t result = ebpf_pcap_read_file(file_name, packets);
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+    if (packets.empty()) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    // The options array and every packet's input and output buffers share a single allocation
+    // so that the caller can release them all with one call.
+    result = ebpf_safe_size_t_multiply(packets.size(), sizeof(ebpf_test_run_options_t), &allocation_size);
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+    for (const auto& packet : packets) {
+        result = _ebpf_safe_size_t_add3(allocation_size, packet.size(), data_size_out, &allocation_size);
+        if (result != EBPF_SUCCESS) {
+            EBPF_RETURN_RESULT(result);
+        }
+    }
+
+    ebpf_test_run_options_t* local_options =
+        reinterpret_cast<ebpf_test_run_options_t*>(ebpf_allocate_with_tag(allocation_size, EBPF_POOL_TAG_DEFAULT));
+    if (local_options == nullptr) {
+        EBPF_RETURN_RESULT(EBPF_NO_MEMORY);
+    }
+
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(local_options + packets.size());
+    for (size_t i = 0; i < packets.size(); i++) {
+        ebpf_test_run_options_t* entry = &local_options[i];
+        std::copy(packets[i].begin(), packets[i].end(), buffer);
+        entry->data_in = buffer;
+        entry->data_size_in = packets[i].size();
+        buffer += packets[i].size();
+        entry->data_out = buffer;
+        entry->data_size_out = data_size_out;
+        buffer += data_size_out;
+        entry->repeat_count = 1;
+    }
+
+    *options = local_options;
+    *input_count = packets.size();
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+void
+ebpf_free_test_run_options(_In_opt_ _Post_invalid_ ebpf_test_run_options_t* options) noexcept
+{
+    EBPF_LOG_ENTRY();
+    ebpf_free(options);
+    EBPF_LOG_EXIT();
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_program_synchronize() NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_operation_epoch_synchronize_request_t request;
+    ebpf_signal_t completion_event;
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.hEvent = completion_event.get();
+
+    request.header.id = ebpf_operation_id_t::EBPF_OPERATION_EPOCH_SYNCHRONIZE;
+    request.header.length = sizeof(request);
+    ebpf_result_t result = win32_error_code_to_ebpf_result(invoke_ioctl(request, _empty_reply, &overlapped));
+
+    if (result == EBPF_PENDING) {
+        unsigned long bytes_returned;
+        completion_event.wait();
+        if (GetOverlappedResult(
+                reinterpret_cast<HANDLE>(get_async_device_handle()), &overlapped, &bytes_returned, FALSE)) {
+            result = EBPF_SUCCESS;
+        } else {
+            result = win32_error_code_to_ebpf_result(GetLastError());
+        }
+    }
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+void
+ebpf_api_thread_local_cleanup() noexcept
+{
+    clean_up_sync_device_handle();
+}
+
+void
+ebpf_api_thread_local_initialize() noexcept
+{
+    // Nothing to do.
+    // Added for symmetry with ebpf_api_thread_local_cleanup.
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_program_set_flags(fd_t program_fd, uint64_t flags) noexcept
+{
+    ebpf_handle_t program_handle = _get_handle_from_file_descriptor(program_fd);
+    if (program_handle == ebpf_handle_invalid) {
+        return EBPF_INVALID_FD;
+    }
+
+    ebpf_operation_program_set_flags_request_t request;
+    request.header.id = ebpf_operation_id_t::EBPF_OPERATION_PROGRAM_SET_FLAGS;
+    request.header.length = sizeof(request);
+    request.program_handle = program_handle;
+    request.flags = flags;
+
+    return win32_error_code_to_ebpf_result(invoke_ioctl(request));
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_buffer_map_map_buffer_with_index(
+    fd_t map_fd,
+    uint64_t index,
+    _Outptr_result_maybenull_ void** consumer,
+    _Outptr_result_maybenull_ const void** producer,
+    _Outptr_result_buffer_maybenull_(*data_size) const uint8_t** data,
+    _Out_ size_t* data_size) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_handle_t map_handle = ebpf_handle_invalid;
+
+    if (!consumer || !producer || !data || !data_size) {
+        result = EBPF_INVALID_ARGUMENT;
+        EBPF_RETURN_RESULT(result);
+    }
+
+    map_handle = _get_handle_from_file_descriptor(map_fd);
+    if (map_handle == ebpf_handle_invalid) {
+        result = EBPF_INVALID_FD;
+        EBPF_RETURN_RESULT(result);
+    }
+
+    ebpf_operation_ring_buffer_map_map_buffer_request_t request{
+        sizeof(request), ebpf_operation_id_t::EBPF_OPERATION_RING_BUFFER_MAP_MAP_BUFFER, map_handle, index};
+    ebpf_operation_ring_buffer_map_map_buffer_reply_t reply{};
 
     result = win32_error_code_to_ebpf_result(invoke_ioctl(request, reply));
     if (result != EBPF_SUCCESS) {
@@ -5869,6 +6439,155 @@ ebpf_ring_buffer_map_unmap_buffer(fd_t map_fd, _In_ void* consumer, _In_ const v
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_mmap(fd_t map_fd, bool writable, _Outptr_result_bytes_(*size) void** data, _Out_ size_t* size) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result = EBPF_SUCCESS;
+
+    if (!data || !size) {
+        result = EBPF_INVALID_ARGUMENT;
+        EBPF_RETURN_RESULT(result);
+    }
+
+    ebpf_handle_t map_handle = _get_handle_from_file_descriptor(map_fd);
+    if (map_handle == ebpf_handle_invalid) {
+        result = EBPF_INVALID_FD;
+        EBPF_RETURN_RESULT(result);
+    }
+
+    ebpf_operation_map_map_memory_request_t request{
+        sizeof(request), ebpf_operation_id_t::EBPF_OPERATION_MAP_MAP_MEMORY, map_handle, writable ? 1u : 0u};
+    ebpf_operation_map_map_memory_reply_t reply{};
+
+    result = win32_error_code_to_ebpf_result(invoke_ioctl(request, reply));
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+
+    *data = reinterpret_cast<void*>(static_cast<uintptr_t>(reply.address));
+    *size = static_cast<size_t>(reply.size);
+
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_munmap(fd_t map_fd, _In_ void* data) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_handle_t map_handle = _get_handle_from_file_descriptor(map_fd);
+    if (map_handle == ebpf_handle_invalid) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_FD);
+    }
+
+    ebpf_operation_map_unmap_memory_request_t request{
+        sizeof(request),
+        ebpf_operation_id_t::EBPF_OPERATION_MAP_UNMAP_MEMORY,
+        map_handle,
+        static_cast<uint64_t>(reinterpret_cast<uintptr_t>(data))};
+    ebpf_result_t result = win32_error_code_to_ebpf_result(invoke_ioctl(request));
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+struct _ebpf_map_iterator
+{
+    ebpf_handle_t handle = ebpf_handle_invalid;
+    ebpf_protocol_buffer_t reply_buffer;
+};
+
+void
+ebpf_map_iterator_destroy(_In_opt_ _Post_invalid_ ebpf_map_iterator_t* iterator) noexcept
+{
+    EBPF_LOG_ENTRY();
+    if (iterator == nullptr) {
+        EBPF_RETURN_VOID();
+    }
+
+    if (iterator->handle != ebpf_handle_invalid) {
+        Platform::CloseHandle(iterator->handle);
+    }
+    delete iterator;
+    EBPF_RETURN_VOID();
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_iterator_create(fd_t map_fd, bool snapshot, uint64_t flags, _Outptr_ ebpf_map_iterator_t** iterator)
+    NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+
+    if (iterator == nullptr || (flags & ~EBPF_F_PERCPU_AGGREGATE_MASK) != 0) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    ebpf_handle_t map_handle = _get_handle_from_file_descriptor(map_fd);
+    if (map_handle == ebpf_handle_invalid) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_FD);
+    }
+
+    std::unique_ptr<ebpf_map_iterator_t, decltype(&ebpf_map_iterator_destroy)> local_iterator(
+        new ebpf_map_iterator_t(), ebpf_map_iterator_destroy);
+
+    ebpf_operation_map_cursor_create_request_t request{
+        sizeof(request),
+        ebpf_operation_id_t::EBPF_OPERATION_MAP_CURSOR_CREATE,
+        map_handle,
+        _get_find_flags(flags),
+        static_cast<uint8_t>(snapshot ? 1 : 0)};
+    ebpf_operation_map_cursor_create_reply_t reply{};
+
+    result = win32_error_code_to_ebpf_result(invoke_ioctl(request, reply));
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+    local_iterator->handle = reply.cursor_handle;
+
+    // A reply is limited to UINT16_MAX bytes. Reserve that once, so that pages of entries don't reallocate.
+    local_iterator->reply_buffer.reserve(UINT16_MAX);
+
+    *iterator = local_iterator.release();
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_iterator_next(
+    _Inout_ ebpf_map_iterator_t* iterator, _Out_writes_bytes_to_(*size, *size) void* entries, _Inout_ size_t* size)
+    NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    const size_t data_offset = EBPF_OFFSET_OF(ebpf_operation_map_cursor_next_reply_t, data);
+
+    if (iterator == nullptr || entries == nullptr || size == nullptr) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    size_t maximum_size = *size;
+    *size = 0;
+
+    // Only request as many entries as the caller can hold, so that none are skipped.
+    size_t reply_length = data_offset + std::min(maximum_size, static_cast<size_t>(UINT16_MAX) - data_offset);
+    iterator->reply_buffer.resize(reply_length);
+    ebpf_operation_map_cursor_next_request_t request{
+        sizeof(request), ebpf_operation_id_t::EBPF_OPERATION_MAP_CURSOR_NEXT, iterator->handle};
+    result = win32_error_code_to_ebpf_result(invoke_ioctl(request, iterator->reply_buffer));
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+
+    auto reply = reinterpret_cast<ebpf_operation_map_cursor_next_reply_t*>(iterator->reply_buffer.data());
+    ebpf_assert(reply->header.length >= data_offset && reply->header.length <= reply_length);
+    *size = reply->header.length - data_offset;
+    memcpy(entries, reply->data, *size);
+
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_set_wait_handle(fd_t map_fd, uint64_t index, ebpf_handle_t handle) NO_EXCEPT_TRY
 {
@@ -5890,6 +6609,354 @@ ebpf_map_set_wait_handle(fd_t map_fd, uint64_t index, ebpf_handle_t handle) NO_E
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+struct _ebpf_map_op_queue
+{
+    ebpf_handle_t handle = ebpf_handle_invalid;
+    HANDLE wait_handle = nullptr;
+    size_t ring_size = 0;
+
+    std::mutex submission_lock;
+    const ebpf_ring_buffer_consumer_page_t* submission_consumer = nullptr;
+    ebpf_ring_buffer_producer_page_t* submission_producer = nullptr;
+    uint8_t* submission_data = nullptr;
+    // Offset after the last queued submission. Submissions between the producer offset and this offset are not
+    // visible to the execution context until ebpf_map_op_queue_submit publishes them.
+    _Guarded_by_(submission_lock) size_t submission_tail = 0;
+
+    std::mutex completion_lock;
+    ebpf_ring_buffer_consumer_page_t* completion_consumer = nullptr;
+    const ebpf_ring_buffer_producer_page_t* completion_producer = nullptr;
+    const uint8_t* completion_data = nullptr;
+};
+
+static ebpf_result_t
+_map_op_queue_notify(_In_ const ebpf_map_op_queue_t* queue)
+{
+    ebpf_operation_map_queue_notify_request_t request{
+        sizeof(request), ebpf_operation_id_t::EBPF_OPERATION_MAP_QUEUE_NOTIFY, queue->handle};
+    ebpf_operation_map_queue_notify_reply_t reply{};
+
+    return win32_error_code_to_ebpf_result(invoke_ioctl(request, reply));
+}
+
+static ebpf_result_t
+_map_op_queue_enqueue(
+    _Inout_ ebpf_map_op_queue_t* queue,
+    fd_t map_fd,
+    ebpf_map_queue_operation_t operation,
+    uint32_t flags,
+    _In_reads_bytes_(key_size) const void* key,
+    uint32_t key_size,
+    _In_reads_bytes_opt_(value_size) const void* value,
+    uint32_t value_size,
+    uint64_t user_data)
+{
+    ebpf_handle_t map_handle = _get_handle_from_file_descriptor(map_fd);
+    if (map_handle == ebpf_handle_invalid) {
+        return EBPF_INVALID_FD;
+    }
+
+    // Lookups only reserve room for the value in the completion ring.
+    uint32_t data_size = (value != nullptr) ? value_size : 0;
+    size_t record_length = EBPF_OFFSET_OF(ebpf_map_queue_submission_t, data) + (size_t)key_size + data_size;
+    size_t total_size = (EBPF_RINGBUF_HEADER_SIZE + record_length + 7) & ~7;
+    if (total_size > queue->ring_size) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    std::scoped_lock lock(queue->submission_lock);
+    size_t consumer_offset = ReadULong64Acquire(&queue->submission_consumer->consumer_offset);
+    if (queue->submission_tail + total_size - consumer_offset > queue->ring_size) {
+        return EBPF_NO_MEMORY;
+    }
+
+    // The data region is mapped twice back to back, so a record never needs to be split at the end of the ring.
+    size_t record_offset = queue->submission_tail % queue->ring_size;
+    ebpf_ring_buffer_record_t* record =
+        reinterpret_cast<ebpf_ring_buffer_record_t*>(queue->submission_data + record_offset);
+    ebpf_map_queue_submission_t* submission = reinterpret_cast<ebpf_map_queue_submission_t*>(record->data);
+    submission->user_data = user_data;
+    submission->map_handle = map_handle;
+    submission->operation = operation;
+    submission->flags = flags;
+    submission->key_size = key_size;
+    submission->value_size = value_size;
+    memcpy(submission->data, key, key_size);
+    if (data_size > 0) {
+        memcpy(submission->data + key_size, value, data_size);
+    }
+    record->header.page_offset = 0;
+    // The record becomes visible when ebpf_map_op_queue_submit releases the producer offset.
+    record->header.length = static_cast<uint32_t>(record_length);
+    queue->submission_tail += total_size;
+
+    return EBPF_SUCCESS;
+}
+
+void
+ebpf_map_op_queue_destroy(_In_opt_ _Post_invalid_ ebpf_map_op_queue_t* queue) noexcept
+{
+    EBPF_LOG_ENTRY();
+    if (queue == nullptr) {
+        EBPF_RETURN_VOID();
+    }
+
+    if (queue->handle != ebpf_handle_invalid) {
+        ebpf_operation_map_queue_unmap_request_t request{
+            sizeof(request), ebpf_operation_id_t::EBPF_OPERATION_MAP_QUEUE_UNMAP, queue->handle};
+        (void)invoke_ioctl(request);
+        Platform::CloseHandle(queue->handle);
+    }
+    if (queue->wait_handle != nullptr) {
+        CloseHandle(queue->wait_handle);
+    }
+    delete queue;
+    EBPF_RETURN_VOID();
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_op_queue_create(size_t ring_size, _Outptr_ ebpf_map_op_queue_t** queue) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    ebpf_operation_map_queue_create_reply_t reply{};
+
+    ebpf_assert(queue);
+    *queue = nullptr;
+
+    std::unique_ptr<ebpf_map_op_queue_t, decltype(&ebpf_map_op_queue_destroy)> local_queue(
+        new ebpf_map_op_queue_t(), ebpf_map_op_queue_destroy);
+
+    // Manual reset, so that a wakeup is not lost between checking the completion ring and waiting.
+    local_queue->wait_handle = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (local_queue->wait_handle == nullptr) {
+        EBPF_RETURN_RESULT(EBPF_NO_MEMORY);
+    }
+
+    ebpf_operation_map_queue_create_request_t request{
+        sizeof(request),
+        ebpf_operation_id_t::EBPF_OPERATION_MAP_QUEUE_CREATE,
+        ring_size,
+        reinterpret_cast<ebpf_handle_t>(local_queue->wait_handle)};
+
+    result = win32_error_code_to_ebpf_result(invoke_ioctl(request, reply));
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+
+    local_queue->handle = reply.queue_handle;
+    local_queue->ring_size = static_cast<size_t>(reply.ring_size);
+    local_queue->submission_consumer =
+        reinterpret_cast<const ebpf_ring_buffer_consumer_page_t*>(reply.submission_consumer_address);
+    local_queue->submission_producer =
+        reinterpret_cast<ebpf_ring_buffer_producer_page_t*>(reply.submission_producer_address);
+    local_queue->submission_data = reinterpret_cast<uint8_t*>(reply.submission_data_address);
+    local_queue->submission_tail = ReadULong64NoFence(&local_queue->submission_producer->producer_offset);
+    local_queue->completion_consumer =
+        reinterpret_cast<ebpf_ring_buffer_consumer_page_t*>(reply.completion_consumer_address);
+    local_queue->completion_producer =
+        reinterpret_cast<const ebpf_ring_buffer_producer_page_t*>(reply.completion_producer_address);
+    local_queue->completion_data = reinterpret_cast<const uint8_t*>(reply.completion_data_address);
+
+    *queue = local_queue.release();
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_op_queue_lookup_elem(
+    _Inout_ ebpf_map_op_queue_t* queue,
+    fd_t map_fd,
+    _In_reads_bytes_(key_size) const void* key,
+    uint32_t key_size,
+    uint32_t value_size,
+    uint64_t flags,
+    uint64_t user_data) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(queue);
+    if ((flags & ~EBPF_F_PERCPU_AGGREGATE_MASK) != 0) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    ebpf_result_t result = _map_op_queue_enqueue(
+        queue,
+        map_fd,
+        EBPF_MAP_QUEUE_OPERATION_LOOKUP,
+        _get_find_flags(flags),
+        key,
+        key_size,
+        nullptr,
+        value_size,
+        user_data);
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_op_queue_update_elem(
+    _Inout_ ebpf_map_op_queue_t* queue,
+    fd_t map_fd,
+    _In_reads_bytes_(key_size) const void* key,
+    uint32_t key_size,
+    _In_reads_bytes_(value_size) const void* value,
+    uint32_t value_size,
+    uint64_t flags,
+    uint64_t user_data) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(queue);
+    ebpf_assert(value);
+
+    switch (flags) {
+    case EBPF_ANY:
+    case EBPF_NOEXIST:
+    case EBPF_EXIST:
+        break;
+    default:
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    ebpf_result_t result = _map_op_queue_enqueue(
+        queue,
+        map_fd,
+        EBPF_MAP_QUEUE_OPERATION_UPDATE,
+        static_cast<uint32_t>(flags),
+        key,
+        key_size,
+        value,
+        value_size,
+        user_data);
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_op_queue_delete_elem(
+    _Inout_ ebpf_map_op_queue_t* queue,
+    fd_t map_fd,
+    _In_reads_bytes_(key_size) const void* key,
+    uint32_t key_size,
+    uint64_t user_data) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(queue);
+    ebpf_result_t result = _map_op_queue_enqueue(
+        queue, map_fd, EBPF_MAP_QUEUE_OPERATION_DELETE, 0, key, key_size, nullptr, 0, user_data);
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_op_queue_submit(_Inout_ ebpf_map_op_queue_t* queue) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(queue);
+    bool notify;
+    {
+        std::scoped_lock lock(queue->submission_lock);
+        size_t published_offset = ReadULong64NoFence(&queue->submission_producer->producer_offset);
+        if (queue->submission_tail == published_offset) {
+            EBPF_RETURN_RESULT(EBPF_SUCCESS);
+        }
+        WriteULong64Release(&queue->submission_producer->producer_offset, queue->submission_tail);
+
+        // The execution context checks for new submissions after it stops processing, so it only needs to be
+        // notified if it had already consumed everything published before this call. The barrier orders the
+        // producer offset store before the consumer offset load.
+        MemoryBarrier();
+        notify = ReadULong64Acquire(&queue->submission_consumer->consumer_offset) == published_offset;
+    }
+
+    ebpf_result_t result = notify ? _map_op_queue_notify(queue) : EBPF_SUCCESS;
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_op_queue_get_result(
+    _Inout_ ebpf_map_op_queue_t* queue,
+    _Out_ ebpf_map_op_result_t* result,
+    _Out_writes_bytes_opt_(value_size) void* value,
+    uint32_t value_size,
+    uint32_t timeout_ms) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(queue);
+    ebpf_assert(result);
+    memset(result, 0, sizeof(*result));
+
+    std::scoped_lock lock(queue->completion_lock);
+    bool waited = false;
+    for (;;) {
+        size_t consumer_offset = ReadULong64NoFence(&queue->completion_consumer->consumer_offset);
+        size_t producer_offset = ReadULong64Acquire(&queue->completion_producer->producer_offset);
+        const ebpf_ring_buffer_record_t* record = ebpf_ring_buffer_next_record(
+            queue->completion_data, queue->ring_size, consumer_offset, producer_offset);
+
+        if (record != nullptr && !ebpf_ring_buffer_record_is_locked(record)) {
+            consumer_offset += ebpf_ring_buffer_record_total_size(record);
+            if (ebpf_ring_buffer_record_is_discarded(record)) {
+                WriteULong64Release(&queue->completion_consumer->consumer_offset, consumer_offset);
+                continue;
+            }
+
+            const ebpf_map_queue_completion_t* completion =
+                reinterpret_cast<const ebpf_map_queue_completion_t*>(record->data);
+            result->user_data = completion->user_data;
+            result->result = static_cast<ebpf_result_t>(completion->result);
+            result->value_size = completion->value_size;
+            if (value != nullptr && completion->value_size > 0) {
+                if (value_size < completion->value_size) {
+                    EBPF_RETURN_RESULT(EBPF_INSUFFICIENT_BUFFER);
+                }
+                memcpy(value, completion->value, completion->value_size);
+            }
+            WriteULong64Release(&queue->completion_consumer->consumer_offset, consumer_offset);
+
+            // The execution context stops processing submissions when the completion ring is full. Once every
+            // completion has been consumed, notify it again if submissions are still waiting.
+            if (consumer_offset == producer_offset) {
+                bool pending;
+                {
+                    std::scoped_lock submission_lock(queue->submission_lock);
+                    pending = ReadULong64Acquire(&queue->submission_consumer->consumer_offset) !=
+                              ReadULong64NoFence(&queue->submission_producer->producer_offset);
+                }
+                if (pending) {
+                    ebpf_result_t notify_result = _map_op_queue_notify(queue);
+                    if (notify_result != EBPF_SUCCESS) {
+                        EBPF_LOG_MESSAGE_UINT64(
+                            EBPF_TRACELOG_LEVEL_WARNING,
+                            EBPF_TRACELOG_KEYWORD_API,
+                            "ebpf_map_op_queue_get_result: notify failed",
+                            notify_result);
+                    }
+                }
+            }
+            EBPF_RETURN_RESULT(EBPF_SUCCESS);
+        }
+
+        if (timeout_ms == 0 || waited) {
+            EBPF_RETURN_RESULT(EBPF_TIMEOUT);
+        }
+
+        // Reset before re-checking the ring so that a completion posted in between still wakes this thread.
+        if (!ResetEvent(queue->wait_handle)) {
+            EBPF_RETURN_RESULT(win32_error_code_to_ebpf_result(GetLastError()));
+        }
+        producer_offset = ReadULong64Acquire(&queue->completion_producer->producer_offset);
+        if (producer_offset != consumer_offset) {
+            continue;
+        }
+        if (WaitForSingleObject(queue->wait_handle, timeout_ms) != WAIT_OBJECT_0) {
+            EBPF_RETURN_RESULT(EBPF_TIMEOUT);
+        }
+        waited = true;
+    }
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
 // Context structure for section data extraction.
 typedef struct _ebpf_section_data_context
 {
@@ -0,0 +1,191 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#include "elf_image.h"
+#include "elfio_wrapper.hpp"
+#pragma warning(push)
+#pragma warning(disable : 26495) // Always initialize a member variable
+#define ebpf_inst ebpf_inst_btf
+#include "libbtf/btf_type_data.h"
+#undef ebpf_inst
+#pragma warning(pop)
+
+#include <stdexcept>
+
+_elf_image::memory_streambuf::memory_streambuf(_In_reads_(size) const uint8_t* data, size_t size)
+{
+    // The stream is only used for input, so the buffer is never written through these pointers.
+    char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+    setg(begin, begin, begin + size);
+}
+
+_elf_image::memory_streambuf::pos_type
+_elf_image::memory_streambuf::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type size = egptr() - eback();
+    off_type position;
+    if (direction == std::ios_base::beg) {
+        position = offset;
+    } else if (direction == std::ios_base::cur) {
+        position = (gptr() - eback()) + offset;
+    } else {
+        position = size + offset;
+    }
+    if (position < 0 || position > size) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), eback() + position, egptr());
+    return pos_type(position);
+}
+
+_elf_image::memory_streambuf::pos_type
+_elf_image::memory_streambuf::seekpos(pos_type position, std::ios_base::openmode which)
+{
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+_elf_image::_elf_image(_In_reads_(size) const uint8_t* data, size_t size, const std::string& name)
+    : _data(data), _size(size), _name(name), _file_handle(INVALID_HANDLE_VALUE), _mapping_handle(nullptr),
+      _streambuf(data, size), _stream(&_streambuf), _reader_streambuf(data, size), _reader_stream(&_reader_streambuf),
+      _btf_parsed(false)
+{
+}
+
+_elf_image::~_elf_image()
+{
+    if (_mapping_handle != nullptr) {
+        UnmapViewOfFile(_data);
+        CloseHandle(_mapping_handle);
+    }
+    if (_file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file_handle);
+    }
+}
+
+std::unique_ptr<_elf_image>
+_elf_image::open_file(_In_z_ const char* path)
+{
+    HANDLE file_handle =
+        CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(std::string("No such file or directory opening ") + path);
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size) || static_cast<uint64_t>(file_size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file_handle);
+        throw std::runtime_error(std::string("Failed to determine file size: ") + path);
+    }
+
+    // A file can't be mapped if it is empty. Such a file is treated as an empty buffer, which then fails to parse.
+    HANDLE mapping_handle = nullptr;
+    const uint8_t* data = nullptr;
+    if (file_size.QuadPart > 0) {
+        mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle != nullptr) {
+            data = reinterpret_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (data == nullptr) {
+            if (mapping_handle != nullptr) {
+                CloseHandle(mapping_handle);
+            }
+            CloseHandle(file_handle);
+            throw std::runtime_error(std::string("Failed to read file: ") + path);
+        }
+    }
+
+    std::unique_ptr<_elf_image> image(new _elf_image(data, static_cast<size_t>(file_size.QuadPart), path));
+    image->_file_handle = file_handle;
+    image->_mapping_handle = mapping_handle;
+    return image;
+}
+
+std::unique_ptr<_elf_image>
+_elf_image::open_memory(_In_reads_(size) const uint8_t* data, size_t size, _In_z_ const char* name)
+{
+    return std::unique_ptr<_elf_image>(new _elf_image(data, size, name));
+}
+
+std::istream&
+_elf_image::stream()
+{
+    _stream.clear();
+    _stream.seekg(0, std::ios::beg);
+    return _stream;
+}
+
+const ELFIO::elfio&
+_elf_image::reader()
+{
+    if (!_reader) {
+        // Load lazily, so that the contents of a section are only copied out of the image if they are used.
+        auto reader = std::make_unique<ELFIO::elfio>();
+        if (!reader->load(_reader_stream, true)) {
+            throw std::runtime_error(std::string("Can't process ELF file ") + _name);
+        }
+        _reader = std::move(reader);
+    }
+    return *_reader;
+}
+
+const libbtf::btf_type_data*
+_elf_image::btf()
+{
+    if (!_btf_parsed) {
+        const ELFIO::section* btf_section = reader().sections[".BTF"];
+        if (btf_section != nullptr && btf_section->get_type() != ELFIO::SHT_NOBITS && btf_section->get_size() > 0) {
+            // Parse the section from the image, rather than have ELFIO copy it first.
+            uint64_t offset = btf_section->get_offset();
+            uint64_t size = btf_section->get_size();
+            if (offset > _size || size > _size - offset) {
+                throw std::runtime_error(std::string("Invalid .BTF section in ELF file ") + _name);
+            }
+            const std::byte* btf_data = reinterpret_cast<const std::byte*>(_data + offset);
+            _btf = std::make_unique<libbtf::btf_type_data>(std::vector<std::byte>(btf_data, btf_data + size));
+        }
+        _btf_parsed = true;
+    }
+    return _btf.get();
+}
+
+const std::vector<_elf_image::symbol_t>&
+_elf_image::symbols_in_section(uint16_t section_index)
+{
+    if (!_symbols_by_section) {
+        std::map<uint16_t, std::vector<symbol_t>> symbols_by_section;
+        const ELFIO::section* symbol_section = reader().sections[".symtab"];
+        if (symbol_section != nullptr) {
+            ELFIO::const_symbol_section_accessor symbols{reader(), symbol_section};
+            for (ELFIO::Elf_Xword i = 0; i < symbols.get_symbols_num(); i++) {
+                std::string symbol_name;
+                ELFIO::Elf64_Addr symbol_value{};
+                unsigned char symbol_bind{};
+                unsigned char symbol_type{};
+                ELFIO::Elf_Half symbol_section_index{};
+                unsigned char symbol_other{};
+                ELFIO::Elf_Xword symbol_size{};
+
+                symbols.get_symbol(
+                    i,
+                    symbol_name,
+                    symbol_value,
+                    symbol_size,
+                    symbol_bind,
+                    symbol_type,
+                    symbol_section_index,
+                    symbol_other);
+                symbols_by_section[symbol_section_index].push_back({std::move(symbol_name), symbol_value});
+            }
+        }
+        _symbols_by_section = std::move(symbols_by_section);
+    }
+
+    static const std::vector<symbol_t> no_symbols;
+    auto it = _symbols_by_section->find(section_index);
+    return (it != _symbols_by_section->end()) ? it->second : no_symbols;
+}
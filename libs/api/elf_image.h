@@ -0,0 +1,147 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <windows.h> // per .clang-format windows should be included early.
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ELFIO {
+class elfio;
+}
+
+namespace libbtf {
+class btf_type_data;
+}
+
+/**
+ * @brief Read-only view of an ELF file that is shared by all stages that process the file, so that the file is
+ * read once and its headers, symbols and BTF data are parsed at most once. A file is mapped into memory rather than
+ * copied, and a buffer provided by the caller is used in place.
+ *
+ * prevail::read_elf only accepts a stream, so it still parses the ELF headers, sections and relocations of the file
+ * on its own, from stream(). The image saves the copies of the file, not that parse.
+ */
+typedef class _elf_image
+{
+  public:
+    typedef struct _symbol
+    {
+        std::string name;
+        uint64_t value;
+    } symbol_t;
+
+    /**
+     * @brief Map an ELF file into memory.
+     *
+     * @param[in] path Path of the ELF file.
+     * @returns The image of the file.
+     * @throws std::runtime_error The file could not be opened or mapped.
+     */
+    static std::unique_ptr<_elf_image>
+    open_file(_In_z_ const char* path);
+
+    /**
+     * @brief Use an ELF file that is already in memory. The buffer is not copied and must outlive the image.
+     *
+     * @param[in] data Contents of the ELF file.
+     * @param[in] size Size of the ELF file.
+     * @param[in] name Name of the ELF file used in error messages.
+     * @returns The image of the buffer.
+     */
+    static std::unique_ptr<_elf_image>
+    open_memory(_In_reads_(size) const uint8_t* data, size_t size, _In_z_ const char* name);
+
+    ~_elf_image();
+
+    _elf_image(const _elf_image&) = delete;
+    _elf_image&
+    operator=(const _elf_image&) = delete;
+
+    const std::string&
+    name() const
+    {
+        return _name;
+    }
+
+    const uint8_t*
+    data() const
+    {
+        return _data;
+    }
+
+    size_t
+    size() const
+    {
+        return _size;
+    }
+
+    /**
+     * @brief Get a stream over the contents of the file, positioned at the start. The stream reads the mapped
+     * memory directly. The stream is shared by all callers, so each caller must be done with it before the next
+     * call.
+     */
+    std::istream&
+    stream();
+
+    /**
+     * @brief Get the parsed ELF headers and sections. The contents of a section are only read when they are first
+     * requested.
+     *
+     * @throws std::runtime_error The file is not a valid ELF file.
+     */
+    const ELFIO::elfio&
+    reader();
+
+    /**
+     * @brief Get the parsed contents of the .BTF section.
+     *
+     * @returns The BTF data, or nullptr if the file has no .BTF section.
+     */
+    const libbtf::btf_type_data*
+    btf();
+
+    /**
+     * @brief Get the symbols defined in a section, in symbol table order.
+     *
+     * @param[in] section_index Index of the section.
+     */
+    const std::vector<symbol_t>&
+    symbols_in_section(uint16_t section_index);
+
+  private:
+    _elf_image(_In_reads_(size) const uint8_t* data, size_t size, const std::string& name);
+
+    class memory_streambuf : public std::streambuf
+    {
+      public:
+        memory_streambuf(_In_reads_(size) const uint8_t* data, size_t size);
+
+      protected:
+        pos_type
+        seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+
+        pos_type
+        seekpos(pos_type position, std::ios_base::openmode which) override;
+    };
+
+    const uint8_t* _data;
+    size_t _size;
+    std::string _name;
+    HANDLE _file_handle;
+    HANDLE _mapping_handle;
+    memory_streambuf _streambuf;
+    std::istream _stream;
+    memory_streambuf _reader_streambuf; ///< Used by _reader to read sections on demand, independently of _stream.
+    std::istream _reader_stream;
+    std::unique_ptr<ELFIO::elfio> _reader;
+    bool _btf_parsed;
+    std::unique_ptr<libbtf::btf_type_data> _btf;
+    std::optional<std::map<uint16_t, std::vector<symbol_t>>> _symbols_by_section;
+} elf_image_t;
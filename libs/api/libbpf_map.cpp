@@ -299,6 +299,12 @@ bpf_map_lookup_elem(int fd, const void* key, void* value)
     return libbpf_result_err(ebpf_map_lookup_element(fd, key, value));
 }
 
+int
+bpf_map_lookup_elem_flags(int fd, const void* key, void* value, __u64 flags)
+{
+    return libbpf_result_err(ebpf_map_lookup_element_flags(fd, key, value, flags));
+}
+
 int
 bpf_map_lookup_batch(
     int fd,
@@ -0,0 +1,224 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#include "pcap_reader.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdlib.h>
+
+// Classic pcap magic numbers, as they appear when read in host (little-endian) order.
+#define PCAP_MAGIC_MICROSECONDS 0xa1b2c3d4
+#define PCAP_MAGIC_NANOSECONDS 0xa1b23c4d
+#define PCAP_MAGIC_MICROSECONDS_SWAPPED 0xd4c3b2a1
+#define PCAP_MAGIC_NANOSECONDS_SWAPPED 0x4d3cb2a1
+#define PCAP_FILE_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
+
+// pcapng block types and byte-order magic.
+#define PCAPNG_BLOCK_TYPE_SECTION_HEADER 0x0a0d0d0a
+#define PCAPNG_BLOCK_TYPE_PACKET 0x00000002
+#define PCAPNG_BLOCK_TYPE_SIMPLE_PACKET 0x00000003
+#define PCAPNG_BLOCK_TYPE_ENHANCED_PACKET 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+#define PCAPNG_BYTE_ORDER_MAGIC_SWAPPED 0x4d3c2b1a
+// Block type + block total length + byte-order magic.
+#define PCAPNG_SECTION_HEADER_MINIMUM_SIZE 12
+// Block type + block total length, before the body.
+#define PCAPNG_BLOCK_HEADER_SIZE 8
+// Trailing copy of the block total length, after the body.
+#define PCAPNG_BLOCK_TRAILER_SIZE 4
+// Fixed fields of an enhanced (or obsolete) packet block body, before the packet data.
+#define PCAPNG_PACKET_BLOCK_FIXED_SIZE 20
+
+typedef class _pcap_cursor
+{
+  public:
+    _pcap_cursor(const std::vector<uint8_t>& buffer) : _buffer(buffer), _swapped(false) {}
+
+    void
+    set_swapped(bool swapped)
+    {
+        _swapped = swapped;
+    }
+
+    _Must_inspect_result_ bool
+    read_uint32(size_t offset, _Out_ uint32_t* value) const
+    {
+        *value = 0;
+        if (offset > _buffer.size() || _buffer.size() - offset < sizeof(uint32_t)) {
+            return false;
+        }
+        uint32_t raw = static_cast<uint32_t>(_buffer[offset]) | (static_cast<uint32_t>(_buffer[offset + 1]) << 8) |
+                       (static_cast<uint32_t>(_buffer[offset + 2]) << 16) |
+                       (static_cast<uint32_t>(_buffer[offset + 3]) << 24);
+        *value = _swapped ? _byteswap_ulong(raw) : raw;
+        return true;
+    }
+
+    _Must_inspect_result_ bool
+    append_bytes(size_t offset, size_t length, _Inout_ std::vector<std::vector<uint8_t>>& packets) const
+    {
+        if (offset > _buffer.size() || _buffer.size() - offset < length) {
+            return false;
+        }
+        packets.emplace_back(_buffer.begin() + offset, _buffer.begin() + offset + length);
+        return true;
+    }
+
+    size_t
+    size() const
+    {
+        return _buffer.size();
+    }
+
+  private:
+    const std::vector<uint8_t>& _buffer;
+    bool _swapped;
+} pcap_cursor_t;
+
+static _Must_inspect_result_ ebpf_result_t
+_ebpf_pcap_parse_classic(
+    _Inout_ pcap_cursor_t& cursor, uint32_t magic, _Inout_ std::vector<std::vector<uint8_t>>& packets)
+{
+    cursor.set_swapped(magic == PCAP_MAGIC_MICROSECONDS_SWAPPED || magic == PCAP_MAGIC_NANOSECONDS_SWAPPED);
+    if (cursor.size() < PCAP_FILE_HEADER_SIZE) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    size_t offset = PCAP_FILE_HEADER_SIZE;
+    while (offset < cursor.size()) {
+        uint32_t captured_length;
+        // The captured length follows the two timestamp fields.
+        if (!cursor.read_uint32(offset + 8, &captured_length)) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        offset += PCAP_RECORD_HEADER_SIZE;
+        if (!cursor.append_bytes(offset, captured_length, packets)) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        offset += captured_length;
+    }
+
+    return EBPF_SUCCESS;
+}
+
+static _Must_inspect_result_ ebpf_result_t
+_ebpf_pcap_parse_next_generation(_Inout_ pcap_cursor_t& cursor, _Inout_ std::vector<std::vector<uint8_t>>& packets)
+{
+    size_t offset = 0;
+    bool section_swapped = false;
+    while (offset < cursor.size()) {
+        uint32_t block_type;
+        uint32_t block_length;
+
+        // The section header block type is a palindrome, so it can be recognized before the byte order is known.
+        cursor.set_swapped(false);
+        if (!cursor.read_uint32(offset, &block_type)) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        if (block_type == PCAPNG_BLOCK_TYPE_SECTION_HEADER) {
+            // Each section header carries the byte order of the blocks that follow it.
+            uint32_t byte_order_magic;
+            if (!cursor.read_uint32(offset + PCAPNG_BLOCK_HEADER_SIZE, &byte_order_magic)) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            if (byte_order_magic == PCAPNG_BYTE_ORDER_MAGIC_SWAPPED) {
+                section_swapped = true;
+            } else if (byte_order_magic == PCAPNG_BYTE_ORDER_MAGIC) {
+                section_swapped = false;
+            } else {
+                return EBPF_INVALID_ARGUMENT;
+            }
+        }
+        cursor.set_swapped(section_swapped);
+
+        if (!cursor.read_uint32(offset, &block_type) || !cursor.read_uint32(offset + 4, &block_length)) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        if (block_length < PCAPNG_BLOCK_HEADER_SIZE + PCAPNG_BLOCK_TRAILER_SIZE || (block_length % 4) != 0 ||
+            block_length > cursor.size() - offset) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+
+        size_t body = offset + PCAPNG_BLOCK_HEADER_SIZE;
+        size_t body_length = block_length - PCAPNG_BLOCK_HEADER_SIZE - PCAPNG_BLOCK_TRAILER_SIZE;
+        uint32_t captured_length;
+        switch (block_type) {
+        case PCAPNG_BLOCK_TYPE_ENHANCED_PACKET:
+        case PCAPNG_BLOCK_TYPE_PACKET:
+            // Interface ID (and drop count for the obsolete packet block), timestamp (high), timestamp (low),
+            // captured length and original length precede the packet data in both block types.
+            if (body_length < PCAPNG_PACKET_BLOCK_FIXED_SIZE || !cursor.read_uint32(body + 12, &captured_length) ||
+                captured_length > body_length - PCAPNG_PACKET_BLOCK_FIXED_SIZE ||
+                !cursor.append_bytes(body + PCAPNG_PACKET_BLOCK_FIXED_SIZE, captured_length, packets)) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            break;
+        case PCAPNG_BLOCK_TYPE_SIMPLE_PACKET: {
+            // Original length, then as much of the packet as fits in the block.
+            uint32_t original_length;
+            if (body_length < sizeof(uint32_t) || !cursor.read_uint32(body, &original_length)) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            size_t available = body_length - sizeof(uint32_t);
+            captured_length = static_cast<uint32_t>((original_length < available) ? original_length : available);
+            if (!cursor.append_bytes(body + sizeof(uint32_t), captured_length, packets)) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            break;
+        }
+        default:
+            // Section headers, interface descriptions, statistics, etc. carry no packet data.
+            break;
+        }
+
+        offset += block_length;
+    }
+
+    return EBPF_SUCCESS;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_pcap_read_file(_In_z_ const char* file_name, _Out_ std::vector<std::vector<uint8_t>>& packets) noexcept
+try {
+    packets.clear();
+
+    std::ifstream stream(file_name, std::ios::binary);
+    if (!stream.is_open()) {
+        return EBPF_FILE_NOT_FOUND;
+    }
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    pcap_cursor_t cursor(buffer);
+    uint32_t magic;
+    if (!cursor.read_uint32(0, &magic)) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    ebpf_result_t result;
+    switch (magic) {
+    case PCAP_MAGIC_MICROSECONDS:
+    case PCAP_MAGIC_NANOSECONDS:
+    case PCAP_MAGIC_MICROSECONDS_SWAPPED:
+    case PCAP_MAGIC_NANOSECONDS_SWAPPED:
+        result = _ebpf_pcap_parse_classic(cursor, magic, packets);
+        break;
+    case PCAPNG_BLOCK_TYPE_SECTION_HEADER:
+        result = (cursor.size() < PCAPNG_SECTION_HEADER_MINIMUM_SIZE)
+                     ? EBPF_INVALID_ARGUMENT
+                     : _ebpf_pcap_parse_next_generation(cursor, packets);
+        break;
+    default:
+        result = EBPF_INVALID_ARGUMENT;
+        break;
+    }
+
+    if (result != EBPF_SUCCESS) {
+        packets.clear();
+    }
+    return result;
+} catch (const std::bad_alloc&) {
+    packets.clear();
+    return EBPF_NO_MEMORY;
+}
@@ -0,0 +1,27 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ebpf_result.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Read every captured packet from a pcap or pcapng file.
+ *
+ * Both byte orders and both the microsecond and nanosecond variants of the
+ * classic pcap format are accepted. For pcapng, enhanced, simple and
+ * (obsolete) packet blocks are returned in file order and all other block
+ * types are skipped. Only the captured portion of each packet is returned.
+ *
+ * @param[in] file_name Path of the capture file.
+ * @param[out] packets On success, the captured bytes of each packet.
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_FILE_NOT_FOUND The file could not be opened.
+ * @retval EBPF_INVALID_ARGUMENT The file is not a well-formed capture file.
+ * @retval EBPF_NO_MEMORY Out of memory.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_pcap_read_file(_In_z_ const char* file_name, _Out_ std::vector<std::vector<uint8_t>>& packets) noexcept;
@@ -361,6 +361,21 @@ ebpf_get_default_verifier_options(ebpf_verification_verbosity_t verbosity)
     return verifier_options;
 }
 
+void
+set_map_annotations(const std::vector<ebpf_verifier_map_info_t>& annotations)
+{
+    _map_annotations.clear();
+    _map_annotation_names.clear();
+    for (const auto& annotation : annotations) {
+        ebpf_verifier_map_info_t copy = annotation;
+        if (annotation.map_name != nullptr) {
+            _map_annotation_names.push_back(annotation.map_name);
+            copy.map_name = _map_annotation_names.back().c_str();
+        }
+        _map_annotations.push_back(copy);
+    }
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_get_map_annotations_from_verifier(
     _Outptr_result_buffer_maybenull_(*count) const ebpf_verifier_map_info_t** annotations, _Out_ size_t* count) noexcept
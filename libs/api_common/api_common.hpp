@@ -259,5 +259,14 @@ ebpf_verify_program(
     _In_ const prevail::VerifierOptions& options,
     _Out_ ebpf_api_verifier_stats_t* stats);
 
+/**
+ * @brief Replace the map annotations of the most recent verification on this thread, e.g. with annotations
+ * restored from the verification cache. Map names are copied.
+ *
+ * @param[in] annotations Annotations to store.
+ */
+void
+set_map_annotations(const std::vector<ebpf_verifier_map_info_t>& annotations);
+
 prevail::VerifierOptions
 ebpf_get_default_verifier_options(ebpf_verification_verbosity_t verbosity = EBPF_VERIFICATION_VERBOSITY_NORMAL);
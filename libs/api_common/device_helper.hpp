@@ -15,6 +15,8 @@
 
 // Function codes from 0x800 to 0xFFF are for customer use.
 #define IOCTL_EBPF_CTL_METHOD_BUFFERED CTL_CODE(EBPF_IOCTL_TYPE, 0x900, METHOD_BUFFERED, FILE_ANY_ACCESS)
+// Large messages. The output buffer is locked and mapped instead of being copied through the system buffer.
+#define IOCTL_EBPF_CTL_METHOD_OUT_DIRECT CTL_CODE(EBPF_IOCTL_TYPE, 0x901, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
 
 // Maximum attempts to invoke an IOCTL.
 #define IOCTL_MAX_ATTEMPTS 16
@@ -73,7 +75,11 @@ get_async_ioctl_result(_In_ const async_ioctl_completion_t* ioctl_completion);
 
 template <typename request_t, typename reply_t = empty_reply_t>
 uint32_t
-invoke_ioctl(request_t& request, reply_t& reply = _empty_reply, _Inout_opt_ OVERLAPPED* overlapped = nullptr)
+invoke_ioctl(
+    request_t& request,
+    reply_t& reply = _empty_reply,
+    _Inout_opt_ OVERLAPPED* overlapped = nullptr,
+    unsigned long io_control_code = IOCTL_EBPF_CTL_METHOD_BUFFERED)
 {
     uint32_t return_value = ERROR_SUCCESS;
     uint32_t actual_reply_size;
@@ -120,7 +126,7 @@ invoke_ioctl(request_t& request, reply_t& reply = _empty_reply, _Inout_opt_ OVER
 
     success = Platform::DeviceIoControl(
         handle,
-        IOCTL_EBPF_CTL_METHOD_BUFFERED,
+        io_control_code,
         request_ptr,
         request_size,
         reply_ptr,
@@ -142,3 +148,13 @@ invoke_ioctl(request_t& request, reply_t& reply = _empty_reply, _Inout_opt_ OVER
 Exit:
     EBPF_RETURN_ERROR(return_value);
 }
+
+/**
+ * @brief Invoke a batch map operation as a large message. The request starts with an ebpf_operation_large_header_t.
+ */
+template <typename reply_t>
+uint32_t
+invoke_large_ioctl(ebpf_protocol_buffer_t& request, reply_t& reply)
+{
+    return invoke_ioctl(request, reply, nullptr, IOCTL_EBPF_CTL_METHOD_OUT_DIRECT);
+}
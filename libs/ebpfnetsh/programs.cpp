@@ -914,3 +914,98 @@ handle_ebpf_unpin_program(
             return ebpf_object_unpin(pinpath);
         });
 }
+
+// The following function uses windows specific type as an input to match
+// definition of "FN_HANDLE_CMD" in public file of NetSh.h
+unsigned long
+handle_ebpf_run_program(
+    LPCWSTR machine, LPWSTR* argv, DWORD current_index, DWORD argc, DWORD flags, LPCVOID data, BOOL* done)
+{
+    UNREFERENCED_PARAMETER(machine);
+    UNREFERENCED_PARAMETER(flags);
+    UNREFERENCED_PARAMETER(data);
+    UNREFERENCED_PARAMETER(done);
+
+    TAG_TYPE tags[] = {
+        {TOKEN_ID, NS_REQ_PRESENT, FALSE},
+        {TOKEN_FILENAME, NS_REQ_PRESENT, FALSE},
+        {TOKEN_REPEAT, NS_REQ_ZERO, FALSE},
+    };
+    const int ID_INDEX = 0;
+    const int FILENAME_INDEX = 1;
+    const int REPEAT_INDEX = 2;
+    unsigned long tag_type[_countof(tags)] = {0};
+
+    unsigned long status =
+        PreprocessCommand(nullptr, argv, current_index, argc, tags, _countof(tags), 0, _countof(tags), tag_type);
+
+    ebpf_id_t id = EBPF_ID_NONE;
+    std::string filename;
+    size_t repeat_count = 1;
+    for (int i = 0; (status == NO_ERROR) && ((i + current_index) < argc) && (i < _countof(tag_type)); i++) {
+        switch (tag_type[i]) {
+        case ID_INDEX: {
+            id = (uint32_t)_wtoi(argv[current_index + i]);
+            break;
+        }
+        case FILENAME_INDEX: {
+            filename = down_cast_from_wstring(std::wstring(argv[current_index + i]));
+            break;
+        }
+        case REPEAT_INDEX: {
+            repeat_count = (size_t)_wtoi(argv[current_index + i]);
+            if (repeat_count == 0) {
+                status = ERROR_INVALID_PARAMETER;
+            }
+            break;
+        }
+        default:
+            status = ERROR_INVALID_SYNTAX;
+            break;
+        }
+    }
+    if (status != NO_ERROR) {
+        return status;
+    }
+
+    ebpf_test_run_options_t* options = nullptr;
+    size_t input_count = 0;
+    ebpf_result_t result = ebpf_test_run_options_from_pcap(filename.c_str(), 0, &options, &input_count);
+    if (result != EBPF_SUCCESS) {
+        std::cerr << "error " << result << ": could not read packets from " << filename << std::endl;
+        return ERROR_SUPPRESS_OUTPUT;
+    }
+
+    fd_t program_fd = bpf_prog_get_fd_by_id(id);
+    if (program_fd == ebpf_fd_invalid) {
+        ebpf_free_test_run_options(options);
+        std::cerr << "Program not found." << std::endl;
+        return ERROR_SUPPRESS_OUTPUT;
+    }
+
+    for (size_t i = 0; i < input_count; i++) {
+        options[i].repeat_count = repeat_count;
+    }
+
+    ebpf_test_run_batch_summary_t summary;
+    result = ebpf_program_test_run_batch(program_fd, input_count, options, &summary);
+    Platform::_close(program_fd);
+
+    std::cout << "\n";
+    std::cout << " Packet  Length  Result  Duration(ns)\n";
+    std::cout << "=======  ======  ======  ============\n";
+    for (size_t i = 0; i < summary.input_count; i++) {
+        std::cout << std::setw(7) << i << "  " << std::setw(6) << options[i].data_size_in << "  " << std::setw(6)
+                  << options[i].return_value << "  " << std::setw(12) << options[i].duration << "\n";
+    }
+    std::cout << "\nPackets: " << summary.input_count << "  min: " << summary.min_duration
+              << " ns  p50: " << summary.p50_duration << " ns  p99: " << summary.p99_duration
+              << " ns  max: " << summary.max_duration << " ns  mean: " << summary.mean_duration << " ns\n";
+    ebpf_free_test_run_options(options);
+
+    if (result != EBPF_SUCCESS) {
+        std::cerr << "error " << result << ": test run failed on packet " << summary.input_count << std::endl;
+        return ERROR_SUPPRESS_OUTPUT;
+    }
+    return NO_ERROR;
+}
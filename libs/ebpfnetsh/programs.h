@@ -13,6 +13,7 @@ extern "C"
     FN_HANDLE_CMD handle_ebpf_add_program;
     FN_HANDLE_CMD handle_ebpf_delete_program;
     FN_HANDLE_CMD handle_ebpf_pin_program;
+    FN_HANDLE_CMD handle_ebpf_run_program;
     FN_HANDLE_CMD handle_ebpf_set_program;
     FN_HANDLE_CMD handle_ebpf_show_programs;
     FN_HANDLE_CMD handle_ebpf_unpin_program;
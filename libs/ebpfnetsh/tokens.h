@@ -13,6 +13,7 @@
 #define TOKEN_PINNED L"pinned"
 #define TOKEN_PINPATH L"pinpath"
 #define TOKEN_PROGRAM L"program"
+#define TOKEN_REPEAT L"repeat"
 #define TOKEN_SECTION L"section"
 #define TOKEN_TYPE L"type"
 
@@ -10,6 +10,8 @@
 #include "ebpf_extension_uuids.h"
 #include "ebpf_handle.h"
 #include "ebpf_link.h"
+#include "ebpf_map_cursor.h"
+#include "ebpf_map_queue.h"
 #include "ebpf_maps.h"
 #include "ebpf_native.h"
 #include "ebpf_pinning_table.h"
@@ -22,6 +24,7 @@
 #include "ebpf_tracelog.h"
 
 #include <errno.h>
+#include <intrin.h>
 #include <stdlib.h>
 
 const NPI_MODULEID ebpf_general_helper_function_module_id = {
@@ -184,6 +187,9 @@ static const void* _ebpf_general_helpers[] = {
     (void*)&_ebpf_core_get_current_thread_create_time,
     // No default implementation of bpf_redirect_map
     (void*)NULL, // bpf_redirect_map
+    // Incremental checksum update.
+    (void*)&ebpf_core_l3_csum_replace_s,
+    (void*)&ebpf_core_l4_csum_replace_s,
 };
 
 static const ebpf_helper_function_addresses_t _ebpf_global_helper_function_dispatch_table = {
@@ -549,6 +555,7 @@ _Must_inspect_result_ ebpf_result_t
 ebpf_core_create_map(
     _In_ const cxplat_utf8_string_t* map_name,
     _In_ const ebpf_map_definition_in_memory_t* ebpf_map_definition,
+    uint32_t map_flags,
     ebpf_handle_t inner_map_handle,
     _Out_ ebpf_handle_t* map_handle)
 {
@@ -556,7 +563,7 @@ ebpf_core_create_map(
     ebpf_result_t retval;
     ebpf_map_t* map = NULL;
 
-    retval = ebpf_map_create(map_name, ebpf_map_definition, inner_map_handle, &map);
+    retval = ebpf_map_create_with_flags(map_name, ebpf_map_definition, map_flags, inner_map_handle, &map);
     if (retval != EBPF_SUCCESS) {
         return retval;
     }
@@ -593,7 +600,34 @@ _ebpf_core_protocol_create_map(
         }
     }
 
-    retval = ebpf_core_create_map(&map_name, &request->ebpf_map_definition, request->inner_map_handle, &reply->handle);
+    retval =
+        ebpf_core_create_map(&map_name, &request->ebpf_map_definition, 0, request->inner_map_handle, &reply->handle);
+
+    EBPF_RETURN_RESULT(retval);
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_create_map_with_flags(
+    _In_ const struct _ebpf_operation_create_map_with_flags_request* request,
+    _Inout_ struct _ebpf_operation_create_map_with_flags_reply* reply)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t retval;
+    cxplat_utf8_string_t map_name = {0};
+
+    if (request->header.length > EBPF_OFFSET_OF(ebpf_operation_create_map_with_flags_request_t, data)) {
+        map_name.value = (uint8_t*)request->data;
+        retval = ebpf_safe_size_t_subtract(
+            request->header.length,
+            EBPF_OFFSET_OF(ebpf_operation_create_map_with_flags_request_t, data),
+            &map_name.length);
+        if (retval != EBPF_SUCCESS) {
+            EBPF_RETURN_RESULT(retval);
+        }
+    }
+
+    retval = ebpf_core_create_map(
+        &map_name, &request->ebpf_map_definition, request->map_flags, request->inner_map_handle, &reply->handle);
 
     EBPF_RETURN_RESULT(retval);
 }
@@ -738,6 +772,36 @@ Done:
     EBPF_RETURN_RESULT(result);
 }
 
+/**
+ * @brief Convert the EBPF_MAP_FIND_ELEMENT_FLAG_* flags of a request to EBPF_MAP_FLAG_* flags.
+ */
+static ebpf_result_t
+_ebpf_core_map_find_flags(uint8_t request_flags, _Out_ int* flags)
+{
+    *flags = 0;
+    if (request_flags & ~(EBPF_MAP_FIND_ELEMENT_FLAG_DELETE | EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MASK)) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    if (request_flags & EBPF_MAP_FIND_ELEMENT_FLAG_DELETE) {
+        *flags |= EBPF_MAP_FIND_FLAG_DELETE;
+    }
+    switch (request_flags & EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MASK) {
+    case EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_SUM:
+        *flags |= EBPF_MAP_FLAG_PERCPU_SUM;
+        break;
+    case EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MIN:
+        *flags |= EBPF_MAP_FLAG_PERCPU_MIN;
+        break;
+    case EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MAX:
+        *flags |= EBPF_MAP_FLAG_PERCPU_MAX;
+        break;
+    default:
+        break;
+    }
+    return EBPF_SUCCESS;
+}
+
 static ebpf_result_t
 _ebpf_core_protocol_map_find_element(
     _In_ const ebpf_operation_map_find_element_request_t* request,
@@ -767,13 +831,13 @@ _ebpf_core_protocol_map_find_element(
         goto Done;
     }
 
-    retval = ebpf_map_find_entry(
-        map,
-        key_length,
-        request->key,
-        value_length,
-        reply->value,
-        request->find_and_delete ? EBPF_MAP_FIND_FLAG_DELETE : 0);
+    int flags;
+    retval = _ebpf_core_map_find_flags(request->flags, &flags);
+    if (retval != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    retval = ebpf_map_find_entry(map, key_length, request->key, value_length, reply->value, flags);
     if (retval != EBPF_SUCCESS) {
         goto Done;
     }
@@ -824,8 +888,9 @@ Done:
 }
 
 static ebpf_result_t
-_ebpf_core_protocol_map_update_element_batch(
-    _In_ const ebpf_operation_map_update_element_batch_request_t* request,
+_ebpf_core_map_update_element_batch(
+    _In_reads_bytes_(request_length) const ebpf_operation_map_update_element_batch_request_t* request,
+    size_t request_length,
     _Inout_ ebpf_operation_map_update_element_batch_reply_t* reply)
 {
     EBPF_LOG_ENTRY();
@@ -844,7 +909,7 @@ _ebpf_core_protocol_map_update_element_batch(
     const ebpf_map_definition_in_memory_t* map_definition = ebpf_map_get_definition(map);
 
     retval = ebpf_safe_size_t_subtract(
-        request->header.length, EBPF_OFFSET_OF(ebpf_operation_map_update_element_batch_request_t, data), &data_length);
+        request_length, EBPF_OFFSET_OF(ebpf_operation_map_update_element_batch_request_t, data), &data_length);
     if (retval != EBPF_SUCCESS) {
         goto Done;
     }
@@ -889,6 +954,14 @@ Done:
     EBPF_RETURN_RESULT(retval);
 }
 
+static ebpf_result_t
+_ebpf_core_protocol_map_update_element_batch(
+    _In_ const ebpf_operation_map_update_element_batch_request_t* request,
+    _Inout_ ebpf_operation_map_update_element_batch_reply_t* reply)
+{
+    return _ebpf_core_map_update_element_batch(request, request->header.length, reply);
+}
+
 static ebpf_result_t
 _ebpf_core_protocol_map_update_element_with_handle(
     _In_ const ebpf_operation_map_update_element_with_handle_request_t* request)
@@ -945,8 +1018,9 @@ Done:
 }
 
 static ebpf_result_t
-_ebpf_core_protocol_map_delete_element_batch(
-    _In_ const ebpf_operation_map_delete_element_batch_request_t* request,
+_ebpf_core_map_delete_element_batch(
+    _In_reads_bytes_(request_length) const ebpf_operation_map_delete_element_batch_request_t* request,
+    size_t request_length,
     _Inout_ ebpf_operation_map_delete_element_batch_reply_t* reply)
 {
     EBPF_LOG_ENTRY();
@@ -962,7 +1036,7 @@ _ebpf_core_protocol_map_delete_element_batch(
     }
 
     retval = ebpf_safe_size_t_subtract(
-        request->header.length, EBPF_OFFSET_OF(ebpf_operation_map_delete_element_request_t, key), &key_length);
+        request_length, EBPF_OFFSET_OF(ebpf_operation_map_delete_element_batch_request_t, keys), &key_length);
     if (retval != EBPF_SUCCESS) {
         goto Done;
     }
@@ -992,6 +1066,14 @@ Done:
     EBPF_RETURN_RESULT(retval);
 }
 
+static ebpf_result_t
+_ebpf_core_protocol_map_delete_element_batch(
+    _In_ const ebpf_operation_map_delete_element_batch_request_t* request,
+    _Inout_ ebpf_operation_map_delete_element_batch_reply_t* reply)
+{
+    return _ebpf_core_map_delete_element_batch(request, request->header.length, reply);
+}
+
 static ebpf_result_t
 _ebpf_core_protocol_map_get_next_key(
     _In_ const ebpf_operation_map_get_next_key_request_t* request,
@@ -1053,10 +1135,13 @@ Done:
 }
 
 static ebpf_result_t
-_ebpf_core_protocol_map_get_next_key_value_batch(
-    _In_ const ebpf_operation_map_get_next_key_value_batch_request_t* request,
-    _Inout_ ebpf_operation_map_get_next_key_value_batch_reply_t* reply,
-    uint16_t reply_length)
+_ebpf_core_map_get_next_key_value_batch(
+    _In_reads_bytes_(request_length) const ebpf_operation_map_get_next_key_value_batch_request_t* request,
+    size_t request_length,
+    _Out_writes_bytes_to_(reply_length, *reply_used_length)
+        ebpf_operation_map_get_next_key_value_batch_reply_t* reply,
+    size_t reply_length,
+    _Out_ size_t* reply_used_length)
 {
     EBPF_LOG_ENTRY();
     ebpf_result_t retval;
@@ -1064,6 +1149,8 @@ _ebpf_core_protocol_map_get_next_key_value_batch(
     size_t previous_key_length;
     size_t reply_data_length = 0;
 
+    *reply_used_length = 0;
+
     retval = EBPF_OBJECT_REFERENCE_BY_HANDLE(request->handle, EBPF_OBJECT_MAP, (ebpf_core_object_t**)&map);
     if (retval != EBPF_SUCCESS) {
         goto Done;
@@ -1072,7 +1159,7 @@ _ebpf_core_protocol_map_get_next_key_value_batch(
     const ebpf_map_definition_in_memory_t* map_definition = ebpf_map_get_definition(map);
 
     retval = ebpf_safe_size_t_subtract(
-        request->header.length,
+        request_length,
         EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_request_t, previous_key),
         &previous_key_length);
 
@@ -1092,20 +1179,25 @@ _ebpf_core_protocol_map_get_next_key_value_batch(
         goto Done;
     }
 
+    int flags;
+    retval = _ebpf_core_map_find_flags(request->flags, &flags);
+    if (retval != EBPF_SUCCESS) {
+        goto Done;
+    }
+
     retval = ebpf_map_get_next_key_and_value_batch(
         map,
         previous_key_length,
         previous_key_length == 0 ? NULL : request->previous_key,
         &reply_data_length,
         reply->data,
-        request->find_and_delete ? EBPF_MAP_FIND_FLAG_DELETE : 0);
+        flags);
 
     if (retval != EBPF_SUCCESS) {
         goto Done;
     }
 
-    reply->header.length =
-        (uint16_t)(EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_reply_t, data) + reply_data_length);
+    *reply_used_length = EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_reply_t, data) + reply_data_length;
 
 Done:
     EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)map);
@@ -1113,6 +1205,21 @@ Done:
     EBPF_RETURN_RESULT(retval);
 }
 
+static ebpf_result_t
+_ebpf_core_protocol_map_get_next_key_value_batch(
+    _In_ const ebpf_operation_map_get_next_key_value_batch_request_t* request,
+    _Inout_ ebpf_operation_map_get_next_key_value_batch_reply_t* reply,
+    uint16_t reply_length)
+{
+    size_t reply_used_length;
+    ebpf_result_t retval = _ebpf_core_map_get_next_key_value_batch(
+        request, request->header.length, reply, reply_length, &reply_used_length);
+    if (retval == EBPF_SUCCESS) {
+        reply->header.length = (uint16_t)reply_used_length;
+    }
+    return retval;
+}
+
 /**
  * @brief Complete the test run of an eBPF program. This is called when a program test run has completed. This
  * function will build the reply message and send it to the client.
@@ -1241,6 +1348,164 @@ Done:
     EBPF_RETURN_RESULT(retval);
 }
 
+static void
+_ebpf_core_protocol_program_test_run_parallel_complete(
+    _In_ ebpf_result_t result,
+    _In_ const ebpf_program_t* program,
+    _In_ const ebpf_program_test_run_options_t* options,
+    _Inout_ void* completion_context,
+    _Inout_ void* async_context)
+{
+    ebpf_operation_program_test_run_parallel_reply_t* reply =
+        (ebpf_operation_program_test_run_parallel_reply_t*)completion_context;
+    if (result == EBPF_SUCCESS) {
+        size_t cpu_results_size = reply->cpu_result_count * sizeof(ebpf_test_run_cpu_result_t);
+
+        // The output data is written directly after the per-CPU results. If the program shrank it, the output
+        // context has to be moved down to follow it.
+        uint8_t* context_out = reply->data + cpu_results_size + options->data_size_out;
+        if (options->context_size_out > 0 && options->context_out != context_out) {
+            memmove(context_out, options->context_out, options->context_size_out);
+        }
+        reply->header.length = (uint16_t)(EBPF_OFFSET_OF(ebpf_operation_program_test_run_parallel_reply_t, data) +
+                                          cpu_results_size + options->data_size_out + options->context_size_out);
+        reply->return_value = options->return_value;
+        reply->context_offset = (uint32_t)(cpu_results_size + options->data_size_out);
+        reply->duration = options->duration;
+    }
+
+    ebpf_async_complete_with_epoch(async_context, reply->header.length, result);
+    EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)program);
+    ebpf_free((void*)options);
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_program_test_run_parallel(
+    _In_ const ebpf_operation_program_test_run_parallel_request_t* request,
+    _Inout_updates_bytes_(reply_length) ebpf_operation_program_test_run_parallel_reply_t* reply,
+    uint16_t reply_length,
+    _Inout_ void* async_context)
+{
+    EBPF_LOG_ENTRY();
+
+    ebpf_program_test_run_options_t* options = NULL;
+
+    ebpf_result_t retval;
+    ebpf_program_t* program = NULL;
+    size_t data_size_in;
+    size_t data_size_out;
+    size_t context_size_in;
+    size_t context_size_out;
+    size_t cpus_size;
+    size_t cpu_results_size;
+
+    if (request->cpu_count == 0) {
+        retval = EBPF_INVALID_ARGUMENT;
+        goto Done;
+    }
+    retval = ebpf_safe_size_t_multiply(request->cpu_count, sizeof(uint32_t), &cpus_size);
+    if (retval != EBPF_SUCCESS) {
+        goto Done;
+    }
+    retval = ebpf_safe_size_t_multiply(request->cpu_count, sizeof(ebpf_test_run_cpu_result_t), &cpu_results_size);
+    if (retval != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    // Subtract the CPU indices.
+    retval = ebpf_safe_size_t_subtract(request->context_offset, cpus_size, &data_size_in);
+    if (retval != EBPF_SUCCESS) {
+        // Context offset doesn't leave room for the CPU indices.
+        goto Done;
+    }
+
+    context_size_in = request->header.length;
+
+    // Subtract the header.
+    retval = ebpf_safe_size_t_subtract(
+        context_size_in, EBPF_OFFSET_OF(ebpf_operation_program_test_run_parallel_request_t, data), &context_size_in);
+    if (retval != EBPF_SUCCESS) {
+        // Request isn't big enough to contain the header.
+        goto Done;
+    }
+
+    // Subtract the CPU indices and the data size.
+    retval = ebpf_safe_size_t_subtract(context_size_in, request->context_offset, &context_size_in);
+    if (retval != EBPF_SUCCESS) {
+        // Request isn't big enough to contain the CPU indices and the data.
+        goto Done;
+    }
+
+    data_size_out = reply_length;
+
+    // Subtract the header.
+    retval = ebpf_safe_size_t_subtract(
+        data_size_out, EBPF_OFFSET_OF(ebpf_operation_program_test_run_parallel_reply_t, data), &data_size_out);
+    if (retval != EBPF_SUCCESS) {
+        // Reply isn't big enough to contain the header.
+        goto Done;
+    }
+
+    // Subtract the per-CPU results.
+    retval = ebpf_safe_size_t_subtract(data_size_out, cpu_results_size, &data_size_out);
+    if (retval != EBPF_SUCCESS) {
+        // Reply isn't big enough to contain the header and the per-CPU results.
+        goto Done;
+    }
+
+    if (context_size_in > 0) {
+        context_size_out = context_size_in;
+        // Subtract the context size.
+        retval = ebpf_safe_size_t_subtract(data_size_out, context_size_out, &data_size_out);
+        if (retval != EBPF_SUCCESS) {
+            // Reply isn't big enough to contain the header, the per-CPU results and the context.
+            goto Done;
+        }
+    } else {
+        context_size_out = 0;
+    }
+
+    retval =
+        EBPF_OBJECT_REFERENCE_BY_HANDLE(request->program_handle, EBPF_OBJECT_PROGRAM, (ebpf_core_object_t**)&program);
+    if (retval != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    options = (ebpf_program_test_run_options_t*)ebpf_allocate_with_tag(
+        sizeof(ebpf_program_test_run_options_t), EBPF_POOL_TAG_DEFAULT);
+    if (!options) {
+        retval = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    reply->cpu_result_count = request->cpu_count;
+    options->data_size_in = data_size_in;
+    options->context_size_in = context_size_in;
+    options->context_size_out = context_size_out;
+    options->data_size_out = data_size_out;
+    options->repeat_count = request->repeat_count ? request->repeat_count : 1;
+    options->flags = request->flags;
+    options->cpus = (const uint32_t*)request->data;
+    options->cpu_count = request->cpu_count;
+    options->batch_size = request->batch_size;
+    options->data_in = options->data_size_in ? request->data + cpus_size : NULL;
+    options->context_in = options->context_size_in ? request->data + request->context_offset : NULL;
+    options->cpu_results = (ebpf_test_run_cpu_result_t*)reply->data;
+    options->data_out = options->data_size_out ? reply->data + cpu_results_size : NULL;
+    options->context_out =
+        options->context_size_out ? reply->data + cpu_results_size + options->data_size_out : NULL;
+
+    retval = ebpf_program_execute_test_run(
+        program, options, async_context, reply, _ebpf_core_protocol_program_test_run_parallel_complete);
+
+Done:
+    if (retval != EBPF_PENDING) {
+        ebpf_free(options);
+        EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)program);
+    }
+    EBPF_RETURN_RESULT(retval);
+}
+
 static ebpf_result_t
 _ebpf_core_protocol_query_program_info(
     _In_ const struct _ebpf_operation_query_program_info_request* request,
@@ -2555,6 +2820,76 @@ _ebpf_core_trace_printk5(
     return _ebpf_core_trace_printk(fmt, fmt_size, 3, arg3, arg4, arg5);
 }
 
+// Buffers shorter than this are summed with the scalar loop, as the vector setup costs more than it saves.
+#define EBPF_CORE_CSUM_VECTOR_MINIMUM_SIZE 16
+
+/**
+ * @brief Sum a buffer as a sequence of 16-bit words, without folding the carries.
+ *
+ * @param[in] words Words to sum.
+ * @param[in] word_count Number of words.
+ * @returns Sum of the words.
+ */
+static uint64_t
+_ebpf_core_sum_words_scalar(_In_reads_(word_count) const uint16_t* words, size_t word_count)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < word_count; i++) {
+        sum += words[i];
+    }
+    return sum;
+}
+
+#if defined(_M_X64)
+/**
+ * @brief Sum a buffer as a sequence of 16-bit words using SSE2, without folding the carries.
+ *
+ * The low and high bytes of each word are summed separately with PSADBW, which adds eight bytes into a 64-bit lane
+ * per instruction, and recombined at the end. SSE2 is part of the x64 baseline, so no CPU feature check is needed.
+ *
+ * @param[in] words Words to sum.
+ * @param[in] word_count Number of words.
+ * @returns Sum of the words.
+ */
+static uint64_t
+_ebpf_core_sum_words_sse2(_In_reads_(word_count) const uint16_t* words, size_t word_count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low_byte_mask = _mm_set1_epi16(0x00ff);
+    __m128i low_sum = zero;
+    __m128i high_sum = zero;
+    size_t block_count = word_count / 8;
+
+    for (size_t i = 0; i < block_count; i++) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(words + i * 8));
+        low_sum = _mm_add_epi64(low_sum, _mm_sad_epu8(_mm_and_si128(block, low_byte_mask), zero));
+        high_sum = _mm_add_epi64(high_sum, _mm_sad_epu8(_mm_srli_epi16(block, 8), zero));
+    }
+
+    __m128i total = _mm_add_epi64(low_sum, _mm_slli_epi64(high_sum, 8));
+    uint64_t sum =
+        (uint64_t)_mm_cvtsi128_si64(total) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total));
+
+    return sum + _ebpf_core_sum_words_scalar(words + block_count * 8, word_count - block_count * 8);
+}
+#endif
+
+static uint64_t
+_ebpf_core_sum_words(_In_reads_bytes_opt_(size) const void* buffer, int size)
+{
+    if (buffer == NULL || size <= 0) {
+        return 0;
+    }
+
+    size_t word_count = (size_t)size / sizeof(uint16_t);
+#if defined(_M_X64)
+    if (size >= EBPF_CORE_CSUM_VECTOR_MINIMUM_SIZE) {
+        return _ebpf_core_sum_words_sse2((const uint16_t*)buffer, word_count);
+    }
+#endif
+    return _ebpf_core_sum_words_scalar((const uint16_t*)buffer, word_count);
+}
+
 int
 ebpf_core_csum_diff(
     _In_reads_bytes_opt_(from_size) const void* from,
@@ -2570,17 +2905,14 @@ ebpf_core_csum_diff(
         goto Exit;
     }
 
-    csum_diff = seed;
-    if (to != NULL) {
-        for (int i = 0; i < to_size / 2; i++) {
-            csum_diff += (uint16_t)(*((uint16_t*)to + i));
-        }
-    }
-    if (from != NULL) {
-        for (int i = 0; i < from_size / 2; i++) {
-            csum_diff += (uint16_t)(~*((uint16_t*)from + i));
-        }
-    }
+    // The one's complement of a word is 0xffff minus the word, so each word of the "from" buffer contributes
+    // 0xffff less its value.
+    uint64_t from_word_count = (from != NULL && from_size > 0) ? (uint64_t)from_size / sizeof(uint16_t) : 0;
+    uint64_t sum = (uint64_t)(int64_t)seed + _ebpf_core_sum_words(to, to_size) + (from_word_count * UINT16_MAX) -
+                   _ebpf_core_sum_words(from, from_size);
+
+    // Truncate to 32 bits, matching a running sum kept in a 32-bit integer.
+    csum_diff = (int)(uint32_t)sum;
 
     // Adding 16-bit unsigned integers or their one's complement will produce a positive 32-bit integer,
     // unless the length of the buffers is so long, that the signed 32 bit output overflows and produces a negative
@@ -2592,6 +2924,112 @@ Exit:
     return csum_diff;
 }
 
+/**
+ * @brief Fold a one's complement sum into 16 bits.
+ *
+ * @param[in] sum Unfolded sum.
+ * @returns Folded sum.
+ */
+static uint16_t
+_ebpf_core_csum_fold(uint64_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & UINT16_MAX) + (sum >> 16);
+    }
+    return (uint16_t)sum;
+}
+
+/**
+ * @brief Incrementally update a 16-bit Internet checksum as described in RFC 1624: HC' = ~(~HC + ~m + m').
+ *
+ * @param[in, out] checksum Checksum to update.
+ * @param[in] from Old value of the modified field.
+ * @param[in] to New value of the modified field, or a checksum delta if field_size is 0.
+ * @param[in] field_size Size in bytes of the modified field: 2, 4, or 0 if "to" is a delta from bpf_csum_diff.
+ * @retval 0 The checksum was updated.
+ * @retval -EINVAL An argument is invalid.
+ */
+static long
+_ebpf_core_csum_replace(_Inout_ uint16_t* checksum, uint64_t from, uint64_t to, uint64_t field_size)
+{
+    uint64_t sum = (uint16_t)~*checksum;
+
+    switch (field_size) {
+    case 0:
+        if (from != 0) {
+            return -EINVAL;
+        }
+        sum += (uint32_t)to;
+        break;
+    case sizeof(uint16_t):
+        sum += (uint16_t)~from + (uint64_t)(uint16_t)to;
+        break;
+    case sizeof(uint32_t):
+        sum += (uint16_t)~from + (uint64_t)(uint16_t)~(from >> 16);
+        sum += (uint64_t)(uint16_t)to + (uint16_t)(to >> 16);
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    *checksum = (uint16_t)~_ebpf_core_csum_fold(sum);
+    return 0;
+}
+
+long
+ebpf_core_l3_csum_replace_s(
+    _Inout_updates_bytes_(checksum_size) void* checksum,
+    uint32_t checksum_size,
+    uint64_t from,
+    uint64_t to,
+    uint64_t flags)
+{
+    if (checksum_size != sizeof(uint16_t) || (flags & ~BPF_F_HDR_FIELD_MASK) != 0) {
+        return -EINVAL;
+    }
+
+    // The checksum field need not be aligned within the packet.
+    uint16_t value;
+    memcpy(&value, checksum, sizeof(value));
+    long result = _ebpf_core_csum_replace(&value, from, to, flags & BPF_F_HDR_FIELD_MASK);
+    if (result == 0) {
+        memcpy(checksum, &value, sizeof(value));
+    }
+    return result;
+}
+
+long
+ebpf_core_l4_csum_replace_s(
+    _Inout_updates_bytes_(checksum_size) void* checksum,
+    uint32_t checksum_size,
+    uint64_t from,
+    uint64_t to,
+    uint64_t flags)
+{
+    if (checksum_size != sizeof(uint16_t) ||
+        (flags & ~(BPF_F_HDR_FIELD_MASK | BPF_F_PSEUDO_HDR | BPF_F_MARK_MANGLED_0)) != 0) {
+        return -EINVAL;
+    }
+
+    uint16_t value;
+    memcpy(&value, checksum, sizeof(value));
+
+    // A zero UDP checksum means that no checksum was computed, so it must stay zero.
+    bool mark_mangled_zero = (flags & BPF_F_MARK_MANGLED_0) != 0;
+    if (mark_mangled_zero && value == 0) {
+        return 0;
+    }
+
+    long result = _ebpf_core_csum_replace(&value, from, to, flags & BPF_F_HDR_FIELD_MASK);
+    if (result == 0) {
+        if (mark_mangled_zero && value == 0) {
+            value = UINT16_MAX;
+        }
+        memcpy(checksum, &value, sizeof(value));
+    }
+    return result;
+}
+
 static int
 _ebpf_core_ring_buffer_output(
     _Inout_ ebpf_map_t* map, _In_reads_bytes_(length) uint8_t* data, size_t length, uint64_t flags)
@@ -2651,6 +3089,283 @@ Exit:
     EBPF_RETURN_RESULT(result);
 }
 
+static ebpf_result_t
+_ebpf_core_protocol_map_map_memory(
+    _In_ const ebpf_operation_map_map_memory_request_t* request,
+    _Inout_ ebpf_operation_map_map_memory_reply_t* reply)
+{
+    EBPF_LOG_ENTRY();
+
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_map_t* map = NULL;
+    void* address = NULL;
+    size_t size = 0;
+
+    result = EBPF_OBJECT_REFERENCE_BY_HANDLE(request->map_handle, EBPF_OBJECT_MAP, (ebpf_core_object_t**)&map);
+    EBPF_BAIL_ON_OBJECT_REF_ERROR(EBPF_TRACELOG_KEYWORD_BASE, result, request->map_handle, Exit);
+
+    result = ebpf_map_map_user_memory(map, request->writable != 0, &address, &size);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    reply->address = (uint64_t)address;
+    reply->size = size;
+
+Exit:
+    EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)map);
+    EBPF_RETURN_RESULT(result);
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_map_unmap_memory(_In_ const ebpf_operation_map_unmap_memory_request_t* request)
+{
+    EBPF_LOG_ENTRY();
+
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_map_t* map = NULL;
+    result = EBPF_OBJECT_REFERENCE_BY_HANDLE(request->map_handle, EBPF_OBJECT_MAP, (ebpf_core_object_t**)&map);
+    EBPF_BAIL_ON_OBJECT_REF_ERROR(EBPF_TRACELOG_KEYWORD_BASE, result, request->map_handle, Exit);
+    result = ebpf_map_unmap_user_memory(map, (const void*)(uintptr_t)request->address);
+
+Exit:
+    EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)map);
+    EBPF_RETURN_RESULT(result);
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_map_cursor_create(
+    _In_ const ebpf_operation_map_cursor_create_request_t* request,
+    _Inout_ ebpf_operation_map_cursor_create_reply_t* reply)
+{
+    EBPF_LOG_ENTRY();
+
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_map_t* map = NULL;
+    ebpf_map_cursor_t* cursor = NULL;
+    int flags;
+
+    // Only the per-CPU aggregation flags apply to a cursor.
+    if (request->flags & EBPF_MAP_FIND_ELEMENT_FLAG_DELETE) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Exit;
+    }
+    result = _ebpf_core_map_find_flags(request->flags, &flags);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    result = EBPF_OBJECT_REFERENCE_BY_HANDLE(request->map_handle, EBPF_OBJECT_MAP, (ebpf_core_object_t**)&map);
+    EBPF_BAIL_ON_OBJECT_REF_ERROR(EBPF_TRACELOG_KEYWORD_BASE, result, request->map_handle, Exit);
+
+    result = ebpf_map_cursor_create(map, flags, request->snapshot != 0, &cursor);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    result = ebpf_handle_create(&reply->cursor_handle, (ebpf_base_object_t*)cursor);
+
+Exit:
+    // On success the handle holds its own reference on the cursor.
+    ebpf_map_cursor_release_reference(cursor);
+    EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)map);
+    EBPF_RETURN_RESULT(result);
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_map_cursor_next(
+    _In_ const ebpf_operation_map_cursor_next_request_t* request,
+    _Inout_ ebpf_operation_map_cursor_next_reply_t* reply,
+    uint16_t reply_length)
+{
+    EBPF_LOG_ENTRY();
+
+    ebpf_result_t result;
+    ebpf_map_cursor_t* cursor = NULL;
+    size_t data_length;
+
+    result = ebpf_map_cursor_reference_by_handle(request->cursor_handle, &cursor);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    result = ebpf_safe_size_t_subtract(
+        reply_length, EBPF_OFFSET_OF(ebpf_operation_map_cursor_next_reply_t, data), &data_length);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    result = ebpf_map_cursor_next(cursor, &data_length, reply->data);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    reply->header.length = (uint16_t)(EBPF_OFFSET_OF(ebpf_operation_map_cursor_next_reply_t, data) + data_length);
+
+Exit:
+    ebpf_map_cursor_release_reference(cursor);
+    EBPF_RETURN_RESULT(result);
+}
+
+// State kept by the map queue notification handler across the submissions of a batch.
+typedef struct _ebpf_core_map_queue_context
+{
+    ebpf_handle_t map_handle; ///< Handle of the map used by the previous submission.
+    ebpf_map_t* map;          ///< Referenced map for map_handle, or NULL.
+} ebpf_core_map_queue_context_t;
+
+static ebpf_result_t
+_ebpf_core_map_queue_execute(
+    _Inout_opt_ void* context,
+    _In_ const ebpf_map_queue_submission_t* submission,
+    _Out_writes_bytes_opt_(submission->value_size) uint8_t* value)
+{
+    ebpf_core_map_queue_context_t* queue_context = (ebpf_core_map_queue_context_t*)context;
+    ebpf_result_t result;
+    ebpf_assert(queue_context != NULL);
+    __analysis_assume(queue_context != NULL);
+
+    // Batches usually target a single map, so keep the map referenced until the batch is done instead of resolving
+    // the handle for each submission.
+    if (queue_context->map == NULL || queue_context->map_handle != submission->map_handle) {
+        EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)queue_context->map);
+        queue_context->map = NULL;
+        result = EBPF_OBJECT_REFERENCE_BY_HANDLE(
+            submission->map_handle, EBPF_OBJECT_MAP, (ebpf_core_object_t**)&queue_context->map);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+        queue_context->map_handle = submission->map_handle;
+    }
+
+    switch (submission->operation) {
+    case EBPF_MAP_QUEUE_OPERATION_LOOKUP: {
+        int flags;
+        if (submission->flags > UINT8_MAX || value == NULL) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        result = _ebpf_core_map_find_flags((uint8_t)submission->flags, &flags);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+        return ebpf_map_find_entry(
+            queue_context->map, submission->key_size, submission->data, submission->value_size, value, flags);
+    }
+    case EBPF_MAP_QUEUE_OPERATION_UPDATE:
+        // Submissions are not validated by the IOCTL parser, which limits the option of an update request.
+        if (submission->flags > EBPF_EXIST) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        return ebpf_map_update_entry(
+            queue_context->map,
+            submission->key_size,
+            submission->data,
+            submission->value_size,
+            submission->data + submission->key_size,
+            (ebpf_map_option_t)submission->flags,
+            0);
+    case EBPF_MAP_QUEUE_OPERATION_DELETE:
+        if (submission->flags != 0) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        return ebpf_map_delete_entry(queue_context->map, submission->key_size, submission->data, 0);
+    default:
+        return EBPF_INVALID_ARGUMENT;
+    }
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_map_queue_create(
+    _In_ const ebpf_operation_map_queue_create_request_t* request,
+    _Inout_ ebpf_operation_map_queue_create_reply_t* reply)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    ebpf_map_queue_t* queue = NULL;
+    ebpf_map_queue_user_mapping_t mapping;
+    bool mapped = false;
+
+    result = ebpf_map_queue_create((size_t)request->ring_size, &queue);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    result = ebpf_map_queue_map_user(queue, request->wait_handle, &mapping);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+    mapped = true;
+
+    result = ebpf_handle_create(&reply->queue_handle, (ebpf_base_object_t*)queue);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    reply->submission_consumer_address = (uint64_t)mapping.submission_consumer;
+    reply->submission_producer_address = (uint64_t)mapping.submission_producer;
+    reply->submission_data_address = (uint64_t)mapping.submission_data;
+    reply->completion_consumer_address = (uint64_t)mapping.completion_consumer;
+    reply->completion_producer_address = (uint64_t)mapping.completion_producer;
+    reply->completion_data_address = (uint64_t)mapping.completion_data;
+    reply->ring_size = mapping.ring_size;
+
+Done:
+    if (result != EBPF_SUCCESS && mapped) {
+        ebpf_assert_success(ebpf_map_queue_unmap_user(queue));
+    }
+    // On success the handle holds its own reference on the queue.
+    ebpf_map_queue_release_reference(queue);
+    EBPF_RETURN_RESULT(result);
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_map_queue_notify(
+    _In_ const ebpf_operation_map_queue_notify_request_t* request,
+    _Inout_ ebpf_operation_map_queue_notify_reply_t* reply)
+{
+    // High volume call - Skip entry/exit logging.
+    ebpf_result_t result;
+    ebpf_map_queue_t* queue = NULL;
+    ebpf_core_map_queue_context_t context = {ebpf_handle_invalid, NULL};
+    size_t processed_count = 0;
+
+    result = ebpf_map_queue_reference_by_handle(request->queue_handle, &queue);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    // Map handles belong to the process that owns the queue, so the batch is processed inline in the caller's
+    // context rather than by a system worker.
+    result = ebpf_map_queue_process(queue, _ebpf_core_map_queue_execute, &context, &processed_count);
+    if (result == EBPF_NO_MEMORY) {
+        // The completion ring is full. The caller notifies again after consuming completions.
+        result = EBPF_SUCCESS;
+    }
+
+    reply->processed_count = processed_count;
+
+Done:
+    EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)context.map);
+    ebpf_map_queue_release_reference(queue);
+    return result;
+}
+
+static ebpf_result_t
+_ebpf_core_protocol_map_queue_unmap(_In_ const ebpf_operation_map_queue_unmap_request_t* request)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_map_queue_t* queue = NULL;
+
+    ebpf_result_t result = ebpf_map_queue_reference_by_handle(request->queue_handle, &queue);
+    EBPF_BAIL_ON_OBJECT_REF_ERROR(EBPF_TRACELOG_KEYWORD_BASE, result, request->queue_handle, Done);
+
+    result = ebpf_map_queue_unmap_user(queue);
+
+Done:
+    ebpf_map_queue_release_reference(queue);
+    EBPF_RETURN_RESULT(result);
+}
+
 static int
 _ebpf_core_perf_event_output(
     _In_ void* ctx, _Inout_ ebpf_map_t* map, uint64_t flags, _In_reads_bytes_(length) uint8_t* data, size_t length)
@@ -3007,6 +3722,16 @@ static ebpf_protocol_handler_t _ebpf_protocol_handlers[] = {
     DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_NO_REPLY(ring_buffer_map_unmap_buffer, PROTOCOL_ALL_MODES),
     DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_NO_REPLY_ASYNC(epoch_synchronize, PROTOCOL_ALL_MODES),
     DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_NO_REPLY(link_set_legacy_mode, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_VARIABLE_REQUEST_VARIABLE_REPLY_ASYNC(
+        program_test_run_parallel, data, data, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_FIXED_REPLY(map_queue_create, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_FIXED_REPLY(map_queue_notify, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_NO_REPLY(map_queue_unmap, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_FIXED_REPLY(map_map_memory, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_NO_REPLY(map_unmap_memory, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_FIXED_REPLY(map_cursor_create, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_VARIABLE_REPLY(map_cursor_next, data, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_VARIABLE_REQUEST_FIXED_REPLY(create_map_with_flags, data, PROTOCOL_ALL_MODES),
 };
 
 _Must_inspect_result_ ebpf_result_t
@@ -3279,6 +4004,95 @@ Done:
     return retval;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_core_invoke_large_protocol_handler(
+    ebpf_operation_id_t operation_id,
+    _In_reads_bytes_(input_buffer_length) const void* input_buffer,
+    uint32_t input_buffer_length,
+    _Out_writes_bytes_(output_buffer_length) void* output_buffer,
+    uint32_t output_buffer_length)
+{
+    ebpf_result_t retval;
+    ebpf_epoch_state_t epoch_state = {0};
+    const ebpf_operation_large_header_t* request = (const ebpf_operation_large_header_t*)input_buffer;
+    ebpf_operation_large_header_t* reply = (ebpf_operation_large_header_t*)output_buffer;
+    size_t request_length;
+    size_t reply_length = 0;
+
+    if (operation_id >= EBPF_COUNT_OF(_ebpf_protocol_handlers) || operation_id < 0) {
+        return EBPF_OPERATION_NOT_SUPPORTED;
+    }
+
+    // If the dispatch function is NULL, the operation is not supported.
+    if (_ebpf_protocol_handlers[operation_id].dispatch.default_case == NULL) {
+        return EBPF_BLOCKED_BY_POLICY;
+    }
+
+    if (!input_buffer || (input_buffer_length < sizeof(*request)) ||
+        (input_buffer_length > EBPF_MAX_LARGE_MESSAGE_LENGTH)) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    if (!output_buffer || (output_buffer_length < _ebpf_protocol_handlers[operation_id].minimum_reply_size) ||
+        (output_buffer_length > EBPF_MAX_LARGE_MESSAGE_LENGTH)) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // The operation to dispatch must be the one that is validated.
+    if (request->id != operation_id) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // Structural validation of the large message. This also rejects operations that do not accept large messages.
+    if (!ebpf_protocol_validate_large_ioctl_message((const uint8_t*)input_buffer, input_buffer_length)) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    request_length = ((size_t)request->length_high << 16) | request->length;
+    if (request_length < _ebpf_protocol_handlers[operation_id].minimum_request_size) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    ebpf_epoch_enter(&epoch_state);
+
+    switch (operation_id) {
+    case EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH:
+        reply_length = sizeof(ebpf_operation_map_update_element_batch_reply_t);
+        retval = _ebpf_core_map_update_element_batch(
+            (const ebpf_operation_map_update_element_batch_request_t*)request,
+            request_length,
+            (ebpf_operation_map_update_element_batch_reply_t*)reply);
+        break;
+    case EBPF_OPERATION_MAP_DELETE_ELEMENT_BATCH:
+        reply_length = sizeof(ebpf_operation_map_delete_element_batch_reply_t);
+        retval = _ebpf_core_map_delete_element_batch(
+            (const ebpf_operation_map_delete_element_batch_request_t*)request,
+            request_length,
+            (ebpf_operation_map_delete_element_batch_reply_t*)reply);
+        break;
+    case EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH:
+        retval = _ebpf_core_map_get_next_key_value_batch(
+            (const ebpf_operation_map_get_next_key_value_batch_request_t*)request,
+            request_length,
+            (ebpf_operation_map_get_next_key_value_batch_reply_t*)reply,
+            output_buffer_length,
+            &reply_length);
+        break;
+    default:
+        retval = EBPF_OPERATION_NOT_SUPPORTED;
+        break;
+    }
+
+    ebpf_epoch_exit(&epoch_state);
+
+    if (retval == EBPF_SUCCESS) {
+        reply->length = (uint16_t)reply_length;
+        reply->length_high = (uint16_t)(reply_length >> 16);
+        reply->id = operation_id;
+    }
+    return retval;
+}
+
 bool
 ebpf_core_cancel_protocol_handler(_Inout_ void* async_context)
 {
@@ -65,6 +65,32 @@ extern "C"
         _Inout_opt_ void* async_context,
         _In_opt_ void (*on_complete)(_Inout_ void*, size_t, ebpf_result_t));
 
+    /**
+     * @brief Invoke a batch map operation that was issued by the user mode
+     *  library as a large message. The request and the reply start with an
+     *  ebpf_operation_large_header_t and may each be up to
+     *  EBPF_MAX_LARGE_MESSAGE_LENGTH bytes. Unlike regular messages, the
+     *  input and output buffers of a large message must not overlap.
+     *
+     * @param[in] operation_id Identifier of the operation to execute.
+     * @param[in] input_buffer Encoded buffer containing parameters for this
+     *  operation.
+     * @param[in] input_buffer_length Length of the input buffer.
+     * @param[out] output_buffer Pointer to memory that will contain the
+     *  encoded result parameters for this operation.
+     * @param[in] output_buffer_length Length of the output buffer.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The message is malformed or the operation
+     *  does not accept large messages.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_core_invoke_large_protocol_handler(
+        ebpf_operation_id_t operation_id,
+        _In_reads_bytes_(input_buffer_length) const void* input_buffer,
+        uint32_t input_buffer_length,
+        _Out_writes_bytes_(output_buffer_length) void* output_buffer,
+        uint32_t output_buffer_length);
+
     /**
      * @brief Query properties about an operation.
      *
@@ -117,6 +143,48 @@ extern "C"
         int to_size,
         int seed);
 
+    /**
+     * @brief Incrementally update a layer 3 (e.g., IPv4 header) checksum after a field covered by it changed.
+     *
+     * @param[in, out] checksum Pointer to the 16-bit checksum field.
+     * @param[in] checksum_size Size in bytes of the checksum field. Must be 2.
+     * @param[in] from Old value of the modified field.
+     * @param[in] to New value of the modified field, or a checksum delta from ebpf_core_csum_diff.
+     * @param[in] flags Size in bytes of the modified field (2 or 4), or 0 if "to" is a checksum delta, in which case
+     * "from" must be 0.
+     *
+     * @retval 0 The checksum was updated.
+     * @retval -EINVAL An argument is invalid.
+     */
+    long
+    ebpf_core_l3_csum_replace_s(
+        _Inout_updates_bytes_(checksum_size) void* checksum,
+        uint32_t checksum_size,
+        uint64_t from,
+        uint64_t to,
+        uint64_t flags);
+
+    /**
+     * @brief Incrementally update a layer 4 (e.g., TCP or UDP) checksum after a field covered by it changed.
+     *
+     * @param[in, out] checksum Pointer to the 16-bit checksum field.
+     * @param[in] checksum_size Size in bytes of the checksum field. Must be 2.
+     * @param[in] from Old value of the modified field.
+     * @param[in] to New value of the modified field, or a checksum delta from ebpf_core_csum_diff.
+     * @param[in] flags Size in bytes of the modified field (masked by BPF_F_HDR_FIELD_MASK), optionally combined
+     * with BPF_F_PSEUDO_HDR and BPF_F_MARK_MANGLED_0.
+     *
+     * @retval 0 The checksum was updated.
+     * @retval -EINVAL An argument is invalid.
+     */
+    long
+    ebpf_core_l4_csum_replace_s(
+        _Inout_updates_bytes_(checksum_size) void* checksum,
+        uint32_t checksum_size,
+        uint64_t from,
+        uint64_t to,
+        uint64_t flags);
+
     /**
      * @brief Return a handle to the object which is pinned at the
      *  supplied pin path.
@@ -150,6 +218,7 @@ extern "C"
      *
      * @param[in] map_name Name of the map to be created.
      * @param[in] ebpf_map_definition Map definition structure.
+     * @param[in] map_flags Zero or BPF_F_MMAPABLE, which is only valid for array maps.
      * @param[in] inner_map_handle Handle to the inner map object, if any.
      * @param[out] map_handle Handle to the created map object.
      *
@@ -160,6 +229,7 @@ extern "C"
     ebpf_core_create_map(
         _In_ const cxplat_utf8_string_t* map_name,
         _In_ const ebpf_map_definition_in_memory_t* ebpf_map_definition,
+        uint32_t map_flags,
         ebpf_handle_t inner_map_handle,
         _Out_ ebpf_handle_t* map_handle);
 
@@ -0,0 +1,1239 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#include "ebpf_interpreter.h"
+#include "ebpf_tracelog.h"
+
+#include <stdlib.h>
+
+// Stack available to each BPF function (frame), and the maximum depth of BPF-to-BPF calls. These match the limits
+// used by the byte code interpreter.
+#define EBPF_INTERPRETER_STACK_SIZE 512
+#define EBPF_INTERPRETER_MAX_CALL_DEPTH 8
+
+#define EBPF_INTERPRETER_REGISTER_COUNT 11
+#define EBPF_INTERPRETER_FRAME_POINTER 10
+
+// eBPF instruction encoding.
+#define EBPF_CLASS_MASK 0x07
+#define EBPF_CLASS_LD 0x00
+#define EBPF_CLASS_LDX 0x01
+#define EBPF_CLASS_ST 0x02
+#define EBPF_CLASS_STX 0x03
+#define EBPF_CLASS_ALU 0x04
+#define EBPF_CLASS_JMP 0x05
+#define EBPF_CLASS_JMP32 0x06
+#define EBPF_CLASS_ALU64 0x07
+
+#define EBPF_SOURCE_REG 0x08
+#define EBPF_OP_MASK 0xf0
+
+#define EBPF_SIZE_MASK 0x18
+#define EBPF_SIZE_W 0x00
+#define EBPF_SIZE_H 0x08
+#define EBPF_SIZE_B 0x10
+#define EBPF_SIZE_DW 0x18
+
+#define EBPF_MODE_MASK 0xe0
+#define EBPF_MODE_IMM 0x00
+#define EBPF_MODE_MEM 0x60
+#define EBPF_MODE_MEMSX 0x80
+#define EBPF_MODE_ATOMIC 0xc0
+
+#define EBPF_ALU_ADD 0x00
+#define EBPF_ALU_SUB 0x10
+#define EBPF_ALU_MUL 0x20
+#define EBPF_ALU_DIV 0x30
+#define EBPF_ALU_OR 0x40
+#define EBPF_ALU_AND 0x50
+#define EBPF_ALU_LSH 0x60
+#define EBPF_ALU_RSH 0x70
+#define EBPF_ALU_NEG 0x80
+#define EBPF_ALU_MOD 0x90
+#define EBPF_ALU_XOR 0xa0
+#define EBPF_ALU_MOV 0xb0
+#define EBPF_ALU_ARSH 0xc0
+#define EBPF_ALU_END 0xd0
+
+#define EBPF_JMP_JA 0x00
+#define EBPF_JMP_JEQ 0x10
+#define EBPF_JMP_JGT 0x20
+#define EBPF_JMP_JGE 0x30
+#define EBPF_JMP_JSET 0x40
+#define EBPF_JMP_JNE 0x50
+#define EBPF_JMP_JSGT 0x60
+#define EBPF_JMP_JSGE 0x70
+#define EBPF_JMP_CALL 0x80
+#define EBPF_JMP_EXIT 0x90
+#define EBPF_JMP_JLT 0xa0
+#define EBPF_JMP_JLE 0xb0
+#define EBPF_JMP_JSLT 0xc0
+#define EBPF_JMP_JSLE 0xd0
+
+#define EBPF_ATOMIC_ADD 0x00
+#define EBPF_ATOMIC_OR 0x40
+#define EBPF_ATOMIC_AND 0x50
+#define EBPF_ATOMIC_XOR 0xa0
+#define EBPF_ATOMIC_FETCH 0x01
+#define EBPF_ATOMIC_XCHG (0xe0 | EBPF_ATOMIC_FETCH)
+#define EBPF_ATOMIC_CMPXCHG (0xf0 | EBPF_ATOMIC_FETCH)
+
+#define EBPF_PSEUDO_CALL_HELPER 0
+#define EBPF_PSEUDO_CALL_LOCAL 1
+
+// Each ALU operation is decoded into four consecutive operation codes, in this order.
+#define EBPF_INTERPRETER_ALU_VARIANTS(name) \
+    EBPF_INTERPRETER_OP_##name##64_IMM, EBPF_INTERPRETER_OP_##name##64_REG, EBPF_INTERPRETER_OP_##name##32_IMM, \
+        EBPF_INTERPRETER_OP_##name##32_REG
+
+// Each conditional jump is decoded into four consecutive operation codes, in this order.
+#define EBPF_INTERPRETER_JMP_VARIANTS(name) \
+    EBPF_INTERPRETER_OP_##name##64_IMM, EBPF_INTERPRETER_OP_##name##64_REG, EBPF_INTERPRETER_OP_##name##32_IMM, \
+        EBPF_INTERPRETER_OP_##name##32_REG
+
+// Each load that is fused with a following JEQ or JNE against an immediate has two operation codes, in this order.
+#define EBPF_INTERPRETER_LOAD_JUMP_VARIANTS(name) \
+    EBPF_INTERPRETER_OP_##name##_JEQ_IMM, EBPF_INTERPRETER_OP_##name##_JNE_IMM
+
+typedef enum _ebpf_interpreter_op
+{
+    // Traps execution. Used for the slot after the last instruction and the second slot of 64-bit immediate loads.
+    EBPF_INTERPRETER_OP_TRAP,
+
+    EBPF_INTERPRETER_ALU_VARIANTS(ADD),
+    EBPF_INTERPRETER_ALU_VARIANTS(SUB),
+    EBPF_INTERPRETER_ALU_VARIANTS(MUL),
+    EBPF_INTERPRETER_ALU_VARIANTS(DIV),
+    EBPF_INTERPRETER_ALU_VARIANTS(SDIV),
+    EBPF_INTERPRETER_ALU_VARIANTS(MOD),
+    EBPF_INTERPRETER_ALU_VARIANTS(SMOD),
+    EBPF_INTERPRETER_ALU_VARIANTS(OR),
+    EBPF_INTERPRETER_ALU_VARIANTS(AND),
+    EBPF_INTERPRETER_ALU_VARIANTS(XOR),
+    EBPF_INTERPRETER_ALU_VARIANTS(LSH),
+    EBPF_INTERPRETER_ALU_VARIANTS(RSH),
+    EBPF_INTERPRETER_ALU_VARIANTS(ARSH),
+    EBPF_INTERPRETER_ALU_VARIANTS(MOV),
+    EBPF_INTERPRETER_OP_MOVSX64_8,
+    EBPF_INTERPRETER_OP_MOVSX64_16,
+    EBPF_INTERPRETER_OP_MOVSX64_32,
+    EBPF_INTERPRETER_OP_MOVSX32_8,
+    EBPF_INTERPRETER_OP_MOVSX32_16,
+    EBPF_INTERPRETER_OP_NEG64,
+    EBPF_INTERPRETER_OP_NEG32,
+    EBPF_INTERPRETER_OP_ZEXT16,
+    EBPF_INTERPRETER_OP_ZEXT32,
+    EBPF_INTERPRETER_OP_NOP,
+    EBPF_INTERPRETER_OP_BSWAP16,
+    EBPF_INTERPRETER_OP_BSWAP32,
+    EBPF_INTERPRETER_OP_BSWAP64,
+
+    EBPF_INTERPRETER_OP_LDDW,
+    EBPF_INTERPRETER_OP_LDXB,
+    EBPF_INTERPRETER_OP_LDXH,
+    EBPF_INTERPRETER_OP_LDXW,
+    EBPF_INTERPRETER_OP_LDXDW,
+    EBPF_INTERPRETER_OP_LDXSB,
+    EBPF_INTERPRETER_OP_LDXSH,
+    EBPF_INTERPRETER_OP_LDXSW,
+    EBPF_INTERPRETER_OP_STB,
+    EBPF_INTERPRETER_OP_STH,
+    EBPF_INTERPRETER_OP_STW,
+    EBPF_INTERPRETER_OP_STDW,
+    EBPF_INTERPRETER_OP_STXB,
+    EBPF_INTERPRETER_OP_STXH,
+    EBPF_INTERPRETER_OP_STXW,
+    EBPF_INTERPRETER_OP_STXDW,
+
+    EBPF_INTERPRETER_OP_ATOMIC32_ADD,
+    EBPF_INTERPRETER_OP_ATOMIC32_OR,
+    EBPF_INTERPRETER_OP_ATOMIC32_AND,
+    EBPF_INTERPRETER_OP_ATOMIC32_XOR,
+    EBPF_INTERPRETER_OP_ATOMIC32_FETCH_ADD,
+    EBPF_INTERPRETER_OP_ATOMIC32_FETCH_OR,
+    EBPF_INTERPRETER_OP_ATOMIC32_FETCH_AND,
+    EBPF_INTERPRETER_OP_ATOMIC32_FETCH_XOR,
+    EBPF_INTERPRETER_OP_ATOMIC32_XCHG,
+    EBPF_INTERPRETER_OP_ATOMIC32_CMPXCHG,
+    EBPF_INTERPRETER_OP_ATOMIC64_ADD,
+    EBPF_INTERPRETER_OP_ATOMIC64_OR,
+    EBPF_INTERPRETER_OP_ATOMIC64_AND,
+    EBPF_INTERPRETER_OP_ATOMIC64_XOR,
+    EBPF_INTERPRETER_OP_ATOMIC64_FETCH_ADD,
+    EBPF_INTERPRETER_OP_ATOMIC64_FETCH_OR,
+    EBPF_INTERPRETER_OP_ATOMIC64_FETCH_AND,
+    EBPF_INTERPRETER_OP_ATOMIC64_FETCH_XOR,
+    EBPF_INTERPRETER_OP_ATOMIC64_XCHG,
+    EBPF_INTERPRETER_OP_ATOMIC64_CMPXCHG,
+
+    EBPF_INTERPRETER_OP_JA,
+    EBPF_INTERPRETER_JMP_VARIANTS(JEQ),
+    EBPF_INTERPRETER_JMP_VARIANTS(JNE),
+    EBPF_INTERPRETER_JMP_VARIANTS(JGT),
+    EBPF_INTERPRETER_JMP_VARIANTS(JGE),
+    EBPF_INTERPRETER_JMP_VARIANTS(JLT),
+    EBPF_INTERPRETER_JMP_VARIANTS(JLE),
+    EBPF_INTERPRETER_JMP_VARIANTS(JSET),
+    EBPF_INTERPRETER_JMP_VARIANTS(JSGT),
+    EBPF_INTERPRETER_JMP_VARIANTS(JSGE),
+    EBPF_INTERPRETER_JMP_VARIANTS(JSLT),
+    EBPF_INTERPRETER_JMP_VARIANTS(JSLE),
+    EBPF_INTERPRETER_OP_CALL_HELPER,
+    EBPF_INTERPRETER_OP_CALL_LOCAL,
+    EBPF_INTERPRETER_OP_EXIT,
+
+    // Superinstructions.
+    EBPF_INTERPRETER_LOAD_JUMP_VARIANTS(LDXB),
+    EBPF_INTERPRETER_LOAD_JUMP_VARIANTS(LDXH),
+    EBPF_INTERPRETER_LOAD_JUMP_VARIANTS(LDXW),
+    EBPF_INTERPRETER_LOAD_JUMP_VARIANTS(LDXDW),
+    EBPF_INTERPRETER_OP_MOV64_IMM_CALL_HELPER,
+
+    EBPF_INTERPRETER_OP_COUNT,
+} ebpf_interpreter_op_t;
+
+static_assert(EBPF_INTERPRETER_OP_COUNT <= UINT8_MAX, "Operation codes must fit in a byte.");
+
+typedef struct _ebpf_interpreter_instruction
+{
+    uint8_t op;      ///< ebpf_interpreter_op_t.
+    uint8_t dst;     ///< Destination register.
+    uint8_t src;     ///< Source register.
+    int16_t offset;  ///< Memory offset.
+    uint32_t target; ///< Branch or local call target index, or helper index.
+    uint64_t imm;    ///< Sign-extended immediate, or the full 64-bit immediate of LDDW.
+} ebpf_interpreter_instruction_t;
+
+typedef uint64_t (*ebpf_interpreter_helper_t)(
+    uint64_t r1, uint64_t r2, uint64_t r3, uint64_t r4, uint64_t r5, _Inout_ void* context);
+
+typedef struct _ebpf_interpreter_program
+{
+    size_t helper_count;
+    ebpf_interpreter_helper_t* helpers;
+    size_t instruction_count;
+    // One entry per original instruction, plus a trailing trap, so original branch targets index directly.
+    ebpf_interpreter_instruction_t instructions[1];
+} ebpf_interpreter_program_t;
+
+typedef struct _ebpf_interpreter_frame
+{
+    uint64_t saved_registers[4]; ///< R6-R9 of the caller.
+    uint64_t frame_pointer;      ///< R10 of the caller.
+    const ebpf_interpreter_instruction_t* return_address;
+} ebpf_interpreter_frame_t;
+
+static ebpf_interpreter_op_t
+_ebpf_interpreter_alu_base(uint8_t alu_op, int16_t offset)
+{
+    switch (alu_op) {
+    case EBPF_ALU_ADD:
+        return EBPF_INTERPRETER_OP_ADD64_IMM;
+    case EBPF_ALU_SUB:
+        return EBPF_INTERPRETER_OP_SUB64_IMM;
+    case EBPF_ALU_MUL:
+        return EBPF_INTERPRETER_OP_MUL64_IMM;
+    case EBPF_ALU_DIV:
+        return (offset == 1) ? EBPF_INTERPRETER_OP_SDIV64_IMM : EBPF_INTERPRETER_OP_DIV64_IMM;
+    case EBPF_ALU_MOD:
+        return (offset == 1) ? EBPF_INTERPRETER_OP_SMOD64_IMM : EBPF_INTERPRETER_OP_MOD64_IMM;
+    case EBPF_ALU_OR:
+        return EBPF_INTERPRETER_OP_OR64_IMM;
+    case EBPF_ALU_AND:
+        return EBPF_INTERPRETER_OP_AND64_IMM;
+    case EBPF_ALU_XOR:
+        return EBPF_INTERPRETER_OP_XOR64_IMM;
+    case EBPF_ALU_LSH:
+        return EBPF_INTERPRETER_OP_LSH64_IMM;
+    case EBPF_ALU_RSH:
+        return EBPF_INTERPRETER_OP_RSH64_IMM;
+    case EBPF_ALU_ARSH:
+        return EBPF_INTERPRETER_OP_ARSH64_IMM;
+    case EBPF_ALU_MOV:
+        return EBPF_INTERPRETER_OP_MOV64_IMM;
+    default:
+        return EBPF_INTERPRETER_OP_TRAP;
+    }
+}
+
+static ebpf_interpreter_op_t
+_ebpf_interpreter_jump_base(uint8_t jump_op)
+{
+    switch (jump_op) {
+    case EBPF_JMP_JEQ:
+        return EBPF_INTERPRETER_OP_JEQ64_IMM;
+    case EBPF_JMP_JNE:
+        return EBPF_INTERPRETER_OP_JNE64_IMM;
+    case EBPF_JMP_JGT:
+        return EBPF_INTERPRETER_OP_JGT64_IMM;
+    case EBPF_JMP_JGE:
+        return EBPF_INTERPRETER_OP_JGE64_IMM;
+    case EBPF_JMP_JLT:
+        return EBPF_INTERPRETER_OP_JLT64_IMM;
+    case EBPF_JMP_JLE:
+        return EBPF_INTERPRETER_OP_JLE64_IMM;
+    case EBPF_JMP_JSET:
+        return EBPF_INTERPRETER_OP_JSET64_IMM;
+    case EBPF_JMP_JSGT:
+        return EBPF_INTERPRETER_OP_JSGT64_IMM;
+    case EBPF_JMP_JSGE:
+        return EBPF_INTERPRETER_OP_JSGE64_IMM;
+    case EBPF_JMP_JSLT:
+        return EBPF_INTERPRETER_OP_JSLT64_IMM;
+    case EBPF_JMP_JSLE:
+        return EBPF_INTERPRETER_OP_JSLE64_IMM;
+    default:
+        return EBPF_INTERPRETER_OP_TRAP;
+    }
+}
+
+static ebpf_interpreter_op_t
+_ebpf_interpreter_atomic_op(uint8_t size, int32_t atomic_op)
+{
+    ebpf_interpreter_op_t base =
+        (size == EBPF_SIZE_DW) ? EBPF_INTERPRETER_OP_ATOMIC64_ADD : EBPF_INTERPRETER_OP_ATOMIC32_ADD;
+    switch (atomic_op) {
+    case EBPF_ATOMIC_ADD:
+        return base;
+    case EBPF_ATOMIC_OR:
+        return (ebpf_interpreter_op_t)(base + 1);
+    case EBPF_ATOMIC_AND:
+        return (ebpf_interpreter_op_t)(base + 2);
+    case EBPF_ATOMIC_XOR:
+        return (ebpf_interpreter_op_t)(base + 3);
+    case EBPF_ATOMIC_ADD | EBPF_ATOMIC_FETCH:
+        return (ebpf_interpreter_op_t)(base + 4);
+    case EBPF_ATOMIC_OR | EBPF_ATOMIC_FETCH:
+        return (ebpf_interpreter_op_t)(base + 5);
+    case EBPF_ATOMIC_AND | EBPF_ATOMIC_FETCH:
+        return (ebpf_interpreter_op_t)(base + 6);
+    case EBPF_ATOMIC_XOR | EBPF_ATOMIC_FETCH:
+        return (ebpf_interpreter_op_t)(base + 7);
+    case EBPF_ATOMIC_XCHG:
+        return (ebpf_interpreter_op_t)(base + 8);
+    case EBPF_ATOMIC_CMPXCHG:
+        return (ebpf_interpreter_op_t)(base + 9);
+    default:
+        return EBPF_INTERPRETER_OP_TRAP;
+    }
+}
+
+/**
+ * @brief Compute and validate a branch target.
+ *
+ * @retval true The target is within the program, or is the trap slot that follows it.
+ */
+static bool
+_ebpf_interpreter_branch_target(size_t pc, int64_t relative, size_t instruction_count, _Out_ uint32_t* target)
+{
+    int64_t absolute = (int64_t)pc + relative + 1;
+    *target = 0;
+    if (absolute < 0 || (uint64_t)absolute > instruction_count) {
+        return false;
+    }
+    *target = (uint32_t)absolute;
+    return true;
+}
+
+/**
+ * @brief Decode a single instruction.
+ *
+ * @retval EBPF_SUCCESS The instruction was decoded. *slots is the number of instruction slots it occupies.
+ * @retval EBPF_OPERATION_NOT_SUPPORTED The instruction is valid but not supported by this interpreter.
+ * @retval EBPF_INVALID_ARGUMENT The instruction is malformed.
+ */
+static ebpf_result_t
+_ebpf_interpreter_decode_instruction(
+    _In_reads_(instruction_count) const ebpf_instruction_t* instructions,
+    size_t instruction_count,
+    size_t helper_count,
+    size_t pc,
+    _Out_ ebpf_interpreter_instruction_t* decoded,
+    _Out_ size_t* slots)
+{
+    const ebpf_instruction_t* instruction = &instructions[pc];
+    uint8_t instruction_class = instruction->opcode & EBPF_CLASS_MASK;
+    bool register_source = (instruction->opcode & EBPF_SOURCE_REG) != 0;
+    uint8_t size = instruction->opcode & EBPF_SIZE_MASK;
+    uint8_t mode = instruction->opcode & EBPF_MODE_MASK;
+    ebpf_interpreter_op_t op = EBPF_INTERPRETER_OP_TRAP;
+
+    memset(decoded, 0, sizeof(*decoded));
+    *slots = 1;
+
+    if (instruction->dst >= EBPF_INTERPRETER_REGISTER_COUNT || instruction->src >= EBPF_INTERPRETER_REGISTER_COUNT) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+    decoded->dst = instruction->dst;
+    decoded->src = instruction->src;
+    decoded->offset = instruction->offset;
+    decoded->imm = (uint64_t)(int64_t)instruction->imm;
+
+    switch (instruction_class) {
+    case EBPF_CLASS_ALU:
+    case EBPF_CLASS_ALU64: {
+        bool is_64 = (instruction_class == EBPF_CLASS_ALU64);
+        uint8_t alu_op = instruction->opcode & EBPF_OP_MASK;
+        if (instruction->dst == EBPF_INTERPRETER_FRAME_POINTER) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        if (alu_op == EBPF_ALU_NEG) {
+            op = is_64 ? EBPF_INTERPRETER_OP_NEG64 : EBPF_INTERPRETER_OP_NEG32;
+        } else if (alu_op == EBPF_ALU_END) {
+            if (instruction->imm != 16 && instruction->imm != 32 && instruction->imm != 64) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            if (is_64 || register_source) {
+                // BSWAP (ALU64) and conversion to big endian swap on a little-endian host.
+                op = (instruction->imm == 16)   ? EBPF_INTERPRETER_OP_BSWAP16
+                     : (instruction->imm == 32) ? EBPF_INTERPRETER_OP_BSWAP32
+                                                : EBPF_INTERPRETER_OP_BSWAP64;
+            } else {
+                // Conversion to little endian only truncates on a little-endian host.
+                op = (instruction->imm == 16)   ? EBPF_INTERPRETER_OP_ZEXT16
+                     : (instruction->imm == 32) ? EBPF_INTERPRETER_OP_ZEXT32
+                                                : EBPF_INTERPRETER_OP_NOP;
+            }
+        } else if (alu_op == EBPF_ALU_MOV && register_source && instruction->offset != 0) {
+            // MOVSX.
+            if (is_64) {
+                op = (instruction->offset == 8)    ? EBPF_INTERPRETER_OP_MOVSX64_8
+                     : (instruction->offset == 16) ? EBPF_INTERPRETER_OP_MOVSX64_16
+                     : (instruction->offset == 32) ? EBPF_INTERPRETER_OP_MOVSX64_32
+                                                   : EBPF_INTERPRETER_OP_TRAP;
+            } else {
+                op = (instruction->offset == 8)    ? EBPF_INTERPRETER_OP_MOVSX32_8
+                     : (instruction->offset == 16) ? EBPF_INTERPRETER_OP_MOVSX32_16
+                                                   : EBPF_INTERPRETER_OP_TRAP;
+            }
+            if (op == EBPF_INTERPRETER_OP_TRAP) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+        } else {
+            op = _ebpf_interpreter_alu_base(alu_op, instruction->offset);
+            if (op == EBPF_INTERPRETER_OP_TRAP) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            op = (ebpf_interpreter_op_t)(op + (is_64 ? 0 : 2) + (register_source ? 1 : 0));
+        }
+        break;
+    }
+    case EBPF_CLASS_LD:
+        if (instruction->opcode != (EBPF_CLASS_LD | EBPF_MODE_IMM | EBPF_SIZE_DW)) {
+            // Legacy packet access instructions are not supported.
+            return EBPF_OPERATION_NOT_SUPPORTED;
+        }
+        if (pc + 1 >= instruction_count || instructions[pc + 1].opcode != 0 ||
+            instruction->dst == EBPF_INTERPRETER_FRAME_POINTER) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        if (instruction->src != 0) {
+            // Unresolved pseudo map references must go through the byte code interpreter.
+            return EBPF_OPERATION_NOT_SUPPORTED;
+        }
+        op = EBPF_INTERPRETER_OP_LDDW;
+        decoded->imm = (uint64_t)(uint32_t)instruction->imm | ((uint64_t)(uint32_t)instructions[pc + 1].imm << 32);
+        *slots = 2;
+        break;
+    case EBPF_CLASS_LDX:
+        if (instruction->dst == EBPF_INTERPRETER_FRAME_POINTER) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        if (mode == EBPF_MODE_MEM) {
+            op = (size == EBPF_SIZE_B)   ? EBPF_INTERPRETER_OP_LDXB
+                 : (size == EBPF_SIZE_H) ? EBPF_INTERPRETER_OP_LDXH
+                 : (size == EBPF_SIZE_W) ? EBPF_INTERPRETER_OP_LDXW
+                                         : EBPF_INTERPRETER_OP_LDXDW;
+        } else if (mode == EBPF_MODE_MEMSX && size != EBPF_SIZE_DW) {
+            op = (size == EBPF_SIZE_B)   ? EBPF_INTERPRETER_OP_LDXSB
+                 : (size == EBPF_SIZE_H) ? EBPF_INTERPRETER_OP_LDXSH
+                                         : EBPF_INTERPRETER_OP_LDXSW;
+        } else {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        break;
+    case EBPF_CLASS_ST:
+        if (mode != EBPF_MODE_MEM) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        op = (size == EBPF_SIZE_B)   ? EBPF_INTERPRETER_OP_STB
+             : (size == EBPF_SIZE_H) ? EBPF_INTERPRETER_OP_STH
+             : (size == EBPF_SIZE_W) ? EBPF_INTERPRETER_OP_STW
+                                     : EBPF_INTERPRETER_OP_STDW;
+        break;
+    case EBPF_CLASS_STX:
+        if (mode == EBPF_MODE_MEM) {
+            op = (size == EBPF_SIZE_B)   ? EBPF_INTERPRETER_OP_STXB
+                 : (size == EBPF_SIZE_H) ? EBPF_INTERPRETER_OP_STXH
+                 : (size == EBPF_SIZE_W) ? EBPF_INTERPRETER_OP_STXW
+                                         : EBPF_INTERPRETER_OP_STXDW;
+        } else if (mode == EBPF_MODE_ATOMIC && (size == EBPF_SIZE_W || size == EBPF_SIZE_DW)) {
+            op = _ebpf_interpreter_atomic_op(size, instruction->imm);
+            if (op == EBPF_INTERPRETER_OP_TRAP) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+        } else {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        break;
+    case EBPF_CLASS_JMP:
+    case EBPF_CLASS_JMP32: {
+        bool is_64 = (instruction_class == EBPF_CLASS_JMP);
+        uint8_t jump_op = instruction->opcode & EBPF_OP_MASK;
+        switch (jump_op) {
+        case EBPF_JMP_JA:
+            op = EBPF_INTERPRETER_OP_JA;
+            // The 32-bit class form (gotol) carries its offset in the immediate.
+            if (!_ebpf_interpreter_branch_target(
+                    pc, is_64 ? instruction->offset : instruction->imm, instruction_count, &decoded->target)) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            break;
+        case EBPF_JMP_CALL:
+            if (!is_64) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            if (instruction->src == EBPF_PSEUDO_CALL_HELPER) {
+                if (instruction->imm < 0 || (size_t)instruction->imm >= helper_count) {
+                    return EBPF_INVALID_ARGUMENT;
+                }
+                op = EBPF_INTERPRETER_OP_CALL_HELPER;
+                decoded->target = (uint32_t)instruction->imm;
+            } else if (instruction->src == EBPF_PSEUDO_CALL_LOCAL) {
+                op = EBPF_INTERPRETER_OP_CALL_LOCAL;
+                if (!_ebpf_interpreter_branch_target(pc, instruction->imm, instruction_count, &decoded->target) ||
+                    decoded->target == instruction_count) {
+                    return EBPF_INVALID_ARGUMENT;
+                }
+            } else {
+                // Calls to BTF resolved functions go through the byte code interpreter.
+                return EBPF_OPERATION_NOT_SUPPORTED;
+            }
+            break;
+        case EBPF_JMP_EXIT:
+            if (!is_64) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            op = EBPF_INTERPRETER_OP_EXIT;
+            break;
+        default:
+            op = _ebpf_interpreter_jump_base(jump_op);
+            if (op == EBPF_INTERPRETER_OP_TRAP) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            op = (ebpf_interpreter_op_t)(op + (is_64 ? 0 : 2) + (register_source ? 1 : 0));
+            if (!_ebpf_interpreter_branch_target(pc, instruction->offset, instruction_count, &decoded->target)) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            break;
+        }
+        break;
+    }
+    default:
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    decoded->op = (uint8_t)op;
+    return EBPF_SUCCESS;
+}
+
+/**
+ * @brief Fuse the instruction at pc with the one that follows it, if they form a supported pair.
+ */
+static void
+_ebpf_interpreter_fuse(_Inout_updates_(2) ebpf_interpreter_instruction_t* decoded)
+{
+    ebpf_interpreter_instruction_t* first = &decoded[0];
+    const ebpf_interpreter_instruction_t* second = &decoded[1];
+
+    // Load, then compare the loaded register with an immediate and branch.
+    if (first->op >= EBPF_INTERPRETER_OP_LDXB && first->op <= EBPF_INTERPRETER_OP_LDXDW &&
+        (second->op == EBPF_INTERPRETER_OP_JEQ64_IMM || second->op == EBPF_INTERPRETER_OP_JNE64_IMM) &&
+        second->dst == first->dst) {
+        first->op = (uint8_t)(EBPF_INTERPRETER_OP_LDXB_JEQ_IMM + 2 * (first->op - EBPF_INTERPRETER_OP_LDXB) +
+                              (second->op == EBPF_INTERPRETER_OP_JNE64_IMM ? 1 : 0));
+        first->imm = second->imm;
+        first->target = second->target;
+        return;
+    }
+
+    // Load an immediate argument, then call a helper.
+    if (first->op == EBPF_INTERPRETER_OP_MOV64_IMM && second->op == EBPF_INTERPRETER_OP_CALL_HELPER) {
+        first->op = EBPF_INTERPRETER_OP_MOV64_IMM_CALL_HELPER;
+        first->target = second->target;
+    }
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_interpreter_program_create(
+    _In_reads_(instruction_count) const ebpf_instruction_t* instructions,
+    size_t instruction_count,
+    size_t helper_count,
+    _Outptr_ ebpf_interpreter_program_t** program)
+{
+    ebpf_result_t result;
+    ebpf_interpreter_program_t* local_program = NULL;
+    uint8_t* is_branch_target = NULL;
+    size_t program_size;
+    size_t pc;
+
+    *program = NULL;
+
+    if (instruction_count == 0 || instruction_count >= UINT32_MAX) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Done;
+    }
+
+    // Header plus instruction_count + 1 decoded instructions (the header already contains one).
+    result = ebpf_safe_size_t_multiply(instruction_count, sizeof(ebpf_interpreter_instruction_t), &program_size);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+    result = ebpf_safe_size_t_add(program_size, sizeof(ebpf_interpreter_program_t), &program_size);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    local_program = (ebpf_interpreter_program_t*)ebpf_allocate_with_tag(program_size, EBPF_POOL_TAG_PROGRAM);
+    if (local_program == NULL) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+    local_program->instruction_count = instruction_count;
+    local_program->helper_count = helper_count;
+    if (helper_count > 0) {
+        size_t helpers_size;
+        result = ebpf_safe_size_t_multiply(helper_count, sizeof(ebpf_interpreter_helper_t), &helpers_size);
+        if (result != EBPF_SUCCESS) {
+            goto Done;
+        }
+        local_program->helpers =
+            (ebpf_interpreter_helper_t*)ebpf_allocate_with_tag(helpers_size, EBPF_POOL_TAG_PROGRAM);
+        if (local_program->helpers == NULL) {
+            result = EBPF_NO_MEMORY;
+            goto Done;
+        }
+    }
+
+    is_branch_target = (uint8_t*)ebpf_allocate_with_tag(instruction_count + 1, EBPF_POOL_TAG_PROGRAM);
+    if (is_branch_target == NULL) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    // Decode every instruction and record branch targets. Allocation zeroes memory, so every slot that is not
+    // decoded (the trailing slot and the second half of LDDW) is a trap.
+    for (pc = 0; pc < instruction_count;) {
+        size_t slots;
+        ebpf_interpreter_instruction_t* decoded = &local_program->instructions[pc];
+        result =
+            _ebpf_interpreter_decode_instruction(instructions, instruction_count, helper_count, pc, decoded, &slots);
+        if (result != EBPF_SUCCESS) {
+            EBPF_LOG_MESSAGE_UINT64(
+                EBPF_TRACELOG_LEVEL_VERBOSE,
+                EBPF_TRACELOG_KEYWORD_PROGRAM,
+                "ebpf_interpreter_program_create: unable to decode instruction",
+                pc);
+            goto Done;
+        }
+        if (decoded->op == EBPF_INTERPRETER_OP_JA ||
+            (decoded->op >= EBPF_INTERPRETER_OP_JEQ64_IMM && decoded->op <= EBPF_INTERPRETER_OP_JSLE32_REG) ||
+            decoded->op == EBPF_INTERPRETER_OP_CALL_LOCAL) {
+            is_branch_target[decoded->target] = 1;
+        }
+        pc += slots;
+    }
+
+    // Fuse instruction pairs where the second instruction is not reachable other than by falling through.
+    for (pc = 0; pc + 1 < instruction_count; pc++) {
+        if (!is_branch_target[pc + 1]) {
+            _ebpf_interpreter_fuse(&local_program->instructions[pc]);
+        }
+    }
+
+    *program = local_program;
+    local_program = NULL;
+    result = EBPF_SUCCESS;
+
+Done:
+    ebpf_free(is_branch_target);
+    ebpf_interpreter_program_free(local_program);
+    return result;
+}
+
+void
+ebpf_interpreter_program_free(_In_opt_ _Frees_ptr_opt_ ebpf_interpreter_program_t* program)
+{
+    if (program != NULL) {
+        ebpf_free(program->helpers);
+        ebpf_free(program);
+    }
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_interpreter_program_set_helper(_Inout_ ebpf_interpreter_program_t* program, uint32_t index, uint64_t address)
+{
+    if (index >= program->helper_count) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+    WritePointerNoFence((void* volatile*)&program->helpers[index], (void*)(uintptr_t)address);
+    return EBPF_SUCCESS;
+}
+
+#define EBPF_INTERPRETER_ALU_CASES(name, operator)                                                       \
+    case EBPF_INTERPRETER_OP_##name##64_IMM:                                                             \
+        reg[instruction->dst] = reg[instruction->dst] operator instruction->imm;                         \
+        instruction++;                                                                                   \
+        break;                                                                                           \
+    case EBPF_INTERPRETER_OP_##name##64_REG:                                                             \
+        reg[instruction->dst] = reg[instruction->dst] operator reg[instruction->src];                    \
+        instruction++;                                                                                   \
+        break;                                                                                           \
+    case EBPF_INTERPRETER_OP_##name##32_IMM:                                                             \
+        reg[instruction->dst] = (uint32_t)((uint32_t)reg[instruction->dst] operator(uint32_t)            \
+                                               instruction->imm);                                        \
+        instruction++;                                                                                   \
+        break;                                                                                           \
+    case EBPF_INTERPRETER_OP_##name##32_REG:                                                             \
+        reg[instruction->dst] = (uint32_t)((uint32_t)reg[instruction->dst] operator(uint32_t)            \
+                                               reg[instruction->src]);                                   \
+        instruction++;                                                                                   \
+        break;
+
+#define EBPF_INTERPRETER_JMP_CASES(name, type64, type32, condition)                                      \
+    case EBPF_INTERPRETER_OP_##name##64_IMM:                                                             \
+        instruction = (condition((type64)reg[instruction->dst], (type64)instruction->imm))               \
+                          ? &instructions[instruction->target]                                           \
+                          : instruction + 1;                                                             \
+        break;                                                                                           \
+    case EBPF_INTERPRETER_OP_##name##64_REG:                                                             \
+        instruction = (condition((type64)reg[instruction->dst], (type64)reg[instruction->src]))          \
+                          ? &instructions[instruction->target]                                           \
+                          : instruction + 1;                                                             \
+        break;                                                                                           \
+    case EBPF_INTERPRETER_OP_##name##32_IMM:                                                             \
+        instruction = (condition((type32)reg[instruction->dst], (type32)instruction->imm))               \
+                          ? &instructions[instruction->target]                                           \
+                          : instruction + 1;                                                             \
+        break;                                                                                           \
+    case EBPF_INTERPRETER_OP_##name##32_REG:                                                             \
+        instruction = (condition((type32)reg[instruction->dst], (type32)reg[instruction->src]))          \
+                          ? &instructions[instruction->target]                                           \
+                          : instruction + 1;                                                             \
+        break;
+
+#define EBPF_INTERPRETER_EQ(a, b) ((a) == (b))
+#define EBPF_INTERPRETER_NE(a, b) ((a) != (b))
+#define EBPF_INTERPRETER_GT(a, b) ((a) > (b))
+#define EBPF_INTERPRETER_GE(a, b) ((a) >= (b))
+#define EBPF_INTERPRETER_LT(a, b) ((a) < (b))
+#define EBPF_INTERPRETER_LE(a, b) ((a) <= (b))
+#define EBPF_INTERPRETER_SET(a, b) (((a) & (b)) != 0)
+
+#define EBPF_INTERPRETER_LOAD_JUMP_CASES(name, type)                                                     \
+    case EBPF_INTERPRETER_OP_##name##_JEQ_IMM:                                                           \
+        reg[instruction->dst] = *(const type*)(uintptr_t)(reg[instruction->src] + instruction->offset);  \
+        instruction = (reg[instruction->dst] == instruction->imm) ? &instructions[instruction->target]   \
+                                                                  : instruction + 2;                     \
+        break;                                                                                           \
+    case EBPF_INTERPRETER_OP_##name##_JNE_IMM:                                                           \
+        reg[instruction->dst] = *(const type*)(uintptr_t)(reg[instruction->src] + instruction->offset);  \
+        instruction = (reg[instruction->dst] != instruction->imm) ? &instructions[instruction->target]   \
+                                                                  : instruction + 2;                     \
+        break;
+
+#define EBPF_INTERPRETER_ADDRESS(base, instruction) ((uintptr_t)(reg[(base)] + (instruction)->offset))
+
+int
+ebpf_interpreter_program_execute(
+    _In_ const ebpf_interpreter_program_t* program, _Inout_ void* context, _Out_ uint64_t* return_value)
+{
+    uint64_t reg[EBPF_INTERPRETER_REGISTER_COUNT];
+    uint64_t stack[(EBPF_INTERPRETER_STACK_SIZE * EBPF_INTERPRETER_MAX_CALL_DEPTH) / sizeof(uint64_t)];
+    ebpf_interpreter_frame_t frames[EBPF_INTERPRETER_MAX_CALL_DEPTH];
+    uint32_t call_depth = 0;
+    const ebpf_interpreter_instruction_t* instructions = program->instructions;
+    const ebpf_interpreter_instruction_t* instruction = instructions;
+    ebpf_interpreter_helper_t helper;
+
+    *return_value = 0;
+    reg[1] = (uintptr_t)context;
+    reg[EBPF_INTERPRETER_FRAME_POINTER] = (uintptr_t)stack + sizeof(stack);
+
+    for (;;) {
+        switch (instruction->op) {
+            EBPF_INTERPRETER_ALU_CASES(ADD, +)
+            EBPF_INTERPRETER_ALU_CASES(SUB, -)
+            EBPF_INTERPRETER_ALU_CASES(MUL, *)
+            EBPF_INTERPRETER_ALU_CASES(OR, |)
+            EBPF_INTERPRETER_ALU_CASES(AND, &)
+            EBPF_INTERPRETER_ALU_CASES(XOR, ^)
+
+        case EBPF_INTERPRETER_OP_DIV64_IMM:
+        case EBPF_INTERPRETER_OP_DIV64_REG: {
+            uint64_t divisor = (instruction->op == EBPF_INTERPRETER_OP_DIV64_IMM) ? instruction->imm
+                                                                                  : reg[instruction->src];
+            reg[instruction->dst] = divisor ? reg[instruction->dst] / divisor : 0;
+            instruction++;
+            break;
+        }
+        case EBPF_INTERPRETER_OP_DIV32_IMM:
+        case EBPF_INTERPRETER_OP_DIV32_REG: {
+            uint32_t divisor = (uint32_t)((instruction->op == EBPF_INTERPRETER_OP_DIV32_IMM) ? instruction->imm
+                                                                                            : reg[instruction->src]);
+            reg[instruction->dst] = divisor ? (uint32_t)reg[instruction->dst] / divisor : 0;
+            instruction++;
+            break;
+        }
+        case EBPF_INTERPRETER_OP_SDIV64_IMM:
+        case EBPF_INTERPRETER_OP_SDIV64_REG: {
+            int64_t dividend = (int64_t)reg[instruction->dst];
+            int64_t divisor = (int64_t)((instruction->op == EBPF_INTERPRETER_OP_SDIV64_IMM) ? instruction->imm
+                                                                                           : reg[instruction->src]);
+            if (divisor == 0) {
+                reg[instruction->dst] = 0;
+            } else if (divisor == -1) {
+                // Avoid the overflow trap of INT64_MIN / -1; negation wraps instead.
+                reg[instruction->dst] = 0 - (uint64_t)dividend;
+            } else {
+                reg[instruction->dst] = (uint64_t)(dividend / divisor);
+            }
+            instruction++;
+            break;
+        }
+        case EBPF_INTERPRETER_OP_SDIV32_IMM:
+        case EBPF_INTERPRETER_OP_SDIV32_REG: {
+            int32_t dividend = (int32_t)reg[instruction->dst];
+            int32_t divisor = (int32_t)((instruction->op == EBPF_INTERPRETER_OP_SDIV32_IMM) ? instruction->imm
+                                                                                           : reg[instruction->src]);
+            if (divisor == 0) {
+                reg[instruction->dst] = 0;
+            } else if (divisor == -1) {
+                reg[instruction->dst] = (uint32_t)(0 - (uint32_t)dividend);
+            } else {
+                reg[instruction->dst] = (uint32_t)(dividend / divisor);
+            }
+            instruction++;
+            break;
+        }
+        case EBPF_INTERPRETER_OP_MOD64_IMM:
+        case EBPF_INTERPRETER_OP_MOD64_REG: {
+            uint64_t divisor = (instruction->op == EBPF_INTERPRETER_OP_MOD64_IMM) ? instruction->imm
+                                                                                  : reg[instruction->src];
+            if (divisor) {
+                reg[instruction->dst] = reg[instruction->dst] % divisor;
+            }
+            instruction++;
+            break;
+        }
+        case EBPF_INTERPRETER_OP_MOD32_IMM:
+        case EBPF_INTERPRETER_OP_MOD32_REG: {
+            uint32_t divisor = (uint32_t)((instruction->op == EBPF_INTERPRETER_OP_MOD32_IMM) ? instruction->imm
+                                                                                            : reg[instruction->src]);
+            reg[instruction->dst] =
+                divisor ? (uint32_t)reg[instruction->dst] % divisor : (uint32_t)reg[instruction->dst];
+            instruction++;
+            break;
+        }
+        case EBPF_INTERPRETER_OP_SMOD64_IMM:
+        case EBPF_INTERPRETER_OP_SMOD64_REG: {
+            int64_t divisor = (int64_t)((instruction->op == EBPF_INTERPRETER_OP_SMOD64_IMM) ? instruction->imm
+                                                                                           : reg[instruction->src]);
+            if (divisor == -1) {
+                reg[instruction->dst] = 0;
+            } else if (divisor != 0) {
+                reg[instruction->dst] = (uint64_t)((int64_t)reg[instruction->dst] % divisor);
+            }
+            instruction++;
+            break;
+        }
+        case EBPF_INTERPRETER_OP_SMOD32_IMM:
+        case EBPF_INTERPRETER_OP_SMOD32_REG: {
+            int32_t divisor = (int32_t)((instruction->op == EBPF_INTERPRETER_OP_SMOD32_IMM) ? instruction->imm
+                                                                                           : reg[instruction->src]);
+            if (divisor == -1) {
+                reg[instruction->dst] = 0;
+            } else if (divisor != 0) {
+                reg[instruction->dst] = (uint32_t)((int32_t)reg[instruction->dst] % divisor);
+            } else {
+                reg[instruction->dst] = (uint32_t)reg[instruction->dst];
+            }
+            instruction++;
+            break;
+        }
+
+        case EBPF_INTERPRETER_OP_LSH64_IMM:
+            reg[instruction->dst] <<= (instruction->imm & 63);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LSH64_REG:
+            reg[instruction->dst] <<= (reg[instruction->src] & 63);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LSH32_IMM:
+            reg[instruction->dst] = (uint32_t)((uint32_t)reg[instruction->dst] << (instruction->imm & 31));
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LSH32_REG:
+            reg[instruction->dst] = (uint32_t)((uint32_t)reg[instruction->dst] << (reg[instruction->src] & 31));
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_RSH64_IMM:
+            reg[instruction->dst] >>= (instruction->imm & 63);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_RSH64_REG:
+            reg[instruction->dst] >>= (reg[instruction->src] & 63);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_RSH32_IMM:
+            reg[instruction->dst] = (uint32_t)reg[instruction->dst] >> (instruction->imm & 31);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_RSH32_REG:
+            reg[instruction->dst] = (uint32_t)reg[instruction->dst] >> (reg[instruction->src] & 31);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ARSH64_IMM:
+            reg[instruction->dst] = (uint64_t)((int64_t)reg[instruction->dst] >> (instruction->imm & 63));
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ARSH64_REG:
+            reg[instruction->dst] = (uint64_t)((int64_t)reg[instruction->dst] >> (reg[instruction->src] & 63));
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ARSH32_IMM:
+            reg[instruction->dst] = (uint32_t)((int32_t)reg[instruction->dst] >> (instruction->imm & 31));
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ARSH32_REG:
+            reg[instruction->dst] = (uint32_t)((int32_t)reg[instruction->dst] >> (reg[instruction->src] & 31));
+            instruction++;
+            break;
+
+        case EBPF_INTERPRETER_OP_MOV64_IMM:
+            reg[instruction->dst] = instruction->imm;
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOV64_REG:
+            reg[instruction->dst] = reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOV32_IMM:
+            reg[instruction->dst] = (uint32_t)instruction->imm;
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOV32_REG:
+            reg[instruction->dst] = (uint32_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOVSX64_8:
+            reg[instruction->dst] = (uint64_t)(int64_t)(int8_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOVSX64_16:
+            reg[instruction->dst] = (uint64_t)(int64_t)(int16_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOVSX64_32:
+            reg[instruction->dst] = (uint64_t)(int64_t)(int32_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOVSX32_8:
+            reg[instruction->dst] = (uint32_t)(int32_t)(int8_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_MOVSX32_16:
+            reg[instruction->dst] = (uint32_t)(int32_t)(int16_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_NEG64:
+            reg[instruction->dst] = 0 - reg[instruction->dst];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_NEG32:
+            reg[instruction->dst] = (uint32_t)(0 - (uint32_t)reg[instruction->dst]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ZEXT16:
+            reg[instruction->dst] = (uint16_t)reg[instruction->dst];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ZEXT32:
+            reg[instruction->dst] = (uint32_t)reg[instruction->dst];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_NOP:
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_BSWAP16:
+            reg[instruction->dst] = _byteswap_ushort((uint16_t)reg[instruction->dst]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_BSWAP32:
+            reg[instruction->dst] = _byteswap_ulong((uint32_t)reg[instruction->dst]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_BSWAP64:
+            reg[instruction->dst] = _byteswap_uint64(reg[instruction->dst]);
+            instruction++;
+            break;
+
+        case EBPF_INTERPRETER_OP_LDDW:
+            reg[instruction->dst] = instruction->imm;
+            instruction += 2;
+            break;
+        case EBPF_INTERPRETER_OP_LDXB:
+            reg[instruction->dst] = *(const uint8_t*)EBPF_INTERPRETER_ADDRESS(instruction->src, instruction);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LDXH:
+            reg[instruction->dst] = *(const uint16_t*)EBPF_INTERPRETER_ADDRESS(instruction->src, instruction);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LDXW:
+            reg[instruction->dst] = *(const uint32_t*)EBPF_INTERPRETER_ADDRESS(instruction->src, instruction);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LDXDW:
+            reg[instruction->dst] = *(const uint64_t*)EBPF_INTERPRETER_ADDRESS(instruction->src, instruction);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LDXSB:
+            reg[instruction->dst] =
+                (uint64_t)(int64_t) * (const int8_t*)EBPF_INTERPRETER_ADDRESS(instruction->src, instruction);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LDXSH:
+            reg[instruction->dst] =
+                (uint64_t)(int64_t) * (const int16_t*)EBPF_INTERPRETER_ADDRESS(instruction->src, instruction);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_LDXSW:
+            reg[instruction->dst] =
+                (uint64_t)(int64_t) * (const int32_t*)EBPF_INTERPRETER_ADDRESS(instruction->src, instruction);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STB:
+            *(uint8_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = (uint8_t)instruction->imm;
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STH:
+            *(uint16_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = (uint16_t)instruction->imm;
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STW:
+            *(uint32_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = (uint32_t)instruction->imm;
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STDW:
+            *(uint64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = instruction->imm;
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STXB:
+            *(uint8_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = (uint8_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STXH:
+            *(uint16_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = (uint16_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STXW:
+            *(uint32_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = (uint32_t)reg[instruction->src];
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_STXDW:
+            *(uint64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction) = reg[instruction->src];
+            instruction++;
+            break;
+
+        case EBPF_INTERPRETER_OP_ATOMIC32_ADD:
+            (void)InterlockedAdd(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_OR:
+            (void)InterlockedOr(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_AND:
+            (void)InterlockedAnd(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_XOR:
+            (void)InterlockedXor(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_FETCH_ADD:
+            reg[instruction->src] = (uint32_t)InterlockedExchangeAdd(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_FETCH_OR:
+            reg[instruction->src] = (uint32_t)InterlockedOr(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_FETCH_AND:
+            reg[instruction->src] = (uint32_t)InterlockedAnd(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_FETCH_XOR:
+            reg[instruction->src] = (uint32_t)InterlockedXor(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_XCHG:
+            reg[instruction->src] = (uint32_t)InterlockedExchange(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction), (long)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC32_CMPXCHG:
+            reg[0] = (uint32_t)InterlockedCompareExchange(
+                (volatile long*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (long)reg[instruction->src],
+                (long)reg[0]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_ADD:
+            (void)InterlockedAdd64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_OR:
+            (void)InterlockedOr64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_AND:
+            (void)InterlockedAnd64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_XOR:
+            (void)InterlockedXor64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_FETCH_ADD:
+            reg[instruction->src] = (uint64_t)InterlockedExchangeAdd64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_FETCH_OR:
+            reg[instruction->src] = (uint64_t)InterlockedOr64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_FETCH_AND:
+            reg[instruction->src] = (uint64_t)InterlockedAnd64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_FETCH_XOR:
+            reg[instruction->src] = (uint64_t)InterlockedXor64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_XCHG:
+            reg[instruction->src] = (uint64_t)InterlockedExchange64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src]);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_ATOMIC64_CMPXCHG:
+            reg[0] = (uint64_t)InterlockedCompareExchange64(
+                (volatile int64_t*)EBPF_INTERPRETER_ADDRESS(instruction->dst, instruction),
+                (int64_t)reg[instruction->src],
+                (int64_t)reg[0]);
+            instruction++;
+            break;
+
+        case EBPF_INTERPRETER_OP_JA:
+            instruction = &instructions[instruction->target];
+            break;
+
+            EBPF_INTERPRETER_JMP_CASES(JEQ, uint64_t, uint32_t, EBPF_INTERPRETER_EQ)
+            EBPF_INTERPRETER_JMP_CASES(JNE, uint64_t, uint32_t, EBPF_INTERPRETER_NE)
+            EBPF_INTERPRETER_JMP_CASES(JGT, uint64_t, uint32_t, EBPF_INTERPRETER_GT)
+            EBPF_INTERPRETER_JMP_CASES(JGE, uint64_t, uint32_t, EBPF_INTERPRETER_GE)
+            EBPF_INTERPRETER_JMP_CASES(JLT, uint64_t, uint32_t, EBPF_INTERPRETER_LT)
+            EBPF_INTERPRETER_JMP_CASES(JLE, uint64_t, uint32_t, EBPF_INTERPRETER_LE)
+            EBPF_INTERPRETER_JMP_CASES(JSET, uint64_t, uint32_t, EBPF_INTERPRETER_SET)
+            EBPF_INTERPRETER_JMP_CASES(JSGT, int64_t, int32_t, EBPF_INTERPRETER_GT)
+            EBPF_INTERPRETER_JMP_CASES(JSGE, int64_t, int32_t, EBPF_INTERPRETER_GE)
+            EBPF_INTERPRETER_JMP_CASES(JSLT, int64_t, int32_t, EBPF_INTERPRETER_LT)
+            EBPF_INTERPRETER_JMP_CASES(JSLE, int64_t, int32_t, EBPF_INTERPRETER_LE)
+
+        case EBPF_INTERPRETER_OP_MOV64_IMM_CALL_HELPER:
+            reg[instruction->dst] = instruction->imm;
+            helper = (ebpf_interpreter_helper_t)ReadPointerNoFence(
+                (void* const volatile*)&program->helpers[instruction->target]);
+            if (helper == NULL) {
+                return -1;
+            }
+            reg[0] = helper(reg[1], reg[2], reg[3], reg[4], reg[5], context);
+            instruction += 2;
+            break;
+        case EBPF_INTERPRETER_OP_CALL_HELPER:
+            helper = (ebpf_interpreter_helper_t)ReadPointerNoFence(
+                (void* const volatile*)&program->helpers[instruction->target]);
+            if (helper == NULL) {
+                return -1;
+            }
+            reg[0] = helper(reg[1], reg[2], reg[3], reg[4], reg[5], context);
+            instruction++;
+            break;
+        case EBPF_INTERPRETER_OP_CALL_LOCAL: {
+            if (call_depth + 1 >= EBPF_INTERPRETER_MAX_CALL_DEPTH) {
+                return -1;
+            }
+            ebpf_interpreter_frame_t* frame = &frames[call_depth++];
+            frame->saved_registers[0] = reg[6];
+            frame->saved_registers[1] = reg[7];
+            frame->saved_registers[2] = reg[8];
+            frame->saved_registers[3] = reg[9];
+            frame->frame_pointer = reg[EBPF_INTERPRETER_FRAME_POINTER];
+            frame->return_address = instruction + 1;
+            reg[EBPF_INTERPRETER_FRAME_POINTER] -= EBPF_INTERPRETER_STACK_SIZE;
+            instruction = &instructions[instruction->target];
+            break;
+        }
+        case EBPF_INTERPRETER_OP_EXIT: {
+            if (call_depth == 0) {
+                *return_value = reg[0];
+                return 0;
+            }
+            const ebpf_interpreter_frame_t* frame = &frames[--call_depth];
+            reg[6] = frame->saved_registers[0];
+            reg[7] = frame->saved_registers[1];
+            reg[8] = frame->saved_registers[2];
+            reg[9] = frame->saved_registers[3];
+            reg[EBPF_INTERPRETER_FRAME_POINTER] = frame->frame_pointer;
+            instruction = frame->return_address;
+            break;
+        }
+
+            EBPF_INTERPRETER_LOAD_JUMP_CASES(LDXB, uint8_t)
+            EBPF_INTERPRETER_LOAD_JUMP_CASES(LDXH, uint16_t)
+            EBPF_INTERPRETER_LOAD_JUMP_CASES(LDXW, uint32_t)
+            EBPF_INTERPRETER_LOAD_JUMP_CASES(LDXDW, uint64_t)
+
+        case EBPF_INTERPRETER_OP_TRAP:
+        default:
+            return -1;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ebpf_program.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Pre-decoded form of an eBPF program, executed by a threaded-code interpreter.
+     *
+     * Each instruction is decoded once into a fixed-size record with its branch target resolved to an absolute index,
+     * its immediate sign-extended (or combined, for 64-bit immediate loads) and its operation folded into a single
+     * dense operation code. Common instruction pairs are fused into superinstructions.
+     */
+    typedef struct _ebpf_interpreter_program ebpf_interpreter_program_t;
+
+    /**
+     * @brief Decode eBPF byte code into the pre-decoded form.
+     *
+     * @param[in] instructions Instructions to decode. Helper call immediates must already be indices into the
+     *  program's helper table.
+     * @param[in] instruction_count Number of instructions.
+     * @param[in] helper_count Number of entries in the program's helper table.
+     * @param[out] program Pointer to memory that will contain the decoded program on success.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MEMORY Unable to allocate resources for this operation.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The program uses an instruction the pre-decoded interpreter does not
+     *  support. The caller should fall back to the byte code interpreter.
+     * @retval EBPF_INVALID_ARGUMENT The program is malformed.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_interpreter_program_create(
+        _In_reads_(instruction_count) const ebpf_instruction_t* instructions,
+        size_t instruction_count,
+        size_t helper_count,
+        _Outptr_ ebpf_interpreter_program_t** program);
+
+    /**
+     * @brief Free a pre-decoded program.
+     *
+     * @param[in] program Program to free.
+     */
+    void
+    ebpf_interpreter_program_free(_In_opt_ _Frees_ptr_opt_ ebpf_interpreter_program_t* program);
+
+    /**
+     * @brief Set the address of a helper function called by the program.
+     *
+     * @param[in, out] program Program to update.
+     * @param[in] index Index of the helper in the program's helper table.
+     * @param[in] address Address of the helper function.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The index is out of range.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_interpreter_program_set_helper(_Inout_ ebpf_interpreter_program_t* program, uint32_t index, uint64_t address);
+
+    /**
+     * @brief Execute a pre-decoded program.
+     *
+     * @param[in] program Program to execute.
+     * @param[in, out] context Program context, passed in R1 and as the implicit context of helper functions.
+     * @param[out] return_value Value of R0 when the program exits.
+     * @retval 0 The program ran to completion.
+     * @retval -1 The program called an unresolved helper, exceeded the maximum call depth or ran off the end of the
+     *  instructions.
+     */
+    int
+    ebpf_interpreter_program_execute(
+        _In_ const ebpf_interpreter_program_t* program, _Inout_ void* context, _Out_ uint64_t* return_value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -89,6 +89,9 @@ _ebpf_link_instance_invoke_batch(
 static ebpf_result_t
 _ebpf_link_instance_invoke_batch_end(_Inout_ void* state);
 
+static ebpf_result_t
+_ebpf_link_instance_get_map_update_generation(_In_ const void* client_binding_context, _Out_ uint64_t* generation);
+
 // Dispatch table.
 static const ebpf_extension_program_dispatch_table_t _ebpf_link_dispatch_table = {
     EBPF_LINK_DISPATCH_TABLE_VERSION_CURRENT,
@@ -98,6 +101,7 @@ static const ebpf_extension_program_dispatch_table_t _ebpf_link_dispatch_table =
     _ebpf_link_instance_invoke_batch_begin,
     _ebpf_link_instance_invoke_batch,
     _ebpf_link_instance_invoke_batch_end,
+    _ebpf_link_instance_get_map_update_generation,
 };
 
 // Assert that the invoke function is aligned with ebpf_extension_dispatch_table_t->function.
@@ -541,6 +545,22 @@ _ebpf_link_instance_invoke_batch_end(_Inout_ void* state)
     return EBPF_SUCCESS;
 }
 
+static ebpf_result_t
+_ebpf_link_instance_get_map_update_generation(_In_ const void* client_binding_context, _Out_ uint64_t* generation)
+{
+    // No function entry exit traces as this is a high volume function.
+    const ebpf_link_t* link = (const ebpf_link_t*)client_binding_context;
+    ebpf_epoch_state_t epoch_state;
+    ebpf_result_t return_value;
+
+    // The program's map array is replaced when a map is added, and the old one is freed at the end of the epoch.
+    ebpf_epoch_enter(&epoch_state);
+    return_value = ebpf_program_get_map_update_generation(link->program, generation);
+    ebpf_epoch_exit(&epoch_state);
+
+    return return_value;
+}
+
 static ebpf_result_t
 _ebpf_link_instance_invoke_batch(
     _In_ const void* client_binding_context,
@@ -0,0 +1,270 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#define EBPF_FILE_ID EBPF_FILE_ID_MAP_CURSOR
+
+#include "ebpf_handle.h"
+#include "ebpf_map_cursor.h"
+#include "ebpf_object.h"
+#include "ebpf_tracelog.h"
+
+static const uint32_t _ebpf_map_cursor_marker = 'emcu';
+
+// Size of the buffer used to read a snapshot from the map. The buffer is doubled each time it fills up.
+#define EBPF_MAP_CURSOR_INITIAL_SNAPSHOT_SIZE (64 * 1024)
+// Largest snapshot a cursor copies. The snapshot is in non-paged pool, as the map is read with its locks held, so the
+// copy stops here and the rest of the map is read live.
+#define EBPF_MAP_CURSOR_MAXIMUM_SNAPSHOT_SIZE (16 * 1024 * 1024)
+
+typedef struct _ebpf_map_cursor
+{
+    ebpf_base_object_t base;
+    ebpf_map_t* map;              ///< Map being iterated. The cursor holds a reference on it.
+    int flags;                    ///< EBPF_MAP_FLAG_PERCPU_* flags passed to ebpf_map_iterate_entries.
+    size_t record_length;         ///< Length of a key and value returned by the cursor.
+    ebpf_lock_t lock;             ///< Serializes ebpf_map_cursor_next.
+    ebpf_map_position_t position; ///< Position of the next entry in the map.
+    uint8_t* snapshot;            ///< Copy of the entries of the map, or NULL for a live cursor.
+    size_t snapshot_length;       ///< Length of the copy.
+    size_t snapshot_offset;       ///< Offset of the next entry in the copy.
+    bool snapshot_truncated;      ///< Whether the copy stopped at position, before the end of the map.
+} ebpf_map_cursor_t;
+
+void
+ebpf_object_update_reference_history(void* object, bool acquire, uint32_t file_id, uint32_t line);
+
+static void
+_ebpf_map_cursor_free(_In_opt_ _Post_invalid_ ebpf_map_cursor_t* cursor)
+{
+    if (!cursor) {
+        return;
+    }
+
+    if (cursor->map) {
+        EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)cursor->map);
+    }
+    ebpf_lock_destroy(&cursor->lock);
+    ebpf_free(cursor->snapshot);
+    cursor->base.marker = ~_ebpf_map_cursor_marker;
+    ebpf_free(cursor);
+}
+
+static void
+_ebpf_map_cursor_acquire_reference_internal(
+    void* base_object, bool user_reference, ebpf_file_id_t file_id, uint32_t line)
+{
+    UNREFERENCED_PARAMETER(user_reference);
+    ebpf_map_cursor_t* cursor = (ebpf_map_cursor_t*)base_object;
+    ebpf_assert(cursor->base.marker == _ebpf_map_cursor_marker);
+    ebpf_object_update_reference_history(base_object, true, file_id, line);
+    if (ebpf_interlocked_increment_int64(&cursor->base.reference_count) == 1) {
+        __fastfail(FAST_FAIL_INVALID_REFERENCE_COUNT);
+    }
+}
+
+static void
+_ebpf_map_cursor_release_reference_internal(
+    void* base_object, bool user_reference, ebpf_file_id_t file_id, uint32_t line)
+{
+    UNREFERENCED_PARAMETER(user_reference);
+    ebpf_map_cursor_t* cursor = (ebpf_map_cursor_t*)base_object;
+    ebpf_assert(cursor->base.marker == _ebpf_map_cursor_marker);
+    ebpf_object_update_reference_history(base_object, false, file_id, line);
+    int64_t new_reference_count = ebpf_interlocked_decrement_int64(&cursor->base.reference_count);
+    if (new_reference_count < 0) {
+        __fastfail(FAST_FAIL_INVALID_REFERENCE_COUNT);
+    }
+    if (new_reference_count == 0) {
+        _ebpf_map_cursor_free(cursor);
+    }
+}
+
+static bool
+_ebpf_map_cursor_compare(_In_ const ebpf_base_object_t* object, _In_opt_ const void* context)
+{
+    UNREFERENCED_PARAMETER(context);
+    return object->marker == _ebpf_map_cursor_marker;
+}
+
+/**
+ * @brief Copy all entries of the map into the snapshot buffer of the cursor. Each bucket of the map is read
+ * atomically, but writers are not blocked, so an entry updated during the copy may be seen in either state. If the
+ * entries do not fit in EBPF_MAP_CURSOR_MAXIMUM_SNAPSHOT_SIZE, the copy is truncated and the position of the cursor is
+ * left at the first entry that was not copied.
+ *
+ * @param[in, out] cursor Cursor to fill the snapshot of.
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_NO_MEMORY Unable to allocate resources for this operation.
+ */
+static _Must_inspect_result_ ebpf_result_t
+_ebpf_map_cursor_take_snapshot(_Inout_ ebpf_map_cursor_t* cursor)
+{
+    ebpf_result_t result;
+    ebpf_map_position_t position = {0};
+    size_t snapshot_size = EBPF_MAP_CURSOR_INITIAL_SNAPSHOT_SIZE;
+    size_t maximum_snapshot_size = EBPF_MAP_CURSOR_MAXIMUM_SNAPSHOT_SIZE;
+    size_t snapshot_length = 0;
+    uint8_t* snapshot = NULL;
+    bool snapshot_truncated = false;
+
+    if (snapshot_size < cursor->record_length) {
+        snapshot_size = cursor->record_length;
+    }
+    if (maximum_snapshot_size < snapshot_size) {
+        maximum_snapshot_size = snapshot_size;
+    }
+
+    snapshot = ebpf_allocate_with_tag(snapshot_size, EBPF_POOL_TAG_MAP_CURSOR);
+    if (!snapshot) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    for (;;) {
+        if (snapshot_size - snapshot_length < cursor->record_length) {
+            if (snapshot_size == maximum_snapshot_size) {
+                snapshot_truncated = true;
+                break;
+            }
+            size_t new_snapshot_size = min(snapshot_size * 2, maximum_snapshot_size);
+            uint8_t* new_snapshot = ebpf_reallocate(
+                snapshot, CXPLAT_POOL_FLAG_NON_PAGED, snapshot_size, new_snapshot_size, EBPF_POOL_TAG_MAP_CURSOR);
+            if (!new_snapshot) {
+                result = EBPF_NO_MEMORY;
+                goto Done;
+            }
+            snapshot = new_snapshot;
+            snapshot_size = new_snapshot_size;
+        }
+
+        size_t length = snapshot_size - snapshot_length;
+        result = ebpf_map_iterate_entries(cursor->map, &position, cursor->flags, &length, snapshot + snapshot_length);
+        if (result == EBPF_NO_MORE_KEYS) {
+            result = EBPF_SUCCESS;
+            break;
+        }
+        if (result != EBPF_SUCCESS) {
+            goto Done;
+        }
+        snapshot_length += length;
+    }
+
+    cursor->snapshot = snapshot;
+    cursor->snapshot_length = snapshot_length;
+    cursor->snapshot_truncated = snapshot_truncated;
+    cursor->position = position;
+    snapshot = NULL;
+
+Done:
+    ebpf_free(snapshot);
+    return result;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_cursor_create(_In_ ebpf_map_t* map, int flags, bool snapshot, _Outptr_ ebpf_map_cursor_t** cursor)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    ebpf_map_cursor_t* local_cursor = NULL;
+    const ebpf_map_definition_in_memory_t* definition = ebpf_map_get_definition(map);
+    ebpf_map_position_t position = {0};
+    size_t length = 0;
+
+    // Validate the map type and flags with an empty read, so that a cursor is never created for a map it can't
+    // iterate.
+    result = ebpf_map_iterate_entries(map, &position, flags, &length, NULL);
+    if (result != EBPF_INSUFFICIENT_BUFFER) {
+        goto Done;
+    }
+
+    local_cursor = ebpf_allocate_with_tag(sizeof(ebpf_map_cursor_t), EBPF_POOL_TAG_MAP_CURSOR);
+    if (!local_cursor) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    local_cursor->base.marker = _ebpf_map_cursor_marker;
+    local_cursor->base.acquire_reference = _ebpf_map_cursor_acquire_reference_internal;
+    local_cursor->base.release_reference = _ebpf_map_cursor_release_reference_internal;
+    local_cursor->base.reference_count = 1;
+    ebpf_lock_create(&local_cursor->lock);
+
+    local_cursor->map = map;
+    EBPF_OBJECT_ACQUIRE_REFERENCE((ebpf_core_object_t*)map);
+    local_cursor->flags = flags;
+    // An aggregated value is the size of the value of a single CPU.
+    local_cursor->record_length = definition->key_size;
+    local_cursor->record_length += (flags & EBPF_MAP_FLAG_PERCPU_AGGREGATE_MASK)
+                                       ? ebpf_map_get_effective_value_size(map)
+                                       : definition->value_size;
+
+    if (snapshot) {
+        result = _ebpf_map_cursor_take_snapshot(local_cursor);
+        if (result != EBPF_SUCCESS) {
+            goto Done;
+        }
+    }
+
+    *cursor = local_cursor;
+    local_cursor = NULL;
+    result = EBPF_SUCCESS;
+
+Done:
+    _ebpf_map_cursor_free(local_cursor);
+    EBPF_RETURN_RESULT(result);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_cursor_reference_by_handle(ebpf_handle_t handle, _Outptr_ ebpf_map_cursor_t** cursor)
+{
+    return ebpf_reference_base_object_by_handle(
+        handle, _ebpf_map_cursor_compare, NULL, (ebpf_base_object_t**)cursor, EBPF_FILE_ID, __LINE__);
+}
+
+void
+ebpf_map_cursor_release_reference(_In_opt_ _Post_invalid_ ebpf_map_cursor_t* cursor)
+{
+    if (cursor) {
+        EBPF_OBJECT_RELEASE_REFERENCE_INDIRECT((&cursor->base));
+    }
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_cursor_next(
+    _Inout_ ebpf_map_cursor_t* cursor,
+    _Inout_ size_t* key_and_value_length,
+    _Out_writes_bytes_to_(*key_and_value_length, *key_and_value_length) uint8_t* key_and_value)
+{
+    ebpf_result_t result;
+    size_t maximum_length = *key_and_value_length;
+
+    *key_and_value_length = 0;
+
+    ebpf_lock_state_t state = ebpf_lock_lock(&cursor->lock);
+    if (cursor->snapshot != NULL && cursor->snapshot_truncated && cursor->snapshot_offset == cursor->snapshot_length) {
+        // The rest of the map did not fit in the snapshot, so continue live from where the copy stopped.
+        ebpf_free(cursor->snapshot);
+        cursor->snapshot = NULL;
+    }
+
+    if (cursor->snapshot == NULL) {
+        *key_and_value_length = maximum_length;
+        result = ebpf_map_iterate_entries(
+            cursor->map, &cursor->position, cursor->flags, key_and_value_length, key_and_value);
+    } else if (cursor->snapshot_offset == cursor->snapshot_length) {
+        result = EBPF_NO_MORE_KEYS;
+    } else if (maximum_length < cursor->record_length) {
+        result = EBPF_INSUFFICIENT_BUFFER;
+    } else {
+        // Only return whole entries.
+        size_t length = min(maximum_length, cursor->snapshot_length - cursor->snapshot_offset);
+        length -= length % cursor->record_length;
+        memcpy(key_and_value, cursor->snapshot + cursor->snapshot_offset, length);
+        cursor->snapshot_offset += length;
+        *key_and_value_length = length;
+        result = EBPF_SUCCESS;
+    }
+    ebpf_lock_unlock(&cursor->lock, state);
+
+    return result;
+}
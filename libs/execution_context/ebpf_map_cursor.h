@@ -0,0 +1,75 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ebpf_maps.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief A cursor over the entries of a map, owned by a user mode process through a handle. A live cursor keeps a
+     * position in the map and returns the entries that follow it, so dumping a map takes linear time and survives
+     * concurrent updates. A snapshot cursor copies all entries when it is created and returns pages of the copy. The
+     * copy is capped in size; entries beyond the cap are read live once the copy has been returned.
+     */
+    typedef struct _ebpf_map_cursor ebpf_map_cursor_t;
+
+    /**
+     * @brief Create a cursor over the entries of a map. The cursor holds a reference on the map.
+     *
+     * @param[in] map Map to iterate. Must support ebpf_map_iterate_entries.
+     * @param[in] flags Zero or one of the EBPF_MAP_FLAG_PERCPU_* flags to return a single aggregated value per key
+     * from a per-CPU map.
+     * @param[in] snapshot Whether to copy all entries of the map now.
+     * @param[out] cursor Pointer to memory that contains the cursor on success. The caller owns a reference on it.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The flags are not valid for this map.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map does not support cursors.
+     * @retval EBPF_NO_MEMORY Unable to allocate resources for this operation.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_cursor_create(_In_ ebpf_map_t* map, int flags, bool snapshot, _Outptr_ ebpf_map_cursor_t** cursor);
+
+    /**
+     * @brief Find the map cursor that a handle refers to and acquire a reference on it.
+     *
+     * @param[in] handle Handle to the map cursor.
+     * @param[out] cursor Pointer to memory that contains the cursor on success.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_OBJECT The handle does not refer to a map cursor.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_cursor_reference_by_handle(ebpf_handle_t handle, _Outptr_ ebpf_map_cursor_t** cursor);
+
+    /**
+     * @brief Release a reference on a map cursor. The cursor is freed when the last reference is released.
+     *
+     * @param[in] cursor The cursor to release.
+     */
+    void
+    ebpf_map_cursor_release_reference(_In_opt_ _Post_invalid_ ebpf_map_cursor_t* cursor);
+
+    /**
+     * @brief Copy the next keys and values to the caller provided buffer and advance the cursor past them.
+     *
+     * @param[in, out] cursor The cursor to advance.
+     * @param[in,out] key_and_value_length Length of the key and value buffer on input. On output, the number of bytes
+     * actually written, which is a multiple of the length of a key and value.
+     * @param[out] key_and_value Buffer to write the keys and values into.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MORE_KEYS The cursor is at the end of the map.
+     * @retval EBPF_INSUFFICIENT_BUFFER The buffer cannot hold a single key and value.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_cursor_next(
+        _Inout_ ebpf_map_cursor_t* cursor,
+        _Inout_ size_t* key_and_value_length,
+        _Out_writes_bytes_to_(*key_and_value_length, *key_and_value_length) uint8_t* key_and_value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,324 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#define EBPF_FILE_ID EBPF_FILE_ID_MAP_QUEUE
+
+#include "ebpf_handle.h"
+#include "ebpf_map_queue.h"
+#include "ebpf_object.h"
+#include "ebpf_tracelog.h"
+
+static const uint32_t _ebpf_map_queue_marker = 'emqu';
+
+typedef struct _ebpf_map_queue
+{
+    ebpf_base_object_t base;
+    ebpf_ring_buffer_t* submission_ring; ///< Produced by user mode, consumed by ebpf_map_queue_process.
+    ebpf_ring_buffer_t* completion_ring; ///< Produced by ebpf_map_queue_process, consumed by user mode.
+    uint8_t* submission;                 ///< Private copy of the submission being executed.
+    size_t submission_size;              ///< Size of the submission buffer.
+    volatile int32_t processing;         ///< Non-zero while a thread is processing the submission ring.
+} ebpf_map_queue_t;
+
+void
+ebpf_object_update_reference_history(void* object, bool acquire, uint32_t file_id, uint32_t line);
+
+static void
+_ebpf_map_queue_free(_In_opt_ _Post_invalid_ ebpf_map_queue_t* queue)
+{
+    if (!queue) {
+        return;
+    }
+
+    if (queue->submission_ring && queue->completion_ring) {
+        // Remove the user mappings if the queue is released by the process that mapped it without unmapping it
+        // first, e.g. when the process exits. This fails harmlessly if the queue is not mapped.
+        ebpf_result_t result = ebpf_ring_buffer_unmap_user(queue->submission_ring);
+        if (result == EBPF_SUCCESS) {
+            result = ebpf_ring_buffer_unmap_user(queue->completion_ring);
+            ebpf_assert(result == EBPF_SUCCESS);
+        }
+    }
+
+    ebpf_ring_buffer_destroy(queue->submission_ring);
+    ebpf_ring_buffer_destroy(queue->completion_ring);
+    ebpf_free(queue->submission);
+    queue->base.marker = ~_ebpf_map_queue_marker;
+    ebpf_free(queue);
+}
+
+static void
+_ebpf_map_queue_acquire_reference_internal(
+    void* base_object, bool user_reference, ebpf_file_id_t file_id, uint32_t line)
+{
+    UNREFERENCED_PARAMETER(user_reference);
+    ebpf_map_queue_t* queue = (ebpf_map_queue_t*)base_object;
+    ebpf_assert(queue->base.marker == _ebpf_map_queue_marker);
+    ebpf_object_update_reference_history(base_object, true, file_id, line);
+    if (ebpf_interlocked_increment_int64(&queue->base.reference_count) == 1) {
+        __fastfail(FAST_FAIL_INVALID_REFERENCE_COUNT);
+    }
+}
+
+static void
+_ebpf_map_queue_release_reference_internal(
+    void* base_object, bool user_reference, ebpf_file_id_t file_id, uint32_t line)
+{
+    UNREFERENCED_PARAMETER(user_reference);
+    ebpf_map_queue_t* queue = (ebpf_map_queue_t*)base_object;
+    ebpf_assert(queue->base.marker == _ebpf_map_queue_marker);
+    ebpf_object_update_reference_history(base_object, false, file_id, line);
+    int64_t new_reference_count = ebpf_interlocked_decrement_int64(&queue->base.reference_count);
+    if (new_reference_count < 0) {
+        __fastfail(FAST_FAIL_INVALID_REFERENCE_COUNT);
+    }
+    if (new_reference_count == 0) {
+        _ebpf_map_queue_free(queue);
+    }
+}
+
+static bool
+_ebpf_map_queue_compare(_In_ const ebpf_base_object_t* object, _In_opt_ const void* context)
+{
+    UNREFERENCED_PARAMETER(context);
+    return object->marker == _ebpf_map_queue_marker;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_queue_create(size_t ring_size, _Outptr_ ebpf_map_queue_t** queue)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    ebpf_map_queue_t* local_queue = NULL;
+
+    if (ring_size < PAGE_SIZE || ring_size > EBPF_MAP_QUEUE_MAX_RING_SIZE || (ring_size & (ring_size - 1)) != 0) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Done;
+    }
+
+    local_queue = ebpf_allocate_with_tag(sizeof(ebpf_map_queue_t), EBPF_POOL_TAG_MAP_QUEUE);
+    if (!local_queue) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    local_queue->base.marker = _ebpf_map_queue_marker;
+    local_queue->base.acquire_reference = _ebpf_map_queue_acquire_reference_internal;
+    local_queue->base.release_reference = _ebpf_map_queue_release_reference_internal;
+    local_queue->base.reference_count = 1;
+
+    result = ebpf_ring_buffer_create(&local_queue->submission_ring, ring_size);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    result = ebpf_ring_buffer_create(&local_queue->completion_ring, ring_size);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    // A record can use the whole ring, so a buffer of the ring size holds any submission.
+    local_queue->submission_size = ring_size;
+    local_queue->submission = ebpf_allocate_with_tag(ring_size, EBPF_POOL_TAG_MAP_QUEUE);
+    if (!local_queue->submission) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    *queue = local_queue;
+    local_queue = NULL;
+    result = EBPF_SUCCESS;
+
+Done:
+    _ebpf_map_queue_free(local_queue);
+    EBPF_RETURN_RESULT(result);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_queue_reference_by_handle(ebpf_handle_t handle, _Outptr_ ebpf_map_queue_t** queue)
+{
+    return ebpf_reference_base_object_by_handle(
+        handle, _ebpf_map_queue_compare, NULL, (ebpf_base_object_t**)queue, EBPF_FILE_ID, __LINE__);
+}
+
+void
+ebpf_map_queue_release_reference(_In_opt_ _Post_invalid_ ebpf_map_queue_t* queue)
+{
+    if (queue) {
+        EBPF_OBJECT_RELEASE_REFERENCE_INDIRECT((&queue->base));
+    }
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_queue_map_user(
+    _Inout_ ebpf_map_queue_t* queue, ebpf_handle_t wait_handle, _Out_ ebpf_map_queue_user_mapping_t* mapping)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    size_t data_size;
+
+    memset(mapping, 0, sizeof(*mapping));
+
+    if (wait_handle != ebpf_handle_invalid) {
+        result = ebpf_ring_buffer_set_wait_handle(queue->completion_ring, wait_handle, 0);
+        if (result != EBPF_SUCCESS) {
+            goto Done;
+        }
+    }
+
+    result = ebpf_ring_buffer_map_user_producer(
+        queue->submission_ring,
+        &mapping->submission_consumer,
+        &mapping->submission_producer,
+        &mapping->submission_data,
+        &mapping->ring_size);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    result = ebpf_ring_buffer_map_user(
+        queue->completion_ring,
+        &mapping->completion_consumer,
+        &mapping->completion_producer,
+        &mapping->completion_data,
+        &data_size);
+    if (result != EBPF_SUCCESS) {
+        ebpf_assert_success(ebpf_ring_buffer_unmap_user(queue->submission_ring));
+        memset(mapping, 0, sizeof(*mapping));
+        goto Done;
+    }
+
+Done:
+    EBPF_RETURN_RESULT(result);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_queue_unmap_user(_Inout_ ebpf_map_queue_t* queue)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result = ebpf_ring_buffer_unmap_user(queue->submission_ring);
+    if (result == EBPF_SUCCESS) {
+        result = ebpf_ring_buffer_unmap_user(queue->completion_ring);
+    }
+    EBPF_RETURN_RESULT(result);
+}
+
+/**
+ * @brief Check that the key and value sizes of a submission match its length.
+ *
+ * @param[in] submission The submission to check.
+ * @param[in] length Length of the submission record.
+ * @retval EBPF_SUCCESS The submission is well formed.
+ * @retval EBPF_INVALID_ARGUMENT The submission is malformed.
+ */
+static ebpf_result_t
+_ebpf_map_queue_validate_submission(_In_ const ebpf_map_queue_submission_t* submission, size_t length)
+{
+    size_t data_length = length - EBPF_OFFSET_OF(ebpf_map_queue_submission_t, data);
+    switch (submission->operation) {
+    case EBPF_MAP_QUEUE_OPERATION_LOOKUP:
+    case EBPF_MAP_QUEUE_OPERATION_DELETE:
+        return (submission->key_size == data_length) ? EBPF_SUCCESS : EBPF_INVALID_ARGUMENT;
+    case EBPF_MAP_QUEUE_OPERATION_UPDATE:
+        return ((size_t)submission->key_size + submission->value_size == data_length) ? EBPF_SUCCESS
+                                                                                       : EBPF_INVALID_ARGUMENT;
+    default:
+        return EBPF_INVALID_ARGUMENT;
+    }
+}
+
+/**
+ * @brief Execute submissions until the submission ring is empty, the completion ring is full, or the submission
+ * ring is found to be corrupt. The caller must own the queue's processing flag.
+ */
+static ebpf_result_t
+_ebpf_map_queue_drain(
+    _Inout_ ebpf_map_queue_t* queue,
+    _In_ ebpf_map_queue_execute_t execute,
+    _Inout_opt_ void* context,
+    _Inout_ size_t* processed_count)
+{
+    for (;;) {
+        size_t length;
+        size_t next_offset;
+        ebpf_result_t result = ebpf_ring_buffer_read_user_record(
+            queue->submission_ring, queue->submission, queue->submission_size, &length, &next_offset);
+        if (result == EBPF_NO_MORE_KEYS) {
+            return EBPF_SUCCESS;
+        }
+        if (result != EBPF_SUCCESS && result != EBPF_INSUFFICIENT_BUFFER) {
+            return result;
+        }
+
+        const ebpf_map_queue_submission_t* submission = (const ebpf_map_queue_submission_t*)queue->submission;
+        uint64_t user_data = (length >= sizeof(submission->user_data)) ? submission->user_data : 0;
+        ebpf_result_t operation_result = result;
+        if (operation_result == EBPF_SUCCESS) {
+            operation_result = (length >= EBPF_OFFSET_OF(ebpf_map_queue_submission_t, data))
+                                   ? _ebpf_map_queue_validate_submission(submission, length)
+                                   : EBPF_INVALID_ARGUMENT;
+        }
+
+        bool lookup = (operation_result == EBPF_SUCCESS) && (submission->operation == EBPF_MAP_QUEUE_OPERATION_LOOKUP);
+        size_t value_size = lookup ? submission->value_size : 0;
+        ebpf_map_queue_completion_t* completion;
+        result = ebpf_ring_buffer_reserve(
+            queue->completion_ring,
+            (uint8_t**)&completion,
+            EBPF_OFFSET_OF(ebpf_map_queue_completion_t, value) + value_size);
+        if (result == EBPF_INVALID_ARGUMENT) {
+            // The value can never fit in the completion ring, so complete the lookup with an error instead.
+            lookup = false;
+            value_size = 0;
+            operation_result = EBPF_INVALID_ARGUMENT;
+            result = ebpf_ring_buffer_reserve(
+                queue->completion_ring, (uint8_t**)&completion, EBPF_OFFSET_OF(ebpf_map_queue_completion_t, value));
+        }
+        if (result != EBPF_SUCCESS) {
+            // The completion ring is full. Leave the submission in place until user mode consumes completions.
+            return result;
+        }
+
+        if (operation_result == EBPF_SUCCESS) {
+            operation_result = execute(context, submission, lookup ? completion->value : NULL);
+        }
+
+        completion->user_data = user_data;
+        completion->result = operation_result;
+        completion->value_size = (lookup && operation_result == EBPF_SUCCESS) ? (uint32_t)value_size : 0;
+        ebpf_assert_success(ebpf_ring_buffer_submit((uint8_t*)completion, 0));
+
+        ebpf_ring_buffer_return_user_record(queue->submission_ring, next_offset);
+        (*processed_count)++;
+    }
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_queue_process(
+    _Inout_ ebpf_map_queue_t* queue,
+    _In_ ebpf_map_queue_execute_t execute,
+    _Inout_opt_ void* context,
+    _Out_ size_t* processed_count)
+{
+    ebpf_result_t result = EBPF_SUCCESS;
+    *processed_count = 0;
+
+    for (;;) {
+        if (ebpf_interlocked_compare_exchange_int32(&queue->processing, 1, 0) != 0) {
+            // Another thread is processing the queue and will pick up the new submissions.
+            break;
+        }
+
+        result = _ebpf_map_queue_drain(queue, execute, context, processed_count);
+
+        (void)ebpf_interlocked_compare_exchange_int32(&queue->processing, 0, 1);
+
+        // User mode only sends a notification when it publishes to an empty ring. A submission published after the
+        // last read saw a non-empty ring, so check again now that the processing flag is clear.
+        if (result != EBPF_SUCCESS || !ebpf_ring_buffer_user_record_pending(queue->submission_ring)) {
+            break;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,130 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ebpf_protocol.h"
+#include "ebpf_ring_buffer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief A queue of map operations shared with a user mode process. The process produces
+     * ebpf_map_queue_submission_t records into the submission ring and consumes ebpf_map_queue_completion_t records
+     * from the completion ring. Both rings are mapped into the process, so a batch of operations costs a single
+     * notification instead of one IOCTL per operation.
+     */
+    typedef struct _ebpf_map_queue ebpf_map_queue_t;
+
+    /**
+     * @brief User mode addresses of the rings of a map queue.
+     */
+    typedef struct _ebpf_map_queue_user_mapping
+    {
+        void* submission_consumer;
+        void* submission_producer;
+        uint8_t* submission_data;
+        void* completion_consumer;
+        void* completion_producer;
+        uint8_t* completion_data;
+        size_t ring_size;
+    } ebpf_map_queue_user_mapping_t;
+
+    /**
+     * @brief Function invoked for each submission. The submission has been copied out of the shared ring and its
+     * key and value sizes have been checked against its length.
+     *
+     * @param[in, out] context Context passed to ebpf_map_queue_process.
+     * @param[in] submission The submission to execute.
+     * @param[out] value Buffer of submission->value_size bytes that receives the value of a lookup, or NULL for other
+     * operations.
+     * @return Result of the operation, reported to user mode in the completion.
+     */
+    typedef ebpf_result_t (*ebpf_map_queue_execute_t)(
+        _Inout_opt_ void* context,
+        _In_ const ebpf_map_queue_submission_t* submission,
+        _Out_writes_bytes_opt_(submission->value_size) uint8_t* value);
+
+    /**
+     * @brief Create a map queue.
+     *
+     * @param[in] ring_size Size in bytes of each of the rings. Must be a power of two between PAGE_SIZE and
+     * EBPF_MAP_QUEUE_MAX_RING_SIZE.
+     * @param[out] queue Pointer to memory that contains the queue on success. The caller owns a reference on it.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The ring size is not valid.
+     * @retval EBPF_NO_MEMORY Unable to allocate resources for this operation.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_queue_create(size_t ring_size, _Outptr_ ebpf_map_queue_t** queue);
+
+    /**
+     * @brief Find the map queue that a handle refers to and acquire a reference on it.
+     *
+     * @param[in] handle Handle to the map queue.
+     * @param[out] queue Pointer to memory that contains the queue on success.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_OBJECT The handle does not refer to a map queue.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_queue_reference_by_handle(ebpf_handle_t handle, _Outptr_ ebpf_map_queue_t** queue);
+
+    /**
+     * @brief Release a reference on a map queue. The queue is freed when the last reference is released.
+     *
+     * @param[in] queue The queue to release.
+     */
+    void
+    ebpf_map_queue_release_reference(_In_opt_ _Post_invalid_ ebpf_map_queue_t* queue);
+
+    /**
+     * @brief Map the rings of the queue into the calling process and set the event that is signaled when
+     * completions are available.
+     *
+     * @param[in, out] queue The queue to map.
+     * @param[in] wait_handle Event to signal, or ebpf_handle_invalid for none.
+     * @param[out] mapping User mode addresses of the rings.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The queue is already mapped or the wait handle is not valid.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_queue_map_user(
+        _Inout_ ebpf_map_queue_t* queue, ebpf_handle_t wait_handle, _Out_ ebpf_map_queue_user_mapping_t* mapping);
+
+    /**
+     * @brief Unmap the rings of the queue from the calling process.
+     *
+     * @param[in, out] queue The queue to unmap.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The queue is not mapped into the calling process.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_queue_unmap_user(_Inout_ ebpf_map_queue_t* queue);
+
+    /**
+     * @brief Execute the pending submissions in a batch and post their completions. Only one thread processes a
+     * queue at a time; a call that finds another thread processing returns immediately and the submissions are
+     * picked up by that thread. Processing stops early when the completion ring is full, leaving the remaining
+     * submissions in the submission ring.
+     *
+     * @param[in, out] queue The queue to process.
+     * @param[in] execute Function that executes each submission.
+     * @param[in, out] context Context to pass to the function.
+     * @param[out] processed_count Number of submissions completed by this call.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MEMORY The completion ring is full.
+     * @retval EBPF_INVALID_ARGUMENT The submission ring is corrupt.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_queue_process(
+        _Inout_ ebpf_map_queue_t* queue,
+        _In_ ebpf_map_queue_execute_t execute,
+        _Inout_opt_ void* context,
+        _Out_ size_t* processed_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -36,6 +36,10 @@ typedef struct _ebpf_core_map
     uint8_t* data;
     uint8_t* custom_map_context; // Pointer to custom map context, if any. Must be NULL for regular maps.
     const ebpf_map_metadata_table_properties_t* properties; // NULL for custom maps.
+    volatile int64_t update_generation;                     // Incremented after entries are updated or deleted.
+    volatile int32_t writable_user_mapping_count;           // Writable user mappings, which bypass update_generation.
+    uint32_t map_flags;                                     // BPF_F_* flags the map was created with.
+    volatile bool frozen;                                   // Whether user mode can no longer write to the map.
 } ebpf_core_map_t;
 
 static ebpf_hash_table_t* _ebpf_map_type_metadata_table = NULL;
@@ -511,6 +515,12 @@ typedef struct _ebpf_map_metadata_table_properties
         _In_ const uint8_t* previous_key,
         _Out_ uint8_t* next_key,
         _Inout_opt_ uint8_t** next_value);
+    ebpf_result_t (*iterate)(
+        _In_ const ebpf_core_map_t* map,
+        _Inout_ ebpf_map_position_t* position,
+        _Inout_ size_t* count,
+        _Out_writes_to_(*count, *count) const uint8_t** keys,
+        _Out_writes_to_(*count, *count) const uint8_t** values);
     ebpf_result_t (*query_buffer)(
         _In_ const ebpf_core_map_t* map, uint64_t index, _Outptr_ uint8_t** data, _Out_ uint64_t* consumer_offset);
     ebpf_result_t (*return_buffer)(_In_ const ebpf_core_map_t* map, uint64_t index, uint64_t consumer_offset);
@@ -652,6 +662,165 @@ _delete_array_map(_In_ _Post_invalid_ ebpf_core_map_t* map)
     ebpf_epoch_free(map);
 }
 
+/**
+ * @brief A mapping of the values of an array map into a process.
+ */
+typedef struct _ebpf_mmap_array_map_user_mapping
+{
+    ebpf_list_entry_t entry;
+    intptr_t process;                    // Referenced process that mapped the values.
+    uint32_t process_id;                 // Id of process.
+    void* address;                       // Address of the values in process.
+    bool writable;                       // Whether process can write to the values.
+    ebpf_process_state_t* process_state; // Used to attach to process to remove the mapping.
+} ebpf_mmap_array_map_user_mapping_t;
+
+/**
+ * @brief BPF_MAP_TYPE_ARRAY keeps its values in pages of their own instead of after the map structure, so that they
+ * can be mapped into processes, which then read and write the values without an IOCTL.
+ */
+typedef struct _ebpf_core_mmap_array_map
+{
+    ebpf_core_map_t core_map;
+    MDL* memory;                     // Pages that hold the values.
+    size_t memory_size;              // Size of the values rounded up to a whole page.
+    ebpf_lock_t user_mapping_lock;   // Protects user_mappings and the frozen state of the map.
+    ebpf_list_entry_t user_mappings; // ebpf_mmap_array_map_user_mapping_t of each mapping of the values.
+} ebpf_core_mmap_array_map_t;
+
+static ebpf_result_t
+_create_mmap_array_map(
+    _In_ const ebpf_map_definition_in_memory_t* map_definition,
+    ebpf_handle_t inner_map_handle,
+    _Outptr_ ebpf_core_map_t** map)
+{
+    ebpf_result_t retval;
+    size_t map_data_size = 0;
+    ebpf_core_mmap_array_map_t* array_map = NULL;
+
+    *map = NULL;
+
+    if (inner_map_handle != ebpf_handle_invalid) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    retval = ebpf_safe_size_t_multiply(map_definition->max_entries, map_definition->value_size, &map_data_size);
+    if (retval != EBPF_SUCCESS) {
+        goto Done;
+    }
+    retval = ebpf_safe_size_t_add(map_data_size, PAGE_SIZE - 1, &map_data_size);
+    if (retval != EBPF_SUCCESS) {
+        goto Done;
+    }
+    map_data_size &= ~((size_t)PAGE_SIZE - 1);
+
+    // A memory descriptor list describes at most 4GB.
+    if (map_data_size > UINT32_MAX) {
+        retval = EBPF_INVALID_ARGUMENT;
+        goto Done;
+    }
+
+    array_map = ebpf_epoch_allocate_with_tag(sizeof(ebpf_core_mmap_array_map_t), EBPF_POOL_TAG_MAP);
+    if (array_map == NULL) {
+        retval = EBPF_NO_MEMORY;
+        goto Done;
+    }
+    memset(array_map, 0, sizeof(ebpf_core_mmap_array_map_t));
+
+    array_map->memory = ebpf_map_memory(map_data_size);
+    if (array_map->memory == NULL) {
+        retval = EBPF_NO_MEMORY;
+        goto Done;
+    }
+    array_map->core_map.data = ebpf_memory_descriptor_get_base_address(array_map->memory);
+    if (array_map->core_map.data == NULL) {
+        retval = EBPF_NO_MEMORY;
+        goto Done;
+    }
+    memset(array_map->core_map.data, 0, map_data_size);
+    array_map->memory_size = map_data_size;
+    array_map->core_map.ebpf_map_definition = *map_definition;
+    ebpf_lock_create(&array_map->user_mapping_lock);
+    ebpf_list_initialize(&array_map->user_mappings);
+
+    *map = &array_map->core_map;
+    array_map = NULL;
+
+Done:
+    if (array_map != NULL) {
+        ebpf_unmap_memory(array_map->memory);
+        ebpf_epoch_free(array_map);
+    }
+    return retval;
+}
+
+/**
+ * @brief Remove a mapping of the values and free it. The caller must have removed it from the list of mappings.
+ *
+ * @param[in, out] array_map Map whose values are mapped.
+ * @param[in] mapping Mapping to remove.
+ */
+static void
+_ebpf_mmap_array_map_remove_user_mapping(
+    _Inout_ ebpf_core_mmap_array_map_t* array_map, _In_ _Post_invalid_ ebpf_mmap_array_map_user_mapping_t* mapping)
+{
+    // The mapping lives in the address space of the process that created it, which is not necessarily the current
+    // process when the last handle to the map is closed.
+    bool attach = ebpf_platform_process_id() != mapping->process_id;
+    if (attach) {
+        ebpf_platform_attach_process(mapping->process, mapping->process_state);
+    }
+    ebpf_memory_descriptor_unmap_user(array_map->memory, mapping->address);
+    if (attach) {
+        ebpf_platform_detach_process(mapping->process_state);
+    }
+
+    ebpf_platform_dereference_process(mapping->process);
+    if (mapping->writable) {
+        ebpf_interlocked_decrement_int32(&array_map->core_map.writable_user_mapping_count);
+    }
+    ebpf_free(mapping->process_state);
+    ebpf_free(mapping);
+}
+
+static void
+_ebpf_map_mmap_array_map_zero_user_reference(_Inout_ ebpf_core_object_t* object)
+{
+    ebpf_core_map_t* core_map = EBPF_FROM_FIELD(ebpf_core_map_t, object, object);
+    ebpf_core_mmap_array_map_t* array_map = EBPF_FROM_FIELD(ebpf_core_mmap_array_map_t, core_map, core_map);
+    ebpf_assert(object->type == EBPF_OBJECT_MAP);
+
+    // Without a handle the processes can no longer remove their mappings themselves, and the mappings must not outlive
+    // the pages, so remove them now. A concurrent map or unmap request has to hold a handle, so none is in progress.
+    ebpf_list_entry_t mappings;
+    ebpf_list_initialize(&mappings);
+    ebpf_lock_state_t state = ebpf_lock_lock(&array_map->user_mapping_lock);
+    while (!ebpf_list_is_empty(&array_map->user_mappings)) {
+        ebpf_list_insert_tail(&mappings, ebpf_list_remove_head_entry(&array_map->user_mappings));
+    }
+    ebpf_lock_unlock(&array_map->user_mapping_lock, state);
+
+    // Mappings can only be removed at PASSIVE_LEVEL, so not while holding the lock.
+    while (!ebpf_list_is_empty(&mappings)) {
+        ebpf_mmap_array_map_user_mapping_t* mapping =
+            EBPF_FROM_FIELD(ebpf_mmap_array_map_user_mapping_t, entry, ebpf_list_remove_head_entry(&mappings));
+        _ebpf_mmap_array_map_remove_user_mapping(array_map, mapping);
+    }
+}
+
+static void
+_delete_mmap_array_map(_In_ _Post_invalid_ ebpf_core_map_t* map)
+{
+    ebpf_core_mmap_array_map_t* array_map = EBPF_FROM_FIELD(ebpf_core_mmap_array_map_t, core_map, map);
+
+    // The user mappings are removed when the last user handle to the map is closed, so the values are no longer
+    // mapped into any process.
+    ebpf_assert(ebpf_list_is_empty(&array_map->user_mappings));
+    ebpf_lock_destroy(&array_map->user_mapping_lock);
+    ebpf_unmap_memory(array_map->memory);
+    ebpf_epoch_free(array_map);
+}
+
 static ebpf_result_t
 _find_array_map_entry(
     _Inout_ ebpf_core_map_t* map, _In_opt_ const uint8_t* key, uint64_t flags, _Outptr_ uint8_t** data)
@@ -2097,6 +2266,18 @@ _next_hash_map_key_and_value(
     return result;
 }
 
+static ebpf_result_t
+_iterate_hash_map(
+    _In_ const ebpf_core_map_t* map,
+    _Inout_ ebpf_map_position_t* position,
+    _Inout_ size_t* count,
+    _Out_writes_to_(*count, *count) const uint8_t** keys,
+    _Out_writes_to_(*count, *count) const uint8_t** values)
+{
+    return ebpf_hash_table_iterate_from_position(
+        (ebpf_hash_table_t*)map->data, &position->bucket, &position->slot, count, keys, values);
+}
+
 static __forceinline ebpf_result_t
 _ebpf_adjust_value_pointer(_In_ const ebpf_map_t* map, _Inout_ uint8_t** value)
 {
@@ -3429,14 +3610,15 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
                 .update_entry = _update_hash_map_entry,
                 .delete_entry = _delete_hash_map_entry,
                 .next_key_and_value = _next_hash_map_key_and_value,
+                .iterate = _iterate_hash_map,
             },
     },
     {
         .map_type = BPF_MAP_TYPE_ARRAY,
         .properties =
             {
-                .create_map = _create_array_map,
-                .delete_map = _delete_array_map,
+                .create_map = _create_mmap_array_map,
+                .delete_map = _delete_mmap_array_map,
                 .find_entry = _find_array_map_entry,
                 .update_entry = _update_array_map_entry,
                 .delete_entry = _delete_array_map_entry,
@@ -3467,6 +3649,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
                 .update_entry_per_cpu = _update_entry_per_cpu,
                 .delete_entry = _delete_hash_map_entry,
                 .next_key_and_value = _next_hash_map_key_and_value,
+                .iterate = _iterate_hash_map,
                 .per_cpu = true,
             },
     },
@@ -3494,6 +3677,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
                 .update_entry_with_handle = _update_map_hash_map_entry_with_handle,
                 .delete_entry = _delete_map_hash_map_entry,
                 .next_key_and_value = _next_hash_map_key_and_value,
+                .iterate = _iterate_hash_map,
             },
     },
     {
@@ -3518,6 +3702,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
                 .update_entry = _update_hash_map_entry,
                 .delete_entry = _delete_hash_map_entry,
                 .next_key_and_value = _next_hash_map_key_and_value,
+                .iterate = _iterate_hash_map,
                 .key_history = true,
             },
     },
@@ -3556,6 +3741,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
                 .update_entry_per_cpu = _update_entry_per_cpu,
                 .delete_entry = _delete_hash_map_entry,
                 .next_key_and_value = _next_hash_map_key_and_value,
+                .iterate = _iterate_hash_map,
                 .per_cpu = true,
                 .key_history = true,
             },
@@ -3728,6 +3914,17 @@ ebpf_map_create(
     _In_ const ebpf_map_definition_in_memory_t* ebpf_map_definition,
     ebpf_handle_t inner_map_handle,
     _Outptr_ ebpf_map_t** ebpf_map)
+{
+    return ebpf_map_create_with_flags(map_name, ebpf_map_definition, 0, inner_map_handle, ebpf_map);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_create_with_flags(
+    _In_ const cxplat_utf8_string_t* map_name,
+    _In_ const ebpf_map_definition_in_memory_t* ebpf_map_definition,
+    uint32_t map_flags,
+    ebpf_handle_t inner_map_handle,
+    _Outptr_ ebpf_map_t** ebpf_map)
 {
     EBPF_LOG_ENTRY();
     ebpf_map_t* local_map = NULL;
@@ -3744,6 +3941,15 @@ ebpf_map_create(
         goto Exit;
     }
 
+    // Only the values of array maps can be mapped into user mode. No map value holds state that must be hidden from
+    // user mode, such as a lock, as bpf_spin_lock and bpf_timer are not supported. Map types whose values do would
+    // have to refuse the flag.
+    if ((map_flags & ~BPF_F_MMAPABLE) || ((map_flags & BPF_F_MMAPABLE) && type != BPF_MAP_TYPE_ARRAY)) {
+        EBPF_LOG_MESSAGE_UINT64(EBPF_TRACELOG_LEVEL_ERROR, EBPF_TRACELOG_KEYWORD_MAP, "Invalid map flags", map_flags);
+        result = EBPF_INVALID_ARGUMENT;
+        goto Exit;
+    }
+
     const ebpf_map_metadata_table_properties_t* properties = _ebpf_map_metadata_table_query(type);
 
     if (properties == NULL) {
@@ -3776,6 +3982,8 @@ ebpf_map_create(
 
     if (type == BPF_MAP_TYPE_ARRAY_OF_MAPS || type == BPF_MAP_TYPE_HASH_OF_MAPS || type == BPF_MAP_TYPE_PROG_ARRAY) {
         zero_user_function = _ebpf_map_object_map_zero_user_reference;
+    } else if (type == BPF_MAP_TYPE_ARRAY) {
+        zero_user_function = _ebpf_map_mmap_array_map_zero_user_reference;
     }
 
     if (properties->per_cpu) {
@@ -3816,6 +4024,7 @@ ebpf_map_create(
 Initialize:
     local_map->original_value_size = ebpf_map_definition->value_size;
     local_map->properties = properties;
+    local_map->map_flags = map_flags;
 
     result = ebpf_duplicate_utf8_string(&local_map->name, map_name);
     if (result != EBPF_SUCCESS) {
@@ -3840,6 +4049,98 @@ Exit:
     EBPF_RETURN_RESULT(result);
 }
 
+/**
+ * @brief Check if the values of a map can be aggregated across CPUs, i.e. if it is a per-CPU map whose values are
+ * arrays of uint64_t fields.
+ */
+static bool
+_ebpf_map_supports_per_cpu_aggregation(_In_ const ebpf_core_map_t* map)
+{
+    return !MAP_IS_CUSTOM(map) && map->properties->per_cpu && (map->original_value_size % sizeof(uint64_t)) == 0;
+}
+
+/**
+ * @brief Reduce the per-CPU copies of a value to a single value, treating the value as an array of uint64_t fields.
+ */
+static void
+_ebpf_map_aggregate_per_cpu_value(
+    _In_ const ebpf_core_map_t* map,
+    _In_ const uint8_t* per_cpu_values,
+    _Out_writes_bytes_(map->original_value_size) uint8_t* value,
+    int aggregate)
+{
+    size_t field_count = map->original_value_size / sizeof(uint64_t);
+    size_t cpu_stride = EBPF_PAD_8((size_t)map->original_value_size);
+    size_t cpu_count = map->ebpf_map_definition.value_size / cpu_stride;
+
+    for (size_t field = 0; field < field_count; field++) {
+        const uint64_t* field_value = (const uint64_t*)per_cpu_values + field;
+        uint64_t result = *field_value;
+        for (size_t cpu = 1; cpu < cpu_count; cpu++) {
+            field_value = (const uint64_t*)((const uint8_t*)field_value + cpu_stride);
+            uint64_t cpu_value = *field_value;
+            switch (aggregate) {
+            case EBPF_MAP_FLAG_PERCPU_SUM:
+                result += cpu_value;
+                break;
+            case EBPF_MAP_FLAG_PERCPU_MIN:
+                result = min(result, cpu_value);
+                break;
+            default:
+                result = max(result, cpu_value);
+                break;
+            }
+        }
+        // The output buffer is only byte aligned.
+        memcpy(value + field * sizeof(uint64_t), &result, sizeof(result));
+    }
+}
+
+/**
+ * @brief Record that map entries may have changed, if the operation that changed them succeeded.
+ *
+ * @param[in, out] map Map whose entries were changed.
+ * @param[in] result Result of the operation.
+ * @return The result of the operation.
+ */
+static inline ebpf_result_t
+_ebpf_map_entries_changed(_Inout_ ebpf_map_t* map, ebpf_result_t result)
+{
+    if (result == EBPF_SUCCESS) {
+        // The increment follows the update, so a reader that sees the old generation has not missed the update. The
+        // counter is on the map itself, so updates to different maps do not contend for it.
+        ebpf_interlocked_increment_int64(&map->update_generation);
+    }
+    return result;
+}
+
+/**
+ * @brief Check that the caller can change the entries of a map. Once a map is frozen, only programs can.
+ */
+static inline ebpf_result_t
+_ebpf_map_check_writable(_In_ const ebpf_core_map_t* map, int flags)
+{
+    if (!(flags & EBPF_MAP_FLAG_HELPER) && map->frozen) {
+        EBPF_LOG_MESSAGE_UINT64(
+            EBPF_TRACELOG_LEVEL_ERROR, EBPF_TRACELOG_KEYWORD_MAP, "Map is frozen", map->ebpf_map_definition.type);
+        return EBPF_ACCESS_DENIED;
+    }
+    return EBPF_SUCCESS;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_get_update_generation(_In_ const ebpf_map_t* map, _Out_ uint64_t* generation)
+{
+    // Entries of the inner maps or programs of a nested map, and values written through a writable user mapping, change
+    // without this map's generation changing.
+    if (IS_NESTED_MAP(map->ebpf_map_definition.type) ||
+        ReadNoFence((const volatile long*)&map->writable_user_mapping_count) != 0) {
+        return EBPF_OPERATION_NOT_SUPPORTED;
+    }
+    *generation = (uint64_t)ReadAcquire64((const volatile LONG64*)&map->update_generation);
+    return EBPF_SUCCESS;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_find_entry(
     _Inout_ ebpf_map_t* map,
@@ -3853,8 +4154,26 @@ ebpf_map_find_entry(
     uint8_t* return_value = NULL;
     ebpf_result_t result;
 
+    int aggregate = flags & EBPF_MAP_FLAG_PERCPU_AGGREGATE_MASK;
+    if (aggregate && ((flags & EBPF_MAP_FLAG_HELPER) || !_ebpf_map_supports_per_cpu_aggregation(map))) {
+        EBPF_LOG_MESSAGE_UINT64(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_MAP,
+            "Per-CPU aggregation not supported on map",
+            map->ebpf_map_definition.type);
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    if (flags & EBPF_MAP_FIND_FLAG_DELETE) {
+        result = _ebpf_map_check_writable(map, flags);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+    }
+
     if (MAP_IS_CUSTOM(map)) {
-        return ebpf_custom_map_find_entry(map, key_size, key, value_size, value, flags);
+        result = ebpf_custom_map_find_entry(map, key_size, key, value_size, value, flags);
+        return (flags & EBPF_MAP_FIND_FLAG_DELETE) ? _ebpf_map_entries_changed(map, result) : result;
     }
 
     if (!(flags & EBPF_MAP_FLAG_HELPER) && (key_size != map->ebpf_map_definition.key_size)) {
@@ -3867,13 +4186,15 @@ ebpf_map_find_entry(
         return EBPF_INVALID_ARGUMENT;
     }
 
-    if (!(flags & EBPF_MAP_FLAG_HELPER) && (value_size != map->ebpf_map_definition.value_size)) {
+    // An aggregated value is the size of the value of a single CPU.
+    size_t expected_value_size = aggregate ? map->original_value_size : map->ebpf_map_definition.value_size;
+    if (!(flags & EBPF_MAP_FLAG_HELPER) && (value_size != expected_value_size)) {
         EBPF_LOG_MESSAGE_UINT64_UINT64(
             EBPF_TRACELOG_LEVEL_ERROR,
             EBPF_TRACELOG_KEYWORD_MAP,
             "Incorrect map value size",
             value_size,
-            map->ebpf_map_definition.value_size);
+            expected_value_size);
         return EBPF_INVALID_ARGUMENT;
     }
 
@@ -3893,7 +4214,10 @@ ebpf_map_find_entry(
         return EBPF_INVALID_ARGUMENT;
     }
 
-    result = map->properties->find_entry(map, key, flags, &return_value);
+    result = map->properties->find_entry(map, key, flags & ~EBPF_MAP_FLAG_PERCPU_AGGREGATE_MASK, &return_value);
+    if (flags & EBPF_MAP_FIND_FLAG_DELETE) {
+        (void)_ebpf_map_entries_changed(map, result);
+    }
     if (result != EBPF_SUCCESS) {
         return result;
     }
@@ -3901,7 +4225,9 @@ ebpf_map_find_entry(
         return EBPF_OBJECT_NOT_FOUND;
     }
 
-    if (flags & EBPF_MAP_FLAG_HELPER) {
+    if (aggregate) {
+        _ebpf_map_aggregate_per_cpu_value(map, return_value, value, aggregate);
+    } else if (flags & EBPF_MAP_FLAG_HELPER) {
         if (_ebpf_adjust_value_pointer(map, &return_value) != EBPF_SUCCESS) {
             return EBPF_INVALID_ARGUMENT;
         }
@@ -3961,8 +4287,8 @@ ebpf_map_get_program_from_entry(_Inout_ ebpf_map_t* map, size_t key_size, _In_re
     return (ebpf_program_t*)_get_object_from_array_map_entry(map, key);
 }
 
-_Must_inspect_result_ ebpf_result_t
-ebpf_map_update_entry(
+static ebpf_result_t
+_ebpf_map_update_entry(
     _Inout_ ebpf_map_t* map,
     size_t key_size,
     _In_reads_(key_size) const uint8_t* key,
@@ -3971,7 +4297,6 @@ ebpf_map_update_entry(
     ebpf_map_option_t option,
     int flags)
 {
-    // High volume call - Skip entry/exit logging.
     ebpf_result_t result;
 
     if (MAP_IS_CUSTOM(map)) {
@@ -4029,6 +4354,25 @@ ebpf_map_update_entry(
     return result;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_update_entry(
+    _Inout_ ebpf_map_t* map,
+    size_t key_size,
+    _In_reads_(key_size) const uint8_t* key,
+    size_t value_size,
+    _In_reads_(value_size) const uint8_t* value,
+    ebpf_map_option_t option,
+    int flags)
+{
+    // High volume call - Skip entry/exit logging.
+    ebpf_result_t result = _ebpf_map_check_writable(map, flags);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+    return _ebpf_map_entries_changed(
+        map, _ebpf_map_update_entry(map, key_size, key, value_size, value, option, flags));
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_update_entry_with_handle(
     _Inout_ ebpf_map_t* map,
@@ -4038,6 +4382,11 @@ ebpf_map_update_entry_with_handle(
     ebpf_map_option_t option)
 {
     // High volume call - Skip entry/exit logging.
+    ebpf_result_t result = _ebpf_map_check_writable(map, 0);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
     if (key_size != map->ebpf_map_definition.key_size) {
         EBPF_LOG_MESSAGE_UINT64_UINT64(
             EBPF_TRACELOG_LEVEL_ERROR,
@@ -4056,13 +4405,13 @@ ebpf_map_update_entry_with_handle(
             map->ebpf_map_definition.type);
         return EBPF_OPERATION_NOT_SUPPORTED;
     }
-    return map->properties->update_entry_with_handle(map, key, value_handle, option);
+    return _ebpf_map_entries_changed(
+        map, map->properties->update_entry_with_handle(map, key, value_handle, option));
 }
 
-_Must_inspect_result_ ebpf_result_t
-ebpf_map_delete_entry(_In_ ebpf_map_t* map, size_t key_size, _In_reads_(key_size) const uint8_t* key, int flags)
+static ebpf_result_t
+_ebpf_map_delete_entry(_In_ ebpf_map_t* map, size_t key_size, _In_reads_(key_size) const uint8_t* key, int flags)
 {
-    // High volume call - Skip entry/exit logging.
     if (MAP_IS_CUSTOM(map)) {
         return ebpf_custom_map_delete_entry(map, key_size, key, flags);
     }
@@ -4092,6 +4441,17 @@ ebpf_map_delete_entry(_In_ ebpf_map_t* map, size_t key_size, _In_reads_(key_size
     return result;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_delete_entry(_In_ ebpf_map_t* map, size_t key_size, _In_reads_(key_size) const uint8_t* key, int flags)
+{
+    // High volume call - Skip entry/exit logging.
+    ebpf_result_t result = _ebpf_map_check_writable(map, flags);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+    return _ebpf_map_entries_changed(map, _ebpf_map_delete_entry(map, key_size, key, flags));
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_next_key(
     _Inout_ ebpf_map_t* map,
@@ -4153,7 +4513,7 @@ ebpf_map_get_info(
     info->key_size = map->ebpf_map_definition.key_size;
     info->value_size = map->original_value_size;
     info->max_entries = map->ebpf_map_definition.max_entries;
-    info->map_flags = 0;
+    info->map_flags = map->map_flags;
     if (info->type == BPF_MAP_TYPE_ARRAY_OF_MAPS || info->type == BPF_MAP_TYPE_HASH_OF_MAPS) {
         ebpf_core_object_map_t* object_map = EBPF_FROM_FIELD(ebpf_core_object_map_t, core_map, map);
         info->inner_map_id = object_map->core_map.ebpf_map_definition.inner_map_id
@@ -4186,8 +4546,14 @@ ebpf_map_push_entry(_Inout_ ebpf_map_t* map, size_t value_size, _In_reads_(value
         return EBPF_INVALID_ARGUMENT;
     }
 
+    ebpf_result_t result = _ebpf_map_check_writable(map, flags);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
     if (MAP_IS_CUSTOM(map)) {
-        return ebpf_custom_map_update_entry(map, 0, NULL, value_size, value, 0, flags);
+        return _ebpf_map_entries_changed(
+            map, ebpf_custom_map_update_entry(map, 0, NULL, value_size, value, 0, flags));
     }
 
     if (map->properties->update_entry == NULL) {
@@ -4199,7 +4565,7 @@ ebpf_map_push_entry(_Inout_ ebpf_map_t* map, size_t value_size, _In_reads_(value
         return EBPF_OPERATION_NOT_SUPPORTED;
     }
 
-    return map->properties->update_entry(map, NULL, value, flags);
+    return _ebpf_map_entries_changed(map, map->properties->update_entry(map, NULL, value, flags));
 }
 
 _Must_inspect_result_ ebpf_result_t
@@ -4210,8 +4576,14 @@ ebpf_map_pop_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Out_writes_(valu
         return EBPF_INVALID_ARGUMENT;
     }
 
+    ebpf_result_t result = _ebpf_map_check_writable(map, flags);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
     if (MAP_IS_CUSTOM(map)) {
-        return ebpf_custom_map_find_entry(map, 0, NULL, value_size, value, EBPF_MAP_FIND_FLAG_DELETE);
+        return _ebpf_map_entries_changed(
+            map, ebpf_custom_map_find_entry(map, 0, NULL, value_size, value, EBPF_MAP_FIND_FLAG_DELETE));
     }
 
     if (map->properties->find_entry == NULL) {
@@ -4223,7 +4595,8 @@ ebpf_map_pop_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Out_writes_(valu
         return EBPF_OPERATION_NOT_SUPPORTED;
     }
 
-    ebpf_result_t result = map->properties->find_entry(map, NULL, flags | EBPF_MAP_FIND_FLAG_DELETE, &return_value);
+    result = _ebpf_map_entries_changed(
+        map, map->properties->find_entry(map, NULL, flags | EBPF_MAP_FIND_FLAG_DELETE, &return_value));
     if (result != EBPF_SUCCESS) {
         return result;
     }
@@ -4284,11 +4657,20 @@ ebpf_map_get_next_key_and_value_batch(
     int flags)
 {
     ebpf_result_t result = EBPF_SUCCESS;
+    int aggregate = flags & EBPF_MAP_FLAG_PERCPU_AGGREGATE_MASK;
     size_t key_size = map->ebpf_map_definition.key_size;
-    size_t value_size = map->ebpf_map_definition.value_size;
+    // An aggregated value is the size of the value of a single CPU.
+    size_t value_size = aggregate ? map->original_value_size : map->ebpf_map_definition.value_size;
     size_t output_length = 0;
     size_t maximum_output_length = *key_and_value_length;
 
+    if (flags & EBPF_MAP_FIND_FLAG_DELETE) {
+        result = _ebpf_map_check_writable(map, flags);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+    }
+
     if ((map->properties == NULL) || (map->properties->next_key_and_value == NULL)) {
         EBPF_LOG_MESSAGE_UINT64(
             EBPF_TRACELOG_LEVEL_ERROR,
@@ -4317,6 +4699,15 @@ ebpf_map_get_next_key_and_value_batch(
         return EBPF_INVALID_ARGUMENT;
     }
 
+    if (aggregate && !_ebpf_map_supports_per_cpu_aggregation(map)) {
+        EBPF_LOG_MESSAGE_UINT64(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_MAP,
+            "Per-CPU aggregation not supported on map",
+            map->ebpf_map_definition.type);
+        return EBPF_INVALID_ARGUMENT;
+    }
+
     // Copy as many key/value pairs as we can fit in the output buffer.
     for (;;) {
         size_t record_length = 0;
@@ -4352,6 +4743,8 @@ ebpf_map_get_next_key_and_value_batch(
             // Get the ID from the object.
             ebpf_core_object_t* object = (ebpf_core_object_t*)ReadULong64NoFence((volatile const uint64_t*)next_value);
             *(uint32_t*)(key_and_value + value_offset) = object ? object->id : 0;
+        } else if (aggregate) {
+            _ebpf_map_aggregate_per_cpu_value(map, next_value, key_and_value + value_offset, aggregate);
         } else {
             memcpy(key_and_value + value_offset, next_value, value_size);
         }
@@ -4395,6 +4788,90 @@ ebpf_map_get_next_key_and_value_batch(
     return result;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_iterate_entries(
+    _In_ const ebpf_map_t* map,
+    _Inout_ ebpf_map_position_t* position,
+    int flags,
+    _Inout_ size_t* key_and_value_length,
+    _Out_writes_bytes_to_(*key_and_value_length, *key_and_value_length) uint8_t* key_and_value)
+{
+    ebpf_result_t result = EBPF_SUCCESS;
+    int aggregate = flags & EBPF_MAP_FLAG_PERCPU_AGGREGATE_MASK;
+    size_t key_size = map->ebpf_map_definition.key_size;
+    // An aggregated value is the size of the value of a single CPU.
+    size_t value_size = aggregate ? map->original_value_size : map->ebpf_map_definition.value_size;
+    size_t record_length = key_size + value_size;
+    size_t output_length = 0;
+    size_t maximum_output_length = *key_and_value_length;
+    // Entries are fetched from the hash table a few at a time, so that the pointers fit on the stack.
+    const uint8_t* keys[32];
+    const uint8_t* values[32];
+
+    *key_and_value_length = 0;
+
+    if (MAP_IS_CUSTOM(map) || map->properties->iterate == NULL) {
+        EBPF_LOG_MESSAGE_UINT64(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_MAP,
+            "ebpf_map_iterate_entries not supported on map",
+            map->ebpf_map_definition.type);
+        return EBPF_OPERATION_NOT_SUPPORTED;
+    }
+
+    if ((flags & ~EBPF_MAP_FLAG_PERCPU_AGGREGATE_MASK) != 0 ||
+        (aggregate && !_ebpf_map_supports_per_cpu_aggregation(map))) {
+        EBPF_LOG_MESSAGE_UINT64(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_MAP,
+            "Invalid flags for ebpf_map_iterate_entries",
+            flags);
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    if (maximum_output_length < record_length) {
+        return EBPF_INSUFFICIENT_BUFFER;
+    }
+
+    for (;;) {
+        size_t count = (maximum_output_length - output_length) / record_length;
+        if (count == 0) {
+            // Output buffer is full.
+            break;
+        }
+        count = min(count, EBPF_COUNT_OF(keys));
+
+        result = map->properties->iterate(map, position, &count, keys, values);
+        if (result != EBPF_SUCCESS) {
+            break;
+        }
+
+        for (size_t index = 0; index < count; index++) {
+            uint8_t* record = key_and_value + output_length;
+            memcpy(record, keys[index], key_size);
+            if (IS_NESTED_MAP(map->ebpf_map_definition.type)) {
+                // Get the ID from the object.
+                ebpf_core_object_t* object =
+                    (ebpf_core_object_t*)ReadULong64NoFence((volatile const uint64_t*)values[index]);
+                *(uint32_t*)(record + key_size) = object ? object->id : 0;
+            } else if (aggregate) {
+                _ebpf_map_aggregate_per_cpu_value(map, values[index], record + key_size, aggregate);
+            } else {
+                memcpy(record + key_size, values[index], value_size);
+            }
+            output_length += record_length;
+        }
+    }
+
+    if (result == EBPF_NO_MORE_KEYS && output_length != 0) {
+        // Returned at least one key/value pair.
+        result = EBPF_SUCCESS;
+    }
+
+    *key_and_value_length = output_length;
+    return result;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_get_value_address(_In_ const ebpf_map_t* map, _Out_ uintptr_t* value_address)
 {
@@ -4407,6 +4884,147 @@ ebpf_map_get_value_address(_In_ const ebpf_map_t* map, _Out_ uintptr_t* value_ad
     return EBPF_SUCCESS;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_map_user_memory(_Inout_ ebpf_map_t* map, bool writable, _Outptr_ void** address, _Out_ size_t* size)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    ebpf_mmap_array_map_user_mapping_t* mapping = NULL;
+    *address = NULL;
+    *size = 0;
+
+    if (MAP_IS_CUSTOM(map) || !(map->map_flags & BPF_F_MMAPABLE)) {
+        EBPF_RETURN_RESULT(EBPF_OPERATION_NOT_SUPPORTED);
+    }
+    ebpf_assert(map->ebpf_map_definition.type == BPF_MAP_TYPE_ARRAY);
+    ebpf_core_mmap_array_map_t* array_map = EBPF_FROM_FIELD(ebpf_core_mmap_array_map_t, core_map, map);
+
+    if (writable && map->frozen) {
+        EBPF_RETURN_RESULT(EBPF_ACCESS_DENIED);
+    }
+
+    mapping = (ebpf_mmap_array_map_user_mapping_t*)ebpf_allocate_with_tag(
+        sizeof(ebpf_mmap_array_map_user_mapping_t), EBPF_POOL_TAG_MAP);
+    if (mapping == NULL) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    // Allocated up front so that removing the mapping from another process cannot fail.
+    mapping->process_state = ebpf_allocate_process_state();
+    if (mapping->process_state == NULL) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    result = ebpf_memory_descriptor_map_user(array_map->memory, writable, &mapping->address);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    // The mapping keeps the process referenced until it is removed, either by the process or when the last user
+    // handle to the map is closed, so that the process id cannot be reused and the mapping can still be found. It
+    // does not reference the map, as the caller holds a handle for as long as the mapping exists.
+    mapping->process = ebpf_platform_reference_process();
+    mapping->process_id = ebpf_platform_process_id();
+    mapping->writable = writable;
+
+    // The map may have been frozen while its pages were being mapped. Freezing checks for writable mappings under
+    // the same lock, so one of the two always fails.
+    ebpf_lock_state_t state = ebpf_lock_lock(&array_map->user_mapping_lock);
+    if (writable && map->frozen) {
+        result = EBPF_ACCESS_DENIED;
+    } else {
+        if (writable) {
+            ebpf_interlocked_increment_int32(&map->writable_user_mapping_count);
+        }
+        ebpf_list_insert_tail(&array_map->user_mappings, &mapping->entry);
+    }
+    ebpf_lock_unlock(&array_map->user_mapping_lock, state);
+
+    if (result != EBPF_SUCCESS) {
+        // Not counted in writable_user_mapping_count, so removing it leaves the count unchanged.
+        mapping->writable = false;
+        _ebpf_mmap_array_map_remove_user_mapping(array_map, mapping);
+        mapping = NULL;
+        goto Done;
+    }
+
+    *address = mapping->address;
+    *size = array_map->memory_size;
+    mapping = NULL;
+
+Done:
+    if (mapping != NULL) {
+        ebpf_free(mapping->process_state);
+        ebpf_free(mapping);
+    }
+    EBPF_RETURN_RESULT(result);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_unmap_user_memory(_Inout_ ebpf_map_t* map, _In_ const void* address)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_mmap_array_map_user_mapping_t* mapping = NULL;
+
+    if (MAP_IS_CUSTOM(map) || !(map->map_flags & BPF_F_MMAPABLE)) {
+        EBPF_RETURN_RESULT(EBPF_OPERATION_NOT_SUPPORTED);
+    }
+    ebpf_core_mmap_array_map_t* array_map = EBPF_FROM_FIELD(ebpf_core_mmap_array_map_t, core_map, map);
+
+    // Only the process that created a mapping can remove it, and only at the address it was given.
+    uint32_t process_id = ebpf_platform_process_id();
+    ebpf_lock_state_t state = ebpf_lock_lock(&array_map->user_mapping_lock);
+    for (ebpf_list_entry_t* entry = array_map->user_mappings.Flink; entry != &array_map->user_mappings;
+         entry = entry->Flink) {
+        ebpf_mmap_array_map_user_mapping_t* candidate =
+            EBPF_FROM_FIELD(ebpf_mmap_array_map_user_mapping_t, entry, entry);
+        if (candidate->process_id == process_id && candidate->address == address) {
+            ebpf_list_remove_entry(entry);
+            mapping = candidate;
+            break;
+        }
+    }
+    ebpf_lock_unlock(&array_map->user_mapping_lock, state);
+
+    if (mapping == NULL) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    // Removed outside the lock, as a mapping can only be removed at PASSIVE_LEVEL.
+    _ebpf_mmap_array_map_remove_user_mapping(array_map, mapping);
+
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_freeze(_Inout_ ebpf_map_t* map)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result = EBPF_SUCCESS;
+
+    if (MAP_IS_CUSTOM(map)) {
+        EBPF_RETURN_RESULT(EBPF_OPERATION_NOT_SUPPORTED);
+    }
+
+    if (map->map_flags & BPF_F_MMAPABLE) {
+        // A writable mapping would still let user mode change the values.
+        ebpf_core_mmap_array_map_t* array_map = EBPF_FROM_FIELD(ebpf_core_mmap_array_map_t, core_map, map);
+        ebpf_lock_state_t state = ebpf_lock_lock(&array_map->user_mapping_lock);
+        if (ReadNoFence((const volatile long*)&map->writable_user_mapping_count) != 0) {
+            result = EBPF_INVALID_ARGUMENT;
+        } else {
+            map->frozen = true;
+        }
+        ebpf_lock_unlock(&array_map->user_mapping_lock, state);
+    } else {
+        map->frozen = true;
+    }
+
+    EBPF_RETURN_RESULT(result);
+}
+
 #pragma region Custom Maps
 
 static ebpf_result_t
@@ -15,9 +15,22 @@ extern "C"
 
 #define EBPF_MAP_FLAG_HELPER 0x01      /* Called by an eBPF program. */
 #define EBPF_MAP_FIND_FLAG_DELETE 0x02 /* Perform a find and delete. */
+#define EBPF_MAP_FLAG_PERCPU_SUM 0x04  /* Copy out the sum of the per-CPU values. */
+#define EBPF_MAP_FLAG_PERCPU_MIN 0x08  /* Copy out the minimum of the per-CPU values. */
+#define EBPF_MAP_FLAG_PERCPU_MAX 0x0c  /* Copy out the maximum of the per-CPU values. */
+#define EBPF_MAP_FLAG_PERCPU_AGGREGATE_MASK 0x0c
 
     typedef struct _ebpf_core_map ebpf_map_t;
 
+    /**
+     * @brief Position of an iteration over the entries of a map. See ebpf_map_iterate_entries.
+     */
+    typedef struct _ebpf_map_position
+    {
+        size_t bucket; ///< Index of the bucket that holds the next entry.
+        size_t slot;   ///< Index of the next entry in its bucket.
+    } ebpf_map_position_t;
+
     /**
      * @brief Initialize map subsystem global state.
      *
@@ -50,6 +63,27 @@ extern "C"
         ebpf_handle_t inner_map_handle,
         _Outptr_ ebpf_map_t** map);
 
+    /**
+     * @brief Allocate a new map with creation flags.
+     *
+     * @param[in] map_name Name of the map.
+     * @param[in] ebpf_map_definition Definition of the new map.
+     * @param[in] map_flags Zero or BPF_F_MMAPABLE, which is only valid for array maps.
+     * @param[in] inner_map_handle Handle to inner map, or ebpf_handle_invalid if none.
+     * @param[out] map Pointer to memory that will contain the map on success.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The map flags are not valid for this map type.
+     * @retval EBPF_NO_MEMORY Unable to allocate resources for this
+     *  map.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_create_with_flags(
+        _In_ const cxplat_utf8_string_t* map_name,
+        _In_ const ebpf_map_definition_in_memory_t* ebpf_map_definition,
+        uint32_t map_flags,
+        ebpf_handle_t inner_map_handle,
+        _Outptr_ ebpf_map_t** map);
+
     /**
      * @brief Get a pointer to the map definition.
      *
@@ -98,6 +132,7 @@ extern "C"
      * @param[in] flags EBPF_MAP_FLAG_HELPER if called from helper function.
      * @retval EBPF_SUCCESS The operation was successful.
      * @retval EBPF_NO_MEMORY Unable to allocate resources for this entry.
+     * @retval EBPF_ACCESS_DENIED The map is frozen and the call is not from a helper function.
      */
     EBPF_INLINE_HINT
     _Must_inspect_result_ ebpf_result_t
@@ -120,6 +155,7 @@ extern "C"
      * @retval EBPF_SUCCESS The operation was successful.
      * @retval EBPF_NO_MEMORY Unable to allocate resources for this
      *  entry.
+     * @retval EBPF_ACCESS_DENIED The map is frozen.
      */
     _Must_inspect_result_ ebpf_result_t
     ebpf_map_update_entry_with_handle(
@@ -137,6 +173,7 @@ extern "C"
      * @retval EBPF_SUCCESS The operation was successful.
      * @retval EBPF_INVALID_ARGUMENT One or more parameters are
      *  invalid.
+     * @retval EBPF_ACCESS_DENIED The map is frozen and the call is not from a helper function.
      */
     EBPF_INLINE_HINT
     _Must_inspect_result_ ebpf_result_t
@@ -424,7 +461,8 @@ extern "C"
      * @param[in,out] key_and_value_length Length of the key and value buffer on input. On output, the number of bytes
      * actually written.
      * @param[out] key_and_value Buffer to write the keys and values into.
-     * @param[in] flags Flags to control the behavior of the function.
+     * @param[in] flags EBPF_MAP_FIND_FLAG_DELETE to delete the entries that are returned. One of the
+     *  EBPF_MAP_FLAG_PERCPU_* flags to return a single aggregated value per key from a per-CPU map.
      * @retval EBPF_SUCCESS The operation was successful.
      * @retval EBPF_KEY_NOT_FOUND The specified previous key was not found.
      * @retval EBPF_NO_MORE_KEYS There is no key following the specified key.
@@ -438,6 +476,33 @@ extern "C"
         _Out_writes_bytes_to_(*key_and_value_length, *key_and_value_length) uint8_t* key_and_value,
         int flags);
 
+    /**
+     * @brief Copy keys and values from the map to the caller provided buffer, starting at a position in the map.
+     * Unlike ebpf_map_get_next_key_and_value_batch, resuming from a position does not look up the previous key, so
+     * iterating over the whole map takes linear time and is not restarted by concurrent deletes. Only supported on
+     * maps that are stored in a hash table.
+     *
+     * @param[in] map Map to iterate.
+     * @param[in, out] position Position to start at, zero to start from the beginning. Updated on return.
+     * @param[in] flags Zero or one of the EBPF_MAP_FLAG_PERCPU_* flags to return a single aggregated value per key
+     * from a per-CPU map.
+     * @param[in,out] key_and_value_length Length of the key and value buffer on input. On output, the number of bytes
+     * actually written, which is a multiple of the length of a key and value.
+     * @param[out] key_and_value Buffer to write the keys and values into.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MORE_KEYS There are no more entries after the position.
+     * @retval EBPF_INSUFFICIENT_BUFFER The buffer cannot hold a single key and value.
+     * @retval EBPF_INVALID_ARGUMENT The flags are not valid for this map.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map does not support iterating by position.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_iterate_entries(
+        _In_ const ebpf_map_t* map,
+        _Inout_ ebpf_map_position_t* position,
+        int flags,
+        _Inout_ size_t* key_and_value_length,
+        _Out_writes_bytes_to_(*key_and_value_length, *key_and_value_length) uint8_t* key_and_value);
+
     /**
      * @brief Get the address of the first value in the map if it is an array or
      * return EBPF_INVALID_ARGUMENT if it is not an array map.
@@ -450,6 +515,61 @@ extern "C"
     _Must_inspect_result_ ebpf_result_t
     ebpf_map_get_value_address(_In_ const ebpf_map_t* map, _Out_ uintptr_t* value_address);
 
+    /**
+     * @brief Get the update generation of a map. The generation changes after an entry of the map is updated or
+     * deleted through the functions in this file.
+     *
+     * @param[in] map Map to query.
+     * @param[out] generation The current update generation of the map.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map is a map of maps or a program array, or is mapped writable into
+     *  user mode, so its contents can change without its generation changing.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_get_update_generation(_In_ const ebpf_map_t* map, _Out_ uint64_t* generation);
+
+    /**
+     * @brief Map the values of an array map created with BPF_F_MMAPABLE into the calling process. A map can be mapped
+     * any number of times, by any number of processes. Each mapping is removed with ebpf_map_unmap_user_memory, or
+     * when the last user handle to the map is closed.
+     *
+     * @param[in, out] map Map to map.
+     * @param[in] writable Whether the process can write to the values. Frozen maps can only be mapped read-only.
+     * @param[out] address Address of the first value in the calling process.
+     * @param[out] size Size of the mapping, which is the size of the values rounded up to a whole page.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map was not created with BPF_F_MMAPABLE.
+     * @retval EBPF_ACCESS_DENIED A writable mapping was requested for a frozen map.
+     * @retval EBPF_INVALID_ARGUMENT The map could not be mapped.
+     * @retval EBPF_NO_MEMORY Unable to allocate resources for this operation.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_map_user_memory(_Inout_ ebpf_map_t* map, bool writable, _Outptr_ void** address, _Out_ size_t* size);
+
+    /**
+     * @brief Remove the mapping created by ebpf_map_map_user_memory. Must be called by the process that created it.
+     *
+     * @param[in, out] map Map to unmap.
+     * @param[in] address Address returned by ebpf_map_map_user_memory.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map was not created with BPF_F_MMAPABLE.
+     * @retval EBPF_INVALID_ARGUMENT The map is not mapped at this address in the calling process.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_unmap_user_memory(_Inout_ ebpf_map_t* map, _In_ const void* address);
+
+    /**
+     * @brief Freeze a map. User mode can then no longer update or delete its entries, or map its values writable.
+     * Programs can still change the entries. A map cannot be unfrozen.
+     *
+     * @param[in, out] map Map to freeze.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map is a custom map.
+     * @retval EBPF_INVALID_ARGUMENT The values of the map are mapped writable into user mode.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_freeze(_Inout_ ebpf_map_t* map);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1583,6 +1583,44 @@ _ebpf_native_initialize_global_variables(
     EBPF_RETURN_RESULT(result);
 }
 
+static bool
+_ebpf_native_is_global_variable_map(_In_ const ebpf_native_module_instance_t* instance, _In_ const char* name)
+{
+    global_variable_section_info_t* global_variables = NULL;
+    size_t global_variable_count = 0;
+
+    instance->module->table.global_variable_sections(&global_variables, &global_variable_count);
+    if (global_variable_count == 0) {
+        return false;
+    }
+
+    // Use "total_size" to calculate the actual size of the global_variable_section_info_t struct.
+    size_t global_variable_section_info_size = global_variables[0].header.total_size;
+    for (size_t i = 0; i < global_variable_count; i++) {
+        const global_variable_section_info_t* global_variable_section_info =
+            (const global_variable_section_info_t*)ARRAY_ELEMENT_INDEX(
+                global_variables, i, global_variable_section_info_size);
+        if (strcmp(global_variable_section_info->name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static ebpf_result_t
+_ebpf_native_freeze_map(ebpf_handle_t map_handle)
+{
+    ebpf_core_object_t* object;
+    ebpf_result_t result = EBPF_OBJECT_REFERENCE_BY_HANDLE(map_handle, EBPF_OBJECT_MAP, &object);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
+    result = ebpf_map_freeze((ebpf_map_t*)object);
+    EBPF_OBJECT_RELEASE_REFERENCE(object);
+    return result;
+}
+
 static ebpf_result_t
 _ebpf_native_create_maps(_Inout_ ebpf_native_module_instance_t* instance)
 {
@@ -1655,7 +1693,12 @@ _ebpf_native_create_maps(_Inout_ ebpf_native_module_instance_t* instance)
         map_definition.value_size = native_map->entry.definition.value_size;
         map_definition.max_entries = native_map->entry.definition.max_entries;
 
-        result = ebpf_core_create_map(&map_name, &map_definition, inner_map_handle, &native_map->handle);
+        // Global variables can be mapped into user mode, as libbpf does for them.
+        bool global_variable_map = map_definition.type == BPF_MAP_TYPE_ARRAY &&
+                                   _ebpf_native_is_global_variable_map(instance, native_map->entry.name);
+        uint32_t map_flags = global_variable_map ? BPF_F_MMAPABLE : 0;
+
+        result = ebpf_core_create_map(&map_name, &map_definition, map_flags, inner_map_handle, &native_map->handle);
         if (result != EBPF_SUCCESS) {
             break;
         }
@@ -1663,6 +1706,16 @@ _ebpf_native_create_maps(_Inout_ ebpf_native_module_instance_t* instance)
         ebpf_free(map_name.value);
         map_name.value = NULL;
 
+        // Constants are read-only for user mode. Their initial values are copied in when each program loads.
+        size_t name_length = strlen(native_map->entry.name);
+        if (global_variable_map && name_length >= sizeof(".rodata") - 1 &&
+            strcmp(native_map->entry.name + name_length - (sizeof(".rodata") - 1), ".rodata") == 0) {
+            result = _ebpf_native_freeze_map(native_map->handle);
+            if (result != EBPF_SUCCESS) {
+                break;
+            }
+        }
+
         // If pin_path is set and the map is not yet pinned, pin it now.
         if (native_map->pin_path.value != NULL && !native_map->pinned) {
             result = ebpf_core_update_pinning(native_map->handle, &native_map->pin_path);
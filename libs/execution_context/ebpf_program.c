@@ -10,6 +10,7 @@
 #include "ebpf_error.h"
 #include "ebpf_extension_uuids.h"
 #include "ebpf_handle.h"
+#include "ebpf_interpreter.h"
 #include "ebpf_link.h"
 #include "ebpf_native.h"
 #include "ebpf_object.h"
@@ -33,6 +34,11 @@ static const GUID GUID_NULL = {0, 0, 0, {0, 0, 0, 0, 0, 0, 0, 0}};
 // Global flag to disable invoking programs. This is used when fuzzing the IOCTL interface.
 bool ebpf_program_disable_invoke = false;
 
+// Execute interpreted programs with the pre-decoded interpreter rather than ubpf, when the program only uses
+// instructions the pre-decoded interpreter supports. Set from the driver configuration at initialization and sampled
+// when each program is loaded.
+static bool _ebpf_program_use_predecoded_interpreter = false;
+
 typedef struct _ebpf_context_header
 {
     EBPF_CONTEXT_HEADER;
@@ -66,6 +72,11 @@ typedef struct _ebpf_program
         } native;
     } code_or_vm;
 
+#if !defined(CONFIG_BPF_INTERPRETER_DISABLED)
+    // Pre-decoded form of an EBPF_CODE_EBPF program, or NULL if the program is executed by ubpf.
+    ebpf_interpreter_program_t* predecoded_program;
+#endif
+
     // NMR client handles for program information providers.
     NPI_CLIENT_CHARACTERISTICS general_program_information_client_characteristics;
     HANDLE general_program_information_nmr_handle;
@@ -1309,6 +1320,7 @@ _IRQL_requires_max_(PASSIVE_LEVEL) static void _ebpf_program_free(_In_opt_ _Post
         if (program->code_or_vm.vm) {
             ubpf_destroy(program->code_or_vm.vm);
         }
+        ebpf_interpreter_program_free(program->predecoded_program);
         break;
 #endif
     case EBPF_CODE_NATIVE:
@@ -1330,7 +1342,7 @@ _IRQL_requires_max_(PASSIVE_LEVEL) static void _ebpf_program_free(_In_opt_ _Post
     ebpf_free((void*)program->parameters.program_info_hash);
     ebpf_free(program->parameters.program_info_hash_type.value);
 
-    ebpf_free(program->maps);
+    ebpf_epoch_free(program->maps);
 
     ebpf_free_trampoline_table(program->trampoline_table);
 
@@ -1589,21 +1601,23 @@ ebpf_program_associate_additional_map(ebpf_program_t* program, ebpf_map_t* map)
     if (result != EBPF_SUCCESS) {
         goto Done;
     }
-    if (program->maps) {
-        program_maps = ebpf_reallocate(
-            program->maps, CXPLAT_POOL_FLAG_NON_PAGED, old_map_size, new_map_size, EBPF_POOL_TAG_PROGRAM);
-    } else {
-        program_maps = ebpf_allocate_with_tag(new_map_size, EBPF_POOL_TAG_PROGRAM);
-    }
+    // The maps are read without the lock by ebpf_program_get_map_update_generation, so the array is replaced rather
+    // than reallocated, and the old one is freed once no reader can be using it.
+    program_maps = ebpf_epoch_allocate_with_tag(new_map_size, EBPF_POOL_TAG_PROGRAM);
     if (program_maps == NULL) {
         result = EBPF_NO_MEMORY;
         goto Done;
     }
+    if (program->maps) {
+        memcpy(program_maps, program->maps, old_map_size);
+        ebpf_epoch_free(program->maps);
+    }
 
     EBPF_OBJECT_ACQUIRE_REFERENCE((ebpf_core_object_t*)map);
     program_maps[map_count - 1] = map;
-    program->maps = program_maps;
-    program->count_of_maps = map_count;
+    // Publish the array before the count, so that a reader never sees more maps than the array it reads holds.
+    WritePointerRelease((void* volatile*)&program->maps, program_maps);
+    WriteRelease((volatile long*)&program->count_of_maps, (long)map_count);
 
 Done:
     ebpf_lock_unlock(&program->lock, state);
@@ -1624,7 +1638,7 @@ ebpf_program_associate_maps(ebpf_program_t* program, ebpf_map_t** maps, uint32_t
     if (result != EBPF_SUCCESS) {
         goto Done;
     }
-    program_maps = ebpf_allocate_with_tag(program_maps_length, EBPF_POOL_TAG_PROGRAM);
+    program_maps = ebpf_epoch_allocate_with_tag(program_maps_length, EBPF_POOL_TAG_PROGRAM);
     if (!program_maps) {
         result = EBPF_NO_MEMORY;
         goto Done;
@@ -1652,21 +1666,43 @@ ebpf_program_associate_maps(ebpf_program_t* program, ebpf_map_t** maps, uint32_t
         goto Done;
     }
     // Now go through again and acquire references.
-    program->maps = program_maps;
-    program->count_of_maps = maps_count;
     for (index = 0; index < maps_count; index++) {
 #pragma warning(suppress : 6385) // program_maps was allocated and populated for maps_count entries above.
         EBPF_OBJECT_ACQUIRE_REFERENCE((ebpf_core_object_t*)program_maps[index]);
     }
+    WritePointerRelease((void* volatile*)&program->maps, program_maps);
+    WriteRelease((volatile long*)&program->count_of_maps, (long)maps_count);
     program_maps = NULL;
     ebpf_lock_unlock(&program->lock, state);
 
 Done:
-    ebpf_free(program_maps);
+    ebpf_epoch_free(program_maps);
 
     EBPF_RETURN_RESULT(result);
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_program_get_map_update_generation(_In_ const ebpf_program_t* program, _Out_ uint64_t* generation)
+{
+    // High volume call - Skip entry/exit logging.
+    uint32_t count_of_maps = (uint32_t)ReadAcquire((const volatile long*)&program->count_of_maps);
+    ebpf_map_t* const* maps = (ebpf_map_t* const*)ReadPointerAcquire((void* const volatile*)&program->maps);
+    uint64_t sum = 0;
+
+    // Each map generation only ever increases, so the sum changes if and only if one of them changes.
+    for (uint32_t index = 0; index < count_of_maps; index++) {
+        uint64_t map_generation;
+        ebpf_result_t result = ebpf_map_get_update_generation(maps[index], &map_generation);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+        sum += map_generation;
+    }
+
+    *generation = sum;
+    return EBPF_SUCCESS;
+}
+
 _Requires_lock_held_(program->lock) static ebpf_result_t _ebpf_program_load_machine_code(
     _Inout_ ebpf_program_t* program,
     _In_opt_ const ebpf_core_code_context_t* code_context,
@@ -1807,6 +1843,13 @@ _ebpf_program_update_interpret_helpers(
             result = EBPF_INVALID_ARGUMENT;
             goto Exit;
         }
+        if (program->predecoded_program != NULL) {
+            result = ebpf_interpreter_program_set_helper(
+                program->predecoded_program, (uint32_t)index, (uint64_t)address_info.address);
+            if (result != EBPF_SUCCESS) {
+                goto Exit;
+            }
+        }
 #endif
     }
 
@@ -2028,6 +2071,19 @@ _Requires_lock_held_(program->lock) static ebpf_result_t _ebpf_program_load_byte
 
     ubpf_set_error_print(program->code_or_vm.vm, ebpf_log_function);
 
+    if (_ebpf_program_use_predecoded_interpreter) {
+        return_value = ebpf_interpreter_program_create(
+            instructions, instruction_count, program->helper_function_count, &program->predecoded_program);
+        if (return_value == EBPF_OPERATION_NOT_SUPPORTED) {
+            EBPF_LOG_MESSAGE(
+                EBPF_TRACELOG_LEVEL_VERBOSE,
+                EBPF_TRACELOG_KEYWORD_PROGRAM,
+                "Program uses instructions the pre-decoded interpreter does not support, using ubpf");
+        } else if (return_value != EBPF_SUCCESS) {
+            goto Done;
+        }
+    }
+
     program->helper_function_addresses_changed_callback = _ebpf_program_update_interpret_helpers;
     program->helper_function_addresses_changed_context = program;
 
@@ -2058,6 +2114,8 @@ Done:
             ubpf_destroy(program->code_or_vm.vm);
         }
         program->code_or_vm.vm = NULL;
+        ebpf_interpreter_program_free(program->predecoded_program);
+        program->predecoded_program = NULL;
     }
 
     EBPF_RETURN_RESULT(return_value);
@@ -2240,7 +2298,12 @@ ebpf_program_invoke(
         } else {
 #if !defined(CONFIG_BPF_INTERPRETER_DISABLED)
             uint64_t out_value;
-            int ret = (uint32_t)(ubpf_exec(current_program->code_or_vm.vm, context, 1024, &out_value));
+            int ret;
+            if (current_program->predecoded_program != NULL) {
+                ret = ebpf_interpreter_program_execute(current_program->predecoded_program, context, &out_value);
+            } else {
+                ret = (uint32_t)(ubpf_exec(current_program->code_or_vm.vm, context, 1024, &out_value));
+            }
             if (ret < 0) {
                 *result = ret;
             } else {
@@ -3379,24 +3442,108 @@ Exit:
     EBPF_RETURN_RESULT(result);
 }
 
+typedef struct _ebpf_program_test_run_context ebpf_program_test_run_context_t;
+
+// State for the part of a test run that executes on a single CPU.
+typedef struct _ebpf_program_test_run_worker
+{
+    ebpf_program_test_run_context_t* context;
+    cxplat_preemptible_work_item_t* work_item;
+    uint32_t cpu;
+    bool reached_start;
+    const uint8_t* data_in;
+    uint8_t* data_out;
+    size_t data_size_out;
+    uint8_t* context_out;
+    size_t context_size_out;
+    ebpf_result_t result;
+    uint64_t return_value;
+    uint64_t run_count;
+    uint64_t duration;
+} ebpf_program_test_run_worker_t;
+
 typedef struct _ebpf_program_test_run_context
 {
     const ebpf_program_t* program;
     const ebpf_program_data_t* program_data;
     ebpf_program_test_run_options_t* options;
     uint8_t required_irql;
-    bool canceled;
+    volatile bool canceled;
     void* async_context;
     void* completion_context;
     ebpf_program_test_run_complete_callback_t completion_callback;
+    // Number of workers that have not yet reached the start barrier.
+    volatile int32_t workers_pending_start;
+    // Number of workers that have not yet finished. The last one to finish completes the test run.
+    volatile int32_t workers_running;
+    uint32_t worker_count;
+    ebpf_program_test_run_worker_t workers[1];
 } ebpf_program_test_run_context_t;
 
+/**
+ * @brief Check in a worker at the start barrier, so that all CPUs start invoking the program at the same time.
+ *
+ * @param[in, out] worker Worker reaching the barrier.
+ * @retval true Every worker has reached the barrier, or the test run was canceled.
+ * @retval false Other workers have not reached the barrier yet.
+ */
+static bool
+_ebpf_program_test_run_reach_start(_Inout_ ebpf_program_test_run_worker_t* worker)
+{
+    ebpf_program_test_run_context_t* context = worker->context;
+
+    if (!worker->reached_start) {
+        worker->reached_start = true;
+        ebpf_interlocked_decrement_int32(&context->workers_pending_start);
+    }
+
+    return ReadNoFence((volatile const long*)&context->workers_pending_start) == 0 || context->canceled;
+}
+
+static void
+_ebpf_program_test_run_complete(_In_ _Post_invalid_ ebpf_program_test_run_context_t* context)
+{
+    ebpf_program_test_run_options_t* options = context->options;
+    const ebpf_program_test_run_worker_t* primary_worker = &context->workers[0];
+    ebpf_result_t result = EBPF_SUCCESS;
+    uint64_t total_duration = 0;
+    uint64_t total_run_count = 0;
+
+    for (uint32_t i = 0; i < context->worker_count; i++) {
+        const ebpf_program_test_run_worker_t* worker = &context->workers[i];
+        if (result == EBPF_SUCCESS) {
+            result = worker->result;
+        }
+        total_duration += worker->duration;
+        total_run_count += worker->run_count;
+
+        if (options->cpu_results != NULL) {
+            options->cpu_results[i].cpu = worker->cpu;
+            options->cpu_results[i].return_value = worker->return_value;
+            options->cpu_results[i].run_count = worker->run_count;
+            options->cpu_results[i].duration = worker->duration;
+        }
+    }
+
+    // The primary worker runs on the caller's buffers, so its output is the output of the test run.
+    options->return_value = primary_worker->return_value;
+    options->data_size_out = primary_worker->data_size_out;
+    options->context_size_out = primary_worker->context_size_out;
+    options->duration = total_run_count ? total_duration / total_run_count : 0;
+
+    context->completion_callback(
+        result, context->program, context->options, context->completion_context, context->async_context);
+    ebpf_program_dereference_providers((ebpf_program_t*)context->program);
+    ebpf_free(context);
+}
+
 static void
 _ebpf_program_test_run_work_item(_In_ cxplat_preemptible_work_item_t* work_item, _In_opt_ void* work_item_context)
 {
     _Analysis_assume_(work_item_context != NULL);
 
-    ebpf_program_test_run_context_t* context = (ebpf_program_test_run_context_t*)work_item_context;
+    ebpf_program_test_run_worker_t* worker = (ebpf_program_test_run_worker_t*)work_item_context;
+    ebpf_program_test_run_context_t* context = worker->context;
     ebpf_program_test_run_options_t* options = context->options;
     uint64_t end_time;
     // Elapsed time is computed while the program is executing, excluding time spent when yielding the CPU.
@@ -3413,13 +3560,25 @@ _ebpf_program_test_run_work_item(_In_ cxplat_preemptible_work_item_t* work_item,
     bool thread_affinity_set = false;
     bool state_stored = false;
     void* program_context = NULL;
+    size_t i = 0;
+
+    // Work items run on system worker threads, which must not be held while waiting for workers that have not been
+    // scheduled yet. A worker that reaches the barrier early queues its work item again and returns its thread.
+    if (!_ebpf_program_test_run_reach_start(worker)) {
+        cxplat_queue_preemptible_work_item(work_item);
+        return;
+    }
+
+    if (context->canceled) {
+        result = EBPF_CANCELED;
+        goto Done;
+    }
 
-    result = ebpf_set_current_thread_cpu_affinity(options->cpu, &old_thread_affinity);
+    result = ebpf_set_current_thread_cpu_affinity(worker->cpu, &old_thread_affinity);
     if (result != EBPF_SUCCESS) {
         goto Done;
     }
     thread_affinity_set = true;
-
     ebpf_epoch_synchronize();
 
     old_irql = ebpf_raise_irql(context->required_irql);
@@ -3427,7 +3586,7 @@ _ebpf_program_test_run_work_item(_In_ cxplat_preemptible_work_item_t* work_item,
 
     // Convert the input buffer to a program type specific context structure.
     result = context->program_data->context_create(
-        options->data_in, options->data_size_in, options->context_in, options->context_size_in, &program_context);
+        worker->data_in, options->data_size_in, options->context_in, options->context_size_in, &program_context);
     if (result != EBPF_SUCCESS) {
         result = EBPF_INVALID_ARGUMENT;
         goto Done;
@@ -3448,7 +3607,7 @@ _ebpf_program_test_run_work_item(_In_ cxplat_preemptible_work_item_t* work_item,
     // This is because the modulus operation is expensive and we want to minimize the overhead of
     // the test run.
     size_t batch_counter = batch_size;
-    for (size_t i = 0; i < options->repeat_count; i++) {
+    for (i = 0; i < options->repeat_count; i++) {
         batch_counter--;
         // Start a new epoch every batch_size iterations.
         if (!batch_counter) {
@@ -3481,9 +3640,9 @@ _ebpf_program_test_run_work_item(_In_ cxplat_preemptible_work_item_t* work_item,
 
     cumulative_time += end_time - start_time;
 
-    options->duration = cumulative_time * EBPF_NS_PER_FILETIME;
-    options->duration /= options->repeat_count;
-    options->return_value = return_value;
+    worker->duration = cumulative_time * EBPF_NS_PER_FILETIME;
+    worker->run_count = i;
+    worker->return_value = return_value;
 
 Done:
     if (state_stored) {
@@ -3496,11 +3655,7 @@ Done:
 
     if (context->program_data && context->program_data->context_destroy != NULL && program_context != NULL) {
         context->program_data->context_destroy(
-            program_context,
-            options->data_out,
-            &options->data_size_out,
-            options->context_out,
-            &options->context_size_out);
+            program_context, worker->data_out, &worker->data_size_out, worker->context_out, &worker->context_size_out);
     }
 
     if (irql_raised) {
@@ -3511,11 +3666,13 @@ Done:
         ebpf_restore_current_thread_cpu_affinity(&old_thread_affinity);
     }
 
-    context->completion_callback(
-        result, context->program, context->options, context->completion_context, context->async_context);
-    ebpf_program_dereference_providers((ebpf_program_t*)context->program);
+    worker->result = result;
+
+    // The last worker to finish reports the results of the test run and frees the test run context.
+    if (ebpf_interlocked_decrement_int32(&context->workers_running) == 0) {
+        _ebpf_program_test_run_complete(context);
+    }
     cxplat_free_preemptible_work_item(work_item);
-    ebpf_free(work_item_context);
 }
 
 static void
@@ -3523,6 +3680,7 @@ _ebpf_program_test_run_cancel(_Inout_opt_ void* context)
 {
     _Analysis_assume_(context != NULL);
     ebpf_program_test_run_context_t* test_run_context = (ebpf_program_test_run_context_t*)context;
+    // Workers that are waiting at the start barrier see this the next time their work item runs.
     test_run_context->canceled = true;
 }
 
@@ -3538,9 +3696,12 @@ ebpf_program_execute_test_run(
 
     ebpf_result_t return_value = EBPF_SUCCESS;
     ebpf_program_test_run_context_t* test_run_context = NULL;
-    cxplat_preemptible_work_item_t* work_item = NULL;
     const ebpf_program_data_t* program_data = NULL;
     bool provider_data_referenced = false;
+    uint32_t worker_count = 0;
+    size_t worker_buffer_size;
+    size_t test_run_context_size;
+    uint8_t* worker_buffer;
 
     // Prevent the provider from detaching while the program is running.
     if (ebpf_program_reference_providers((ebpf_program_t*)program) != EBPF_SUCCESS) {
@@ -3571,8 +3732,51 @@ ebpf_program_execute_test_run(
         goto Exit;
     }
 
-    test_run_context = (ebpf_program_test_run_context_t*)ebpf_allocate_with_tag(
-        sizeof(ebpf_program_test_run_context_t), EBPF_POOL_TAG_PROGRAM);
+    if (options->cpu_count == 0) {
+        worker_count = 1;
+    } else {
+        // CPU indices span all processor groups, and ebpf_set_current_thread_cpu_affinity maps them to a group and a
+        // processor number within it.
+        uint32_t cpu_count = ebpf_get_cpu_count();
+        for (uint32_t i = 0; i < options->cpu_count; i++) {
+            if (options->cpus[i] >= cpu_count || (i > 0 && options->cpus[i] <= options->cpus[i - 1])) {
+                EBPF_LOG_MESSAGE_UINT64(
+                    EBPF_TRACELOG_LEVEL_ERROR,
+                    EBPF_TRACELOG_KEYWORD_PROGRAM,
+                    "Test run CPU does not exist or is out of order",
+                    options->cpus[i]);
+                return_value = EBPF_INVALID_ARGUMENT;
+                goto Exit;
+            }
+        }
+        worker_count = options->cpu_count;
+    }
+
+    // Every worker other than the primary one gets a private copy of the input data and its own output buffers,
+    // so that concurrent invocations do not race on the packet contents.
+    return_value = ebpf_safe_size_t_add(options->data_size_in, options->data_size_out, &worker_buffer_size);
+    if (return_value != EBPF_SUCCESS) {
+        goto Exit;
+    }
+    return_value = ebpf_safe_size_t_add(worker_buffer_size, options->context_size_out, &worker_buffer_size);
+    if (return_value != EBPF_SUCCESS) {
+        goto Exit;
+    }
+    return_value = ebpf_safe_size_t_multiply(worker_buffer_size, worker_count - 1, &test_run_context_size);
+    if (return_value != EBPF_SUCCESS) {
+        goto Exit;
+    }
+    return_value = ebpf_safe_size_t_add(
+        test_run_context_size,
+        EBPF_OFFSET_OF(ebpf_program_test_run_context_t, workers) +
+            worker_count * sizeof(ebpf_program_test_run_worker_t),
+        &test_run_context_size);
+    if (return_value != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    test_run_context =
+        (ebpf_program_test_run_context_t*)ebpf_allocate_with_tag(test_run_context_size, EBPF_POOL_TAG_PROGRAM);
     if (test_run_context == NULL) {
         return_value = EBPF_NO_MEMORY;
         goto Exit;
@@ -3585,23 +3789,54 @@ ebpf_program_execute_test_run(
     test_run_context->async_context = async_context;
     test_run_context->completion_context = completion_context;
     test_run_context->completion_callback = callback;
+    test_run_context->workers_pending_start = (int32_t)worker_count;
+    test_run_context->workers_running = (int32_t)worker_count;
+    test_run_context->worker_count = worker_count;
+
+    worker_buffer = (uint8_t*)&test_run_context->workers[worker_count];
+    for (uint32_t worker_index = 0; worker_index < worker_count; worker_index++) {
+        ebpf_program_test_run_worker_t* worker = &test_run_context->workers[worker_index];
+        worker->cpu = (options->cpu_count == 0) ? options->cpu : options->cpus[worker_index];
+        worker->context = test_run_context;
+        if (worker_index == 0) {
+            worker->data_in = options->data_in;
+            worker->data_out = options->data_out;
+            worker->data_size_out = options->data_size_out;
+            worker->context_out = options->context_out;
+            worker->context_size_out = options->context_size_out;
+        } else {
+            if (options->data_size_in > 0) {
+                memcpy(worker_buffer, options->data_in, options->data_size_in);
+            }
+            worker->data_in = worker_buffer;
+            worker->data_out = worker_buffer + options->data_size_in;
+            worker->data_size_out = options->data_size_out;
+            worker->context_out = options->context_size_out ? worker->data_out + options->data_size_out : NULL;
+            worker->context_size_out = options->context_size_out;
+            worker_buffer += worker_buffer_size;
+        }
 
-    // Queue the work item so that it can be executed on the target CPU and at the target dispatch level.
-    // The work item will signal the completion event when it is done.
-    return_value = ebpf_allocate_preemptible_work_item(&work_item, _ebpf_program_test_run_work_item, test_run_context);
-    if (return_value != EBPF_SUCCESS) {
-        EBPF_LOG_MESSAGE_NTSTATUS(
-            EBPF_TRACELOG_LEVEL_ERROR,
-            EBPF_TRACELOG_KEYWORD_PROGRAM,
-            "Failed to allocate work item for test run",
-            return_value);
-        goto Exit;
+        // Queue a work item per CPU so that it can be executed on the target CPU and at the target dispatch level.
+        return_value =
+            ebpf_allocate_preemptible_work_item(&worker->work_item, _ebpf_program_test_run_work_item, worker);
+        if (return_value != EBPF_SUCCESS) {
+            EBPF_LOG_MESSAGE_NTSTATUS(
+                EBPF_TRACELOG_LEVEL_ERROR,
+                EBPF_TRACELOG_KEYWORD_PROGRAM,
+                "Failed to allocate work item for test run",
+                return_value);
+            goto Exit;
+        }
     }
 
     ebpf_assert_success(ebpf_async_set_cancel_callback(async_context, test_run_context, _ebpf_program_test_run_cancel));
 
-    // cxplat_queue_preemptible_work_item() will free both the work item and the context when it is done.
-    cxplat_queue_preemptible_work_item(work_item);
+    // Each work item frees itself when it is done, and the last one to finish frees the test run context.
+    // The context can't be freed before every work item has been queued, since none of the workers can finish
+    // until all of them have reached the start barrier.
+    for (uint32_t i = 0; i < worker_count; i++) {
+        cxplat_queue_preemptible_work_item(test_run_context->workers[i].work_item);
+    }
 
     // This thread no longer owns the test run context.
     // It will be freed within _ebpf_program_test_run_work_item().
@@ -3611,7 +3846,14 @@ ebpf_program_execute_test_run(
     return_value = EBPF_PENDING;
 
 Exit:
-    ebpf_free(test_run_context);
+    if (test_run_context != NULL) {
+        for (uint32_t i = 0; i < worker_count; i++) {
+            if (test_run_context->workers[i].work_item != NULL) {
+                cxplat_free_preemptible_work_item(test_run_context->workers[i].work_item);
+            }
+        }
+        ebpf_free(test_run_context);
+    }
 
     if (provider_data_referenced) {
         ebpf_program_dereference_providers((ebpf_program_t*)program);
@@ -3708,6 +3950,12 @@ ebpf_program_set_flags(_Inout_ ebpf_program_t* program, uint64_t flags)
     program->flags = flags;
 }
 
+void
+ebpf_program_set_use_predecoded_interpreter(bool use_predecoded_interpreter)
+{
+    _ebpf_program_use_predecoded_interpreter = use_predecoded_interpreter;
+}
+
 void
 ebpf_program_get_context_data(
     _In_ const void* program_context, _Out_ const uint8_t** data_start, _Out_ const uint8_t** data_end)
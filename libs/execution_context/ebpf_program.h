@@ -163,6 +163,19 @@ extern "C"
     _Must_inspect_result_ ebpf_result_t
     ebpf_program_associate_maps(ebpf_program_t* program, ebpf_map_t** maps, uint32_t maps_count);
 
+    /**
+     * @brief Get the update generation of the maps associated with this program. The generation changes after an
+     * entry of any of them is updated or deleted. The caller must be in an epoch.
+     *
+     * @param[in] program Program instance to query.
+     * @param[out] generation The current update generation of the program's maps.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED A map of the program can change without its generation changing, e.g. a
+     *  map of maps or a map that is mapped writable into user mode.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_program_get_map_update_generation(_In_ const ebpf_program_t* program, _Out_ uint64_t* generation);
+
     /**
      * @brief Associate an additional map with this program instance.
      *
@@ -395,6 +408,9 @@ extern "C"
         uint32_t flags;          ///< Flags to control the test run.
         uint32_t cpu;            ///< CPU to run the program on.
         size_t batch_size;       ///< Number of times to repeat the program in a batch.
+        _Field_size_(cpu_count) const uint32_t* cpus; ///< CPUs to run the program on concurrently, in ascending order.
+        uint32_t cpu_count;                           ///< Number of entries in cpus, or 0 to run only on cpu.
+        _Field_size_opt_(cpu_count) ebpf_test_run_cpu_result_t* cpu_results; ///< Optional per-CPU results.
     } ebpf_program_test_run_options_t;
 
     /**
@@ -411,6 +427,12 @@ extern "C"
     /**
      * @brief Run the program with the given input and output buffers and measure the duration.
      *
+     * If options->cpu_count is non-zero, a worker is started on each CPU in options->cpus. CPU indices span all
+     * processor groups. The workers wait for each other before invoking the program, so that they contend for shared
+     * state such as maps for the whole run. Each worker invokes the program options->repeat_count times on its own copy
+     * of the input, and options->duration is the mean duration across all workers. The output buffers and return value
+     * are those of the first CPU.
+     *
      * @param[in] program Program to run.
      * @param[in, out] options Options to control the test run.
      * @param[in] async_context Async context to receive cancellation notifications on.
@@ -532,6 +554,16 @@ extern "C"
     void
     ebpf_program_set_flags(_Inout_ ebpf_program_t* program, uint64_t flags);
 
+    /**
+     * @brief Select whether interpreted programs loaded from now on run under the pre-decoded interpreter rather than
+     * ubpf. Programs that use instructions the pre-decoded interpreter does not support always run under ubpf.
+     * Programs that are already loaded are not affected.
+     *
+     * @param[in] use_predecoded_interpreter True to use the pre-decoded interpreter, false to use ubpf.
+     */
+    void
+    ebpf_program_set_use_predecoded_interpreter(bool use_predecoded_interpreter);
+
     /**
      * @brief Get the data start and end pointers from the program context.
      *
@@ -55,6 +55,15 @@ typedef enum _ebpf_operation_id
     EBPF_OPERATION_RING_BUFFER_MAP_UNMAP_BUFFER,
     EBPF_OPERATION_EPOCH_SYNCHRONIZE,
     EBPF_OPERATION_LINK_SET_LEGACY_MODE,
+    EBPF_OPERATION_PROGRAM_TEST_RUN_PARALLEL,
+    EBPF_OPERATION_MAP_QUEUE_CREATE,
+    EBPF_OPERATION_MAP_QUEUE_NOTIFY,
+    EBPF_OPERATION_MAP_QUEUE_UNMAP,
+    EBPF_OPERATION_MAP_MAP_MEMORY,
+    EBPF_OPERATION_MAP_UNMAP_MEMORY,
+    EBPF_OPERATION_MAP_CURSOR_CREATE,
+    EBPF_OPERATION_MAP_CURSOR_NEXT,
+    EBPF_OPERATION_CREATE_MAP_WITH_FLAGS,
 } ebpf_operation_id_t;
 
 typedef enum _ebpf_code_type
@@ -72,6 +81,20 @@ typedef struct _ebpf_operation_header
     ebpf_operation_id_t id;
 } ebpf_operation_header_t;
 
+// Maximum size of a large message, and of the reply to one.
+#define EBPF_MAX_LARGE_MESSAGE_LENGTH (64 * 1024 * 1024)
+
+// The batch map operations can also be sent as large messages, using a separate IOCTL whose output buffer is mapped
+// directly rather than copied. A large message starts with an ebpf_operation_large_header_t, which has the layout of
+// ebpf_operation_header_t with the upper 16 bits of the length stored in its padding. A variable length reply to a
+// large message starts with an ebpf_operation_large_header_t as well.
+typedef struct _ebpf_operation_large_header
+{
+    uint16_t length;      ///< Lower 16 bits of the message length.
+    uint16_t length_high; ///< Upper 16 bits of the message length.
+    ebpf_operation_id_t id;
+} ebpf_operation_large_header_t;
+
 typedef enum _ebpf_ec_function
 {
     EBPF_EC_FUNCTION_LOG
@@ -152,11 +175,35 @@ typedef struct _ebpf_operation_create_map_reply
     ebpf_handle_t handle;
 } ebpf_operation_create_map_reply_t;
 
+// Used instead of ebpf_operation_create_map_request_t when the map is created with flags.
+typedef struct _ebpf_operation_create_map_with_flags_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_map_definition_in_memory_t ebpf_map_definition;
+    ebpf_handle_t inner_map_handle;
+    uint32_t map_flags; ///< BPF_F_* flags of the map.
+    uint8_t data[1];
+} ebpf_operation_create_map_with_flags_request_t;
+
+typedef struct _ebpf_operation_create_map_with_flags_reply
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t handle;
+} ebpf_operation_create_map_with_flags_reply_t;
+
+// Flags for ebpf_operation_map_find_element_request_t and ebpf_operation_map_get_next_key_value_batch_request_t. The
+// first flag keeps the encoding of the former find_and_delete field.
+#define EBPF_MAP_FIND_ELEMENT_FLAG_DELETE 0x01      ///< Delete the element after it has been found.
+#define EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_SUM 0x02  ///< Return the sum of the per-CPU values.
+#define EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MIN 0x04  ///< Return the minimum of the per-CPU values.
+#define EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MAX 0x06  ///< Return the maximum of the per-CPU values.
+#define EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_MASK 0x06 ///< Mask of the per-CPU aggregation.
+
 typedef struct _ebpf_operation_map_find_element_request
 {
     struct _ebpf_operation_header header;
     ebpf_handle_t handle;
-    bool find_and_delete;
+    uint8_t flags; ///< EBPF_MAP_FIND_ELEMENT_FLAG_* flags.
     uint8_t key[1];
 } ebpf_operation_map_find_element_request_t;
 
@@ -541,7 +588,7 @@ typedef struct _ebpf_operation_map_get_next_key_value_batch_request
 {
     struct _ebpf_operation_header header;
     ebpf_handle_t handle;
-    bool find_and_delete;
+    uint8_t flags; ///< EBPF_MAP_FIND_ELEMENT_FLAG_* flags.
     uint8_t previous_key[1];
 } ebpf_operation_map_get_next_key_value_batch_request_t;
 
@@ -610,6 +657,53 @@ typedef struct _ebpf_operation_ring_buffer_map_unmap_buffer_request
     uint64_t index;
 } ebpf_operation_ring_buffer_map_unmap_buffer_request_t;
 
+typedef struct _ebpf_operation_map_map_memory_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t map_handle;
+    uint32_t writable; ///< Non-zero to map the values writable.
+} ebpf_operation_map_map_memory_request_t;
+
+typedef struct _ebpf_operation_map_map_memory_reply
+{
+    struct _ebpf_operation_header header;
+    uint64_t address;
+    uint64_t size;
+} ebpf_operation_map_map_memory_reply_t;
+
+typedef struct _ebpf_operation_map_unmap_memory_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t map_handle;
+    uint64_t address;
+} ebpf_operation_map_unmap_memory_request_t;
+
+typedef struct _ebpf_operation_map_cursor_create_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t map_handle;
+    uint8_t flags;    ///< Zero or one of the EBPF_MAP_FIND_ELEMENT_FLAG_PERCPU_* flags.
+    uint8_t snapshot; ///< Non-zero to copy all entries of the map when the cursor is created.
+} ebpf_operation_map_cursor_create_request_t;
+
+typedef struct _ebpf_operation_map_cursor_create_reply
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t cursor_handle;
+} ebpf_operation_map_cursor_create_reply_t;
+
+typedef struct _ebpf_operation_map_cursor_next_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t cursor_handle;
+} ebpf_operation_map_cursor_next_request_t;
+
+typedef struct _ebpf_operation_map_cursor_next_reply
+{
+    struct _ebpf_operation_header header;
+    uint8_t data[1]; ///< Keys and values, each key immediately followed by its value.
+} ebpf_operation_map_cursor_next_reply_t;
+
 typedef struct _ebpf_operation_epoch_synchronize_request
 {
     struct _ebpf_operation_header header;
@@ -619,4 +713,96 @@ typedef struct _ebpf_operation_link_set_legacy_mode_request
 {
     struct _ebpf_operation_header header;
     ebpf_handle_t link_handle;
-} ebpf_operation_link_set_legacy_mode_request_t;
\ No newline at end of file
+} ebpf_operation_link_set_legacy_mode_request_t;
+
+typedef struct _ebpf_operation_program_test_run_parallel_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t program_handle;
+    size_t repeat_count;
+    size_t batch_size;
+    uint32_t flags;
+    // Data is the indices of the CPUs to run on, followed by the input data, followed by the input context.
+    uint32_t cpu_count;
+    uint32_t context_offset;
+    uint8_t data[1];
+} ebpf_operation_program_test_run_parallel_request_t;
+
+typedef struct _ebpf_operation_program_test_run_parallel_reply
+{
+    struct _ebpf_operation_header header;
+    uint64_t duration;
+    uint64_t return_value;
+    // Data is the per-CPU results, followed by the output data, followed by the output context.
+    uint32_t cpu_result_count;
+    uint32_t context_offset;
+    uint8_t data[1];
+} ebpf_operation_program_test_run_parallel_reply_t;
+
+#define EBPF_MAP_QUEUE_MAX_RING_SIZE (16 * 1024 * 1024) ///< Maximum size of each ring of a map queue.
+
+typedef enum _ebpf_map_queue_operation
+{
+    EBPF_MAP_QUEUE_OPERATION_LOOKUP,
+    EBPF_MAP_QUEUE_OPERATION_UPDATE,
+    EBPF_MAP_QUEUE_OPERATION_DELETE,
+} ebpf_map_queue_operation_t;
+
+// Record written by user mode to the submission ring of a map queue.
+typedef struct _ebpf_map_queue_submission
+{
+    uint64_t user_data; ///< Copied to the completion of this submission.
+    ebpf_handle_t map_handle;
+    uint32_t operation;  ///< ebpf_map_queue_operation_t.
+    uint32_t flags;      ///< EBPF_MAP_FIND_ELEMENT_FLAG_* for lookups, ebpf_map_option_t for updates.
+    uint32_t key_size;   ///< Size of the key at the start of data.
+    uint32_t value_size; ///< Size of the value following the key for updates, or of the value to return for lookups.
+    uint8_t data[1];
+} ebpf_map_queue_submission_t;
+
+// Record written by the execution context to the completion ring of a map queue.
+typedef struct _ebpf_map_queue_completion
+{
+    uint64_t user_data;
+    int32_t result;      ///< ebpf_result_t of the operation.
+    uint32_t value_size; ///< Size of the value returned by a successful lookup.
+    uint8_t value[1];
+} ebpf_map_queue_completion_t;
+
+typedef struct _ebpf_operation_map_queue_create_request
+{
+    struct _ebpf_operation_header header;
+    uint64_t ring_size;
+    ebpf_handle_t wait_handle; ///< Event signaled when completions are available, or ebpf_handle_invalid.
+} ebpf_operation_map_queue_create_request_t;
+
+typedef struct _ebpf_operation_map_queue_create_reply
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t queue_handle;
+    uint64_t submission_consumer_address;
+    uint64_t submission_producer_address;
+    uint64_t submission_data_address;
+    uint64_t completion_consumer_address;
+    uint64_t completion_producer_address;
+    uint64_t completion_data_address;
+    uint64_t ring_size;
+} ebpf_operation_map_queue_create_reply_t;
+
+typedef struct _ebpf_operation_map_queue_notify_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t queue_handle;
+} ebpf_operation_map_queue_notify_request_t;
+
+typedef struct _ebpf_operation_map_queue_notify_reply
+{
+    struct _ebpf_operation_header header;
+    uint64_t processed_count;
+} ebpf_operation_map_queue_notify_reply_t;
+
+typedef struct _ebpf_operation_map_queue_unmap_request
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t queue_handle;
+} ebpf_operation_map_queue_unmap_request_t;
@@ -6,6 +6,7 @@
 #include "catch_wrapper.hpp"
 #include "ebpf_async.h"
 #include "ebpf_core.h"
+#include "ebpf_handle.h"
 #include "ebpf_maps.h"
 #include "ebpf_object.h"
 #include "ebpf_program.h"
@@ -387,7 +388,7 @@ TEST_CASE("map_create_invalid", "[execution_context][negative]")
         ebpf_handle_t handle;
         ebpf_handle_t inner_handle = ebpf_handle_invalid;
         CAPTURE(name);
-        REQUIRE(ebpf_core_create_map(&utf8_name, &def, inner_handle, &handle) == EBPF_INVALID_ARGUMENT);
+        REQUIRE(ebpf_core_create_map(&utf8_name, &def, 0, inner_handle, &handle) == EBPF_INVALID_ARGUMENT);
     }
 }
 
@@ -1130,6 +1131,231 @@ test_function()
     return TEST_FUNCTION_RETURN;
 }
 
+TEST_CASE("map_per_cpu_aggregation", "[execution_context]")
+{
+    _ebpf_core_initializer core;
+    core.initialize();
+    typedef struct _counters
+    {
+        uint64_t packets;
+        uint64_t bytes;
+    } counters_t;
+    uint32_t cpu_count = ebpf_get_cpu_count();
+
+    for (auto type : {BPF_MAP_TYPE_PERCPU_ARRAY, BPF_MAP_TYPE_PERCPU_HASH, BPF_MAP_TYPE_LRU_PERCPU_HASH}) {
+        ebpf_map_definition_in_memory_t map_definition{type, sizeof(uint32_t), sizeof(counters_t), 2};
+        map_ptr map;
+        {
+            ebpf_map_t* local_map;
+            cxplat_utf8_string_t map_name = {0};
+            REQUIRE(
+                ebpf_map_create(&map_name, &map_definition, (uintptr_t)ebpf_handle_invalid, &local_map) ==
+                EBPF_SUCCESS);
+            map.reset(local_map);
+        }
+
+        // CPU i holds {i + 1, 10 * (i + 1)} for both keys.
+        std::vector<counters_t> per_cpu_values(cpu_count);
+        for (uint32_t cpu = 0; cpu < cpu_count; cpu++) {
+            per_cpu_values[cpu] = {cpu + 1ull, 10ull * (cpu + 1)};
+        }
+        for (uint32_t key = 0; key < 2; key++) {
+            REQUIRE(
+                ebpf_map_update_entry(
+                    map.get(),
+                    sizeof(key),
+                    reinterpret_cast<uint8_t*>(&key),
+                    static_cast<uint32_t>(per_cpu_values.size() * sizeof(counters_t)),
+                    reinterpret_cast<uint8_t*>(per_cpu_values.data()),
+                    EBPF_ANY,
+                    0) == EBPF_SUCCESS);
+        }
+
+        uint64_t sum = static_cast<uint64_t>(cpu_count) * (cpu_count + 1) / 2;
+        struct
+        {
+            int flags;
+            counters_t expected;
+        } cases[] = {
+            {EBPF_MAP_FLAG_PERCPU_SUM, {sum, 10 * sum}},
+            {EBPF_MAP_FLAG_PERCPU_MIN, {1, 10}},
+            {EBPF_MAP_FLAG_PERCPU_MAX, {cpu_count, 10ull * cpu_count}},
+        };
+        for (auto& [flags, expected] : cases) {
+            uint32_t key = 1;
+            counters_t value = {};
+            REQUIRE(
+                ebpf_map_find_entry(
+                    map.get(),
+                    sizeof(key),
+                    reinterpret_cast<uint8_t*>(&key),
+                    sizeof(value),
+                    reinterpret_cast<uint8_t*>(&value),
+                    flags) == EBPF_SUCCESS);
+            REQUIRE(value.packets == expected.packets);
+            REQUIRE(value.bytes == expected.bytes);
+
+            // A batch returns one aggregated value per key.
+            const size_t record_size = sizeof(uint32_t) + sizeof(counters_t);
+            std::vector<uint8_t> records(2 * record_size);
+            size_t length = records.size();
+            REQUIRE(
+                ebpf_map_get_next_key_and_value_batch(map.get(), 0, nullptr, &length, records.data(), flags) ==
+                EBPF_SUCCESS);
+            REQUIRE(length == records.size());
+            for (size_t index = 0; index < 2; index++) {
+                counters_t record_value;
+                memcpy(&record_value, records.data() + index * record_size + sizeof(uint32_t), sizeof(record_value));
+                REQUIRE(record_value.packets == expected.packets);
+                REQUIRE(record_value.bytes == expected.bytes);
+            }
+        }
+
+        // The full per-CPU value size is rejected when aggregating.
+        uint32_t key = 0;
+        REQUIRE(
+            ebpf_map_find_entry(
+                map.get(),
+                sizeof(key),
+                reinterpret_cast<uint8_t*>(&key),
+                static_cast<uint32_t>(per_cpu_values.size() * sizeof(counters_t)),
+                reinterpret_cast<uint8_t*>(per_cpu_values.data()),
+                EBPF_MAP_FLAG_PERCPU_SUM) == EBPF_INVALID_ARGUMENT);
+    }
+
+    // Maps that are not per-CPU are rejected.
+    ebpf_map_definition_in_memory_t map_definition{BPF_MAP_TYPE_ARRAY, sizeof(uint32_t), sizeof(uint64_t), 1};
+    map_ptr map;
+    {
+        ebpf_map_t* local_map;
+        cxplat_utf8_string_t map_name = {0};
+        REQUIRE(
+            ebpf_map_create(&map_name, &map_definition, (uintptr_t)ebpf_handle_invalid, &local_map) == EBPF_SUCCESS);
+        map.reset(local_map);
+    }
+    uint32_t key = 0;
+    uint64_t value = 0;
+    REQUIRE(
+        ebpf_map_find_entry(
+            map.get(),
+            sizeof(key),
+            reinterpret_cast<uint8_t*>(&key),
+            sizeof(value),
+            reinterpret_cast<uint8_t*>(&value),
+            EBPF_MAP_FLAG_PERCPU_SUM) == EBPF_INVALID_ARGUMENT);
+}
+
+TEST_CASE("large_message_batch", "[execution_context]")
+{
+    _ebpf_core_initializer core;
+    core.initialize();
+
+    // Each batch is larger than the 64 KB that fits in a regular message.
+    const uint32_t entry_count = 2048;
+    const size_t value_size = 64;
+    const size_t entry_size = sizeof(uint32_t) + value_size;
+    ebpf_map_definition_in_memory_t map_definition{
+        BPF_MAP_TYPE_HASH, sizeof(uint32_t), static_cast<uint32_t>(value_size), entry_count};
+    cxplat_utf8_string_t map_name = {0};
+    ebpf_handle_t map_handle;
+    REQUIRE(ebpf_core_create_map(&map_name, &map_definition, 0, ebpf_handle_invalid, &map_handle) == EBPF_SUCCESS);
+
+    auto set_header = [](std::vector<uint8_t>& request, ebpf_operation_id_t id) {
+        auto header = reinterpret_cast<ebpf_operation_large_header_t*>(request.data());
+        header->length = static_cast<uint16_t>(request.size());
+        header->length_high = static_cast<uint16_t>(request.size() >> 16);
+        header->id = id;
+    };
+
+    // Insert all entries with a single request.
+    std::vector<uint8_t> update_request(
+        EBPF_OFFSET_OF(ebpf_operation_map_update_element_batch_request_t, data) + entry_count * entry_size);
+    REQUIRE(update_request.size() > UINT16_MAX);
+    auto update = reinterpret_cast<ebpf_operation_map_update_element_batch_request_t*>(update_request.data());
+    update->handle = map_handle;
+    update->option = EBPF_ANY;
+    for (uint32_t key = 0; key < entry_count; key++) {
+        uint8_t* entry = update->data + key * entry_size;
+        memcpy(entry, &key, sizeof(key));
+        memset(entry + sizeof(key), static_cast<uint8_t>(key), value_size);
+    }
+    set_header(update_request, EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH);
+    ebpf_operation_map_update_element_batch_reply_t update_reply = {};
+    REQUIRE(
+        ebpf_core_invoke_large_protocol_handler(
+            EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH,
+            update_request.data(),
+            static_cast<uint32_t>(update_request.size()),
+            &update_reply,
+            sizeof(update_reply)) == EBPF_SUCCESS);
+    REQUIRE(update_reply.count_of_elements_processed == entry_count);
+
+    // Read all entries back with a single request.
+    std::vector<uint8_t> dump_request(
+        EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_request_t, previous_key));
+    auto dump = reinterpret_cast<ebpf_operation_map_get_next_key_value_batch_request_t*>(dump_request.data());
+    dump->handle = map_handle;
+    dump->flags = 0;
+    set_header(dump_request, EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH);
+    std::vector<uint8_t> dump_reply(
+        EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_reply_t, data) + entry_count * entry_size);
+    REQUIRE(
+        ebpf_core_invoke_large_protocol_handler(
+            EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH,
+            dump_request.data(),
+            static_cast<uint32_t>(dump_request.size()),
+            dump_reply.data(),
+            static_cast<uint32_t>(dump_reply.size())) == EBPF_SUCCESS);
+    auto reply_header = reinterpret_cast<ebpf_operation_large_header_t*>(dump_reply.data());
+    REQUIRE((static_cast<size_t>(reply_header->length_high) << 16 | reply_header->length) == dump_reply.size());
+    REQUIRE(reply_header->id == EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH);
+    auto reply_data = reinterpret_cast<ebpf_operation_map_get_next_key_value_batch_reply_t*>(dump_reply.data())->data;
+    std::set<uint32_t> keys;
+    for (uint32_t index = 0; index < entry_count; index++) {
+        uint32_t key;
+        memcpy(&key, reply_data + index * entry_size, sizeof(key));
+        std::vector<uint8_t> expected_value(value_size, static_cast<uint8_t>(key));
+        REQUIRE(memcmp(reply_data + index * entry_size + sizeof(key), expected_value.data(), value_size) == 0);
+        keys.insert(key);
+    }
+    REQUIRE(keys.size() == entry_count);
+
+    // The operation must match the header.
+    REQUIRE(
+        ebpf_core_invoke_large_protocol_handler(
+            EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH,
+            dump_request.data(),
+            static_cast<uint32_t>(dump_request.size()),
+            dump_reply.data(),
+            static_cast<uint32_t>(dump_reply.size())) == EBPF_INVALID_ARGUMENT);
+
+    // The length must not exceed the buffer.
+    reinterpret_cast<ebpf_operation_large_header_t*>(dump_request.data())->length_high = 1;
+    REQUIRE(
+        ebpf_core_invoke_large_protocol_handler(
+            EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH,
+            dump_request.data(),
+            static_cast<uint32_t>(dump_request.size()),
+            dump_reply.data(),
+            static_cast<uint32_t>(dump_reply.size())) == EBPF_INVALID_ARGUMENT);
+
+    // Only batch operations accept large messages.
+    std::vector<uint8_t> find_request(
+        EBPF_OFFSET_OF(ebpf_operation_map_find_element_request_t, key) + sizeof(uint32_t));
+    auto find = reinterpret_cast<ebpf_operation_map_find_element_request_t*>(find_request.data());
+    find->handle = map_handle;
+    set_header(find_request, EBPF_OPERATION_MAP_FIND_ELEMENT);
+    REQUIRE(
+        ebpf_core_invoke_large_protocol_handler(
+            EBPF_OPERATION_MAP_FIND_ELEMENT,
+            find_request.data(),
+            static_cast<uint32_t>(find_request.size()),
+            dump_reply.data(),
+            static_cast<uint32_t>(dump_reply.size())) == EBPF_INVALID_ARGUMENT);
+
+    REQUIRE(ebpf_handle_close(map_handle) == EBPF_SUCCESS);
+}
+
 TEST_CASE("name size", "[execution_context]")
 {
     _ebpf_core_initializer core;
@@ -1173,6 +1399,41 @@ TEST_CASE("test-csum-diff", "[execution_context]")
     REQUIRE(csum == 0xb861);
 }
 
+TEST_CASE("test-csum-replace", "[execution_context]")
+{
+    // Checksum of the "from" header.
+    int csum = ebpf_core_csum_diff(nullptr, 0, from_buffer, sizeof(from_buffer), 0);
+    REQUIRE(csum > 0);
+    csum = (csum >> 16) + (csum & 0xFFFF);
+    csum = (csum >> 16) + (csum & 0xFFFF);
+    uint16_t checksum = (uint16_t)~csum;
+
+    // Rewrite the source address as a 4 byte field.
+    uint64_t from = from_buffer[6] | ((uint64_t)from_buffer[7] << 16);
+    uint64_t to = to_buffer[6] | ((uint64_t)to_buffer[7] << 16);
+    REQUIRE(ebpf_core_l3_csum_replace_s(&checksum, sizeof(checksum), from, to, sizeof(uint32_t)) == 0);
+
+    // Rewrite the destination address using a delta from bpf_csum_diff.
+    int diff = ebpf_core_csum_diff(&from_buffer[8], 2 * sizeof(uint16_t), &to_buffer[8], 2 * sizeof(uint16_t), 0);
+    REQUIRE(diff >= 0);
+    REQUIRE(ebpf_core_l4_csum_replace_s(&checksum, sizeof(checksum), 0, diff, 0) == 0);
+    REQUIRE(checksum == 0xb861);
+
+    // A zero checksum is left as is with BPF_F_MARK_MANGLED_0.
+    checksum = 0;
+    REQUIRE(
+        ebpf_core_l4_csum_replace_s(&checksum, sizeof(checksum), from, to, sizeof(uint32_t) | BPF_F_MARK_MANGLED_0) ==
+        0);
+    REQUIRE(checksum == 0);
+
+    // Invalid field sizes, checksum sizes and flags are rejected.
+    REQUIRE(ebpf_core_l3_csum_replace_s(&checksum, sizeof(checksum), from, to, 3) == -EINVAL);
+    REQUIRE(ebpf_core_l3_csum_replace_s(&checksum, sizeof(checksum), from, to, BPF_F_PSEUDO_HDR) == -EINVAL);
+    REQUIRE(ebpf_core_l3_csum_replace_s(&checksum, sizeof(checksum), 1, to, 0) == -EINVAL);
+    REQUIRE(ebpf_core_l4_csum_replace_s(&checksum, sizeof(uint32_t), from, to, sizeof(uint32_t)) == -EINVAL);
+    REQUIRE(ebpf_core_l4_csum_replace_s(&checksum, sizeof(checksum), from, to, 1ULL << 6) == -EINVAL);
+}
+
 TEST_CASE("ring_buffer_async_query", "[execution_context][ring_buffer]")
 {
     _ebpf_core_initializer core;
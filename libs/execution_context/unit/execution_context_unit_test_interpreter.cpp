@@ -0,0 +1,245 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+// Differential tests for the pre-decoded interpreter. Every program in the uBPF and bpf_conformance test corpus is
+// executed by both ubpf and the pre-decoded interpreter and the results are compared.
+
+#include "..\..\..\tests\bpf2c_tests\test_helpers.h"
+#include "catch_wrapper.hpp"
+#include "ebpf.h"
+#include "ebpf_interpreter.h"
+#include "execution_context_unit_test_jit.h"
+
+extern "C"
+{
+#include "ubpf.h"
+}
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#if !defined(CONFIG_BPF_INTERPRETER_DISABLED)
+
+// Note: The bpf_assembler.h file is not included here because it has a conflicting definition of
+// the bpf_insn struct.
+std::vector<ebpf_inst>
+bpf_assembler(std::istream& input);
+
+#define SEPARATOR "\\"
+
+// Path to ubpf tests directory (tests that remain in ubpf/tests/)
+#define UBPF_TEST_PATH ".." SEPARATOR ".." SEPARATOR "external" SEPARATOR "ubpf" SEPARATOR "tests"
+
+// Path to bpf_conformance tests directory (tests moved to ubpf/external/bpf_conformance/tests/)
+#define CONFORMANCE_TEST_PATH                                                                \
+    ".." SEPARATOR ".." SEPARATOR "external" SEPARATOR "ubpf" SEPARATOR "external" SEPARATOR \
+    "bpf_conformance" SEPARATOR "tests"
+
+typedef struct _interpreter_test_data
+{
+    std::vector<ebpf_inst> instructions;
+    std::vector<uint8_t> memory;
+} interpreter_test_data_t;
+
+// Parse a corpus data file. Returns false if the file does not describe a program that is expected to run to
+// completion, e.g. it has no result block or it expects the program to be rejected.
+static bool
+_parse_interpreter_test_file(const std::filesystem::path& data_file, interpreter_test_data_t& test_data)
+{
+    enum class _state
+    {
+        state_ignore,
+        state_assembly,
+        state_result,
+        state_memory,
+    } state = _state::state_ignore;
+    std::ifstream data_in(data_file);
+    std::stringstream assembly;
+    std::string memory;
+    bool has_result = false;
+    std::string line;
+
+    test_data = {};
+    while (std::getline(data_in, line)) {
+        if (line.find("#") != std::string::npos) {
+            line = line.substr(0, line.find("#"));
+        }
+
+        if (line.find("--") != std::string::npos) {
+            if (line.find("asm") != std::string::npos) {
+                state = _state::state_assembly;
+            } else if (line.find("result") != std::string::npos) {
+                state = _state::state_result;
+                has_result = true;
+            } else if (line.find("mem") != std::string::npos) {
+                state = _state::state_memory;
+            } else if (line.find("error") != std::string::npos) {
+                return false;
+            } else {
+                state = _state::state_ignore;
+            }
+            continue;
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        switch (state) {
+        case _state::state_assembly:
+            assembly << line << std::endl;
+            break;
+        case _state::state_memory:
+            memory += std::string(" ") + line;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!has_result) {
+        return false;
+    }
+
+    std::stringstream memory_stream(memory);
+    uint32_t value;
+    while (memory_stream >> std::hex >> value) {
+        test_data.memory.push_back(static_cast<uint8_t>(value));
+    }
+
+    try {
+        test_data.instructions = bpf_assembler(assembly);
+    } catch (std::exception&) {
+        // Tests using directives the assembler does not understand are not usable here.
+        return false;
+    }
+
+    // Both interpreters pass the memory in R1. ubpf also passes its length in R2, which is not part of the eBPF ISA,
+    // so set R2 explicitly to give both interpreters the same initial state.
+    ebpf_inst set_length = {};
+    set_length.opcode = EBPF_OP_MOV64_IMM;
+    set_length.dst = 2;
+    set_length.imm = static_cast<int32_t>(test_data.memory.size());
+    test_data.instructions.insert(test_data.instructions.begin(), set_length);
+    return !test_data.instructions.empty();
+}
+
+static ubpf_vm*
+_prepare_ubpf_vm(const std::vector<ebpf_inst>& instructions)
+{
+    ubpf_vm* vm = ubpf_create();
+    char* error = nullptr;
+    REQUIRE(vm != nullptr);
+
+    // Match the ubpf configuration used by ebpf_program.c.
+    ubpf_toggle_bounds_check(vm, false);
+    ubpf_toggle_readonly_bytecode(vm, false);
+
+    for (auto& [key, value] : helper_functions) {
+        REQUIRE(ubpf_register(vm, key, "unnamed", value) == 0);
+    }
+
+    if (ubpf_load(vm, instructions.data(), static_cast<uint32_t>(instructions.size() * sizeof(ebpf_inst)), &error) !=
+        0) {
+        // Malformed programs are rejected by the verifier and ubpf before the pre-decoded interpreter sees them.
+        free(error);
+        ubpf_destroy(vm);
+        return nullptr;
+    }
+    return vm;
+}
+
+static ebpf_interpreter_program_t*
+_prepare_predecoded_program(const std::vector<ebpf_inst>& instructions)
+{
+    static_assert(sizeof(ebpf_inst) == sizeof(ebpf_instruction_t));
+    ebpf_interpreter_program_t* program = nullptr;
+    uint32_t helper_count = 0;
+    for (auto& [key, value] : helper_functions) {
+        helper_count = (std::max)(helper_count, key + 1);
+    }
+
+    ebpf_result_t result = ebpf_interpreter_program_create(
+        reinterpret_cast<const ebpf_instruction_t*>(instructions.data()), instructions.size(), helper_count, &program);
+    if (result == EBPF_OPERATION_NOT_SUPPORTED) {
+        return nullptr;
+    }
+    REQUIRE(result == EBPF_SUCCESS);
+
+    for (auto& [key, value] : helper_functions) {
+        REQUIRE(ebpf_interpreter_program_set_helper(program, key, reinterpret_cast<uint64_t>(value)) == EBPF_SUCCESS);
+    }
+    return program;
+}
+
+TEST_CASE("predecoded_interpreter_differential", "[execution_context][interpreter]")
+{
+    _ebpf_core_initializer core;
+    core.initialize();
+    std::set<uint8_t> opcode_classes;
+    size_t compared_count = 0;
+
+    for (const char* test_path : {CONFORMANCE_TEST_PATH, UBPF_TEST_PATH}) {
+        for (const auto& entry : std::filesystem::directory_iterator(test_path)) {
+            if (entry.path().extension() != ".data") {
+                continue;
+            }
+
+            interpreter_test_data_t test_data;
+            if (!_parse_interpreter_test_file(entry.path(), test_data)) {
+                continue;
+            }
+            INFO(entry.path().string());
+
+            ubpf_vm* vm = _prepare_ubpf_vm(test_data.instructions);
+            if (vm == nullptr) {
+                continue;
+            }
+            ebpf_interpreter_program_t* program = _prepare_predecoded_program(test_data.instructions);
+            if (program == nullptr) {
+                // Programs the pre-decoded interpreter does not support keep running under ubpf.
+                ubpf_destroy(vm);
+                continue;
+            }
+
+            std::vector<uint8_t> ubpf_memory = test_data.memory;
+            uint64_t ubpf_result = 0;
+            int ubpf_status = ubpf_exec(vm, ubpf_memory.data(), ubpf_memory.size(), &ubpf_result);
+
+            std::vector<uint8_t> predecoded_memory = test_data.memory;
+            uint64_t predecoded_result = 0;
+            int predecoded_status =
+                ebpf_interpreter_program_execute(program, predecoded_memory.data(), &predecoded_result);
+
+            ebpf_interpreter_program_free(program);
+            ubpf_destroy(vm);
+
+            REQUIRE(predecoded_status == ubpf_status);
+            REQUIRE(predecoded_result == ubpf_result);
+            REQUIRE(predecoded_memory == ubpf_memory);
+
+            for (const auto& instruction : test_data.instructions) {
+                opcode_classes.insert(instruction.opcode & EBPF_CLS_MASK);
+            }
+            compared_count++;
+        }
+    }
+
+    INFO("Compared " << compared_count << " programs");
+    REQUIRE(compared_count > 0);
+
+    // Every instruction class must be covered by at least one compared program.
+    for (uint8_t opcode_class : {EBPF_CLS_LD,
+                                 EBPF_CLS_LDX,
+                                 EBPF_CLS_ST,
+                                 EBPF_CLS_STX,
+                                 EBPF_CLS_ALU,
+                                 EBPF_CLS_JMP,
+                                 EBPF_CLS_JMP32,
+                                 EBPF_CLS_ALU64}) {
+        INFO("Opcode class " << (int)opcode_class);
+        REQUIRE(opcode_classes.find(opcode_class) != opcode_classes.end());
+    }
+}
+#endif
@@ -97,7 +97,7 @@ create_various_objects(std::vector<ebpf_handle_t>& program_handles, std::map<std
         if (def.inner_map_id != 0) {
             inner_handle = map_handles.begin()->second;
         }
-        REQUIRE(ebpf_core_create_map(&utf8_name, &def, inner_handle, &handle) == EBPF_SUCCESS);
+        REQUIRE(ebpf_core_create_map(&utf8_name, &def, 0, inner_handle, &handle) == EBPF_SUCCESS);
         map_handles.insert({name, handle});
     }
 }
@@ -8,6 +8,15 @@
 #include "ebpf_protocol.h"
 
 static_assert(sizeof(ebpf_operation_header_t) == 8, "ebpf_operation_header_t must remain 8 bytes");
+static_assert(
+    sizeof(ebpf_operation_large_header_t) == sizeof(ebpf_operation_header_t),
+    "ebpf_operation_large_header_t must match ebpf_operation_header_t");
+static_assert(
+    offsetof(ebpf_operation_large_header_t, length_high) == 2,
+    "ebpf_operation_large_header_t.length_high must occupy the header padding");
+static_assert(
+    offsetof(ebpf_operation_large_header_t, id) == offsetof(ebpf_operation_header_t, id),
+    "ebpf_operation_large_header_t.id offset mismatch");
 static_assert(sizeof(ebpf_operation_id_t) == sizeof(uint32_t), "ebpf_operation_id_t must remain 4 bytes");
 static_assert(sizeof(ebpf_code_type_t) == sizeof(uint32_t), "ebpf_code_type_t must remain 4 bytes");
 static_assert(sizeof(ebpf_map_option_t) == sizeof(uint32_t), "ebpf_map_option_t must remain 4 bytes");
@@ -40,3 +40,40 @@ ebpf_protocol_validate_ioctl_message(_In_reads_bytes_(length) const uint8_t* buf
     // EverParse takes a mutable buffer pointer here, but validation is read-only in practice.
     return (bool)EbpfProtocolCheckEbpfIoctlMessage(length, (uint8_t*)buffer, length);
 }
+
+// Large messages carry only the batch map operations, whose bodies are a handle and a fixed field followed by
+// variable-length data. They are validated here rather than by a second EverParse entry point, applying the same
+// checks that EbpfProtocol.3d applies to these bodies in a regular message.
+_Must_inspect_result_ bool
+ebpf_protocol_validate_large_ioctl_message(_In_reads_bytes_(length) const uint8_t* buffer, uint32_t length)
+{
+    const ebpf_operation_large_header_t* header = (const ebpf_operation_large_header_t*)buffer;
+    uint32_t message_length;
+
+    if (length < sizeof(*header)) {
+        return false;
+    }
+
+    message_length = ((uint32_t)header->length_high << 16) | header->length;
+    if (message_length < sizeof(*header) || message_length > length ||
+        message_length > EBPF_MAX_LARGE_MESSAGE_LENGTH) {
+        return false;
+    }
+
+    switch (header->id) {
+    case EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH: {
+        const ebpf_operation_map_update_element_batch_request_t* request =
+            (const ebpf_operation_map_update_element_batch_request_t*)buffer;
+        if (message_length < offsetof(ebpf_operation_map_update_element_batch_request_t, data)) {
+            return false;
+        }
+        return (uint32_t)request->option <= EBPFPROTOCOL____EBPF_MAP_OPTION_MAX;
+    }
+    case EBPF_OPERATION_MAP_DELETE_ELEMENT_BATCH:
+        return message_length >= offsetof(ebpf_operation_map_delete_element_batch_request_t, keys);
+    case EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH:
+        return message_length >= offsetof(ebpf_operation_map_get_next_key_value_batch_request_t, previous_key);
+    default:
+        return false;
+    }
+}
@@ -24,6 +24,11 @@ extern "C"
     _Must_inspect_result_ bool
     ebpf_protocol_validate_ioctl_message(_In_reads_bytes_(length) const uint8_t* buffer, uint32_t length);
 
+    // Validate a large IOCTL message, which starts with an ebpf_operation_large_header_t.
+    // Returns true if the message passes structural validation.
+    _Must_inspect_result_ bool
+    ebpf_protocol_validate_large_ioctl_message(_In_reads_bytes_(length) const uint8_t* buffer, uint32_t length);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1134,7 +1134,7 @@ ValidateMapFindElementBody(
             }
             else
             {
-                /* Validating field FindAndDelete */
+                /* Validating field Flags */
                 /* Checking that we have enough space for a UINT8, i.e., 1 byte
                  */
                 BOOLEAN hasBytes0 =
@@ -1160,7 +1160,7 @@ ValidateMapFindElementBody(
                 else
                 {
                     Err("_MAP_FIND_ELEMENT_BODY",
-                        "FindAndDelete",
+                        "Flags",
                         EverParseErrorReasonOfResult(
                             positionAfterMapFindElementBody0),
                         Ctxt,
@@ -1168,11 +1168,11 @@ ValidateMapFindElementBody(
                         positionAfterHandle);
                     res0 = positionAfterMapFindElementBody0;
                 }
-                uint64_t positionAfterFindAndDelete = res0;
-                if (EverParseIsError(positionAfterFindAndDelete))
+                uint64_t positionAfterFlags = res0;
+                if (EverParseIsError(positionAfterFlags))
                 {
                     positionAfterMapFindElementBody =
-                        positionAfterFindAndDelete;
+                        positionAfterFlags;
                 }
                 else
                 {
@@ -1183,25 +1183,25 @@ ValidateMapFindElementBody(
                             MessageLength -
                             (uint16_t)
                                 EBPFPROTOCOL____FIND_ELEMENT_KEY_OFFSET) <=
-                        (InputLength - positionAfterFindAndDelete);
+                        (InputLength - positionAfterFlags);
                     uint64_t positionAfterMapFindElementBody0;
                     if (!hasEnoughBytes)
                     {
                         positionAfterMapFindElementBody0 =
                             EverParseSetValidatorErrorPos(
                                 EVERPARSE_VALIDATOR_ERROR_NOT_ENOUGH_DATA,
-                                positionAfterFindAndDelete);
+                                positionAfterFlags);
                     }
                     else
                     {
                         uint8_t *truncatedInput = Input;
                         uint64_t truncatedInputLength =
-                            positionAfterFindAndDelete +
+                            positionAfterFlags +
                             (uint64_t)(uint32_t)(
                                 MessageLength -
                                 (uint16_t)
                                     EBPFPROTOCOL____FIND_ELEMENT_KEY_OFFSET);
-                        uint64_t result = positionAfterFindAndDelete;
+                        uint64_t result = positionAfterFlags;
                         while (TRUE)
                         {
                             uint64_t position = *&result;
@@ -1273,7 +1273,7 @@ ValidateMapFindElementBody(
                                 positionAfterMapFindElementBody0),
                             Ctxt,
                             Input,
-                            positionAfterFindAndDelete);
+                            positionAfterFlags);
                         positionAfterMapFindElementBody =
                             positionAfterMapFindElementBody0;
                     }
@@ -5528,7 +5528,7 @@ ValidateMapGetNextKeyValueBatchBody(
             }
             else
             {
-                /* Validating field FindAndDelete */
+                /* Validating field Flags */
                 /* Checking that we have enough space for a UINT8, i.e., 1 byte
                  */
                 BOOLEAN hasBytes0 =
@@ -5555,7 +5555,7 @@ ValidateMapGetNextKeyValueBatchBody(
                 else
                 {
                     Err("_MAP_GET_NEXT_KEY_VALUE_BATCH_BODY",
-                        "FindAndDelete",
+                        "Flags",
                         EverParseErrorReasonOfResult(
                             positionAfterMapGetNextKeyValueBatchBody0),
                         Ctxt,
@@ -5563,11 +5563,11 @@ ValidateMapGetNextKeyValueBatchBody(
                         positionAfterHandle);
                     res0 = positionAfterMapGetNextKeyValueBatchBody0;
                 }
-                uint64_t positionAfterFindAndDelete = res0;
-                if (EverParseIsError(positionAfterFindAndDelete))
+                uint64_t positionAfterFlags = res0;
+                if (EverParseIsError(positionAfterFlags))
                 {
                     positionAfterMapGetNextKeyValueBatchBody =
-                        positionAfterFindAndDelete;
+                        positionAfterFlags;
                 }
                 else
                 {
@@ -5578,25 +5578,25 @@ ValidateMapGetNextKeyValueBatchBody(
                             MessageLength -
                             (uint16_t)
                                 EBPFPROTOCOL____GET_NEXT_KEY_VALUE_BATCH_KEY_OFFSET) <=
-                        (InputLength - positionAfterFindAndDelete);
+                        (InputLength - positionAfterFlags);
                     uint64_t positionAfterMapGetNextKeyValueBatchBody0;
                     if (!hasEnoughBytes)
                     {
                         positionAfterMapGetNextKeyValueBatchBody0 =
                             EverParseSetValidatorErrorPos(
                                 EVERPARSE_VALIDATOR_ERROR_NOT_ENOUGH_DATA,
-                                positionAfterFindAndDelete);
+                                positionAfterFlags);
                     }
                     else
                     {
                         uint8_t *truncatedInput = Input;
                         uint64_t truncatedInputLength =
-                            positionAfterFindAndDelete +
+                            positionAfterFlags +
                             (uint64_t)(uint32_t)(
                                 MessageLength -
                                 (uint16_t)
                                     EBPFPROTOCOL____GET_NEXT_KEY_VALUE_BATCH_KEY_OFFSET);
-                        uint64_t result = positionAfterFindAndDelete;
+                        uint64_t result = positionAfterFlags;
                         while (TRUE)
                         {
                             uint64_t position = *&result;
@@ -5672,7 +5672,7 @@ ValidateMapGetNextKeyValueBatchBody(
                                 positionAfterMapGetNextKeyValueBatchBody0),
                             Ctxt,
                             Input,
-                            positionAfterFindAndDelete);
+                            positionAfterFlags);
                         positionAfterMapGetNextKeyValueBatchBody =
                             positionAfterMapGetNextKeyValueBatchBody0;
                     }
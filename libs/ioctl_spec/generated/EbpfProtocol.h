@@ -13,7 +13,7 @@ extern "C"
 
 #define EBPFPROTOCOL____HEADER_PAD_SIZE ((uint8_t)2U)
 
-#define EBPFPROTOCOL____MAX_OPERATION_ID ((uint8_t)45U)
+#define EBPFPROTOCOL____MAX_OPERATION_ID ((uint8_t)54U)
 
 #define EBPFPROTOCOL____OP_CREATE_PROGRAM ((uint8_t)2U)
 
@@ -1279,6 +1279,49 @@ ebpf_hash_table_iterate(
     return EBPF_SUCCESS;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_hash_table_iterate_from_position(
+    _In_ const ebpf_hash_table_t* hash_table,
+    _Inout_ size_t* bucket,
+    _Inout_ size_t* slot,
+    _Inout_ size_t* count,
+    _Out_writes_to_(*count, *count) const uint8_t** keys,
+    _Out_writes_to_(*count, *count) const uint8_t** values)
+{
+    size_t bucket_index = *bucket;
+    size_t slot_index = *slot;
+    size_t index = 0;
+
+    if (*count == 0) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    while (index < *count && bucket_index < hash_table->bucket_count) {
+        // Read the bucket once, so that all entries returned from it come from the same immutable copy.
+        ebpf_hash_bucket_header_t* bucket_header = _ebpf_hash_table_get_bucket(hash_table, bucket_index);
+        size_t bucket_entry_count = bucket_header ? bucket_header->count : 0;
+        for (; slot_index < bucket_entry_count && index < *count; slot_index++) {
+            ebpf_hash_bucket_entry_t* entry =
+                _ebpf_hash_table_bucket_entry(hash_table->key_size, bucket_header, slot_index);
+            if (!entry) {
+                return EBPF_INVALID_ARGUMENT;
+            }
+            keys[index] = entry->key;
+            values[index] = entry->data;
+            index++;
+        }
+        if (slot_index >= bucket_entry_count) {
+            bucket_index++;
+            slot_index = 0;
+        }
+    }
+
+    *bucket = bucket_index;
+    *slot = slot_index;
+    *count = index;
+    return (index == 0) ? EBPF_NO_MORE_KEYS : EBPF_SUCCESS;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_hash_table_next_key_and_value_sorted(
     _In_ const ebpf_hash_table_t* hash_table,
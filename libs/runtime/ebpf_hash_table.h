@@ -169,6 +169,34 @@ extern "C"
         _Out_writes_(*count) const uint8_t** keys,
         _Out_writes_(*count) const uint8_t** values);
 
+    /**
+     * @brief Fetch pointers to keys and values in bucket order, starting at a position in the hash table. Unlike
+     * ebpf_hash_table_next_key, the position does not depend on a key, so no lookup is needed to resume and deleting
+     * the last key returned does not restart the iteration. An entry that stays in the hash table for the whole
+     * iteration is returned exactly once, except when the bucket holding the position is replaced between two calls,
+     * in which case entries of that bucket may be skipped or repeated. The pointers are valid until the caller leaves
+     * the current epoch.
+     *
+     * @param[in] hash_table Hash-table to iterate.
+     * @param[in,out] bucket Index of the bucket to start at, 0 to start from the beginning. Updated on return.
+     * @param[in,out] slot Index of the entry in the bucket to start at. Updated on return.
+     * @param[in,out] count On input, the number of keys and values that can be stored in the buffers. On output, the
+     * number of keys and values returned.
+     * @param[out] keys An array of pointers to keys in the hash table.
+     * @param[out] values An array of pointers to values in the hash table.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT An invalid argument was passed to this function.
+     * @retval EBPF_NO_MORE_KEYS No more keys.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_hash_table_iterate_from_position(
+        _In_ const ebpf_hash_table_t* hash_table,
+        _Inout_ size_t* bucket,
+        _Inout_ size_t* slot,
+        _Inout_ size_t* count,
+        _Out_writes_to_(*count, *count) const uint8_t** keys,
+        _Out_writes_to_(*count, *count) const uint8_t** values);
+
     /**
      * @brief Find the next key in the hash table.
      *
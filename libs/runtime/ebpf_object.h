@@ -29,6 +29,8 @@ extern "C"
         EBPF_FILE_ID_PLATFORM_UNIT_TESTS,
         EBPF_FILE_ID_PERFORMANCE_TESTS,
         EBPF_FILE_ID_CORE_HELPER_FUZZER,
+        EBPF_FILE_ID_MAP_QUEUE,
+        EBPF_FILE_ID_MAP_CURSOR,
     } ebpf_file_id_t;
 
 /**
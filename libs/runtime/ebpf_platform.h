@@ -123,6 +123,30 @@ extern "C"
     void*
     ebpf_memory_descriptor_get_base_address(MDL* memory_descriptor);
 
+    /**
+     * @brief Map memory allocated via ebpf_map_memory into the calling process.
+     *
+     * @param[in] memory_descriptor Pointer to an ebpf_memory_descriptor_t
+     * describing allocated pages.
+     * @param[in] writable Whether the process can write to the mapping.
+     * @param[out] address Base address of the mapping in the calling process.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT Unable to map the memory.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_memory_descriptor_map_user(_In_ MDL* memory_descriptor, bool writable, _Outptr_ void** address);
+
+    /**
+     * @brief Remove a mapping created by ebpf_memory_descriptor_map_user. Must be called in the context of the
+     * process that created the mapping, attaching to it with ebpf_platform_attach_process if necessary.
+     *
+     * @param[in] memory_descriptor Pointer to an ebpf_memory_descriptor_t
+     * describing allocated pages.
+     * @param[in] address Base address of the mapping in the calling process.
+     */
+    void
+    ebpf_memory_descriptor_unmap_user(_In_ MDL* memory_descriptor, _In_ void* address);
+
     /**
      * @brief Allocate pages from physical memory and create a mapping into the
      * system address space with the same pages mapped twice.
@@ -167,6 +191,21 @@ extern "C"
     ebpf_ring_map_user(
         _In_ ebpf_ring_descriptor_t* ring, _Outptr_ void** consumer, _Outptr_ void** producer, _Outptr_ uint8_t** data);
 
+    /**
+     * @brief Create a mapping in the calling process of the ring buffer where the producer page and the data region
+     * are writable. This is used for rings where the calling process is the producer and the kernel is the consumer.
+     *
+     * @param[in] ring Ring buffer to map.
+     * @param[out] consumer Pointer to the mapped consumer page.
+     * @param[out] producer Pointer to the mapped producer page.
+     * @param[out] data Pointer to the mapped data region.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT Unable to map the buffer.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_ring_map_user_writable(
+        _In_ ebpf_ring_descriptor_t* ring, _Outptr_ void** consumer, _Outptr_ void** producer, _Outptr_ uint8_t** data);
+
     /**
      * @brief Unmap the memory of a ring buffer.
      *
@@ -420,6 +420,7 @@ ebpf_ring_buffer_allocate_ring(_Out_writes_bytes_(sizeof(ebpf_ring_buffer_t)) eb
     ring->data = (uint8_t*)base_address + (EBPF_RING_BUFFER_HEADER_PAGES * PAGE_SIZE);
     ring->length = capacity;
     ring->kernel_page->wait_event = NULL;
+    ring->kernel_page->user_record_consumer_offset = 0;
 
     return EBPF_SUCCESS;
 }
@@ -630,6 +631,96 @@ ebpf_ring_buffer_unmap_user(_In_ const ebpf_ring_buffer_t* ring)
     return ebpf_ring_unmap_user(ring->ring_descriptor);
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_buffer_map_user_producer(
+    _In_ const ebpf_ring_buffer_t* ring,
+    _Outptr_ void** consumer,
+    _Outptr_ void** producer,
+    _Outptr_result_buffer_(*data_size) uint8_t** data,
+    _Out_ size_t* data_size)
+{
+    *data_size = ring->length;
+    return ebpf_ring_map_user_writable(ring->ring_descriptor, consumer, producer, data);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_buffer_read_user_record(
+    _Inout_ ebpf_ring_buffer_t* ring,
+    _Out_writes_bytes_to_(buffer_size, *length) uint8_t* buffer,
+    size_t buffer_size,
+    _Out_ size_t* length,
+    _Out_ size_t* next_offset)
+{
+    *length = 0;
+    *next_offset = 0;
+
+    // The consumer page is writable by user mode, so the kernel page holds the authoritative consumer offset.
+    size_t consumer_offset = ring->kernel_page->user_record_consumer_offset;
+    // Read-acquire the producer offset to ensure we see the record headers written before it.
+    size_t producer_offset = _ring_read_producer_offset_acquire(ring);
+
+    while (producer_offset != consumer_offset) {
+        size_t available = producer_offset - consumer_offset;
+        // A producer offset behind the consumer offset wraps to a large value and fails this check as well.
+        if (available > _ring_get_length(ring) || available < EBPF_RINGBUF_HEADER_SIZE || (available & 7) != 0) {
+            EBPF_LOG_MESSAGE_UINT64_UINT64(
+                EBPF_TRACELOG_LEVEL_ERROR,
+                EBPF_TRACELOG_KEYWORD_MAP,
+                "ebpf_ring_buffer_read_user_record: Invalid producer offset",
+                producer_offset,
+                consumer_offset);
+            return EBPF_INVALID_ARGUMENT;
+        }
+
+        const ebpf_ring_buffer_record_t* record = _ring_record_at_offset(ring, consumer_offset);
+        // Read the header once; user mode may change it while we look at it.
+        uint32_t record_header = _ring_record_read_header_acquire(record);
+        if (_ring_header_locked(record_header)) {
+            // The producer published the offset before unlocking the record.
+            return EBPF_NO_MORE_KEYS;
+        }
+
+        size_t record_length = _ring_header_length(record_header);
+        size_t total_record_size = _ring_record_size(record_length);
+        if (total_record_size > available) {
+            EBPF_LOG_MESSAGE_UINT64(
+                EBPF_TRACELOG_LEVEL_ERROR,
+                EBPF_TRACELOG_KEYWORD_MAP,
+                "ebpf_ring_buffer_read_user_record: Invalid record length",
+                record_length);
+            return EBPF_INVALID_ARGUMENT;
+        }
+
+        if (_ring_header_discarded(record_header)) {
+            consumer_offset += total_record_size;
+            ebpf_ring_buffer_return_user_record(ring, consumer_offset);
+            continue;
+        }
+
+        // The data region is double mapped, so a record that wraps around the end of the ring is contiguous.
+        memcpy(buffer, record->data, min(record_length, buffer_size));
+        *length = record_length;
+        *next_offset = consumer_offset + total_record_size;
+        return (record_length > buffer_size) ? EBPF_INSUFFICIENT_BUFFER : EBPF_SUCCESS;
+    }
+    return EBPF_NO_MORE_KEYS;
+}
+
+void
+ebpf_ring_buffer_return_user_record(_Inout_ ebpf_ring_buffer_t* ring, size_t next_offset)
+{
+    ebpf_assert(next_offset - ring->kernel_page->user_record_consumer_offset <= _ring_get_length(ring));
+    ring->kernel_page->user_record_consumer_offset = next_offset;
+    // Publish the consumer offset so the producer can reuse the space.
+    _ring_write_consumer_offset_release(ring, next_offset);
+}
+
+bool
+ebpf_ring_buffer_user_record_pending(_In_ const ebpf_ring_buffer_t* ring)
+{
+    return _ring_read_producer_offset_acquire(ring) != ring->kernel_page->user_record_consumer_offset;
+}
+
 _Must_inspect_result_ _Ret_maybenull_ const ebpf_ring_buffer_record_t*
 ebpf_ring_buffer_next_consumer_record(
     _Inout_ ebpf_ring_buffer_t* ring_buffer, _When_(return != NULL, _Out_) size_t* next_offset)
@@ -25,6 +25,7 @@ typedef struct _ebpf_ring_buffer_kernel_page
 {
     PKEVENT wait_event;                      ///< Event to signal the producer thread.
     volatile size_t producer_reserve_offset; ///< Next record to be reserved.
+    size_t user_record_consumer_offset;      ///< Consumer offset when user mode is the producer (kernel-only copy).
 } ebpf_ring_buffer_kernel_page_t;
 
 static_assert(
@@ -225,6 +226,70 @@ ebpf_ring_buffer_map_user(
 _Must_inspect_result_ ebpf_result_t
 ebpf_ring_buffer_unmap_user(_In_ const ebpf_ring_buffer_t* ring_buffer);
 
+/**
+ * @brief Get user space pointers to a ring buffer whose producer is the calling process. The producer page and the
+ * data region are mapped writable, and the kernel consumes the records with ebpf_ring_buffer_read_user_record.
+ *
+ * @param[in] ring_buffer Ring buffer to query.
+ * @param[out] consumer Pointer to mapped consumer page.
+ * @param[out] producer Pointer to mapped producer page.
+ * @param[out] data Pointer to mapped data region.
+ * @retval EBPF_SUCCESS Successfully mapped the ring buffer.
+ * @retval EBPF_INVALID_ARGUMENT Unable to map the ring buffer.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_buffer_map_user_producer(
+    _In_ const ebpf_ring_buffer_t* ring_buffer,
+    _Outptr_ void** consumer,
+    _Outptr_ void** producer,
+    _Outptr_result_buffer_(*data_size) uint8_t** data,
+    _Out_ size_t* data_size);
+
+/**
+ * @brief Copy the next record produced by user mode out of the ring buffer, skipping any discarded records.
+ *
+ * The producer offset and the record headers are written by an untrusted producer, so they are validated against
+ * the consumer offset kept in the kernel page and the record is copied before use. The record is not consumed until
+ * the value returned in next_offset is passed to ebpf_ring_buffer_return_user_record. Only a single thread may
+ * consume user records at a time.
+ *
+ * @param[in, out] ring_buffer Ring buffer to read from.
+ * @param[out] buffer Buffer that receives the record data.
+ * @param[in] buffer_size Size of the buffer.
+ * @param[out] length Length of the record data.
+ * @param[out] next_offset Offset after the last byte of this record.
+ * @retval EBPF_SUCCESS The record was copied.
+ * @retval EBPF_INSUFFICIENT_BUFFER The record is larger than the buffer. The first buffer_size bytes were copied.
+ * @retval EBPF_NO_MORE_KEYS There are no more published records.
+ * @retval EBPF_INVALID_ARGUMENT The producer offset or a record header is corrupt.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_buffer_read_user_record(
+    _Inout_ ebpf_ring_buffer_t* ring_buffer,
+    _Out_writes_bytes_to_(buffer_size, *length) uint8_t* buffer,
+    size_t buffer_size,
+    _Out_ size_t* length,
+    _Out_ size_t* next_offset);
+
+/**
+ * @brief Return the space of records read with ebpf_ring_buffer_read_user_record to the user mode producer.
+ *
+ * @param[in, out] ring_buffer Ring buffer to update.
+ * @param[in] next_offset Offset returned by ebpf_ring_buffer_read_user_record.
+ */
+void
+ebpf_ring_buffer_return_user_record(_Inout_ ebpf_ring_buffer_t* ring_buffer, size_t next_offset);
+
+/**
+ * @brief Check if user mode has published records that have not been consumed yet.
+ *
+ * @param[in] ring_buffer Ring buffer to query.
+ * @retval true The producer offset is ahead of the kernel consumer offset.
+ * @retval false The ring is empty.
+ */
+bool
+ebpf_ring_buffer_user_record_pending(_In_ const ebpf_ring_buffer_t* ring_buffer);
+
 /**
  * @brief Get the next record in the ring buffer's data buffer, skipping any discarded records.
  *
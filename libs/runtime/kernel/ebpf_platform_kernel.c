@@ -219,9 +219,13 @@ ebpf_ring_descriptor_get_base_address(_In_ const ebpf_ring_descriptor_t* memory_
     return memory_descriptor->base_address;
 }
 
-_Must_inspect_result_ ebpf_result_t
-ebpf_ring_map_user(
-    _In_ ebpf_ring_descriptor_t* ring, _Outptr_ void** consumer, _Outptr_ void** producer, _Outptr_ uint8_t** data)
+static _Must_inspect_result_ ebpf_result_t
+_ebpf_ring_map_user(
+    _In_ ebpf_ring_descriptor_t* ring,
+    bool producer_writable,
+    _Outptr_ void** consumer,
+    _Outptr_ void** producer,
+    _Outptr_ uint8_t** data)
 {
     EBPF_LOG_ENTRY();
     ebpf_result_t result = EBPF_SUCCESS;
@@ -263,7 +267,12 @@ ebpf_ring_map_user(
     status = STATUS_SUCCESS;
     __try {
         *producer = MmMapLockedPagesSpecifyCache(
-            ring->user_mdl_producer, UserMode, MmCached, NULL, FALSE, NormalPagePriority | MdlMappingNoWrite);
+            ring->user_mdl_producer,
+            UserMode,
+            MmCached,
+            NULL,
+            FALSE,
+            producer_writable ? NormalPagePriority : (NormalPagePriority | MdlMappingNoWrite));
     } __except (EXCEPTION_EXECUTE_HANDLER) {
         status = GetExceptionCode();
         *producer = NULL;
@@ -292,6 +301,20 @@ Exit:
     EBPF_RETURN_RESULT(result);
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_map_user(
+    _In_ ebpf_ring_descriptor_t* ring, _Outptr_ void** consumer, _Outptr_ void** producer, _Outptr_ uint8_t** data)
+{
+    return _ebpf_ring_map_user(ring, false, consumer, producer, data);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_map_user_writable(
+    _In_ ebpf_ring_descriptor_t* ring, _Outptr_ void** consumer, _Outptr_ void** producer, _Outptr_ uint8_t** data)
+{
+    return _ebpf_ring_map_user(ring, true, consumer, producer, data);
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_ring_unmap_user(_In_ ebpf_ring_descriptor_t* ring)
 {
@@ -317,6 +340,39 @@ ebpf_ring_unmap_user(_In_ ebpf_ring_descriptor_t* ring)
     return EBPF_SUCCESS;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_memory_descriptor_map_user(_In_ MDL* memory_descriptor, bool writable, _Outptr_ void** address)
+{
+    EBPF_LOG_ENTRY();
+    NTSTATUS status = STATUS_SUCCESS;
+    unsigned long priority = NormalPagePriority | MdlMappingNoExecute;
+    if (!writable) {
+        priority |= MdlMappingNoWrite;
+    }
+
+    __try {
+        *address = MmMapLockedPagesSpecifyCache(memory_descriptor, UserMode, MmCached, NULL, FALSE, priority);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        status = GetExceptionCode();
+        *address = NULL;
+    }
+    if (!*address) {
+        if (NT_SUCCESS(status)) {
+            status = STATUS_NO_MEMORY;
+        }
+        EBPF_LOG_NTSTATUS_API_FAILURE(EBPF_TRACELOG_KEYWORD_BASE, MmMapLockedPagesSpecifyCache, status);
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+
+void
+ebpf_memory_descriptor_unmap_user(_In_ MDL* memory_descriptor, _In_ void* address)
+{
+    MmUnmapLockedPages(address, memory_descriptor);
+}
+
 // There isn't an official API to query this information from kernel.
 // Use NtQuerySystemInformation with struct + header from winternl.h.
 
@@ -415,6 +415,30 @@ TEST_CASE("hash_table_test", "[platform]")
     REQUIRE(ebpf_hash_table_iterate(table.get(), &cookie, &count, keys.data(), values.data()) == EBPF_NO_MORE_KEYS);
     REQUIRE(keys_found == 0x7);
 
+    // Iterate by position, resuming in the middle of the bucket.
+    size_t bucket = 0;
+    size_t slot = 0;
+    count = 2;
+    REQUIRE(
+        ebpf_hash_table_iterate_from_position(table.get(), &bucket, &slot, &count, keys.data(), values.data()) ==
+        EBPF_SUCCESS);
+    REQUIRE(count == 2);
+    REQUIRE(slot == 2);
+    const uint8_t* first_key = keys[0];
+    const uint8_t* second_key = keys[1];
+    count = 2;
+    REQUIRE(
+        ebpf_hash_table_iterate_from_position(table.get(), &bucket, &slot, &count, keys.data(), values.data()) ==
+        EBPF_SUCCESS);
+    REQUIRE(count == 1);
+    REQUIRE(keys[0] != first_key);
+    REQUIRE(keys[0] != second_key);
+    count = 2;
+    REQUIRE(
+        ebpf_hash_table_iterate_from_position(table.get(), &bucket, &slot, &count, keys.data(), values.data()) ==
+        EBPF_NO_MORE_KEYS);
+    REQUIRE(count == 0);
+
     // Find the first
     REQUIRE(ebpf_hash_table_find(table.get(), key_1.data(), &returned_value) == EBPF_SUCCESS);
     REQUIRE(memcmp(returned_value, data_1.data(), data_1.size()) == 0);
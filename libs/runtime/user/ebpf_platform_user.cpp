@@ -250,6 +250,14 @@ ebpf_ring_map_user(
     EBPF_RETURN_RESULT(EBPF_SUCCESS);
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_ring_map_user_writable(
+    _In_ ebpf_ring_descriptor_t* ring, _Outptr_ void** consumer, _Outptr_ void** producer, _Outptr_ uint8_t** data)
+{
+    // User mode shares a single view, so the writable mapping is the same as the read-only one.
+    return ebpf_ring_map_user(ring, consumer, producer, data);
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_ring_unmap_user(_In_ ebpf_ring_descriptor_t* ring)
 {
@@ -258,6 +266,26 @@ ebpf_ring_unmap_user(_In_ ebpf_ring_descriptor_t* ring)
     EBPF_RETURN_RESULT(EBPF_SUCCESS);
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_memory_descriptor_map_user(_In_ MDL* memory_descriptor, bool writable, _Outptr_ void** address)
+{
+    EBPF_LOG_ENTRY();
+    UNREFERENCED_PARAMETER(writable);
+    // User mode shares the address space with the caller, so the system mapping is returned as is.
+    *address = ebpf_memory_descriptor_get_base_address(memory_descriptor);
+    if (*address == nullptr) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+
+void
+ebpf_memory_descriptor_unmap_user(_In_ MDL* memory_descriptor, _In_ void* address)
+{
+    UNREFERENCED_PARAMETER(memory_descriptor);
+    UNREFERENCED_PARAMETER(address);
+}
+
 static uint32_t
 _ntstatus_to_win32_error_code(NTSTATUS status)
 {
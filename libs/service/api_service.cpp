@@ -18,6 +18,7 @@ extern "C"
 #include "ubpf.h"
 #endif
 }
+#include "verification_cache.h"
 #include "Verifier.h"
 #include "verifier_service.h"
 #include "windows_platform.hpp"
@@ -941,6 +942,28 @@ _initialize_test_signing_state()
     return EBPF_SUCCESS;
 }
 
+/**
+ * @brief Enable the verification cache if a directory for it is configured in the registry. This is best effort,
+ * programs are simply verified each time they are loaded otherwise.
+ */
+static void
+_initialize_verification_cache()
+{
+    ebpf_store_key_t parameters_key = nullptr;
+    wchar_t* directory = nullptr;
+    if (ebpf_open_registry_key(ebpf_store_hklm_root_key, EBPF_PARAMETERS_REGISTRY_PATH, KEY_READ, &parameters_key) !=
+        EBPF_SUCCESS) {
+        return;
+    }
+    if (ebpf_read_registry_value_string(parameters_key, EBPF_VERIFICATION_CACHE_DIRECTORY_REGISTRY_VALUE, &directory) ==
+            EBPF_SUCCESS &&
+        directory != nullptr) {
+        (void)ebpf_verification_cache_initialize(directory);
+    }
+    ebpf_free(directory);
+    ebpf_close_registry_key(parameters_key);
+}
+
 uint32_t
 ebpf_service_initialize() noexcept
 {
@@ -962,11 +985,14 @@ ebpf_service_initialize() noexcept
         }
     }
 
+    _initialize_verification_cache();
+
     return ERROR_SUCCESS;
 }
 
 void
 ebpf_service_cleanup() noexcept
 {
+    ebpf_verification_cache_cleanup();
     clean_up_async_device_handle();
 }
@@ -0,0 +1,627 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file
+ * This file implements a persistent cache of successful verifications. Each
+ * entry is a file named after the cache key, which contains the key, the map
+ * annotations produced by the verification, and an HMAC-SHA256 of the entry
+ * that is checked before the entry is used. The HMAC key is random and is
+ * stored in the cache directory protected with DPAPI for the identity of the
+ * service, so an entry can't be forged without running as the service. The
+ * directory itself is restricted to SYSTEM, Administrators and the identity
+ * of the service, who can load programs without verification in the first
+ * place.
+ */
+
+#include "api_common.hpp"
+#include "ebpf_utilities.h"
+#include "hash.h"
+#include "map_descriptors.hpp"
+#include "verification_cache.h"
+#include "windows_platform_common.hpp"
+
+#include <aclapi.h>
+#include <bcrypt.h>
+#include <deque>
+#include <dpapi.h>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sddl.h>
+#include <shared_mutex>
+#include <string>
+
+#pragma comment(lib, "advapi32.lib")
+#pragma comment(lib, "bcrypt.lib")
+#pragma comment(lib, "crypt32.lib")
+
+#define VERIFICATION_CACHE_ENTRY_MAGIC 'evce'
+
+// Must be incremented whenever the format of the key or of an entry changes.
+#define VERIFICATION_CACHE_ENTRY_VERSION 2
+
+#define VERIFICATION_CACHE_HASH_ALGORITHM "SHA256"
+#define VERIFICATION_CACHE_HASH_LENGTH 32
+
+// Entries are authenticated with an HMAC using VERIFICATION_CACHE_HASH_ALGORITHM, whose key is stored in this file.
+#define VERIFICATION_CACHE_MAC_KEY_FILE_NAME L"mac.key"
+#define VERIFICATION_CACHE_MAC_KEY_LENGTH 32
+
+// Only permit access from SYSTEM and SDDL_BUILTIN_ADMINISTRATORS, and don't inherit access from the parent. Access
+// for the current user is appended at runtime.
+#define VERIFICATION_CACHE_DIRECTORY_SDDL L"D:P(A;OICI;FA;;;SY)(A;OICI;FA;;;BA)"
+
+typedef struct _verification_cache_entry_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint8_t key[VERIFICATION_CACHE_HASH_LENGTH];
+    uint32_t annotation_count;
+    uint32_t payload_length; ///< Length of the annotation records that follow the header.
+} verification_cache_entry_header_t;
+
+typedef struct _verification_cache_annotation_record
+{
+    uint32_t instruction_offset;
+    int32_t helper_id;
+    uint32_t map_type;
+    uint32_t value_size;
+    uint32_t max_entries;
+    uint8_t is_inner_map_template;
+    uint8_t has_map_name;
+    uint16_t map_name_length; ///< Length of the map name that follows the record.
+} verification_cache_annotation_record_t;
+
+static std::shared_mutex _verification_cache_mutex;
+static std::filesystem::path _verification_cache_directory;
+static std::vector<uint8_t> _verifier_build_hash;
+static std::vector<uint8_t> _verification_cache_mac_key;
+
+static _Must_inspect_result_ ebpf_result_t
+_read_file(const std::filesystem::path& path, std::vector<uint8_t>& contents)
+{
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream) {
+        return EBPF_OBJECT_NOT_FOUND;
+    }
+    std::streamoff size = stream.tellg();
+    if (size < 0) {
+        return EBPF_FAILED;
+    }
+    contents.resize(static_cast<size_t>(size));
+    stream.seekg(0);
+    if (!stream.read(reinterpret_cast<char*>(contents.data()), contents.size())) {
+        return EBPF_FAILED;
+    }
+    return EBPF_SUCCESS;
+}
+
+/**
+ * @brief Write a file through a temporary file that is renamed, so that a concurrent reader never sees a partial
+ * file.
+ */
+static _Must_inspect_result_ ebpf_result_t
+_write_file(const std::filesystem::path& path, const std::vector<uint8_t>& contents)
+{
+    std::filesystem::path temporary_path = path;
+    temporary_path += L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+    {
+        std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!stream.write(reinterpret_cast<const char*>(contents.data()), contents.size())) {
+            stream.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return EBPF_FAILED;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::filesystem::remove(temporary_path, error);
+        return EBPF_FAILED;
+    }
+    return EBPF_SUCCESS;
+}
+
+/**
+ * @brief Hash the image that contains the verifier, so that entries written by another build of the verifier
+ * are never used.
+ */
+static _Must_inspect_result_ ebpf_result_t
+_get_verifier_build_hash(std::vector<uint8_t>& build_hash)
+{
+    HMODULE module = nullptr;
+    if (!GetModuleHandleExW(
+            GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            reinterpret_cast<LPCWSTR>(&_get_verifier_build_hash),
+            &module)) {
+        return win32_error_code_to_ebpf_result(GetLastError());
+    }
+
+    std::wstring module_path(MAX_PATH, L'\0');
+    for (;;) {
+        DWORD length = GetModuleFileNameW(module, module_path.data(), static_cast<DWORD>(module_path.size()));
+        if (length == 0) {
+            return win32_error_code_to_ebpf_result(GetLastError());
+        }
+        if (length < module_path.size()) {
+            module_path.resize(length);
+            break;
+        }
+        module_path.resize(module_path.size() * 2);
+    }
+
+    std::vector<uint8_t> image;
+    ebpf_result_t result = _read_file(module_path, image);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
+    hash_t hash(VERIFICATION_CACHE_HASH_ALGORITHM);
+    build_hash = hash.hash_byte_ranges({{image.data(), image.size()}});
+    return EBPF_SUCCESS;
+}
+
+static _Must_inspect_result_ ebpf_result_t
+_get_current_user_sid(std::vector<uint8_t>& sid)
+{
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) {
+        return win32_error_code_to_ebpf_result(GetLastError());
+    }
+
+    DWORD length = 0;
+    (void)GetTokenInformation(token, TokenUser, nullptr, 0, &length);
+    std::vector<uint8_t> token_user(length);
+    if (length == 0 || !GetTokenInformation(token, TokenUser, token_user.data(), length, &length)) {
+        DWORD error = GetLastError();
+        CloseHandle(token);
+        return win32_error_code_to_ebpf_result(error);
+    }
+    CloseHandle(token);
+
+    PSID user_sid = reinterpret_cast<TOKEN_USER*>(token_user.data())->User.Sid;
+    const uint8_t* user_sid_bytes = reinterpret_cast<const uint8_t*>(user_sid);
+    sid.assign(user_sid_bytes, user_sid_bytes + GetLengthSid(user_sid));
+    return EBPF_SUCCESS;
+}
+
+/**
+ * @brief Restrict an existing cache directory to SYSTEM, Administrators and the current user. The directory is only
+ * used if it is owned by one of them, as the owner can always change its ACL. Its ACL is replaced rather than
+ * checked, since any ACE granting write access to someone else would let them plant entries.
+ */
+static _Must_inspect_result_ ebpf_result_t
+_secure_existing_cache_directory(
+    const std::filesystem::path& directory,
+    const std::vector<uint8_t>& user_sid,
+    _In_ PSECURITY_DESCRIPTOR security_descriptor)
+{
+    PSID owner = nullptr;
+    PSECURITY_DESCRIPTOR owner_security_descriptor = nullptr;
+    DWORD error = GetNamedSecurityInfoW(
+        directory.c_str(),
+        SE_FILE_OBJECT,
+        OWNER_SECURITY_INFORMATION,
+        &owner,
+        nullptr,
+        nullptr,
+        nullptr,
+        &owner_security_descriptor);
+    if (error != ERROR_SUCCESS) {
+        return win32_error_code_to_ebpf_result(error);
+    }
+    bool trusted = EqualSid(owner, reinterpret_cast<PSID>(const_cast<uint8_t*>(user_sid.data()))) ||
+                   IsWellKnownSid(owner, WinLocalSystemSid) || IsWellKnownSid(owner, WinBuiltinAdministratorsSid);
+    LocalFree(owner_security_descriptor);
+    if (!trusted) {
+        return EBPF_ACCESS_DENIED;
+    }
+
+    BOOL dacl_present = FALSE;
+    BOOL dacl_defaulted = FALSE;
+    PACL dacl = nullptr;
+    if (!GetSecurityDescriptorDacl(security_descriptor, &dacl_present, &dacl, &dacl_defaulted)) {
+        return win32_error_code_to_ebpf_result(GetLastError());
+    }
+    // PROTECTED_DACL_SECURITY_INFORMATION drops any ACEs inherited from the parent directory.
+    error = SetNamedSecurityInfoW(
+        const_cast<wchar_t*>(directory.c_str()),
+        SE_FILE_OBJECT,
+        DACL_SECURITY_INFORMATION | PROTECTED_DACL_SECURITY_INFORMATION,
+        nullptr,
+        nullptr,
+        dacl,
+        nullptr);
+    return win32_error_code_to_ebpf_result(error);
+}
+
+/**
+ * @brief Create the cache directory, accessible only to SYSTEM, Administrators and the current user, or restrict an
+ * existing one in the same way.
+ */
+static _Must_inspect_result_ ebpf_result_t
+_open_cache_directory(const std::filesystem::path& directory)
+{
+    std::vector<uint8_t> user_sid;
+    ebpf_result_t result = _get_current_user_sid(user_sid);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
+    wchar_t* user_sid_string = nullptr;
+    if (!ConvertSidToStringSidW(reinterpret_cast<PSID>(user_sid.data()), &user_sid_string)) {
+        return win32_error_code_to_ebpf_result(GetLastError());
+    }
+    std::wstring sddl = VERIFICATION_CACHE_DIRECTORY_SDDL L"(A;OICI;FA;;;" + std::wstring(user_sid_string) + L")";
+    LocalFree(user_sid_string);
+
+    PSECURITY_DESCRIPTOR security_descriptor = nullptr;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(
+            sddl.c_str(), SDDL_REVISION_1, &security_descriptor, nullptr)) {
+        return win32_error_code_to_ebpf_result(GetLastError());
+    }
+    SECURITY_ATTRIBUTES attributes = {sizeof(attributes), security_descriptor, FALSE};
+    if (!CreateDirectoryW(directory.c_str(), &attributes)) {
+        DWORD error = GetLastError();
+        if (error == ERROR_ALREADY_EXISTS) {
+            result = _secure_existing_cache_directory(directory, user_sid, security_descriptor);
+        } else {
+            result = win32_error_code_to_ebpf_result(error);
+        }
+    }
+    LocalFree(security_descriptor);
+    return result;
+}
+
+/**
+ * @brief Load the key used to authenticate cache entries, or create one if the directory has no key that the current
+ * identity can unprotect. Replacing the key invalidates all existing entries.
+ */
+static _Must_inspect_result_ ebpf_result_t
+_load_mac_key(const std::filesystem::path& directory, std::vector<uint8_t>& mac_key)
+{
+    std::filesystem::path path = directory / VERIFICATION_CACHE_MAC_KEY_FILE_NAME;
+    std::vector<uint8_t> protected_key;
+    if (_read_file(path, protected_key) == EBPF_SUCCESS && protected_key.size() <= MAXDWORD) {
+        DATA_BLOB input = {static_cast<DWORD>(protected_key.size()), protected_key.data()};
+        DATA_BLOB output = {};
+        if (CryptUnprotectData(&input, nullptr, nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+            bool valid = (output.cbData == VERIFICATION_CACHE_MAC_KEY_LENGTH);
+            if (valid) {
+                mac_key.assign(output.pbData, output.pbData + output.cbData);
+            }
+            SecureZeroMemory(output.pbData, output.cbData);
+            LocalFree(output.pbData);
+            if (valid) {
+                return EBPF_SUCCESS;
+            }
+        }
+    }
+
+    mac_key.resize(VERIFICATION_CACHE_MAC_KEY_LENGTH);
+    if (!BCRYPT_SUCCESS(BCryptGenRandom(
+            nullptr, mac_key.data(), static_cast<ULONG>(mac_key.size()), BCRYPT_USE_SYSTEM_PREFERRED_RNG))) {
+        return EBPF_FAILED;
+    }
+
+    // Protect the key for the current identity rather than the machine, so that other local users can't read it.
+    DATA_BLOB input = {static_cast<DWORD>(mac_key.size()), mac_key.data()};
+    DATA_BLOB output = {};
+    if (!CryptProtectData(
+            &input, L"eBPF verification cache", nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        return win32_error_code_to_ebpf_result(GetLastError());
+    }
+    protected_key.assign(output.pbData, output.pbData + output.cbData);
+    LocalFree(output.pbData);
+    return _write_file(path, protected_key);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_verification_cache_initialize(_In_opt_z_ const wchar_t* directory) noexcept
+{
+    try {
+        if (directory == nullptr) {
+            ebpf_verification_cache_cleanup();
+            return EBPF_SUCCESS;
+        }
+
+        std::vector<uint8_t> build_hash;
+        ebpf_result_t result = _get_verifier_build_hash(build_hash);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+
+        std::filesystem::path path(directory);
+        result = _open_cache_directory(path);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+
+        std::vector<uint8_t> mac_key;
+        result = _load_mac_key(path, mac_key);
+        if (result != EBPF_SUCCESS) {
+            return result;
+        }
+
+        std::unique_lock lock(_verification_cache_mutex);
+        _verification_cache_directory = std::move(path);
+        _verifier_build_hash = std::move(build_hash);
+        _verification_cache_mac_key = std::move(mac_key);
+        return EBPF_SUCCESS;
+    } catch (const std::bad_alloc&) {
+        return EBPF_NO_MEMORY;
+    } catch (const std::exception&) {
+        return EBPF_FAILED;
+    }
+}
+
+void
+ebpf_verification_cache_cleanup() noexcept
+{
+    std::unique_lock lock(_verification_cache_mutex);
+    _verification_cache_directory.clear();
+    _verifier_build_hash.clear();
+    SecureZeroMemory(_verification_cache_mac_key.data(), _verification_cache_mac_key.size());
+    _verification_cache_mac_key.clear();
+}
+
+static std::filesystem::path
+_get_entry_path(const std::vector<uint8_t>& key, std::vector<uint8_t>& mac_key)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    std::string file_name;
+    for (uint8_t byte : key) {
+        file_name.push_back(hex_digits[byte >> 4]);
+        file_name.push_back(hex_digits[byte & 0xf]);
+    }
+    file_name += ".entry";
+
+    std::shared_lock lock(_verification_cache_mutex);
+    if (_verification_cache_directory.empty()) {
+        return {};
+    }
+    mac_key = _verification_cache_mac_key;
+    return _verification_cache_directory / file_name;
+}
+
+// Compare MACs in constant time, so that the time taken doesn't reveal how much of a forged MAC is correct.
+static bool
+_mac_equal(_In_reads_(length) const uint8_t* first, _In_reads_(length) const uint8_t* second, size_t length)
+{
+    uint8_t difference = 0;
+    for (size_t index = 0; index < length; index++) {
+        difference |= first[index] ^ second[index];
+    }
+    return difference == 0;
+}
+
+template <typename T>
+static void
+_append_bytes(std::vector<uint8_t>& buffer, const T& value)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+}
+
+static void
+_append_bytes(std::vector<uint8_t>& buffer, _In_opt_z_ const char* string)
+{
+    // Strings are length prefixed, so that consecutive strings can't be confused with each other.
+    size_t length = (string != nullptr) ? strlen(string) : 0;
+    _append_bytes(buffer, length);
+    buffer.insert(buffer.end(), string, string + length);
+}
+
+static void
+_append_bytes(std::vector<uint8_t>& buffer, _In_ const ebpf_helper_function_prototype_t& prototype)
+{
+    _append_bytes(buffer, prototype.helper_id);
+    _append_bytes(buffer, prototype.name);
+    _append_bytes(buffer, prototype.return_type);
+    for (size_t argument = 0; argument < _countof(prototype.arguments); argument++) {
+        _append_bytes(buffer, prototype.arguments[argument]);
+    }
+    _append_bytes(buffer, static_cast<uint8_t>(prototype.flags.reallocate_packet));
+    _append_bytes(buffer, static_cast<uint8_t>(prototype.implicit_context));
+}
+
+bool
+verification_cache_get_key(
+    _In_ const GUID* program_type,
+    _In_reads_(instruction_count) const ebpf_inst* instructions,
+    uint32_t instruction_count,
+    std::vector<uint8_t>& key)
+{
+    try {
+        key.clear();
+        std::vector<uint8_t> material;
+        {
+            std::shared_lock lock(_verification_cache_mutex);
+            if (_verification_cache_directory.empty()) {
+                return false;
+            }
+            _append_bytes(material, static_cast<uint32_t>(VERIFICATION_CACHE_ENTRY_VERSION));
+            material.insert(material.end(), _verifier_build_hash.begin(), _verifier_build_hash.end());
+        }
+
+        // Program type information, including the prototypes of all helpers the program could call.
+        const prevail::EbpfProgramType* type = get_program_type_windows(*program_type);
+        const ebpf_program_info_t* program_info = nullptr;
+        if (type == nullptr || get_program_type_info(*type, &program_info) != EBPF_SUCCESS) {
+            return false;
+        }
+        const ebpf_program_type_descriptor_t* descriptor = program_info->program_type_descriptor;
+        _append_bytes(material, *program_type);
+        _append_bytes(material, descriptor->name);
+        _append_bytes(material, *descriptor->context_descriptor);
+        _append_bytes(material, descriptor->program_type);
+        _append_bytes(material, descriptor->bpf_prog_type);
+        _append_bytes(material, descriptor->is_privileged);
+        _append_bytes(material, program_info->count_of_program_type_specific_helpers);
+        for (uint32_t index = 0; index < program_info->count_of_program_type_specific_helpers; index++) {
+            _append_bytes(material, program_info->program_type_specific_helper_prototype[index]);
+        }
+        _append_bytes(material, program_info->count_of_global_helpers);
+        for (uint32_t index = 0; index < program_info->count_of_global_helpers; index++) {
+            _append_bytes(material, program_info->global_helper_prototype[index]);
+        }
+
+        // Definitions of the maps the program refers to.
+        const std::vector<map_cache_t>& maps = get_all_map_descriptors();
+        _append_bytes(material, maps.size());
+        for (const map_cache_t& map : maps) {
+            const prevail::EbpfMapDescriptor& map_descriptor = map.verifier_map_descriptor;
+            _append_bytes(material, map_descriptor.original_fd);
+            _append_bytes(material, map_descriptor.type);
+            _append_bytes(material, map_descriptor.key_size);
+            _append_bytes(material, map_descriptor.value_size);
+            _append_bytes(material, map_descriptor.max_entries);
+            _append_bytes(material, map_descriptor.inner_map_fd);
+            _append_bytes(material, map_descriptor.name.c_str());
+            _append_bytes(material, static_cast<uint8_t>(map_descriptor.is_inner_map_template));
+        }
+
+        _append_bytes(material, instruction_count);
+        const uint8_t* instruction_bytes = reinterpret_cast<const uint8_t*>(instructions);
+        material.insert(material.end(), instruction_bytes, instruction_bytes + instruction_count * sizeof(ebpf_inst));
+
+        hash_t hash(VERIFICATION_CACHE_HASH_ALGORITHM);
+        key = hash.hash_byte_ranges({{material.data(), material.size()}});
+        return key.size() == VERIFICATION_CACHE_HASH_LENGTH;
+    } catch (const std::exception&) {
+        key.clear();
+        return false;
+    }
+}
+
+bool
+verification_cache_lookup(const std::vector<uint8_t>& key)
+{
+    try {
+        std::vector<uint8_t> mac_key;
+        std::filesystem::path path = _get_entry_path(key, mac_key);
+        if (path.empty()) {
+            return false;
+        }
+
+        std::vector<uint8_t> entry;
+        if (_read_file(path, entry) != EBPF_SUCCESS ||
+            entry.size() < sizeof(verification_cache_entry_header_t) + VERIFICATION_CACHE_HASH_LENGTH) {
+            return false;
+        }
+
+        // Authenticate the entry before parsing any of it.
+        size_t signed_length = entry.size() - VERIFICATION_CACHE_HASH_LENGTH;
+        hash_t mac(VERIFICATION_CACHE_HASH_ALGORITHM, mac_key);
+        std::vector<uint8_t> entry_mac = mac.hash_byte_ranges({{entry.data(), signed_length}});
+        if (entry_mac.size() != VERIFICATION_CACHE_HASH_LENGTH ||
+            !_mac_equal(entry_mac.data(), entry.data() + signed_length, VERIFICATION_CACHE_HASH_LENGTH)) {
+            return false;
+        }
+
+        verification_cache_entry_header_t header;
+        memcpy(&header, entry.data(), sizeof(header));
+        if (header.magic != VERIFICATION_CACHE_ENTRY_MAGIC || header.version != VERIFICATION_CACHE_ENTRY_VERSION ||
+            memcmp(header.key, key.data(), sizeof(header.key)) != 0 ||
+            header.payload_length != signed_length - sizeof(header)) {
+            return false;
+        }
+
+        std::vector<ebpf_verifier_map_info_t> annotations;
+        std::deque<std::string> map_names;
+        size_t offset = sizeof(header);
+        for (uint32_t index = 0; index < header.annotation_count; index++) {
+            verification_cache_annotation_record_t record;
+            if (signed_length - offset < sizeof(record)) {
+                return false;
+            }
+            memcpy(&record, entry.data() + offset, sizeof(record));
+            offset += sizeof(record);
+            if (signed_length - offset < record.map_name_length) {
+                return false;
+            }
+
+            ebpf_verifier_map_info_t annotation = {};
+            annotation.instruction_offset = record.instruction_offset;
+            annotation.helper_id = record.helper_id;
+            annotation.map_type = record.map_type;
+            annotation.value_size = record.value_size;
+            annotation.max_entries = record.max_entries;
+            annotation.is_inner_map_template = record.is_inner_map_template != 0;
+            if (record.has_map_name) {
+                map_names.emplace_back(reinterpret_cast<const char*>(entry.data() + offset), record.map_name_length);
+                annotation.map_name = map_names.back().c_str();
+            }
+            offset += record.map_name_length;
+            annotations.push_back(annotation);
+        }
+        if (offset != signed_length) {
+            return false;
+        }
+
+        set_map_annotations(annotations);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+void
+verification_cache_store(const std::vector<uint8_t>& key)
+{
+    try {
+        std::vector<uint8_t> mac_key;
+        std::filesystem::path path = _get_entry_path(key, mac_key);
+        if (path.empty() || key.size() != VERIFICATION_CACHE_HASH_LENGTH) {
+            return;
+        }
+
+        const ebpf_verifier_map_info_t* annotations = nullptr;
+        size_t annotation_count = 0;
+        if (ebpf_get_map_annotations_from_verifier(&annotations, &annotation_count) != EBPF_SUCCESS ||
+            annotation_count > UINT32_MAX) {
+            return;
+        }
+
+        std::vector<uint8_t> entry(sizeof(verification_cache_entry_header_t));
+        for (size_t index = 0; index < annotation_count; index++) {
+            const ebpf_verifier_map_info_t& annotation = annotations[index];
+            size_t map_name_length = (annotation.map_name != nullptr) ? strlen(annotation.map_name) : 0;
+            if (map_name_length > UINT16_MAX) {
+                return;
+            }
+            verification_cache_annotation_record_t record = {};
+            record.instruction_offset = annotation.instruction_offset;
+            record.helper_id = annotation.helper_id;
+            record.map_type = annotation.map_type;
+            record.value_size = annotation.value_size;
+            record.max_entries = annotation.max_entries;
+            record.is_inner_map_template = annotation.is_inner_map_template;
+            record.has_map_name = (annotation.map_name != nullptr);
+            record.map_name_length = static_cast<uint16_t>(map_name_length);
+            _append_bytes(entry, record);
+            entry.insert(entry.end(), annotation.map_name, annotation.map_name + map_name_length);
+        }
+        if (entry.size() - sizeof(verification_cache_entry_header_t) > UINT32_MAX) {
+            return;
+        }
+
+        verification_cache_entry_header_t header = {};
+        header.magic = VERIFICATION_CACHE_ENTRY_MAGIC;
+        header.version = VERIFICATION_CACHE_ENTRY_VERSION;
+        memcpy(header.key, key.data(), sizeof(header.key));
+        header.annotation_count = static_cast<uint32_t>(annotation_count);
+        header.payload_length = static_cast<uint32_t>(entry.size() - sizeof(header));
+        memcpy(entry.data(), &header, sizeof(header));
+
+        hash_t mac(VERIFICATION_CACHE_HASH_ALGORITHM, mac_key);
+        std::vector<uint8_t> entry_mac = mac.hash_byte_ranges({{entry.data(), entry.size()}});
+        entry.insert(entry.end(), entry_mac.begin(), entry_mac.end());
+
+        (void)_write_file(path, entry);
+    } catch (const std::exception&) {
+        // The program is simply verified again next time.
+    }
+}
@@ -0,0 +1,69 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "platform.hpp"
+
+#include <vector>
+
+/**
+ * @brief Enable the persistent verification cache. Each successful verification is recorded in a file in the
+ * cache directory, so that verifying a byte-identical program against the same program information and map
+ * definitions can be skipped, including after the service restarts.
+ *
+ * @param[in] directory Directory to store cache entries in. If it doesn't exist, it is created with an ACL that
+ * only grants access to SYSTEM, Administrators and the current user. An existing directory must be owned by one of
+ * them, and its ACL is replaced with the same ACL. Entries are authenticated with a key stored in the directory,
+ * protected with DPAPI for the current user. NULL disables the cache.
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_NO_MEMORY Out of memory.
+ * @retval EBPF_ACCESS_DENIED The directory is owned by someone else.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_verification_cache_initialize(_In_opt_z_ const wchar_t* directory) noexcept;
+
+/**
+ * @brief Disable the persistent verification cache. Entries already on disk are kept.
+ */
+void
+ebpf_verification_cache_cleanup() noexcept;
+
+/**
+ * @brief Compute the cache key of a program. The key is a SHA256 hash of the build of the verifier, the
+ * instructions, the program type information including all helper prototypes, and the map descriptors cached for
+ * the current verification.
+ *
+ * @param[in] program_type Program type of the program.
+ * @param[in] instructions Instructions of the program.
+ * @param[in] instruction_count Number of instructions.
+ * @param[out] key Cache key of the program.
+ * @retval true The key was computed.
+ * @retval false The cache is disabled or the program can't be cached.
+ */
+bool
+verification_cache_get_key(
+    _In_ const GUID* program_type,
+    _In_reads_(instruction_count) const ebpf_inst* instructions,
+    uint32_t instruction_count,
+    std::vector<uint8_t>& key);
+
+/**
+ * @brief Look up a successful verification in the cache. On a hit the map annotations produced by that
+ * verification are restored, so that ebpf_get_map_annotations_from_verifier returns them.
+ *
+ * @param[in] key Cache key of the program.
+ * @retval true The program passed verification before.
+ * @retval false No valid entry exists for the key.
+ */
+bool
+verification_cache_lookup(const std::vector<uint8_t>& key);
+
+/**
+ * @brief Record that the program with the given key passed verification, along with the map annotations of the
+ * verification. Failures to write the entry are ignored, so the program is simply verified again next time.
+ *
+ * @param[in] key Cache key of the program.
+ */
+void
+verification_cache_store(const std::vector<uint8_t>& key);
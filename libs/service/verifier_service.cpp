@@ -7,6 +7,7 @@
 #include "ebpf_shared_framework.h"
 #include "ebpf_verifier_wrapper.hpp"
 #include "platform.hpp"
+#include "verification_cache.h"
 #include "windows_platform_service.hpp"
 
 #include <filesystem>
@@ -67,7 +68,19 @@ verify_byte_code(
         return EBPF_VERIFICATION_FAILED;
     }
 
+    // A program that passed verification before, against the same program information and maps, is not
+    // verified again.
+    std::vector<uint8_t> cache_key;
+    bool cacheable = verification_cache_get_key(program_type, instruction_array, instruction_count, cache_key);
+    if (cacheable && verification_cache_lookup(cache_key)) {
+        return EBPF_SUCCESS;
+    }
+
     prevail::RawProgram raw_prog{file, section, 0, {}, instructions, info};
 
-    return _analyze(raw_prog, error_message, error_message_size);
+    ebpf_result_t result = _analyze(raw_prog, error_message, error_message_size);
+    if (result == EBPF_SUCCESS && cacheable) {
+        verification_cache_store(cache_key);
+    }
+    return result;
 }
@@ -30,6 +30,7 @@ CXPLAT_EXTERN_C_BEGIN
 
 #define EBPF_PARAMETERS_REGISTRY_PATH L"Software\\eBPF\\Parameters"
 #define EBPF_PROOF_OF_VERIFICATION_REGISTRY_VALUE L"ProofOfVerification"
+#define EBPF_VERIFICATION_CACHE_DIRECTORY_REGISTRY_VALUE L"VerificationCacheDirectory"
 
 #define ebpf_assert_assume(x) \
     ebpf_assert(x);           \
@@ -53,6 +54,8 @@ typedef enum _ebpf_pool_tag
     EBPF_POOL_TAG_EPOCH = 'cpee',
     EBPF_POOL_TAG_LINK = 'knle',
     EBPF_POOL_TAG_MAP = 'pame',
+    EBPF_POOL_TAG_MAP_CURSOR = 'cmpe',
+    EBPF_POOL_TAG_MAP_QUEUE = 'qmpe',
     EBPF_POOL_TAG_NATIVE = 'vtne',
     EBPF_POOL_TAG_PINNING = 'nipe',
     EBPF_POOL_TAG_PROGRAM = 'grpe',
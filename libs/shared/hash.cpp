@@ -13,13 +13,21 @@
 
 #pragma comment(lib, "Bcrypt.lib")
 
-_hash::_hash(const std::string& algorithm)
+_hash::_hash(const std::string& algorithm) { open_algorithm_provider(algorithm, BCRYPT_HASH_REUSABLE_FLAG); }
+
+_hash::_hash(const std::string& algorithm, const std::vector<uint8_t>& key) : hmac_key(key)
+{
+    open_algorithm_provider(algorithm, BCRYPT_HASH_REUSABLE_FLAG | BCRYPT_ALG_HANDLE_HMAC_FLAG);
+}
+
+void
+_hash::open_algorithm_provider(const std::string& algorithm, unsigned long flags)
 {
     HRESULT hr;
     std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> converter;
     std::wstring wide_algorithm = converter.from_bytes(algorithm);
 
-    hr = BCryptOpenAlgorithmProvider(&algorithm_handle, wide_algorithm.c_str(), nullptr, BCRYPT_HASH_REUSABLE_FLAG);
+    hr = BCryptOpenAlgorithmProvider(&algorithm_handle, wide_algorithm.c_str(), nullptr, flags);
     if (!SUCCEEDED(hr)) {
         throw std::runtime_error(
             std::string("BCryptOpenAlgorithmProvider failed with algorithm: ") + algorithm +
@@ -43,7 +51,14 @@ _hash::hash_byte_ranges(const byte_range_t& byte_ranges)
     std::vector<uint8_t> hash;
     BCRYPT_HASH_HANDLE hash_handle;
     HRESULT hr;
-    hr = BCryptCreateHash(algorithm_handle, &hash_handle, nullptr, 0, nullptr, 0, 0);
+    hr = BCryptCreateHash(
+        algorithm_handle,
+        &hash_handle,
+        nullptr,
+        0,
+        hmac_key.empty() ? nullptr : hmac_key.data(),
+        static_cast<unsigned long>(hmac_key.size()),
+        0);
     if (!SUCCEEDED(hr)) {
         throw std::runtime_error(std::string("BCryptCreateHash failed with HR=") + std::to_string(hr));
     }
@@ -25,6 +25,10 @@ typedef class _hash
         }
     };
     _hash(const std::string& algorithm);
+    /**
+     * @brief Compute a keyed hash (HMAC) with the given algorithm.
+     */
+    _hash(const std::string& algorithm, const std::vector<uint8_t>& key);
     ~_hash();
 
     std::vector<uint8_t>
@@ -34,5 +38,9 @@ typedef class _hash
     hash_byte_ranges(const byte_range_t& byte_ranges);
 
   private:
+    void
+    open_algorithm_provider(const std::string& algorithm, unsigned long flags);
+
     void* algorithm_handle;
+    std::vector<uint8_t> hmac_key;
 } hash_t;
@@ -51,9 +51,32 @@ static net_ebpf_ext_sublayer_info_t _net_ebpf_ext_sublayers[] = {
 // Global object used to store state for cleanup.
 static net_ebpf_extension_wfp_cleanup_state_t _net_ebpf_ext_wfp_cleanup_state = {0};
 
+/**
+ * @brief Per-CPU counts of the epochs entered and exited on each of the two reader counters. A thread may exit an
+ * epoch on a different CPU than it entered it on, so only the sums over all CPUs are meaningful.
+ */
+__declspec(align(EBPF_CACHE_LINE_SIZE)) typedef struct _net_ebpf_ext_epoch_cpu_entry
+{
+    volatile LONG64 enter_count[2];
+    volatile LONG64 exit_count[2];
+} net_ebpf_ext_epoch_cpu_entry_t;
+
+static net_ebpf_ext_epoch_cpu_entry_t* _net_ebpf_ext_epoch_cpu_entries = NULL;
+static uint32_t _net_ebpf_ext_epoch_cpu_count = 0;
+// Reader counter that new epochs are entered on. Flipped by _net_ebpf_ext_epoch_synchronize.
+static volatile long _net_ebpf_ext_epoch_index = 0;
+// Serializes _net_ebpf_ext_epoch_synchronize.
+static EX_PUSH_LOCK _net_ebpf_ext_epoch_synchronize_lock;
+
 static void
 _net_ebpf_ext_flow_delete(uint16_t layer_id, uint32_t callout_id, uint64_t flow_context);
 
+static NTSTATUS
+_net_ebpf_ext_epoch_initialize();
+
+static void
+_net_ebpf_ext_epoch_uninitialize();
+
 NTSTATUS
 net_ebpf_ext_filter_change_notify(
     FWPS_CALLOUT_NOTIFY_TYPE callout_notification_type, _In_ const GUID* filter_key, _Inout_ FWPS_FILTER* filter);
@@ -733,6 +756,20 @@ net_ebpf_extension_initialize_wfp_components(_Inout_ void* device_object)
     InitializeListHead(&_net_ebpf_ext_wfp_cleanup_state.filter_cleanup_list);
     KeInitializeEvent(&_net_ebpf_ext_wfp_cleanup_state.wfp_filter_cleanup_event, NotificationEvent, FALSE);
 
+    // Failing to allocate the flow context cache is not fatal, as flow contexts are then allocated from the pool.
+    (void)net_ebpf_ext_sock_ops_initialize_flow_context_cache();
+
+    // Classify callouts read client snapshots within an epoch, so the epoch must outlive the callouts.
+    status = _net_ebpf_ext_epoch_initialize();
+    if (!NT_SUCCESS(status)) {
+        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+            EBPF_EXT_TRACELOG_LEVEL_ERROR,
+            EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
+            "_net_ebpf_ext_epoch_initialize failed.",
+            status);
+        goto Exit;
+    }
+
     status = FwpmEngineOpen(NULL, RPC_C_AUTHN_WINNT, NULL, NULL, &_fwp_engine_handle);
     EBPF_EXT_BAIL_ON_API_FAILURE_STATUS(EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, "FwpmEngineOpen", status);
     is_engine_opened = TRUE;
@@ -796,6 +833,9 @@ Exit:
 
         if (is_engine_opened) {
             net_ebpf_extension_uninitialize_wfp_components();
+        } else {
+            net_ebpf_ext_sock_ops_uninitialize_flow_context_cache();
+            _net_ebpf_ext_epoch_uninitialize();
         }
     }
 
@@ -966,6 +1006,10 @@ net_ebpf_extension_uninitialize_wfp_components(void)
 
     ExReleaseSpinLockExclusive(&_net_ebpf_ext_wfp_cleanup_state.lock, old_irql);
 
+    // The callouts are unregistered, so no more flow contexts can be freed and no more epochs can be entered.
+    net_ebpf_ext_sock_ops_uninitialize_flow_context_cache();
+    _net_ebpf_ext_epoch_uninitialize();
+
     EBPF_EXT_LOG_EXIT();
 }
 
@@ -1083,12 +1127,258 @@ net_ebpf_ext_unregister_providers()
     EBPF_EXT_LOG_EXIT();
 }
 
+static NTSTATUS
+_net_ebpf_ext_epoch_initialize()
+{
+    _net_ebpf_ext_epoch_cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    _net_ebpf_ext_epoch_cpu_entries = (net_ebpf_ext_epoch_cpu_entry_t*)ExAllocatePoolUninitialized(
+        NonPagedPoolNx,
+        sizeof(net_ebpf_ext_epoch_cpu_entry_t) * _net_ebpf_ext_epoch_cpu_count,
+        NET_EBPF_EXTENSION_POOL_TAG);
+    if (_net_ebpf_ext_epoch_cpu_entries == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    memset(_net_ebpf_ext_epoch_cpu_entries, 0, sizeof(net_ebpf_ext_epoch_cpu_entry_t) * _net_ebpf_ext_epoch_cpu_count);
+    _net_ebpf_ext_epoch_index = 0;
+    ExInitializePushLock(&_net_ebpf_ext_epoch_synchronize_lock);
+    return STATUS_SUCCESS;
+}
+
+static void
+_net_ebpf_ext_epoch_uninitialize()
+{
+    if (_net_ebpf_ext_epoch_cpu_entries != NULL) {
+        ExFreePool(_net_ebpf_ext_epoch_cpu_entries);
+        _net_ebpf_ext_epoch_cpu_entries = NULL;
+    }
+}
+
+static inline net_ebpf_ext_epoch_cpu_entry_t*
+_net_ebpf_ext_epoch_get_cpu_entry()
+{
+    return &_net_ebpf_ext_epoch_cpu_entries[KeGetCurrentProcessorNumberEx(NULL) % _net_ebpf_ext_epoch_cpu_count];
+}
+
+void
+net_ebpf_ext_epoch_enter(_Out_ net_ebpf_ext_epoch_state_t* epoch_state)
+{
+    epoch_state->index = (uint32_t)ReadAcquire(&_net_ebpf_ext_epoch_index) & 1;
+    // The interlocked increment is a full barrier, so pointers read within the epoch are read after it is counted.
+    // It is interlocked because a DPC may enter an epoch on the same CPU.
+    InterlockedIncrement64(&_net_ebpf_ext_epoch_get_cpu_entry()->enter_count[epoch_state->index]);
+}
+
+void
+net_ebpf_ext_epoch_exit(_In_ const net_ebpf_ext_epoch_state_t* epoch_state)
+{
+    InterlockedIncrement64(&_net_ebpf_ext_epoch_get_cpu_entry()->exit_count[epoch_state->index]);
+}
+
+/**
+ * @brief Wait until every epoch entered on a reader counter has been exited.
+ *
+ * @param[in] index Reader counter to wait for.
+ */
+static void
+_net_ebpf_ext_epoch_wait_for_readers(uint32_t index)
+{
+    LARGE_INTEGER interval;
+    interval.QuadPart = -10 * 1000; // 1 ms.
+
+    for (;;) {
+        LONG64 exit_count = 0;
+        LONG64 enter_count = 0;
+        // Exits are summed before entries, so an epoch whose exit is counted also has its entry counted.
+        for (uint32_t cpu = 0; cpu < _net_ebpf_ext_epoch_cpu_count; cpu++) {
+            exit_count += ReadAcquire64(&_net_ebpf_ext_epoch_cpu_entries[cpu].exit_count[index]);
+        }
+        MemoryBarrier();
+        for (uint32_t cpu = 0; cpu < _net_ebpf_ext_epoch_cpu_count; cpu++) {
+            enter_count += ReadAcquire64(&_net_ebpf_ext_epoch_cpu_entries[cpu].enter_count[index]);
+        }
+        if (enter_count == exit_count) {
+            break;
+        }
+        KeDelayExecutionThread(KernelMode, FALSE, &interval);
+    }
+}
+
+/**
+ * @brief Wait until every epoch that was entered before the call has been exited. Pointers that were replaced before
+ * the call can then no longer be in use.
+ */
+_IRQL_requires_(PASSIVE_LEVEL) static void _net_ebpf_ext_epoch_synchronize()
+{
+    ACQUIRE_PUSH_LOCK_EXCLUSIVE(&_net_ebpf_ext_epoch_synchronize_lock);
+
+    // A thread may read the index just before it is flipped and only count its entry afterwards. Such a thread reads
+    // the replaced pointer's successor, but it is counted on the old index, so a later call must wait for it too.
+    // Wait for both counters, flipping the index in between so that new epochs do not hold up the second wait.
+    uint32_t index = (uint32_t)ReadAcquire(&_net_ebpf_ext_epoch_index) & 1;
+    _net_ebpf_ext_epoch_wait_for_readers(index ^ 1);
+    InterlockedExchange(&_net_ebpf_ext_epoch_index, (long)(index ^ 1));
+    _net_ebpf_ext_epoch_wait_for_readers(index);
+
+    RELEASE_PUSH_LOCK_EXCLUSIVE(&_net_ebpf_ext_epoch_synchronize_lock);
+}
+
+_Must_inspect_result_ ebpf_result_t
+net_ebpf_ext_allocate_client_snapshot(_Outptr_ net_ebpf_extension_hook_client_snapshot_t** client_snapshot)
+{
+    ebpf_result_t result = EBPF_SUCCESS;
+    net_ebpf_extension_hook_client_snapshot_t* local_client_snapshot = NULL;
+
+    *client_snapshot = NULL;
+
+    local_client_snapshot = (net_ebpf_extension_hook_client_snapshot_t*)ExAllocatePoolUninitialized(
+        NonPagedPoolNx, sizeof(net_ebpf_extension_hook_client_snapshot_t), NET_EBPF_EXTENSION_POOL_TAG);
+    EBPF_EXT_BAIL_ON_ALLOC_FAILURE_RESULT(
+        EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, local_client_snapshot, "client_snapshot", result);
+
+    memset(local_client_snapshot, 0, sizeof(net_ebpf_extension_hook_client_snapshot_t));
+    *client_snapshot = local_client_snapshot;
+
+Exit:
+    return result;
+}
+
+void
+net_ebpf_ext_free_client_snapshot(_In_opt_ _Frees_ptr_opt_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot)
+{
+    if (client_snapshot != NULL) {
+        ExFreePool(client_snapshot);
+    }
+}
+
+/**
+ * @brief Free a snapshot that was replaced, once no classify callout can still be using it, and release its rundown
+ * references on its clients.
+ *
+ * @param[in] client_snapshot Snapshot that was replaced.
+ */
+_IRQL_requires_(PASSIVE_LEVEL) static void _net_ebpf_ext_retire_client_snapshot(
+    _In_opt_ _Frees_ptr_opt_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot)
+{
+    if (client_snapshot == NULL) {
+        return;
+    }
+    _net_ebpf_ext_epoch_synchronize();
+    for (uint32_t index = 0; index < client_snapshot->client_count; index++) {
+        net_ebpf_extension_hook_client_leave_rundown(client_snapshot->clients[index]);
+    }
+    ExFreePool(client_snapshot);
+}
+
+/**
+ * @brief Fill the snapshot with the clients currently attached to the filter context and make it the current
+ * snapshot.
+ *
+ * @param[in, out] filter_context Filter context to publish the snapshot for.
+ * @param[in] client_snapshot Snapshot to publish, or NULL if the filter context has no clients.
+ *
+ * @returns The previously published snapshot. The caller must retire it after releasing the filter context lock.
+ */
+_Requires_exclusive_lock_held_(filter_context->lock) static net_ebpf_extension_hook_client_snapshot_t*
+    _net_ebpf_ext_swap_client_snapshot(
+        _Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context,
+        _In_opt_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot)
+{
+    net_ebpf_extension_hook_client_snapshot_t* old_client_snapshot = filter_context->client_snapshot;
+
+    if (client_snapshot != NULL) {
+        ASSERT(filter_context->client_context_count <= NET_EBPF_EXT_MAX_CLIENTS_PER_HOOK_MULTI_ATTACH);
+        client_snapshot->client_count = 0;
+        for (uint32_t index = 0; index < filter_context->client_context_count; index++) {
+            // Rundown for a client only starts once the client has been removed from the filter context, so this is
+            // not expected to fail.
+            if (!net_ebpf_extension_hook_client_enter_rundown(filter_context->client_contexts[index])) {
+                EBPF_EXT_LOG_MESSAGE(
+                    EBPF_EXT_TRACELOG_LEVEL_ERROR,
+                    EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
+                    "_net_ebpf_ext_swap_client_snapshot: Rundown failed for client");
+                ASSERT(FALSE);
+                continue;
+            }
+            client_snapshot->clients[client_snapshot->client_count++] = filter_context->client_contexts[index];
+        }
+        net_ebpf_extension_hook_prepare_client_snapshot(client_snapshot);
+    }
+
+    // Classify callouts read the snapshot without the lock, so it is published with a full barrier after it is filled.
+    InterlockedExchangePointer((void* volatile*)&filter_context->client_snapshot, client_snapshot);
+    filter_context->published_client_count = (client_snapshot != NULL) ? (long)client_snapshot->client_count : 0;
+    // Anything derived from the previous set of clients (such as cached verdicts) is now stale.
+    InterlockedIncrement64(&filter_context->client_snapshot_generation);
+    return old_client_snapshot;
+}
+
+void
+net_ebpf_ext_publish_client_snapshot(
+    _Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context,
+    _In_ _Frees_ptr_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot)
+{
+    net_ebpf_extension_hook_client_snapshot_t* old_client_snapshot;
+    KIRQL old_irql;
+
+    old_irql = ExAcquireSpinLockExclusive(&filter_context->lock);
+    old_client_snapshot = _net_ebpf_ext_swap_client_snapshot(filter_context, client_snapshot);
+    ExReleaseSpinLockExclusive(&filter_context->lock, old_irql);
+
+    _net_ebpf_ext_retire_client_snapshot(old_client_snapshot);
+}
+
+_Must_inspect_result_ net_ebpf_extension_hook_client_snapshot_t*
+net_ebpf_ext_get_client_snapshot(_In_ const net_ebpf_extension_wfp_filter_context_t* filter_context)
+{
+    return (net_ebpf_extension_hook_client_snapshot_t*)ReadPointerAcquire(
+        (void* const volatile*)&filter_context->client_snapshot);
+}
+
+_Must_inspect_result_ bool
+net_ebpf_ext_get_program_generations(
+    _In_ net_ebpf_extension_wfp_filter_context_t* filter_context,
+    _Out_ uint64_t* client_snapshot_generation,
+    _Out_ uint64_t* map_update_generation)
+{
+    net_ebpf_extension_hook_client_snapshot_t* client_snapshot;
+    net_ebpf_ext_epoch_state_t epoch_state;
+    bool generations_read = false;
+
+    // The generation is published after the snapshot, so reading it first yields a generation no newer than the
+    // snapshot read below. A result cached with an older generation is only discarded early.
+    *client_snapshot_generation = (uint64_t)ReadAcquire64(&filter_context->client_snapshot_generation);
+
+    net_ebpf_ext_epoch_enter(&epoch_state);
+    client_snapshot = net_ebpf_ext_get_client_snapshot(filter_context);
+    *map_update_generation = 0;
+    if (client_snapshot != NULL && client_snapshot->get_map_update_generation != NULL) {
+        // The snapshot holds rundown protection on its clients, so the function cannot be unloaded while it runs.
+        // Each generation only ever increases, so their sum changes whenever one of them does.
+        generations_read = true;
+        for (uint32_t index = 0; index < client_snapshot->client_count; index++) {
+            uint64_t client_map_update_generation;
+            if (client_snapshot->get_map_update_generation(
+                    client_snapshot->clients[index]->client_binding_context, &client_map_update_generation) !=
+                EBPF_SUCCESS) {
+                generations_read = false;
+                break;
+            }
+            *map_update_generation += client_map_update_generation;
+        }
+    }
+    net_ebpf_ext_epoch_exit(&epoch_state);
+
+    return generations_read;
+}
+
 ebpf_result_t
 net_ebpf_ext_add_client_context(
     _Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context,
-    _In_ const struct _net_ebpf_extension_hook_client* hook_client)
+    _In_ const struct _net_ebpf_extension_hook_client* hook_client,
+    _In_ _Frees_ptr_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot)
 {
     ebpf_result_t result = EBPF_SUCCESS;
+    net_ebpf_extension_hook_client_snapshot_t* old_client_snapshot = NULL;
     KIRQL old_irql;
 
     EBPF_EXT_LOG_ENTRY();
@@ -1114,19 +1404,30 @@ net_ebpf_ext_add_client_context(
     net_ebpf_extension_hook_client_set_provider_data(
         (struct _net_ebpf_extension_hook_client*)hook_client, (void*)filter_context);
 
+    // Publish the new set of clients to classify callouts.
+    old_client_snapshot = _net_ebpf_ext_swap_client_snapshot(filter_context, client_snapshot);
+    client_snapshot = NULL;
+
 Exit:
     ExReleaseSpinLockExclusive(&filter_context->lock, old_irql);
+
+    _net_ebpf_ext_retire_client_snapshot(old_client_snapshot);
+    net_ebpf_ext_free_client_snapshot(client_snapshot);
     EBPF_EXT_RETURN_RESULT(result);
 }
 
 void
 net_ebpf_ext_remove_client_context(
     _Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context,
-    _In_ const struct _net_ebpf_extension_hook_client* hook_client)
+    _Inout_ struct _net_ebpf_extension_hook_client* hook_client)
 {
     KIRQL old_irql;
     uint32_t index = 0;
     bool found = FALSE;
+    net_ebpf_extension_hook_client_snapshot_t* client_snapshot = hook_client->detach_snapshot;
+    net_ebpf_extension_hook_client_snapshot_t* old_client_snapshot = NULL;
+
+    hook_client->detach_snapshot = NULL;
 
     old_irql = ExAcquireSpinLockExclusive(&filter_context->lock);
 
@@ -1151,8 +1452,20 @@ net_ebpf_ext_remove_client_context(
     }
     filter_context->client_contexts[filter_context->client_context_count] = NULL;
 
+    // Publish the remaining clients. Classify callouts still using the previous snapshot keep the rundown reference
+    // on the removed client until they release it.
+    if (filter_context->client_context_count > 0) {
+        old_client_snapshot = _net_ebpf_ext_swap_client_snapshot(filter_context, client_snapshot);
+        client_snapshot = NULL;
+    } else {
+        old_client_snapshot = _net_ebpf_ext_swap_client_snapshot(filter_context, NULL);
+    }
+
 Exit:
     ExReleaseSpinLockExclusive(&filter_context->lock, old_irql);
+
+    _net_ebpf_ext_retire_client_snapshot(old_client_snapshot);
+    net_ebpf_ext_free_client_snapshot(client_snapshot);
 }
 
 void
@@ -1186,3 +1499,123 @@ net_ebpf_ext_remove_filter_context_from_cleanup_list(_Inout_ net_ebpf_extension_
         ExReleaseSpinLockExclusive(&_net_ebpf_ext_wfp_cleanup_state.lock, old_irql);
     }
 }
+
+_Must_inspect_result_ NTSTATUS
+net_ebpf_extension_lookaside_initialize(
+    _Out_ net_ebpf_extension_lookaside_t* lookaside, size_t entry_size, uint16_t maximum_depth)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    memset(lookaside, 0, sizeof(*lookaside));
+
+    // Free entries are linked through their first bytes.
+    lookaside->entry_size = (entry_size < sizeof(SLIST_ENTRY)) ? sizeof(SLIST_ENTRY) : entry_size;
+    lookaside->maximum_depth = maximum_depth;
+    lookaside->cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    lookaside->cpu_entries = (net_ebpf_extension_lookaside_cpu_entry_t*)ExAllocatePoolUninitialized(
+        NonPagedPoolNx,
+        sizeof(net_ebpf_extension_lookaside_cpu_entry_t) * lookaside->cpu_count,
+        NET_EBPF_EXTENSION_POOL_TAG);
+    if (lookaside->cpu_entries == NULL) {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+        EBPF_EXT_LOG_NTSTATUS_API_FAILURE(EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, "ExAllocatePoolUninitialized", status);
+        goto Exit;
+    }
+    memset(lookaside->cpu_entries, 0, sizeof(net_ebpf_extension_lookaside_cpu_entry_t) * lookaside->cpu_count);
+
+    for (uint32_t cpu = 0; cpu < lookaside->cpu_count; cpu++) {
+        InitializeSListHead(&lookaside->cpu_entries[cpu].free_list);
+    }
+
+Exit:
+    return status;
+}
+
+void
+net_ebpf_extension_lookaside_uninitialize(_Inout_ net_ebpf_extension_lookaside_t* lookaside)
+{
+    if (lookaside->cpu_entries == NULL) {
+        return;
+    }
+
+    net_ebpf_extension_lookaside_statistics_t statistics;
+    net_ebpf_extension_lookaside_get_statistics(lookaside, &statistics);
+    EBPF_EXT_LOG_MESSAGE_UINT64_UINT64(
+        EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
+        EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
+        "Lookaside cache statistics (allocations, hits)",
+        statistics.allocate_count,
+        statistics.hit_count);
+
+    for (uint32_t cpu = 0; cpu < lookaside->cpu_count; cpu++) {
+        SLIST_ENTRY* entry;
+        while ((entry = InterlockedPopEntrySList(&lookaside->cpu_entries[cpu].free_list)) != NULL) {
+            ExFreePool(entry);
+        }
+    }
+
+    ExFreePool(lookaside->cpu_entries);
+    lookaside->cpu_entries = NULL;
+}
+
+static inline net_ebpf_extension_lookaside_cpu_entry_t*
+_net_ebpf_extension_lookaside_get_cpu_entry(_In_ const net_ebpf_extension_lookaside_t* lookaside)
+{
+    return &lookaside->cpu_entries[KeGetCurrentProcessorNumberEx(NULL) % lookaside->cpu_count];
+}
+
+_Must_inspect_result_ _Ret_maybenull_ _Post_writable_byte_size_(lookaside->entry_size) void*
+net_ebpf_extension_lookaside_allocate(_Inout_ net_ebpf_extension_lookaside_t* lookaside)
+{
+    if (lookaside->cpu_entries == NULL) {
+        return ExAllocatePoolUninitialized(NonPagedPoolNx, lookaside->entry_size, NET_EBPF_EXTENSION_POOL_TAG);
+    }
+
+    net_ebpf_extension_lookaside_cpu_entry_t* cpu_entry = _net_ebpf_extension_lookaside_get_cpu_entry(lookaside);
+
+    // The counters are only updated by the owning CPU in the common case, so the interlocked increments do not
+    // contend with other CPUs.
+    InterlockedIncrement64(&cpu_entry->allocate_count);
+    void* entry = InterlockedPopEntrySList(&cpu_entry->free_list);
+    if (entry != NULL) {
+        InterlockedIncrement64(&cpu_entry->hit_count);
+        return entry;
+    }
+
+    return ExAllocatePoolUninitialized(NonPagedPoolNx, lookaside->entry_size, NET_EBPF_EXTENSION_POOL_TAG);
+}
+
+void
+net_ebpf_extension_lookaside_free(_Inout_ net_ebpf_extension_lookaside_t* lookaside, _Frees_ptr_ void* entry)
+{
+    if (lookaside->cpu_entries == NULL) {
+        ExFreePool(entry);
+        return;
+    }
+
+    net_ebpf_extension_lookaside_cpu_entry_t* cpu_entry = _net_ebpf_extension_lookaside_get_cpu_entry(lookaside);
+
+    // The depth check races with other pushes to the same list, so the list can briefly exceed the maximum depth by
+    // a few entries. That is harmless, since the depth only bounds the memory held by the cache.
+    if (QueryDepthSList(&cpu_entry->free_list) < lookaside->maximum_depth) {
+        InterlockedPushEntrySList(&cpu_entry->free_list, (SLIST_ENTRY*)entry);
+    } else {
+        ExFreePool(entry);
+    }
+}
+
+void
+net_ebpf_extension_lookaside_get_statistics(
+    _In_ const net_ebpf_extension_lookaside_t* lookaside, _Out_ net_ebpf_extension_lookaside_statistics_t* statistics)
+{
+    statistics->allocate_count = 0;
+    statistics->hit_count = 0;
+    if (lookaside->cpu_entries == NULL) {
+        return;
+    }
+    for (uint32_t cpu = 0; cpu < lookaside->cpu_count; cpu++) {
+        statistics->allocate_count += (uint64_t)ReadNoFence64(&lookaside->cpu_entries[cpu].allocate_count);
+        statistics->hit_count += (uint64_t)ReadNoFence64(&lookaside->cpu_entries[cpu].hit_count);
+    }
+}
@@ -27,13 +27,11 @@
 #define NET_EBPF_EXTENSION_NPI_PROVIDER_VERSION 0
 
 // Note: The maximum number of clients that can attach per-hook in multi-attach case has been currently capped to
-// a constant value to keep the implementation simple. Keeping the max limit constant allows allocating the memory
-// required for creating a copy of list of clients on the stack itself. In the future, if there is a need to increase
-// this maximum count, the value can be simply increased as long as the required memory can still be allocated on stack.
-// If the required memory becomes too large, we may need to switch to a different design to handle this. One option is
-// to use epoch based memory management for the list of clients. This eliminates the need to create a copy of programs
-// per-invocation. Another option can be to always invoke the programs while holding the socket context lock, but that
-// comes with a side effect of every program invocation now happening at DISPATCH_LEVEL.
+// a constant value to keep the implementation simple. Keeping the max limit constant allows the client snapshot
+// published for each filter context to be a fixed size. Classify callouts reference the current snapshot instead of
+// acquiring rundown protection on each client, and a detaching client's rundown completes once the last snapshot
+// that contains it is released. Programs are not invoked while holding the filter context lock, since that would
+// force every program invocation to happen at DISPATCH_LEVEL.
 #define NET_EBPF_EXT_MAX_CLIENTS_PER_HOOK_MULTI_ATTACH 16
 #define NET_EBPF_EXT_MAX_CLIENTS_PER_HOOK_SINGLE_ATTACH 1
 
@@ -128,6 +126,72 @@ typedef struct _net_ebpf_ext_wfp_filter_id
     NTSTATUS error_code;
 } net_ebpf_ext_wfp_filter_id_t;
 
+#define NET_EBPF_EXT_CLIENT_SNAPSHOT_FILTER_CACHE_SIZE 2
+
+#define NET_EBPF_EXT_FILTER_CACHE_ENTRY_EMPTY 0
+#define NET_EBPF_EXT_FILTER_CACHE_ENTRY_FILLING 1
+#define NET_EBPF_EXT_FILTER_CACHE_ENTRY_READY 2
+
+struct _net_ebpf_extension_hook_client_snapshot;
+
+/**
+ * @brief Dispatch routine that invokes the programs in a client snapshot.
+ *
+ * @param[in, out] client_snapshot Snapshot of the clients to invoke.
+ * @param[in] client_mask Bit i is set if clients[i] of the snapshot must be invoked.
+ * @param[in] process_verdict (Optional) Callback to decide whether to continue invoking programs.
+ * @param[in, out] program_context Context to pass to the eBPF programs.
+ * @param[out] result Return value from the last eBPF program invoked.
+ *
+ * @retval ebpf_result_t Status of the program invocation.
+ */
+typedef ebpf_result_t (*net_ebpf_extension_hook_dispatch_function_t)(
+    _Inout_ struct _net_ebpf_extension_hook_client_snapshot* client_snapshot,
+    uint32_t client_mask,
+    _In_opt_ net_ebpf_extension_hook_process_verdict process_verdict,
+    _Inout_ void* program_context,
+    _Out_ uint32_t* result);
+
+/**
+ * @brief Cached result of applying a client filter function to every client in a snapshot.
+ */
+typedef struct _net_ebpf_extension_hook_client_filter_cache_entry
+{
+    volatile long state; ///< One of NET_EBPF_EXT_FILTER_CACHE_ENTRY_*.
+    bool (*filter_function)(
+        _In_ const struct _net_ebpf_extension_hook_client* hook_client); ///< Filter function the entry is for.
+    uint32_t client_mask; ///< Bit i is set if the filter function selects clients[i].
+} net_ebpf_extension_hook_client_filter_cache_entry_t;
+
+/**
+ * @brief Immutable copy of the hook NPI clients attached to a filter context, together with the dispatch routine
+ * selected for them.
+ *
+ * A snapshot holds a rundown reference on each client in it. Classify callouts read the published snapshot within a
+ * net_ebpf_ext epoch, and a replaced snapshot is only freed, and its rundown references released, once every epoch
+ * that could have read it has been exited. A new snapshot is published whenever a client attaches or detaches, so the
+ * dispatch routine and batch functions are resolved once per change in the set of clients instead of once per
+ * classify.
+ */
+typedef struct _net_ebpf_extension_hook_client_snapshot
+{
+    uint32_t client_count; ///< Number of hook NPI clients in the snapshot.
+    struct _net_ebpf_extension_hook_client*
+        clients[NET_EBPF_EXT_MAX_CLIENTS_PER_HOOK_MULTI_ATTACH]; ///< Hook NPI clients in invocation order.
+    net_ebpf_extension_hook_dispatch_function_t dispatch;         ///< Dispatch routine selected for the clients.
+    ebpf_program_batch_begin_invoke_function_t batch_begin;       ///< Batch begin function shared by batch clients.
+    ebpf_program_batch_end_invoke_function_t batch_end;           ///< Batch end function shared by batch clients.
+    ebpf_program_get_map_update_generation_function_t
+        get_map_update_generation; ///< Set if every client reports the map update generation, NULL otherwise.
+    uint32_t all_clients_mask;   ///< Mask with a bit set for every client.
+    uint32_t batch_clients_mask; ///< Bit i is set if clients[i] is invoked within the batch.
+    net_ebpf_extension_hook_client_filter_cache_entry_t
+        filter_cache[NET_EBPF_EXT_CLIENT_SNAPSHOT_FILTER_CACHE_SIZE]; ///< Cached filter function results.
+} net_ebpf_extension_hook_client_snapshot_t;
+
+static_assert(
+    NET_EBPF_EXT_MAX_CLIENTS_PER_HOOK_MULTI_ATTACH <= 32, "Client masks in the client snapshot are 32 bits wide.");
+
 typedef struct _net_ebpf_extension_wfp_filter_context
 {
     LIST_ENTRY link;                   ///< Entry in the list of filter contexts.
@@ -137,6 +201,10 @@ typedef struct _net_ebpf_extension_wfp_filter_context
     _Guarded_by_(
         lock) struct _net_ebpf_extension_hook_client** client_contexts; ///< Array of pointers to hook NPI clients.
     _Guarded_by_(lock) uint32_t client_context_count;                   ///< Current number of hook NPI clients.
+    net_ebpf_extension_hook_client_snapshot_t* volatile client_snapshot; ///< Snapshot of clients used by classify.
+                                                                         ///< Replaced under the lock, read in an epoch.
+    volatile LONG64 client_snapshot_generation; ///< Incremented each time a client snapshot is published.
+    volatile long published_client_count;       ///< Number of clients in the published snapshot. Read without the lock.
     const struct _net_ebpf_extension_hook_provider* provider_context;   ///< Pointer to provider binding context.
 
     net_ebpf_ext_wfp_filter_id_t* filter_ids; ///< Array of WFP filter Ids.
@@ -148,6 +216,22 @@ typedef struct _net_ebpf_extension_wfp_filter_context
     HANDLE wfp_engine_handle;  ///< WFP engine handle.
 } net_ebpf_extension_wfp_filter_context_t;
 
+/**
+ * @brief Check, without taking the filter context lock, whether any client is attached to a filter context. Classify
+ * callouts call this before building the program context, so that classifies for a filter context with no attached
+ * program bail out without copying the WFP values or taking the lock.
+ *
+ * @param[in] filter_context Filter context to check.
+ *
+ * @retval true At least one client is attached.
+ * @retval false No client is attached, or the filter context is being deleted.
+ */
+static inline bool
+net_ebpf_ext_filter_context_has_clients(_In_ const net_ebpf_extension_wfp_filter_context_t* filter_context)
+{
+    return !filter_context->context_deleting && ReadNoFence(&filter_context->published_client_count) != 0;
+}
+
 /**
  * @brief Structure that holds objects related to WFP that require cleanup.
  */
@@ -386,7 +470,8 @@ net_ebpf_ext_filter_change_notify(
     FWPS_CALLOUT_NOTIFY_TYPE callout_notification_type, _In_ const GUID* filter_key, _Inout_ FWPS_FILTER* filter);
 
 /**
- * @brief Remove the client context from the filter context.
+ * @brief Remove the client context from the filter context and publish a new client snapshot without it. The
+ * snapshot preallocated in the hook client is consumed.
  *
  * @param filter_context Filter context to remove the client from.
  * @param hook_client Hook client to remove.
@@ -394,13 +479,15 @@ net_ebpf_ext_filter_change_notify(
 void
 net_ebpf_ext_remove_client_context(
     _Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context,
-    _In_ const struct _net_ebpf_extension_hook_client* hook_client);
+    _Inout_ struct _net_ebpf_extension_hook_client* hook_client);
 
 /**
- * @brief Add a client context to the filter context.
+ * @brief Add a client context to the filter context and publish a new client snapshot with it.
  *
  * @param filter_context Filter context to add the client to.
  * @param hook_client Hook client to add.
+ * @param client_snapshot Snapshot allocated with net_ebpf_ext_allocate_client_snapshot. Ownership is transferred to
+ * this function whether or not it succeeds.
  *
  * @retval EBPF_SUCCESS The client context was added successfully.
  * @retval EBPF_NO_MEMORY No more client contexts can be added.
@@ -408,7 +495,93 @@ net_ebpf_ext_remove_client_context(
 ebpf_result_t
 net_ebpf_ext_add_client_context(
     _Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context,
-    _In_ const struct _net_ebpf_extension_hook_client* hook_client);
+    _In_ const struct _net_ebpf_extension_hook_client* hook_client,
+    _In_ _Frees_ptr_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot);
+
+/**
+ * @brief Allocate an unpublished client snapshot.
+ *
+ * @param[out] client_snapshot Pointer to the allocated snapshot.
+ *
+ * @retval EBPF_SUCCESS The snapshot was allocated.
+ * @retval EBPF_NO_MEMORY Unable to allocate resources for this operation.
+ */
+_Must_inspect_result_ ebpf_result_t
+net_ebpf_ext_allocate_client_snapshot(_Outptr_ net_ebpf_extension_hook_client_snapshot_t** client_snapshot);
+
+/**
+ * @brief Free a client snapshot that was never published.
+ *
+ * @param[in] client_snapshot Snapshot to free.
+ */
+void
+net_ebpf_ext_free_client_snapshot(_In_opt_ _Frees_ptr_opt_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot);
+
+/**
+ * @brief Publish a snapshot of the clients currently attached to the filter context, replacing the previous one.
+ *
+ * @param filter_context Filter context to publish the snapshot for.
+ * @param client_snapshot Snapshot allocated with net_ebpf_ext_allocate_client_snapshot. Ownership is transferred to
+ * the filter context.
+ */
+void
+net_ebpf_ext_publish_client_snapshot(
+    _Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context,
+    _In_ _Frees_ptr_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot);
+
+/**
+ * @brief State of a thread in a net_ebpf_ext epoch.
+ */
+typedef struct _net_ebpf_ext_epoch_state
+{
+    uint32_t index; ///< Reader counters the epoch was entered on.
+} net_ebpf_ext_epoch_state_t;
+
+/**
+ * @brief Enter an epoch. Client snapshots read within the epoch stay valid until it is exited. Epochs do not block
+ * and may be nested.
+ *
+ * @param[out] epoch_state Receives the state to pass to net_ebpf_ext_epoch_exit.
+ */
+void
+net_ebpf_ext_epoch_enter(_Out_ net_ebpf_ext_epoch_state_t* epoch_state);
+
+/**
+ * @brief Exit an epoch entered with net_ebpf_ext_epoch_enter.
+ *
+ * @param[in] epoch_state State returned by net_ebpf_ext_epoch_enter.
+ */
+void
+net_ebpf_ext_epoch_exit(_In_ const net_ebpf_ext_epoch_state_t* epoch_state);
+
+/**
+ * @brief Get the current client snapshot of the filter context. The caller must be in an epoch, and must not use the
+ * snapshot after exiting it.
+ *
+ * @param filter_context Filter context to get the snapshot from.
+ *
+ * @returns Current snapshot, or NULL if no clients are published.
+ */
+_Must_inspect_result_ net_ebpf_extension_hook_client_snapshot_t*
+net_ebpf_ext_get_client_snapshot(_In_ const net_ebpf_extension_wfp_filter_context_t* filter_context);
+
+/**
+ * @brief Get the generations that a result derived from the programs attached to a filter context depends on. The
+ * client snapshot generation changes when a program is attached or detached, and the map update generation changes
+ * when a map used by one of the programs is updated. A cached result is only valid while both are unchanged.
+ *
+ * @param filter_context Filter context of the programs.
+ * @param client_snapshot_generation Receives the client snapshot generation of the filter context.
+ * @param map_update_generation Receives the combined map update generation of the attached programs.
+ *
+ * @retval true The generations were read.
+ * @retval false No program is attached, or a program does not report map updates, so results must not be cached.
+ */
+_Must_inspect_result_ bool
+net_ebpf_ext_get_program_generations(
+    _In_ net_ebpf_extension_wfp_filter_context_t* filter_context,
+    _Out_ uint64_t* client_snapshot_generation,
+    _Out_ uint64_t* map_update_generation);
 
 /**
  * @brief Add a provider context to the cleanup list.
@@ -433,3 +606,90 @@ net_ebpf_ext_add_filter_context_to_cleanup_list(_Inout_ net_ebpf_extension_wfp_f
  */
 void
 net_ebpf_ext_remove_filter_context_from_cleanup_list(_Inout_ net_ebpf_extension_wfp_filter_context_t* filter_context);
+
+/**
+ * @brief Per-CPU free list of a lookaside cache.
+ */
+__declspec(align(EBPF_CACHE_LINE_SIZE)) typedef struct _net_ebpf_extension_lookaside_cpu_entry
+{
+    SLIST_HEADER free_list;         ///< Entries freed on this CPU and available for reuse.
+    volatile LONG64 allocate_count; ///< Number of allocations made on this CPU.
+    volatile LONG64 hit_count;      ///< Number of allocations on this CPU satisfied from the free list.
+} net_ebpf_extension_lookaside_cpu_entry_t;
+
+/**
+ * @brief Fixed-size object cache with a bounded free list per CPU.
+ *
+ * Entries freed on a CPU are pushed to that CPU's free list, and allocations pop from the free list of the current
+ * CPU, so the hot per-classify and per-flow allocations stay off the pool allocator and the cache lines they touch
+ * are not shared between CPUs. An entry allocated on one CPU may be freed on another. A cache that is not initialized
+ * (or failed to initialize) allocates and frees entries directly from the pool.
+ */
+typedef struct _net_ebpf_extension_lookaside
+{
+    size_t entry_size;                                     ///< Size of each entry.
+    uint16_t maximum_depth;                                ///< Maximum number of entries on each per-CPU free list.
+    uint32_t cpu_count;                                    ///< Number of per-CPU free lists.
+    net_ebpf_extension_lookaside_cpu_entry_t* cpu_entries; ///< Per-CPU free lists.
+} net_ebpf_extension_lookaside_t;
+
+/**
+ * @brief Aggregate statistics of a lookaside cache.
+ */
+typedef struct _net_ebpf_extension_lookaside_statistics
+{
+    uint64_t allocate_count; ///< Number of allocations.
+    uint64_t hit_count;      ///< Number of allocations satisfied from a per-CPU free list.
+} net_ebpf_extension_lookaside_statistics_t;
+
+/**
+ * @brief Initialize a lookaside cache.
+ *
+ * @param[out] lookaside Lookaside cache to initialize.
+ * @param[in] entry_size Size of each entry.
+ * @param[in] maximum_depth Maximum number of free entries cached per CPU.
+ *
+ * @retval STATUS_SUCCESS The operation was successful.
+ * @retval STATUS_INSUFFICIENT_RESOURCES Unable to allocate the per-CPU free lists.
+ */
+_Must_inspect_result_ NTSTATUS
+net_ebpf_extension_lookaside_initialize(
+    _Out_ net_ebpf_extension_lookaside_t* lookaside, size_t entry_size, uint16_t maximum_depth);
+
+/**
+ * @brief Free the entries cached in a lookaside cache and the per-CPU free lists. All entries allocated from the
+ * cache must have been freed.
+ *
+ * @param[in, out] lookaside Lookaside cache to uninitialize.
+ */
+void
+net_ebpf_extension_lookaside_uninitialize(_Inout_ net_ebpf_extension_lookaside_t* lookaside);
+
+/**
+ * @brief Allocate an entry from a lookaside cache. The contents of the entry are not initialized.
+ *
+ * @param[in, out] lookaside Lookaside cache to allocate from.
+ *
+ * @returns Pointer to the entry, or NULL if the allocation failed.
+ */
+_Must_inspect_result_ _Ret_maybenull_ _Post_writable_byte_size_(lookaside->entry_size) void*
+net_ebpf_extension_lookaside_allocate(_Inout_ net_ebpf_extension_lookaside_t* lookaside);
+
+/**
+ * @brief Return an entry to a lookaside cache.
+ *
+ * @param[in, out] lookaside Lookaside cache the entry was allocated from.
+ * @param[in] entry Entry to free.
+ */
+void
+net_ebpf_extension_lookaside_free(_Inout_ net_ebpf_extension_lookaside_t* lookaside, _Frees_ptr_ void* entry);
+
+/**
+ * @brief Get the aggregate statistics of a lookaside cache.
+ *
+ * @param[in] lookaside Lookaside cache to query.
+ * @param[out] statistics Statistics summed over all CPUs.
+ */
+void
+net_ebpf_extension_lookaside_get_statistics(
+    _In_ const net_ebpf_extension_lookaside_t* lookaside, _Out_ net_ebpf_extension_lookaside_statistics_t* statistics);
@@ -43,6 +43,12 @@ const net_ebpf_extension_wfp_filter_parameters_t _net_ebpf_extension_bind_wfp_fi
 
 #define NET_EBPF_BIND_FILTER_COUNT EBPF_COUNT_OF(_net_ebpf_extension_bind_wfp_filter_parameters)
 
+// Maximum number of free test-run contexts cached per CPU.
+#define NET_EBPF_BIND_TEST_RUN_CONTEXT_CACHE_DEPTH 16
+
+// Cache of program test-run contexts.
+static net_ebpf_extension_lookaside_t _net_ebpf_bind_test_run_context_cache = {0};
+
 static ebpf_result_t
 _ebpf_bind_context_create(
     _In_reads_bytes_opt_(data_size_in) const uint8_t* data_in,
@@ -182,6 +188,14 @@ net_ebpf_ext_bind_register_providers()
         .delete_filter_context = _net_ebpf_ext_bind_delete_filter_context,
         .validate_client_data = _net_ebpf_ext_bind_validate_client_data};
 
+    status = net_ebpf_extension_lookaside_initialize(
+        &_net_ebpf_bind_test_run_context_cache,
+        sizeof(bind_context_header_t),
+        NET_EBPF_BIND_TEST_RUN_CONTEXT_CACHE_DEPTH);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
     status = net_ebpf_extension_program_info_provider_register(
         &program_info_provider_parameters, &_ebpf_bind_program_info_provider_context);
     if (!NT_SUCCESS(status)) {
@@ -226,6 +240,7 @@ net_ebpf_ext_bind_unregister_providers()
         net_ebpf_extension_program_info_provider_unregister(_ebpf_bind_program_info_provider_context);
         _ebpf_bind_program_info_provider_context = NULL;
     }
+    net_ebpf_extension_lookaside_uninitialize(&_net_ebpf_bind_test_run_context_cache);
 }
 
 //
@@ -305,14 +320,13 @@ net_ebpf_ext_resource_allocation_classify(
         goto Exit;
     }
 
-    // Note: This is intentionally not guarded by a lock as this is opportunistically checking if all the clients have
-    // detached and the filter context is being deleted.
-    if (filter_context->context_deleting) {
-        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    // Note: This is intentionally not guarded by a lock, so that classifies with no attached program bail out before
+    // the program context is built.
+    if (!net_ebpf_ext_filter_context_has_clients(filter_context)) {
+        EBPF_EXT_LOG_MESSAGE(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_BIND,
-            "net_ebpf_ext_resource_allocation_classify - Filter context deleting.",
-            STATUS_INVALID_PARAMETER);
+            "net_ebpf_ext_resource_allocation_classify - No programs attached.");
         goto Exit;
     }
 
@@ -428,14 +442,13 @@ net_ebpf_ext_resource_release_classify(
         goto Exit;
     }
 
-    // Note: This is intentionally not guarded by a lock as this is opportunistically checking if all the clients have
-    // detached and the filter context is being deleted.
-    if (filter_context->context_deleting) {
-        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    // Note: This is intentionally not guarded by a lock, so that classifies with no attached program bail out before
+    // the program context is built.
+    if (!net_ebpf_ext_filter_context_has_clients(filter_context)) {
+        EBPF_EXT_LOG_MESSAGE(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_BIND,
-            "net_ebpf_ext_resource_release_classify - Client detach detected.",
-            STATUS_INVALID_PARAMETER);
+            "net_ebpf_ext_resource_release_classify - No programs attached.");
         goto Exit;
     }
 
@@ -491,8 +504,8 @@ _ebpf_bind_context_create(
         goto Exit;
     }
 
-    bind_context_header = (bind_context_header_t*)ExAllocatePoolUninitialized(
-        NonPagedPoolNx, sizeof(bind_context_header_t), NET_EBPF_EXTENSION_POOL_TAG);
+    bind_context_header =
+        (bind_context_header_t*)net_ebpf_extension_lookaside_allocate(&_net_ebpf_bind_test_run_context_cache);
     EBPF_EXT_BAIL_ON_ALLOC_FAILURE_RESULT(
         EBPF_EXT_TRACELOG_KEYWORD_BIND, bind_context_header, "bind_context_header", result);
 
@@ -515,7 +528,7 @@ _ebpf_bind_context_create(
 
 Exit:
     if (bind_context_header) {
-        ExFreePool(bind_context_header);
+        net_ebpf_extension_lookaside_free(&_net_ebpf_bind_test_run_context_cache, bind_context_header);
         bind_context_header = NULL;
     }
     EBPF_EXT_RETURN_RESULT(result);
@@ -561,7 +574,7 @@ _ebpf_bind_context_destroy(
         *data_size_out = 0;
     }
 
-    ExFreePool(bind_context_header);
+    net_ebpf_extension_lookaside_free(&_net_ebpf_bind_test_run_context_cache, bind_context_header);
 
 Exit:
     EBPF_EXT_LOG_EXIT();
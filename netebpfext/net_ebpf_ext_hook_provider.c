@@ -137,27 +137,205 @@ net_ebpf_extension_hook_provider_get_attach_capability(_In_ const net_ebpf_exten
     return provider_context->attach_capability;
 }
 
-__forceinline _Must_inspect_result_ static ebpf_result_t
-_net_ebpf_extension_hook_invoke_single_program(
-    _In_ const net_ebpf_extension_hook_client_t* client, _Inout_ void* context, _Out_ uint32_t* result)
+/**
+ * @brief Dispatch routine for clients that do not support batch invocation.
+ */
+static ebpf_result_t
+_net_ebpf_extension_hook_dispatch_unbatched(
+    _Inout_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot,
+    uint32_t client_mask,
+    _In_opt_ net_ebpf_extension_hook_process_verdict process_verdict,
+    _Inout_ void* program_context,
+    _Out_ uint32_t* result)
 {
-    ebpf_program_invoke_function_t invoke_program = client->invoke_program;
-    const void* client_binding_context = client->client_binding_context;
+    ebpf_result_t program_result = EBPF_OBJECT_NOT_FOUND;
+
+    *result = 0;
+
+    for (uint32_t i = 0; i < client_snapshot->client_count; i++) {
+        if ((client_mask & (1u << i)) == 0) {
+            continue;
+        }
+        const net_ebpf_extension_hook_client_t* client = client_snapshot->clients[i];
+        program_result = client->invoke_program(client->client_binding_context, program_context, result);
+        if (program_result != EBPF_SUCCESS) {
+            // If we failed to invoke an eBPF program, stop processing and return the error code.
+            break;
+        }
+
+        // Invoke callback to see if we should continue processing.
+        if (process_verdict != NULL && !process_verdict(program_context, *result)) {
+            break;
+        }
+    }
 
-    return invoke_program(client_binding_context, context, result);
+    return program_result;
 }
 
-static void
-_net_ebpf_extension_release_rundown_for_clients(
-    _Inout_ net_ebpf_extension_hook_client_t** hook_clients, uint32_t client_count)
+/**
+ * @brief Dispatch routine for a single client that supports batch invocation.
+ */
+static ebpf_result_t
+_net_ebpf_extension_hook_dispatch_single_batched(
+    _Inout_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot,
+    uint32_t client_mask,
+    _In_opt_ net_ebpf_extension_hook_process_verdict process_verdict,
+    _Inout_ void* program_context,
+    _Out_ uint32_t* result)
+{
+    const net_ebpf_extension_hook_client_t* client = client_snapshot->clients[0];
+    ebpf_execution_context_state_t state;
+    ebpf_result_t program_result;
+
+    ASSERT(client_mask == 1);
+    UNREFERENCED_PARAMETER(client_mask);
+
+    *result = 0;
+
+    program_result = client_snapshot->batch_begin(sizeof(state), &state);
+    if (program_result != EBPF_SUCCESS) {
+        return _net_ebpf_extension_hook_dispatch_unbatched(
+            client_snapshot, client_mask, process_verdict, program_context, result);
+    }
+
+    program_result = client->batch_invoke(client->client_binding_context, program_context, result, &state);
+    if (program_result == EBPF_SUCCESS && process_verdict != NULL) {
+        (void)process_verdict(program_context, *result);
+    }
+
+    (void)client_snapshot->batch_end(&state);
+    return program_result;
+}
+
+/**
+ * @brief Dispatch routine for multiple clients, at least the first of which supports batch invocation. The execution
+ * context is entered once for all the programs invoked.
+ */
+static ebpf_result_t
+_net_ebpf_extension_hook_dispatch_batched(
+    _Inout_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot,
+    uint32_t client_mask,
+    _In_opt_ net_ebpf_extension_hook_process_verdict process_verdict,
+    _Inout_ void* program_context,
+    _Out_ uint32_t* result)
 {
-    for (uint32_t i = 0; i < client_count; i++) {
-        if (hook_clients[i] == NULL) {
+    ebpf_execution_context_state_t state;
+    ebpf_result_t program_result;
+    const uint32_t batch_clients_mask = client_snapshot->batch_clients_mask;
+
+    *result = 0;
+
+    program_result = client_snapshot->batch_begin(sizeof(state), &state);
+    if (program_result != EBPF_SUCCESS) {
+        return _net_ebpf_extension_hook_dispatch_unbatched(
+            client_snapshot, client_mask, process_verdict, program_context, result);
+    }
+
+    program_result = EBPF_OBJECT_NOT_FOUND;
+    for (uint32_t i = 0; i < client_snapshot->client_count; i++) {
+        const uint32_t client_bit = 1u << i;
+        if ((client_mask & client_bit) == 0) {
             continue;
         }
-        net_ebpf_extension_hook_client_leave_rundown(hook_clients[i]);
-        hook_clients[i] = NULL;
+        const net_ebpf_extension_hook_client_t* client = client_snapshot->clients[i];
+        if ((batch_clients_mask & client_bit) != 0) {
+            program_result = client->batch_invoke(client->client_binding_context, program_context, result, &state);
+        } else {
+            program_result = client->invoke_program(client->client_binding_context, program_context, result);
+        }
+        if (program_result != EBPF_SUCCESS) {
+            // If we failed to invoke an eBPF program, stop processing and return the error code.
+            break;
+        }
+
+        // Invoke callback to see if we should continue processing.
+        if (process_verdict != NULL && !process_verdict(program_context, *result)) {
+            break;
+        }
     }
+
+    (void)client_snapshot->batch_end(&state);
+    return program_result;
+}
+
+void
+net_ebpf_extension_hook_prepare_client_snapshot(_Inout_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot)
+{
+    const net_ebpf_extension_hook_client_t* first_client =
+        (client_snapshot->client_count > 0) ? client_snapshot->clients[0] : NULL;
+
+    client_snapshot->all_clients_mask = 0;
+    client_snapshot->batch_clients_mask = 0;
+    client_snapshot->batch_begin = (first_client != NULL) ? first_client->batch_begin : NULL;
+    client_snapshot->batch_end = (first_client != NULL) ? first_client->batch_end : NULL;
+    client_snapshot->get_map_update_generation =
+        (first_client != NULL) ? first_client->get_map_update_generation : NULL;
+    memset(client_snapshot->filter_cache, 0, sizeof(client_snapshot->filter_cache));
+
+    // Only clients attached through the same batch functions as the first client can share its execution context
+    // state. Other clients are invoked individually.
+    for (uint32_t i = 0; i < client_snapshot->client_count; i++) {
+        const net_ebpf_extension_hook_client_t* client = client_snapshot->clients[i];
+        client_snapshot->all_clients_mask |= (1u << i);
+        if (client->get_map_update_generation != client_snapshot->get_map_update_generation) {
+            // All clients bind to the same execution context, so this only happens with an older one.
+            client_snapshot->get_map_update_generation = NULL;
+        }
+        if (client_snapshot->batch_begin != NULL && client->batch_begin == client_snapshot->batch_begin &&
+            client->batch_end == client_snapshot->batch_end) {
+            client_snapshot->batch_clients_mask |= (1u << i);
+        }
+    }
+
+    if (client_snapshot->batch_begin == NULL) {
+        client_snapshot->dispatch = _net_ebpf_extension_hook_dispatch_unbatched;
+    } else if (client_snapshot->client_count == 1) {
+        client_snapshot->dispatch = _net_ebpf_extension_hook_dispatch_single_batched;
+    } else {
+        client_snapshot->dispatch = _net_ebpf_extension_hook_dispatch_batched;
+    }
+}
+
+/**
+ * @brief Get the set of clients in the snapshot selected by a filter function. Filter functions only depend on the
+ * client, so the result is computed once per snapshot and cached.
+ */
+static uint32_t
+_net_ebpf_extension_hook_get_filtered_client_mask(
+    _Inout_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot,
+    _In_ bool (*filter_function)(_In_ const net_ebpf_extension_hook_client_t* hook_client))
+{
+    uint32_t client_mask = 0;
+
+    for (uint32_t i = 0; i < NET_EBPF_EXT_CLIENT_SNAPSHOT_FILTER_CACHE_SIZE; i++) {
+        net_ebpf_extension_hook_client_filter_cache_entry_t* entry = &client_snapshot->filter_cache[i];
+        if (ReadAcquire(&entry->state) == NET_EBPF_EXT_FILTER_CACHE_ENTRY_READY &&
+            entry->filter_function == filter_function) {
+            return entry->client_mask;
+        }
+    }
+
+    for (uint32_t i = 0; i < client_snapshot->client_count; i++) {
+        if (filter_function(client_snapshot->clients[i])) {
+            client_mask |= (1u << i);
+        }
+    }
+
+    // Cache the result in the first free entry, if any. Concurrent classifies may compute the same mask; only one
+    // of them fills a given entry.
+    for (uint32_t i = 0; i < NET_EBPF_EXT_CLIENT_SNAPSHOT_FILTER_CACHE_SIZE; i++) {
+        net_ebpf_extension_hook_client_filter_cache_entry_t* entry = &client_snapshot->filter_cache[i];
+        if (InterlockedCompareExchange(
+                &entry->state, NET_EBPF_EXT_FILTER_CACHE_ENTRY_FILLING, NET_EBPF_EXT_FILTER_CACHE_ENTRY_EMPTY) ==
+            NET_EBPF_EXT_FILTER_CACHE_ENTRY_EMPTY) {
+            entry->filter_function = filter_function;
+            entry->client_mask = client_mask;
+            WriteRelease(&entry->state, NET_EBPF_EXT_FILTER_CACHE_ENTRY_READY);
+            break;
+        }
+    }
+
+    return client_mask;
 }
 
 ebpf_result_t
@@ -175,74 +353,36 @@ net_ebpf_extension_hook_invoke_filtered_programs(
     _Out_ uint32_t* result,
     _In_opt_ bool (*filter_function)(_In_ const net_ebpf_extension_hook_client_t* hook_client))
 {
-    ebpf_result_t program_result = EBPF_SUCCESS;
-    KIRQL old_irql = PASSIVE_LEVEL;
-    bool lock_acquired = FALSE;
-    uint32_t client_count = 0;
-    net_ebpf_extension_hook_client_t* clients[NET_EBPF_EXT_MAX_CLIENTS_PER_HOOK_MULTI_ATTACH] = {0};
+    ebpf_result_t program_result = EBPF_OBJECT_NOT_FOUND;
+    net_ebpf_extension_hook_client_snapshot_t* client_snapshot = NULL;
+    net_ebpf_ext_epoch_state_t epoch_state;
+    uint32_t client_mask;
     const net_ebpf_extension_hook_process_verdict process_verdict =
         filter_context->provider_context->dispatch.process_verdict;
 
     *result = 0;
 
-    // Acquire shared filter context lock.
-    old_irql = ExAcquireSpinLockShared(&filter_context->lock);
-    lock_acquired = TRUE;
-
-    // Create a local copy of the client contexts.
-    client_count = filter_context->client_context_count;
-    for (uint32_t i = 0; i < client_count; i++) {
-        // Acquire rundown protection for the client. Rundown for a client only starts once the client has been removed
-        // from the list of clients in the filter context. So we should not expect any failure in acquiring rundown
-        // here. If acquiring rundown fails, bail.
-        if (!net_ebpf_extension_hook_client_enter_rundown(filter_context->client_contexts[i])) {
-            EBPF_EXT_LOG_MESSAGE(
-                EBPF_EXT_TRACELOG_LEVEL_ERROR,
-                EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
-                "net_ebpf_extension_hook_invoke_programs: Rundown failed for client");
-            goto Exit;
-        }
-        clients[i] = filter_context->client_contexts[i];
-    }
-
-    // Release the shared filter context lock.
-    ExReleaseSpinLockShared(&filter_context->lock, old_irql);
-    lock_acquired = FALSE;
+    // Read the current snapshot of the clients within an epoch, so it is not freed until the epoch is exited. The
+    // snapshot holds rundown protection on each of its clients, so no per-client rundown needs to be acquired here.
+    net_ebpf_ext_epoch_enter(&epoch_state);
+    client_snapshot = net_ebpf_ext_get_client_snapshot(filter_context);
     filter_context = NULL;
-
-    program_result = EBPF_OBJECT_NOT_FOUND;
-
-    // Iterate over all the programs in the array.
-    for (uint32_t i = 0; i < client_count; i++) {
-        ASSERT(clients[i] != NULL);
-
-        if (filter_function != NULL) {
-            // If a filter function is provided, invoke it to see if we should invoke this program.
-            if (!filter_function(clients[i])) {
-                continue;
-            }
-        }
-        program_result = _net_ebpf_extension_hook_invoke_single_program(clients[i], program_context, result);
-        if (program_result != EBPF_SUCCESS) {
-            // If we failed to invoke an eBPF program, stop processing and return the error code.
-            goto Exit;
-        }
-
-        // Invoke callback to see if we should continue processing.
-        if (process_verdict != NULL) {
-            if (!process_verdict(program_context, *result)) {
-                program_result = EBPF_SUCCESS;
-                goto Exit;
-            }
-        }
+    if (client_snapshot == NULL) {
+        goto Exit;
     }
 
-Exit:
-    if (lock_acquired) {
-        ExReleaseSpinLockShared(&filter_context->lock, old_irql);
+    client_mask = (filter_function == NULL)
+                      ? client_snapshot->all_clients_mask
+                      : _net_ebpf_extension_hook_get_filtered_client_mask(client_snapshot, filter_function);
+    if (client_mask == 0) {
+        goto Exit;
     }
 
-    _net_ebpf_extension_release_rundown_for_clients(clients, client_count);
+    // Invoke the programs through the dispatch routine selected when the snapshot was published.
+    program_result = client_snapshot->dispatch(client_snapshot, client_mask, process_verdict, program_context, result);
+
+Exit:
+    net_ebpf_ext_epoch_exit(&epoch_state);
     return program_result;
 }
 
@@ -349,6 +489,7 @@ _net_ebpf_extension_hook_client_cleanup(_In_opt_ _Frees_ptr_opt_ net_ebpf_extens
         if (hook_client->detach_work_item != NULL) {
             IoFreeWorkItem(hook_client->detach_work_item);
         }
+        net_ebpf_ext_free_client_snapshot(hook_client->detach_snapshot);
         ExFreePool(hook_client);
     }
 }
@@ -388,6 +529,7 @@ _net_ebpf_extension_hook_provider_attach_client(
     bool is_wild_card_attach_parameter = FALSE;
     net_ebpf_extension_wfp_filter_context_t* new_filter_context = NULL;
     bool rundown_acquired = FALSE;
+    net_ebpf_extension_hook_client_snapshot_t* attach_snapshot = NULL;
 
     EBPF_EXT_LOG_ENTRY();
 
@@ -438,6 +580,29 @@ _net_ebpf_extension_hook_provider_attach_client(
         goto Exit;
     }
     hook_client->invoke_program = client_dispatch_table->ebpf_program_invoke_function;
+    if (client_dispatch_table->count >= EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_1 &&
+        client_dispatch_table->ebpf_program_batch_begin_invoke_function != NULL &&
+        client_dispatch_table->ebpf_program_batch_invoke_function != NULL &&
+        client_dispatch_table->ebpf_program_batch_end_invoke_function != NULL) {
+        hook_client->batch_begin = client_dispatch_table->ebpf_program_batch_begin_invoke_function;
+        hook_client->batch_invoke = client_dispatch_table->ebpf_program_batch_invoke_function;
+        hook_client->batch_end = client_dispatch_table->ebpf_program_batch_end_invoke_function;
+    }
+    if (client_dispatch_table->count >= EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_2) {
+        hook_client->get_map_update_generation =
+            client_dispatch_table->ebpf_program_get_map_update_generation_function;
+    }
+
+    // Allocate the client snapshots up front: one to publish when this client is added to a filter context, and one
+    // to publish when it is removed, so that detach cannot fail.
+    result = net_ebpf_ext_allocate_client_snapshot(&attach_snapshot);
+    if (result == EBPF_SUCCESS) {
+        result = net_ebpf_ext_allocate_client_snapshot(&hook_client->detach_snapshot);
+    }
+    if (result != EBPF_SUCCESS) {
+        status = STATUS_NO_MEMORY;
+        goto Exit;
+    }
 
     status = _ebpf_ext_attach_init_rundown(hook_client);
     if (!NT_SUCCESS(status)) {
@@ -471,7 +636,8 @@ _net_ebpf_extension_hook_provider_attach_client(
             hook_client->client_data->data_size, hook_client->client_data->data, local_provider_context);
         if (matching_context != NULL) {
             // Insert the new client in the filter context.
-            result = net_ebpf_ext_add_client_context(matching_context, hook_client);
+            result = net_ebpf_ext_add_client_context(matching_context, hook_client, attach_snapshot);
+            attach_snapshot = NULL;
             if (result != EBPF_SUCCESS) {
                 EBPF_EXT_LOG_MESSAGE_UINT32(
                     EBPF_EXT_TRACELOG_LEVEL_ERROR,
@@ -551,6 +717,10 @@ _net_ebpf_extension_hook_provider_attach_client(
         InsertHeadList(&local_provider_context->filter_context_list, &new_filter_context->link);
     }
     new_filter_context->initialized = TRUE;
+
+    // Make the client visible to classify callouts only once the filter context is fully set up.
+    net_ebpf_ext_publish_client_snapshot(new_filter_context, attach_snapshot);
+    attach_snapshot = NULL;
     new_filter_context = NULL;
 
     *provider_binding_context = hook_client;
@@ -566,6 +736,7 @@ Exit:
     }
 
     _net_ebpf_extension_hook_client_cleanup(hook_client);
+    net_ebpf_ext_free_client_snapshot(attach_snapshot);
 
     if (status != STATUS_SUCCESS) {
         if (rundown_acquired) {
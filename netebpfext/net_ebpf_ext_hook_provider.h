@@ -79,6 +79,15 @@ net_ebpf_extension_hook_provider_register(
     _In_opt_ const void* custom_data,
     _Outptr_ net_ebpf_extension_hook_provider_t** provider_context);
 
+/**
+ * @brief Resolve the batch functions of the clients in a snapshot and select the dispatch routine used to invoke
+ * them. Must be called before the snapshot is published.
+ *
+ * @param[in, out] client_snapshot Snapshot whose clients have been filled in.
+ */
+void
+net_ebpf_extension_hook_prepare_client_snapshot(_Inout_ net_ebpf_extension_hook_client_snapshot_t* client_snapshot);
+
 /**
  * @brief Invoke all the eBPF programs attached to the specified filter context.
  *
@@ -14,6 +14,14 @@
 #define EXPIRY_TIME 60000 // 60 seconds in ms.
 #define CONVERT_100NS_UNITS_TO_MS(x) ((x) / 10000)
 #define LOW_MEMORY_CONNECTION_CONTEXT_COUNT 1000
+// Number of independently locked shards of the connection context table, and hash buckets per shard. Both must be
+// powers of two.
+#define CONNECTION_CONTEXT_SHARD_COUNT 64
+#define CONNECTION_CONTEXT_SHARD_BUCKET_COUNT 64
+// Maximum number of free connection contexts cached per CPU.
+#define CONNECTION_CONTEXT_CACHE_DEPTH 256
+// Number of entries in the per-filter connect verdict cache. Must be a power of two.
+#define VERDICT_CACHE_ENTRY_COUNT 256
 
 #define CLEAN_UP_SOCK_ADDR_FILTER_CONTEXT(filter_context)                 \
     if ((filter_context) != NULL) {                                       \
@@ -227,6 +235,7 @@ typedef struct _net_ebpf_bpf_sock_addr
     bool redirected : 1;
     bool address_changed : 1;
     bool v4_mapped : 1;
+    bool verdict_cacheable : 1; ///< Cleared when an invoked connect program does not allow its verdict to be cached.
     // Additional network layer properties (CONNECT_AUTHORIZATION, AUTH_RECV_ACCEPT, BIND, and LISTEN).
     // Fields use SDK-defined "unspecified" values when not available for the current attach type.
     uint32_t interface_type;          ///< Interface type. 0 if not available.
@@ -259,7 +268,8 @@ typedef struct _net_ebpf_extension_connection_context
     uint32_t compartment_id;
     uint16_t protocol;
     uint64_t timestamp;
-    LIST_ENTRY list_entry;
+    LIST_ENTRY list_entry; ///< Entry in the shard LRU list, or in a low memory list.
+    LIST_ENTRY hash_entry; ///< Entry in a shard hash bucket.
     uint32_t verdict;
 } net_ebpf_extension_connection_context_t;
 
@@ -275,21 +285,43 @@ typedef struct _net_ebpf_ext_sock_addr_statistics
 
 static net_ebpf_ext_sock_addr_statistics_t _net_ebpf_ext_statistics;
 
-typedef struct _net_ebpf_ext_sock_addr_connection_contexts
+// The verdict cache is consulted on every connect, so its counters are kept per CPU and summed when they are read.
+__declspec(align(EBPF_CACHE_LINE_SIZE)) typedef struct _net_ebpf_ext_sock_addr_verdict_cache_cpu_statistics
+{
+    volatile LONG64 hit_count;
+    volatile LONG64 miss_count;
+} net_ebpf_ext_sock_addr_verdict_cache_cpu_statistics_t;
+
+static uint32_t _net_ebpf_ext_verdict_cache_cpu_count = 0;
+static net_ebpf_ext_sock_addr_verdict_cache_cpu_statistics_t* _net_ebpf_ext_verdict_cache_cpu_statistics = NULL;
+
+// A connection context is inserted at the connect_redirect layer and removed at the connect layer, usually on a
+// different CPU, so the table is sharded by the hash of the context rather than by CPU.
+__declspec(align(EBPF_CACHE_LINE_SIZE)) typedef struct _net_ebpf_ext_connection_context_shard
 {
     EX_SPIN_LOCK lock;
     // This list is used to ensure that contexts are never leaked and are freed after some time.
     _Guarded_by_(lock) LIST_ENTRY context_lru_list;
-    // This list stores connection contexts at the connect_redirect, to be retrieved and removed at the connect
+    // Hash chains storing connection contexts at the connect_redirect, to be retrieved and removed at the connect
     // layer.
-    _Guarded_by_(lock) RTL_AVL_TABLE context_table;
-    uint32_t context_count;
+    _Guarded_by_(lock) LIST_ENTRY buckets[CONNECTION_CONTEXT_SHARD_BUCKET_COUNT];
+    _Guarded_by_(lock) uint32_t context_count;
+} net_ebpf_ext_connection_context_shard_t;
 
+typedef struct _net_ebpf_ext_sock_addr_connection_contexts
+{
+    net_ebpf_ext_connection_context_shard_t shards[CONNECTION_CONTEXT_SHARD_COUNT];
+
+    EX_SPIN_LOCK low_memory_lock;
     // This list stores pre-allocated contexts, to be used under low memory conditions.
-    _Guarded_by_(lock) LIST_ENTRY low_memory_free_context_list;
+    _Guarded_by_(low_memory_lock) LIST_ENTRY low_memory_free_context_list;
     // This list is used in place of the table under low memory conditions, when we fail to allocate entries.
-    _Guarded_by_(lock) LIST_ENTRY low_memory_context_list;
-    uint32_t low_memory_context_count;
+    _Guarded_by_(low_memory_lock) LIST_ENTRY low_memory_context_list;
+    // Updated under low_memory_lock, read without it to skip the list when it is empty.
+    volatile long low_memory_context_count;
+
+    // Cache the shard entries are allocated from. Pre-allocated low memory entries are not part of the cache.
+    net_ebpf_extension_lookaside_t context_cache;
 } net_ebpf_ext_sock_addr_connection_contexts_t;
 
 static net_ebpf_ext_sock_addr_connection_contexts_t _net_ebpf_ext_sock_addr_contexts = {0};
@@ -663,12 +695,41 @@ const net_ebpf_extension_wfp_filter_parameters_array_t _net_ebpf_extension_sock_
      &_cgroup_inet6_listen_filter_parameters[0]},
 };
 
+typedef struct _net_ebpf_ext_sock_addr_verdict_cache_key
+{
+    uint64_t process_id;
+    uint32_t family;
+    uint32_t destination_ip[4];
+    uint32_t protocol;
+    uint32_t compartment_id;
+    uint16_t destination_port;
+    uint16_t reserved; ///< Always zero, so that keys can be hashed and compared as bytes.
+} net_ebpf_ext_sock_addr_verdict_cache_key_t;
+
+/**
+ * @brief Entry in the connect verdict cache of a filter context.
+ *
+ * Entries are protected by a sequence counter rather than a lock: the counter is odd while an entry is being written,
+ * and a reader discards what it read if the counter was odd or changed while it was reading.
+ */
+typedef struct _net_ebpf_ext_sock_addr_verdict_cache_entry
+{
+    volatile long sequence;
+    uint32_t verdict;
+    uint64_t generation;            ///< Client snapshot generation of the filter context that produced the verdict.
+    uint64_t map_update_generation; ///< Map update generation read before the programs produced the verdict.
+    net_ebpf_ext_sock_addr_verdict_cache_key_t key;
+} net_ebpf_ext_sock_addr_verdict_cache_entry_t;
+
 typedef struct _net_ebpf_extension_sock_addr_wfp_filter_context
 {
     net_ebpf_extension_wfp_filter_context_t base;
     HANDLE redirect_handle;
     uint32_t compartment_id;
     BOOLEAN v4_attach_type;
+    BOOLEAN verdict_cache_in_use; ///< TRUE once an attached connect program has allowed its verdict to be cached.
+    // The cache is embedded so that it is freed with the filter context, after the last classify using it.
+    net_ebpf_ext_sock_addr_verdict_cache_entry_t verdict_cache[VERDICT_CACHE_ENTRY_COUNT];
 } net_ebpf_extension_sock_addr_wfp_filter_context_t;
 
 static ebpf_result_t
@@ -687,9 +748,6 @@ _ebpf_sock_addr_context_destroy(
     _Out_writes_bytes_to_(*context_size_out, *context_size_out) uint8_t* context_out,
     _Inout_ size_t* context_size_out);
 
-_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.lock) static void _net_ebpf_ext_purge_connect_contexts(
-    bool delete_all);
-
 //
 // SOCK_ADDR Program Information NPI Provider.
 //
@@ -1016,58 +1074,222 @@ _net_ebpf_sock_addr_clean_up_security_descriptor()
     }
 }
 
-void
-_net_ebpf_ext_uninitialize_connection_contexts()
+/**
+ * @brief Hash the comparison prefix (every field before the timestamp) of a connection context.
+ */
+static inline uint32_t
+_net_ebpf_ext_connection_context_hash(_In_ const net_ebpf_extension_connection_context_t* context)
 {
-    KIRQL old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.lock);
+    // FNV-1a.
+    const uint8_t* data = (const uint8_t*)context;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < EBPF_OFFSET_OF(net_ebpf_extension_connection_context_t, timestamp); i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
-    // Clean up all in use connect contexts.
-    _net_ebpf_ext_purge_connect_contexts(true);
+static inline net_ebpf_ext_connection_context_shard_t*
+_net_ebpf_ext_get_connection_context_shard(uint32_t hash)
+{
+    return &_net_ebpf_ext_sock_addr_contexts.shards[hash & (CONNECTION_CONTEXT_SHARD_COUNT - 1)];
+}
 
-    // Clean up pre-allocated connect contexts.
-    while (!IsListEmpty(&_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list)) {
-        PLIST_ENTRY entry = RemoveHeadList(&_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list);
-        net_ebpf_extension_connection_context_t* context =
-            CONTAINING_RECORD(entry, net_ebpf_extension_connection_context_t, list_entry);
-        ExFreePool(context);
+static inline uint32_t
+_net_ebpf_ext_get_connection_context_bucket(uint32_t hash)
+{
+    // The low bits select the shard, so use the next bits to select the bucket.
+    return (hash / CONNECTION_CONTEXT_SHARD_COUNT) & (CONNECTION_CONTEXT_SHARD_BUCKET_COUNT - 1);
+}
+
+static void
+_net_ebpf_ext_sock_addr_get_verdict_cache_key(
+    _In_ const net_ebpf_sock_addr_t* sock_addr_ctx, _Out_ net_ebpf_ext_sock_addr_verdict_cache_key_t* key)
+{
+    memset(key, 0, sizeof(*key));
+    key->process_id = sock_addr_ctx->process_id;
+    key->family = sock_addr_ctx->base.family;
+    if (sock_addr_ctx->base.family == AF_INET) {
+        key->destination_ip[0] = sock_addr_ctx->base.user_ip4;
+    } else {
+        memcpy(key->destination_ip, sock_addr_ctx->base.user_ip6, sizeof(key->destination_ip));
     }
+    key->protocol = sock_addr_ctx->base.protocol;
+    key->compartment_id = sock_addr_ctx->base.compartment_id;
+    key->destination_port = sock_addr_ctx->base.user_port;
+}
 
-    ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.lock, old_irql);
+static inline uint32_t
+_net_ebpf_ext_sock_addr_verdict_cache_hash(_In_ const net_ebpf_ext_sock_addr_verdict_cache_key_t* key)
+{
+    // FNV-1a.
+    const uint8_t* data = (const uint8_t*)key;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(*key); i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
 }
 
-_Function_class_(RTL_AVL_COMPARE_ROUTINE) static RTL_GENERIC_COMPARE_RESULTS
-    _net_ebpf_sock_addr_context_avl_compare_routine(_In_ RTL_AVL_TABLE* table, _In_ PVOID first, _In_ PVOID second)
+/**
+ * @brief Look up a cached connect verdict.
+ *
+ * @param[in] filter_context Filter context that owns the cache.
+ * @param[in] key Key of the connection.
+ * @param[in] hash Hash of the key.
+ * @param[in] generation Current client snapshot generation of the filter context.
+ * @param[in] map_update_generation Current map update generation.
+ * @param[out] verdict Cached verdict.
+ *
+ * @retval true A valid verdict was found.
+ * @retval false No valid verdict was found, or the entry was being updated.
+ */
+static bool
+_net_ebpf_ext_sock_addr_lookup_cached_verdict(
+    _In_ const net_ebpf_extension_sock_addr_wfp_filter_context_t* filter_context,
+    _In_ const net_ebpf_ext_sock_addr_verdict_cache_key_t* key,
+    uint32_t hash,
+    uint64_t generation,
+    uint64_t map_update_generation,
+    _Out_ uint32_t* verdict)
 {
-    UNREFERENCED_PARAMETER(table);
+    const net_ebpf_ext_sock_addr_verdict_cache_entry_t* entry =
+        &filter_context->verdict_cache[hash & (VERDICT_CACHE_ENTRY_COUNT - 1)];
+    long sequence = ReadAcquire(&entry->sequence);
+    bool found;
 
-    int result = memcmp(first, second, EBPF_OFFSET_OF(net_ebpf_extension_connection_context_t, timestamp));
-    if (result < 0) {
-        return GenericLessThan;
-    } else if (result > 0) {
-        return GenericGreaterThan;
-    } else {
-        return GenericEqual;
+    *verdict = 0;
+    if (sequence & 1) {
+        return false;
+    }
+
+    found = (entry->generation == generation) && (entry->map_update_generation == map_update_generation) &&
+            (memcmp(&entry->key, key, sizeof(*key)) == 0);
+    *verdict = entry->verdict;
+
+    // Discard the result if a writer updated the entry while it was being read.
+    MemoryBarrier();
+    if (ReadNoFence(&entry->sequence) != sequence) {
+        return false;
     }
+
+    return found;
 }
 
-_Function_class_(RTL_AVL_ALLOCATE_ROUTINE) static PVOID
-    _net_ebpf_sock_addr_context_avl_allocate_routine(_In_ RTL_AVL_TABLE* table, _In_ CLONG buffer_size)
+/**
+ * @brief Cache a connect verdict. If another classify is updating the same entry, the verdict is not cached.
+ *
+ * @param[in, out] filter_context Filter context that owns the cache.
+ * @param[in] key Key of the connection.
+ * @param[in] hash Hash of the key.
+ * @param[in] generation Client snapshot generation of the filter context read before the programs were invoked.
+ * @param[in] map_update_generation Map update generation read before the programs were invoked.
+ * @param[in] verdict Verdict to cache.
+ */
+static void
+_net_ebpf_ext_sock_addr_insert_cached_verdict(
+    _Inout_ net_ebpf_extension_sock_addr_wfp_filter_context_t* filter_context,
+    _In_ const net_ebpf_ext_sock_addr_verdict_cache_key_t* key,
+    uint32_t hash,
+    uint64_t generation,
+    uint64_t map_update_generation,
+    uint32_t verdict)
 {
-    UNREFERENCED_PARAMETER(table);
+    net_ebpf_ext_sock_addr_verdict_cache_entry_t* entry =
+        &filter_context->verdict_cache[hash & (VERDICT_CACHE_ENTRY_COUNT - 1)];
+    long sequence = ReadNoFence(&entry->sequence);
 
-    PVOID buffer = ExAllocatePoolUninitialized(NonPagedPoolNx, buffer_size, NET_EBPF_EXTENSION_POOL_TAG);
-    if (buffer) {
-        memset(buffer, 0, buffer_size);
+    if ((sequence & 1) || InterlockedCompareExchange(&entry->sequence, sequence + 1, sequence) != sequence) {
+        return;
     }
-    return buffer;
+
+    entry->verdict = verdict;
+    entry->generation = generation;
+    entry->map_update_generation = map_update_generation;
+    entry->key = *key;
+
+    InterlockedIncrement(&entry->sequence);
 }
 
-_Function_class_(RTL_AVL_FREE_ROUTINE) static VOID
-    _net_ebpf_sock_addr_context_avl_free_routine(_In_ RTL_AVL_TABLE* table, _In_ PVOID buffer)
+static _Must_inspect_result_ NTSTATUS
+_net_ebpf_ext_sock_addr_initialize_verdict_cache_statistics()
 {
-    UNREFERENCED_PARAMETER(table);
+    NTSTATUS status = STATUS_SUCCESS;
+    uint32_t cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    _net_ebpf_ext_verdict_cache_cpu_statistics =
+        (net_ebpf_ext_sock_addr_verdict_cache_cpu_statistics_t*)ExAllocatePoolUninitialized(
+            NonPagedPoolNx,
+            sizeof(net_ebpf_ext_sock_addr_verdict_cache_cpu_statistics_t) * cpu_count,
+            NET_EBPF_EXTENSION_POOL_TAG);
+    if (_net_ebpf_ext_verdict_cache_cpu_statistics == NULL) {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+        EBPF_EXT_LOG_NTSTATUS_API_FAILURE(EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR, "ExAllocatePoolUninitialized", status);
+        goto Exit;
+    }
+    memset(
+        _net_ebpf_ext_verdict_cache_cpu_statistics,
+        0,
+        sizeof(net_ebpf_ext_sock_addr_verdict_cache_cpu_statistics_t) * cpu_count);
+    _net_ebpf_ext_verdict_cache_cpu_count = cpu_count;
+
+Exit:
+    return status;
+}
+
+static void
+_net_ebpf_ext_sock_addr_uninitialize_verdict_cache_statistics()
+{
+    if (_net_ebpf_ext_verdict_cache_cpu_statistics != NULL) {
+        ExFreePool(_net_ebpf_ext_verdict_cache_cpu_statistics);
+        _net_ebpf_ext_verdict_cache_cpu_statistics = NULL;
+    }
+    _net_ebpf_ext_verdict_cache_cpu_count = 0;
+}
+
+static inline net_ebpf_ext_sock_addr_verdict_cache_cpu_statistics_t*
+_net_ebpf_ext_sock_addr_get_verdict_cache_cpu_statistics()
+{
+    return &_net_ebpf_ext_verdict_cache_cpu_statistics
+        [KeGetCurrentProcessorNumberEx(NULL) % _net_ebpf_ext_verdict_cache_cpu_count];
+}
+
+_Requires_exclusive_lock_held_(shard->lock) static void _net_ebpf_ext_purge_connection_context_shard(
+    _Inout_ net_ebpf_ext_connection_context_shard_t* shard, bool delete_all);
+
+_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.low_memory_lock) static void
+    _net_ebpf_ext_purge_low_memory_connection_contexts(bool delete_all);
+
+void
+_net_ebpf_ext_uninitialize_connection_contexts()
+{
+    KIRQL old_irql;
+
+    // Clean up all in use connect contexts.
+    for (uint32_t i = 0; i < CONNECTION_CONTEXT_SHARD_COUNT; i++) {
+        net_ebpf_ext_connection_context_shard_t* shard = &_net_ebpf_ext_sock_addr_contexts.shards[i];
+        old_irql = ExAcquireSpinLockExclusive(&shard->lock);
+        _net_ebpf_ext_purge_connection_context_shard(shard, true);
+        ExReleaseSpinLockExclusive(&shard->lock, old_irql);
+    }
+
+    old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.low_memory_lock);
+
+    _net_ebpf_ext_purge_low_memory_connection_contexts(true);
+
+    // Clean up pre-allocated connect contexts.
+    while (!IsListEmpty(&_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list)) {
+        PLIST_ENTRY entry = RemoveHeadList(&_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list);
+        net_ebpf_extension_connection_context_t* context =
+            CONTAINING_RECORD(entry, net_ebpf_extension_connection_context_t, list_entry);
+        ExFreePool(context);
+    }
 
-    ExFreePool(buffer);
+    ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.low_memory_lock, old_irql);
+
+    net_ebpf_extension_lookaside_uninitialize(&_net_ebpf_ext_sock_addr_contexts.context_cache);
 }
 
 static NTSTATUS
@@ -1075,17 +1297,25 @@ _net_ebpf_sock_addr_initialize_connection_contexts()
 {
     NTSTATUS status = STATUS_SUCCESS;
 
-    RtlInitializeGenericTableAvl(
-        &_net_ebpf_ext_sock_addr_contexts.context_table,
-        _net_ebpf_sock_addr_context_avl_compare_routine,
-        _net_ebpf_sock_addr_context_avl_allocate_routine,
-        _net_ebpf_sock_addr_context_avl_free_routine,
-        NULL);
+    for (uint32_t i = 0; i < CONNECTION_CONTEXT_SHARD_COUNT; i++) {
+        net_ebpf_ext_connection_context_shard_t* shard = &_net_ebpf_ext_sock_addr_contexts.shards[i];
+        InitializeListHead(&shard->context_lru_list);
+        for (uint32_t j = 0; j < CONNECTION_CONTEXT_SHARD_BUCKET_COUNT; j++) {
+            InitializeListHead(&shard->buckets[j]);
+        }
+    }
 
-    InitializeListHead(&_net_ebpf_ext_sock_addr_contexts.context_lru_list);
     InitializeListHead(&_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list);
     InitializeListHead(&_net_ebpf_ext_sock_addr_contexts.low_memory_context_list);
 
+    status = net_ebpf_extension_lookaside_initialize(
+        &_net_ebpf_ext_sock_addr_contexts.context_cache,
+        sizeof(net_ebpf_extension_connection_context_t),
+        CONNECTION_CONTEXT_CACHE_DEPTH);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
     // Pre-allocate entries for use under low memory conditions.
     for (int32_t i = 0; i < LOW_MEMORY_CONNECTION_CONTEXT_COUNT; i++) {
         net_ebpf_extension_connection_context_t* context =
@@ -1153,50 +1383,65 @@ _net_ebpf_extension_connection_context_initialize(
     }
 }
 
-_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.lock) static uint32_t
-    _net_ebpf_ext_find_and_remove_connection_context_locked(_In_ net_ebpf_extension_connection_context_t* context)
+_Requires_exclusive_lock_held_(shard->lock) static net_ebpf_extension_connection_context_t*
+    _net_ebpf_ext_find_connection_context_in_shard(
+        _In_ const net_ebpf_ext_connection_context_shard_t* shard,
+        uint32_t bucket,
+        _In_ const net_ebpf_extension_connection_context_t* context)
 {
-    uint32_t verdict = BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT;
-    // Check the hash table for the entry.
-    net_ebpf_extension_connection_context_t* found_context =
-        (net_ebpf_extension_connection_context_t*)RtlLookupElementGenericTableAvl(
-            &_net_ebpf_ext_sock_addr_contexts.context_table, context);
-    if (found_context != NULL) {
-        verdict = found_context->verdict;
-        RemoveEntryList(&found_context->list_entry);
-        uint64_t transport_endpoint_handle = found_context->transport_endpoint_handle;
-        // Delete should succeed as the entry was just found in the lookup.
-        BOOLEAN result = RtlDeleteElementGenericTableAvl(&_net_ebpf_ext_sock_addr_contexts.context_table, context);
-        ebpf_assert(result);
-        _net_ebpf_ext_sock_addr_contexts.context_count--;
-        EBPF_EXT_LOG_MESSAGE_UINT64(
-            EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "_net_ebpf_ext_find_and_remove_connection_context_locked: Delete",
-            transport_endpoint_handle);
-    } else {
-        // The entry was not found in the hash table. Check the low-memory list to see if the entry is there.
-        LIST_ENTRY* entry = _net_ebpf_ext_sock_addr_contexts.low_memory_context_list.Flink;
-        while (entry != &_net_ebpf_ext_sock_addr_contexts.low_memory_context_list) {
-            net_ebpf_extension_connection_context_t* connection_context =
-                CONTAINING_RECORD(entry, net_ebpf_extension_connection_context_t, list_entry);
-            if (memcmp(
-                    context, connection_context, EBPF_OFFSET_OF(net_ebpf_extension_connection_context_t, timestamp)) ==
-                0) {
-                // Found matching entry. Remove it from the list and return it to the free list, and then return stored
-                // verdict.
-                verdict = connection_context->verdict;
-                RemoveEntryList(&connection_context->list_entry);
-                InsertHeadList(
-                    &_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list, &connection_context->list_entry);
-                _net_ebpf_ext_sock_addr_contexts.low_memory_context_count--;
-                break;
-            }
-            entry = entry->Flink;
+    const LIST_ENTRY* bucket_head = &shard->buckets[bucket];
+    for (LIST_ENTRY* entry = bucket_head->Flink; entry != bucket_head; entry = entry->Flink) {
+        net_ebpf_extension_connection_context_t* connection_context =
+            CONTAINING_RECORD(entry, net_ebpf_extension_connection_context_t, hash_entry);
+        if (memcmp(context, connection_context, EBPF_OFFSET_OF(net_ebpf_extension_connection_context_t, timestamp)) ==
+            0) {
+            return connection_context;
         }
     }
+    return NULL;
+}
 
-    return verdict;
+_Requires_exclusive_lock_held_(shard->lock) static void _net_ebpf_ext_delete_connection_context_from_shard(
+    _Inout_ net_ebpf_ext_connection_context_shard_t* shard,
+    _In_ _Frees_ptr_ net_ebpf_extension_connection_context_t* context)
+{
+    RemoveEntryList(&context->list_entry);
+    RemoveEntryList(&context->hash_entry);
+    shard->context_count--;
+    net_ebpf_extension_lookaside_free(&_net_ebpf_ext_sock_addr_contexts.context_cache, context);
+}
+
+/**
+ * @brief Remove a context matching the comparison prefix of the supplied context from the low memory list.
+ *
+ * @param[in] context Connection context to find.
+ * @param[out] verdict Verdict stored in the removed context.
+ *
+ * @return true if a context was found and removed, false otherwise.
+ */
+_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.low_memory_lock) static bool
+    _net_ebpf_ext_find_and_remove_low_memory_connection_context_locked(
+        _In_ const net_ebpf_extension_connection_context_t* context, _Out_ uint32_t* verdict)
+{
+    *verdict = BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT;
+    LIST_ENTRY* entry = _net_ebpf_ext_sock_addr_contexts.low_memory_context_list.Flink;
+    while (entry != &_net_ebpf_ext_sock_addr_contexts.low_memory_context_list) {
+        net_ebpf_extension_connection_context_t* connection_context =
+            CONTAINING_RECORD(entry, net_ebpf_extension_connection_context_t, list_entry);
+        if (memcmp(context, connection_context, EBPF_OFFSET_OF(net_ebpf_extension_connection_context_t, timestamp)) ==
+            0) {
+            // Found matching entry. Remove it from the list and return it to the free list, and then return stored
+            // verdict.
+            *verdict = connection_context->verdict;
+            RemoveEntryList(&connection_context->list_entry);
+            InsertHeadList(
+                &_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list, &connection_context->list_entry);
+            InterlockedDecrement(&_net_ebpf_ext_sock_addr_contexts.low_memory_context_count);
+            return true;
+        }
+        entry = entry->Flink;
+    }
+    return false;
 }
 
 static uint32_t
@@ -1205,25 +1450,50 @@ _net_ebpf_ext_find_and_remove_connection_context(
 {
     KIRQL old_irql;
     net_ebpf_extension_connection_context_t local_connection_context = {0};
+    uint32_t verdict = BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT;
+    bool found = false;
 
     _net_ebpf_extension_connection_context_initialize(
         transport_endpoint_handle, sock_addr_ctx, 0, 0, &local_connection_context);
 
-    old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.lock);
-    uint32_t verdict = _net_ebpf_ext_find_and_remove_connection_context_locked(&local_connection_context);
-    ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.lock, old_irql);
+    uint32_t hash = _net_ebpf_ext_connection_context_hash(&local_connection_context);
+    net_ebpf_ext_connection_context_shard_t* shard = _net_ebpf_ext_get_connection_context_shard(hash);
+
+    // Check the shard's hash table for the entry.
+    old_irql = ExAcquireSpinLockExclusive(&shard->lock);
+    net_ebpf_extension_connection_context_t* found_context = _net_ebpf_ext_find_connection_context_in_shard(
+        shard, _net_ebpf_ext_get_connection_context_bucket(hash), &local_connection_context);
+    if (found_context != NULL) {
+        verdict = found_context->verdict;
+        _net_ebpf_ext_delete_connection_context_from_shard(shard, found_context);
+        found = true;
+    }
+    ExReleaseSpinLockExclusive(&shard->lock, old_irql);
+
+    if (found) {
+        EBPF_EXT_LOG_MESSAGE_UINT64(
+            EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
+            EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
+            "_net_ebpf_ext_find_and_remove_connection_context: Delete",
+            transport_endpoint_handle);
+    } else if (ReadNoFence(&_net_ebpf_ext_sock_addr_contexts.low_memory_context_count) != 0) {
+        // The entry was not found in the hash table. Check the low-memory list to see if the entry is there.
+        old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.low_memory_lock);
+        (void)_net_ebpf_ext_find_and_remove_low_memory_connection_context_locked(&local_connection_context, &verdict);
+        ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.low_memory_lock, old_irql);
+    }
 
     return verdict;
 }
 
-_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.lock) static void _net_ebpf_ext_purge_connect_contexts(
-    bool delete_all)
+_Requires_exclusive_lock_held_(shard->lock) static void _net_ebpf_ext_purge_connection_context_shard(
+    _Inout_ net_ebpf_ext_connection_context_shard_t* shard, bool delete_all)
 {
     uint64_t expiry_time = CONVERT_100NS_UNITS_TO_MS(KeQueryInterruptTime()) - EXPIRY_TIME;
 
-    // Free entries from the LRU list. These entries should also be removed from the table.
-    LIST_ENTRY* list_entry = _net_ebpf_ext_sock_addr_contexts.context_lru_list.Blink;
-    while (list_entry != &_net_ebpf_ext_sock_addr_contexts.context_lru_list) {
+    // Free entries from the tail of the shard's LRU list. These entries are also removed from the shard's table.
+    LIST_ENTRY* list_entry = shard->context_lru_list.Blink;
+    while (list_entry != &shard->context_lru_list) {
         net_ebpf_extension_connection_context_t* entry =
             CONTAINING_RECORD(list_entry, net_ebpf_extension_connection_context_t, list_entry);
         // Move pointer to next entry prior to removing the entry.
@@ -1233,22 +1503,25 @@ _Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.lock) static voi
             break;
         }
 
-#pragma warning(suppress : 6001) /* entry and list entry are non-null */
-        RemoveEntryList(&entry->list_entry);
         uint64_t transport_endpoint_handle = entry->transport_endpoint_handle;
-        BOOLEAN result = RtlDeleteElementGenericTableAvl(&_net_ebpf_ext_sock_addr_contexts.context_table, entry);
-        ebpf_assert(result);
+#pragma warning(suppress : 6001) /* entry and list entry are non-null */
+        _net_ebpf_ext_delete_connection_context_from_shard(shard, entry);
         entry = NULL;
-        _net_ebpf_ext_sock_addr_contexts.context_count--;
         EBPF_EXT_LOG_MESSAGE_UINT64(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "_net_ebpf_ext_purge_connect_contexts: Delete",
+            "_net_ebpf_ext_purge_connection_context_shard: Delete",
             transport_endpoint_handle);
     }
+}
+
+_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.low_memory_lock) static void
+    _net_ebpf_ext_purge_low_memory_connection_contexts(bool delete_all)
+{
+    uint64_t expiry_time = CONVERT_100NS_UNITS_TO_MS(KeQueryInterruptTime()) - EXPIRY_TIME;
 
     // Free entries from low-memory list.
-    list_entry = _net_ebpf_ext_sock_addr_contexts.low_memory_context_list.Blink;
+    LIST_ENTRY* list_entry = _net_ebpf_ext_sock_addr_contexts.low_memory_context_list.Blink;
     while (list_entry != &_net_ebpf_ext_sock_addr_contexts.low_memory_context_list) {
         net_ebpf_extension_connection_context_t* entry =
             CONTAINING_RECORD(list_entry, net_ebpf_extension_connection_context_t, list_entry);
@@ -1267,17 +1540,11 @@ _Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.lock) static voi
             // Return the entry to the free list.
             InsertHeadList(&_net_ebpf_ext_sock_addr_contexts.low_memory_free_context_list, &entry->list_entry);
         }
-        _net_ebpf_ext_sock_addr_contexts.low_memory_context_count--;
+        InterlockedDecrement(&_net_ebpf_ext_sock_addr_contexts.low_memory_context_count);
     }
-
-    EBPF_EXT_LOG_MESSAGE_UINT64(
-        EBPF_EXT_TRACELOG_LEVEL_INFO,
-        EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-        "_net_ebpf_ext_purge_connect_contexts",
-        _net_ebpf_ext_sock_addr_contexts.context_count);
 }
 
-_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.lock) static ebpf_result_t
+_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.low_memory_lock) static ebpf_result_t
     _net_ebpf_ext_insert_connection_context_to_low_memory_list(
         _In_ uint64_t transport_endpoint_handle, _In_ const bpf_sock_addr_t* sock_addr_ctx, _In_ uint32_t verdict)
 {
@@ -1303,7 +1570,7 @@ _Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_contexts.lock) static ebp
 
     // Insert into the connection context list.
     InsertHeadList(&_net_ebpf_ext_sock_addr_contexts.low_memory_context_list, &connection_context->list_entry);
-    _net_ebpf_ext_sock_addr_contexts.low_memory_context_count++;
+    InterlockedIncrement(&_net_ebpf_ext_sock_addr_contexts.low_memory_context_count);
     InterlockedIncrement(&_net_ebpf_ext_statistics.low_memory_context_count);
 
 Exit:
@@ -1316,58 +1583,106 @@ _net_ebpf_ext_insert_connection_context_to_list(
 {
     ebpf_result_t result = EBPF_SUCCESS;
     KIRQL old_irql = PASSIVE_LEVEL;
-    net_ebpf_extension_connection_context_t connection_context = {0};
+    net_ebpf_extension_connection_context_t local_connection_context = {0};
     net_ebpf_extension_connection_context_t* new_context = NULL;
+    net_ebpf_extension_connection_context_t* old_context = NULL;
+    bool replaced = false;
 
     _net_ebpf_extension_connection_context_initialize(
-        transport_endpoint_handle,
-        sock_addr_ctx,
-        CONNECTION_CONTEXT_INITIALIZATION_SET_TIMESTAMP,
-        verdict,
-        &connection_context);
+        transport_endpoint_handle, sock_addr_ctx, 0, 0, &local_connection_context);
 
-    old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.lock);
+    uint32_t hash = _net_ebpf_ext_connection_context_hash(&local_connection_context);
+    uint32_t bucket = _net_ebpf_ext_get_connection_context_bucket(hash);
+    net_ebpf_ext_connection_context_shard_t* shard = _net_ebpf_ext_get_connection_context_shard(hash);
 
-    // Remove the context if it exists.
-    _net_ebpf_ext_find_and_remove_connection_context_locked(&connection_context);
+    // Allocate and initialize the new entry before taking the shard lock.
+    new_context = (net_ebpf_extension_connection_context_t*)net_ebpf_extension_lookaside_allocate(
+        &_net_ebpf_ext_sock_addr_contexts.context_cache);
+    if (new_context == NULL) {
+        EBPF_EXT_LOG_MESSAGE(
+            EBPF_EXT_TRACELOG_LEVEL_ERROR,
+            EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
+            "_net_ebpf_ext_insert_connection_context_to_list: Failed to allocate connection context");
+        result = EBPF_NO_MEMORY;
+
+        // The table is searched before the low memory list, so remove any context for this connection from the
+        // table. Otherwise its verdict would be returned instead of the one stored in the low memory list.
+        old_irql = ExAcquireSpinLockExclusive(&shard->lock);
+        old_context = _net_ebpf_ext_find_connection_context_in_shard(shard, bucket, &local_connection_context);
+        if (old_context != NULL) {
+            _net_ebpf_ext_delete_connection_context_from_shard(shard, old_context);
+            replaced = true;
+        }
+        ExReleaseSpinLockExclusive(&shard->lock, old_irql);
+    } else {
+        memset(new_context, 0, sizeof(net_ebpf_extension_connection_context_t));
+        _net_ebpf_extension_connection_context_initialize(
+            transport_endpoint_handle,
+            sock_addr_ctx,
+            CONNECTION_CONTEXT_INITIALIZATION_SET_TIMESTAMP,
+            verdict,
+            new_context);
 
-    // Insert into table.
-    new_context = (net_ebpf_extension_connection_context_t*)RtlInsertElementGenericTableAvl(
-        &_net_ebpf_ext_sock_addr_contexts.context_table, &connection_context, sizeof(connection_context), NULL);
-    EBPF_EXT_BAIL_ON_ALLOC_FAILURE_RESULT(EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR, new_context, "connection", result);
+        old_irql = ExAcquireSpinLockExclusive(&shard->lock);
 
-    // Successfully inserted into the table. Also insert into the LRU list to ensure
-    // entries are not leaked.
-    InsertHeadList(&_net_ebpf_ext_sock_addr_contexts.context_lru_list, &new_context->list_entry);
-    _net_ebpf_ext_sock_addr_contexts.context_count++;
+        // Replace the context if it exists.
+        old_context = _net_ebpf_ext_find_connection_context_in_shard(shard, bucket, new_context);
+        if (old_context != NULL) {
+            _net_ebpf_ext_delete_connection_context_from_shard(shard, old_context);
+            replaced = true;
+        }
 
-    switch (verdict) {
-    case BPF_SOCK_ADDR_VERDICT_PROCEED_HARD:
-        InterlockedIncrement(&_net_ebpf_ext_statistics.permit_hard_connection_count);
-        break;
-    case BPF_SOCK_ADDR_VERDICT_REJECT:
-        InterlockedIncrement(&_net_ebpf_ext_statistics.block_connection_count);
-        break;
-    default:
-        break;
-    }
+        // Insert into the shard's table, and into its LRU list to ensure entries are not leaked.
+        InsertHeadList(&shard->buckets[bucket], &new_context->hash_entry);
+        InsertHeadList(&shard->context_lru_list, &new_context->list_entry);
+        shard->context_count++;
 
-    EBPF_EXT_LOG_MESSAGE_UINT64(
-        EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-        EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-        "_net_ebpf_ext_insert_connection_context_to_list: Insert",
-        transport_endpoint_handle);
+        // Purge stale entries from this shard.
+        _net_ebpf_ext_purge_connection_context_shard(shard, false);
+        uint32_t shard_context_count = shard->context_count;
+        ExReleaseSpinLockExclusive(&shard->lock, old_irql);
 
-Exit:
-    if (result != EBPF_SUCCESS) {
-        // If any failure occurred, attempt to use low memory list instead.
-        result = _net_ebpf_ext_insert_connection_context_to_low_memory_list(
-            transport_endpoint_handle, sock_addr_ctx, verdict);
+        switch (verdict) {
+        case BPF_SOCK_ADDR_VERDICT_PROCEED_HARD:
+            InterlockedIncrement(&_net_ebpf_ext_statistics.permit_hard_connection_count);
+            break;
+        case BPF_SOCK_ADDR_VERDICT_REJECT:
+            InterlockedIncrement(&_net_ebpf_ext_statistics.block_connection_count);
+            break;
+        default:
+            break;
+        }
+
+        EBPF_EXT_LOG_MESSAGE_UINT64_UINT64(
+            EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
+            EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
+            "_net_ebpf_ext_insert_connection_context_to_list: Insert",
+            transport_endpoint_handle,
+            shard_context_count);
     }
 
-    // Purge stale entries from the list.
-    _net_ebpf_ext_purge_connect_contexts(false);
-    ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.lock, old_irql);
+    // The low memory list is only consulted while it is in use, or when the table insert failed.
+    if (result != EBPF_SUCCESS ||
+        (!replaced && ReadNoFence(&_net_ebpf_ext_sock_addr_contexts.low_memory_context_count) != 0)) {
+        old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.low_memory_lock);
+
+        if (!replaced) {
+            // Remove the context from the low memory list if it exists there instead.
+            uint32_t old_verdict;
+            (void)_net_ebpf_ext_find_and_remove_low_memory_connection_context_locked(
+                &local_connection_context, &old_verdict);
+        }
+
+        if (result != EBPF_SUCCESS) {
+            // If the table insert failed, attempt to use low memory list instead.
+            result = _net_ebpf_ext_insert_connection_context_to_low_memory_list(
+                transport_endpoint_handle, sock_addr_ctx, verdict);
+        }
+
+        // Purge stale entries from the low memory list.
+        _net_ebpf_ext_purge_low_memory_connection_contexts(false);
+        ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_contexts.low_memory_lock, old_irql);
+    }
 
     EBPF_EXT_RETURN_RESULT(result);
 }
@@ -1434,6 +1749,11 @@ net_ebpf_ext_sock_addr_register_providers()
     }
     connection_contexts_initialized = true;
 
+    status = _net_ebpf_ext_sock_addr_initialize_verdict_cache_statistics();
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
     status = net_ebpf_extension_program_info_provider_register(
         &program_info_provider_parameters, &_ebpf_sock_addr_program_info_provider_context);
     if (!NT_SUCCESS(status)) {
@@ -1529,10 +1849,23 @@ net_ebpf_ext_sock_addr_unregister_providers()
         _ebpf_sock_addr_program_info_provider_context = NULL;
     }
 
+    _net_ebpf_ext_sock_addr_uninitialize_verdict_cache_statistics();
     _net_ebpf_ext_uninitialize_connection_contexts();
     _net_ebpf_sock_addr_clean_up_security_descriptor();
 }
 
+void
+net_ebpf_ext_sock_addr_get_verdict_cache_statistics(
+    _Out_ net_ebpf_ext_sock_addr_verdict_cache_statistics_t* statistics)
+{
+    statistics->hit_count = 0;
+    statistics->miss_count = 0;
+    for (uint32_t cpu = 0; cpu < _net_ebpf_ext_verdict_cache_cpu_count; cpu++) {
+        statistics->hit_count += (uint64_t)ReadNoFence64(&_net_ebpf_ext_verdict_cache_cpu_statistics[cpu].hit_count);
+        statistics->miss_count += (uint64_t)ReadNoFence64(&_net_ebpf_ext_verdict_cache_cpu_statistics[cpu].miss_count);
+    }
+}
+
 typedef enum _net_ebpf_extension_sock_addr_connection_direction
 {
     EBPF_HOOK_SOCK_ADDR_INGRESS = 0,
@@ -1969,6 +2302,60 @@ _net_ebpf_extension_sock_addr_copy_wfp_listen_fields(
     sock_addr_ctx->sub_interface_index = NET_IFINDEX_UNSPECIFIED;
 }
 
+/**
+ * @brief Check, from the WFP incoming values alone, whether the programs attached to a filter context may be
+ * interested in a classify. Classify callouts call this before building the program context, so that classifies with
+ * no attached program, for another compartment or for the other address family bail out without copying the WFP
+ * values or taking the filter context lock.
+ *
+ * @param[in] filter_context Filter context of the WFP filter.
+ * @param[in] incoming_fixed_values WFP fixed values of the classify.
+ *
+ * @retval true The attached programs may be interested in the classify.
+ * @retval false No attached program is interested in the classify.
+ */
+static bool
+_net_ebpf_extension_sock_addr_is_classify_of_interest(
+    _In_ const net_ebpf_extension_sock_addr_wfp_filter_context_t* filter_context,
+    _In_ const FWPS_INCOMING_VALUES* incoming_fixed_values)
+{
+    net_ebpf_extension_hook_id_t hook_id =
+        net_ebpf_extension_get_hook_id_from_wfp_layer_id(incoming_fixed_values->layerId);
+    const FWPS_INCOMING_VALUE0* incoming_values = incoming_fixed_values->incomingValue;
+    const wfp_ale_layer_fields_t* fields;
+
+    if (!net_ebpf_ext_filter_context_has_clients(&filter_context->base)) {
+        return false;
+    }
+
+    if (hook_id == EBPF_HOOK_ALE_RESOURCE_ALLOC_V4 || hook_id == EBPF_HOOK_ALE_RESOURCE_ALLOC_V6) {
+        fields = &wfp_bind_fields[hook_id - EBPF_HOOK_ALE_RESOURCE_ALLOC_V4];
+    } else {
+        ASSERT(hook_id >= EBPF_HOOK_ALE_AUTH_CONNECT_V4 && hook_id <= EBPF_HOOK_ALE_AUTH_LISTEN_V6);
+#pragma warning(suppress : 33010) // Unchecked lower bound for enum hook_id used as index.
+        fields = &wfp_connection_fields[hook_id - EBPF_HOOK_ALE_AUTH_CONNECT_V4];
+    }
+
+    if (filter_context->compartment_id != UNSPECIFIED_COMPARTMENT_ID &&
+        filter_context->compartment_id != incoming_values[fields->compartment_id_field].value.uint32) {
+        return false;
+    }
+
+    // Connections to v4-mapped addresses are classified at the v6 connect_redirect layer, where the filter contexts
+    // of both attach types see every connection. Re-authorizations are left to the classify callout, which permits
+    // them regardless of the address family.
+    if (hook_id == EBPF_HOOK_ALE_CONNECT_REDIRECT_V6 &&
+        (incoming_values[fields->flags_field].value.uint32 & FWP_CONDITION_FLAG_IS_REAUTHORIZE) == 0) {
+        bool v4_mapped =
+            IN6_IS_ADDR_V4MAPPED((IN6_ADDR*)incoming_values[fields->remote_ip_address_field].value.byteArray16);
+        if (v4_mapped != (filter_context->v4_attach_type != FALSE)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static void
 _net_ebpf_ext_sock_addr_redirected(
     _In_ const bpf_sock_addr_t* original_context,
@@ -2033,6 +2420,16 @@ _net_ebpf_extension_sock_addr_process_verdict(_Inout_ void* program_context, int
     // It points to a caller's stack variable and is only valid during synchronous program invocation.
     ASSERT(original_context != NULL);
 
+    // Only connect programs can allow their verdict to be cached, and a verdict is only cached if every program in
+    // the chain allows it.
+    if ((context->hook_id == EBPF_HOOK_ALE_CONNECT_REDIRECT_V4) ||
+        (context->hook_id == EBPF_HOOK_ALE_CONNECT_REDIRECT_V6)) {
+        if ((program_verdict & BPF_SOCK_ADDR_VERDICT_CACHEABLE) == 0) {
+            context->verdict_cacheable = FALSE;
+        }
+        normalized_verdict = _normalize_sock_addr_verdict(program_verdict & ~BPF_SOCK_ADDR_VERDICT_CACHEABLE);
+    }
+
     _net_ebpf_ext_sock_addr_redirected(original_context, &local_context, &redirected, &address_changed);
     context->redirected = redirected;
     context->address_changed = address_changed;
@@ -2134,12 +2531,13 @@ net_ebpf_extension_sock_addr_authorize_listen_classify(
         goto Exit;
     }
 
-    if (filter_context->base.context_deleting) {
-        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    // Note: This is intentionally not guarded by a lock, so that classifies no program is interested in bail out
+    // before the program context is built.
+    if (!_net_ebpf_extension_sock_addr_is_classify_of_interest(filter_context, incoming_fixed_values)) {
+        EBPF_EXT_LOG_MESSAGE(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "net_ebpf_extension_sock_addr_authorize_listen_classify - Client detach detected.",
-            STATUS_INVALID_PARAMETER);
+            "net_ebpf_extension_sock_addr_authorize_listen_classify - No program is interested.");
         goto Exit;
     }
 
@@ -2249,14 +2647,13 @@ net_ebpf_extension_sock_addr_authorize_recv_accept_classify(
         goto Exit;
     }
 
-    // Note: This is intentionally not guarded by a lock as this is opportunistically checking if all the
-    // clients have detached and the filter context is being deleted.
-    if (filter_context->base.context_deleting) {
-        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    // Note: This is intentionally not guarded by a lock, so that classifies no program is interested in bail out
+    // before the program context is built.
+    if (!_net_ebpf_extension_sock_addr_is_classify_of_interest(filter_context, incoming_fixed_values)) {
+        EBPF_EXT_LOG_MESSAGE(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "net_ebpf_extension_sock_addr_authorize_recv_accept_classify - Client detach detected.",
-            STATUS_INVALID_PARAMETER);
+            "net_ebpf_extension_sock_addr_authorize_recv_accept_classify - No program is interested.");
         goto Exit;
     }
 
@@ -2369,23 +2766,19 @@ net_ebpf_extension_sock_addr_bind_classify(
         goto Exit;
     }
 
-    if (filter_context->base.context_deleting) {
-        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    // Note: This is intentionally not guarded by a lock, so that classifies no program is interested in (such as
+    // binds in other compartments) bail out before the program context is built.
+    if (!_net_ebpf_extension_sock_addr_is_classify_of_interest(filter_context, incoming_fixed_values)) {
+        EBPF_EXT_LOG_MESSAGE(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "net_ebpf_extension_sock_addr_bind_classify - Client detach detected.",
-            STATUS_INVALID_PARAMETER);
+            "net_ebpf_extension_sock_addr_bind_classify - No program is interested.");
         goto Exit;
     }
 
     _net_ebpf_extension_sock_addr_copy_wfp_bind_fields(
         incoming_fixed_values, incoming_metadata_values, &net_ebpf_sock_addr_ctx);
-
     compartment_id = filter_context->compartment_id;
-    if (compartment_id != UNSPECIFIED_COMPARTMENT_ID && compartment_id != sock_addr_ctx->compartment_id) {
-        // The client is not interested in this compartment Id.
-        goto Exit;
-    }
 
     // Initialize the accumulated verdict to PROCEED_SOFT so that if no program updates it
     // (e.g. all clients are filtered out), the bind defaults to permit.
@@ -2483,14 +2876,13 @@ net_ebpf_extension_sock_addr_authorize_connection_classify(
         goto Exit;
     }
 
-    // Note: This is intentionally not guarded by a lock as this is opportunistically checking if all the
-    // clients have detached and the filter context is being deleted.
-    if (filter_context->base.context_deleting) {
-        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    // Note: This is intentionally not guarded by a lock, so that classifies no program is interested in bail out
+    // before the program context is built.
+    if (!_net_ebpf_extension_sock_addr_is_classify_of_interest(filter_context, incoming_fixed_values)) {
+        EBPF_EXT_LOG_MESSAGE(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "net_ebpf_extension_sock_addr_authorize_connection_classify - Client detach detected.",
-            STATUS_INVALID_PARAMETER);
+            "net_ebpf_extension_sock_addr_authorize_connection_classify - No program is interested.");
         verdict = BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT;
         goto Exit;
     }
@@ -2875,15 +3267,16 @@ net_ebpf_extension_sock_addr_redirect_connection_classify(
         goto Exit;
     }
 
-    // Note: This is intentionally not guarded by a lock as this is opportunistically checking if all the
-    // clients have detached and the filter context is being deleted.
-    if (filter_context->base.context_deleting) {
-        EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    // Note: This is intentionally not guarded by a lock, so that classifies no program is interested in (such as
+    // v6 connections at the filters of the v4 attach type) bail out before the program context is built.
+    if (!_net_ebpf_extension_sock_addr_is_classify_of_interest(filter_context, incoming_fixed_values)) {
+        EBPF_EXT_LOG_MESSAGE(
             EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "net_ebpf_extension_sock_addr_redirect_connection_classify - Client detach detected.",
-            STATUS_INVALID_PARAMETER);
+            "net_ebpf_extension_sock_addr_redirect_connection_classify - No program is interested.");
         verdict = BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT;
+        // The program context has not been built, so there is no connection to cache a verdict for.
+        cache_verdict = FALSE;
         goto Exit;
     }
 
@@ -2976,10 +3369,64 @@ net_ebpf_extension_sock_addr_redirect_connection_classify(
     memcpy(&sock_addr_ctx_original, sock_addr_ctx, sizeof(sock_addr_ctx_original));
     net_ebpf_sock_addr_ctx.original_context = &sock_addr_ctx_original;
 
-    // This parameter is not used. Verdict in net_ebpf_sock_addr_ctx is used instead as long as it's valid.
-    uint32_t ignored_verdict;
-    result = net_ebpf_extension_hook_expand_stack_and_invoke_filtered_programs(
-        sock_addr_ctx, &filter_context->base, &ignored_verdict, _net_ebpf_extension_sock_addr_is_connect_program);
+    // The cache is only used once a program has allowed its verdict to be cached, so connects to hooks whose programs
+    // never do pay nothing for it. The generations must be read before the programs are invoked, so that a verdict
+    // produced by a client snapshot that is replaced, or from map entries that are updated, during the invocation is
+    // never used.
+    uint64_t verdict_cache_generation = 0;
+    uint64_t verdict_cache_map_update_generation = 0;
+    bool verdict_cacheable = false;
+    net_ebpf_ext_sock_addr_verdict_cache_key_t verdict_cache_key;
+    uint32_t verdict_cache_hash = 0;
+    uint32_t cached_verdict;
+    if (filter_context->verdict_cache_in_use) {
+        verdict_cacheable = net_ebpf_ext_get_program_generations(
+            &filter_context->base, &verdict_cache_generation, &verdict_cache_map_update_generation);
+        if (verdict_cacheable) {
+            _net_ebpf_ext_sock_addr_get_verdict_cache_key(&net_ebpf_sock_addr_ctx, &verdict_cache_key);
+            verdict_cache_hash = _net_ebpf_ext_sock_addr_verdict_cache_hash(&verdict_cache_key);
+        }
+    }
+
+    if (verdict_cacheable &&
+        _net_ebpf_ext_sock_addr_lookup_cached_verdict(
+            filter_context,
+            &verdict_cache_key,
+            verdict_cache_hash,
+            verdict_cache_generation,
+            verdict_cache_map_update_generation,
+            &cached_verdict)) {
+        InterlockedIncrement64(&_net_ebpf_ext_sock_addr_get_verdict_cache_cpu_statistics()->hit_count);
+        net_ebpf_sock_addr_ctx.verdict = (int32_t)cached_verdict;
+        result = EBPF_SUCCESS;
+    } else {
+        if (verdict_cacheable) {
+            InterlockedIncrement64(&_net_ebpf_ext_sock_addr_get_verdict_cache_cpu_statistics()->miss_count);
+        }
+
+        // This parameter is not used. Verdict in net_ebpf_sock_addr_ctx is used instead as long as it's valid.
+        uint32_t ignored_verdict;
+        net_ebpf_sock_addr_ctx.verdict_cacheable = TRUE;
+        result = net_ebpf_extension_hook_expand_stack_and_invoke_filtered_programs(
+            sock_addr_ctx, &filter_context->base, &ignored_verdict, _net_ebpf_extension_sock_addr_is_connect_program);
+
+        if (result == EBPF_SUCCESS && net_ebpf_sock_addr_ctx.verdict_cacheable && !net_ebpf_sock_addr_ctx.redirected &&
+            net_ebpf_sock_addr_ctx.verdict >= 0) {
+            if (verdict_cacheable) {
+                _net_ebpf_ext_sock_addr_insert_cached_verdict(
+                    filter_context,
+                    &verdict_cache_key,
+                    verdict_cache_hash,
+                    verdict_cache_generation,
+                    verdict_cache_map_update_generation,
+                    (uint32_t)net_ebpf_sock_addr_ctx.verdict);
+            } else if (!filter_context->verdict_cache_in_use) {
+                // The generations were not read for this connect, so its verdict can't be cached. Later connects will
+                // read them.
+                filter_context->verdict_cache_in_use = TRUE;
+            }
+        }
+    }
 
     if (net_ebpf_sock_addr_ctx.verdict >= 0) {
         verdict = net_ebpf_sock_addr_ctx.verdict;
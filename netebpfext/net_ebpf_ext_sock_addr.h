@@ -247,3 +247,21 @@ net_ebpf_ext_sock_addr_unregister_providers();
  */
 NTSTATUS
 net_ebpf_ext_sock_addr_register_providers();
+
+/**
+ * @brief Counters for the CGROUP_INET4_CONNECT and CGROUP_INET6_CONNECT verdict cache.
+ */
+typedef struct _net_ebpf_ext_sock_addr_verdict_cache_statistics
+{
+    uint64_t hit_count;  ///< Number of connections given a cached verdict without invoking the programs.
+    uint64_t miss_count; ///< Number of connections for which a cached verdict was looked up but not found.
+} net_ebpf_ext_sock_addr_verdict_cache_statistics_t;
+
+/**
+ * @brief Get the counters of the CGROUP_INET4_CONNECT and CGROUP_INET6_CONNECT verdict cache.
+ *
+ * @param[out] statistics Cache hit and miss counts.
+ */
+void
+net_ebpf_ext_sock_addr_get_verdict_cache_statistics(
+    _Out_ net_ebpf_ext_sock_addr_verdict_cache_statistics_t* statistics);
@@ -31,17 +31,26 @@ typedef struct _net_ebpf_bpf_sock_ops
 typedef struct _net_ebpf_extension_sock_ops_wfp_flow_context
 {
     LIST_ENTRY link;                                         ///< Link to next flow context.
+    uint32_t shard_index;                                    ///< Index of the flow context shard holding the link.
     net_ebpf_extension_flow_context_parameters_t parameters; ///< WFP flow parameters.
     struct _net_ebpf_extension_sock_ops_wfp_filter_context*
         filter_context;          ///< WFP filter context associated with this flow.
     net_ebpf_sock_ops_t context; ///< sock_ops context.
 } net_ebpf_extension_sock_ops_wfp_flow_context_t;
 
-typedef struct _net_ebpf_extension_sock_ops_wfp_flow_context_list
+// Number of independently locked flow context lists per filter context. Must be a power of two.
+#define NET_EBPF_SOCK_OPS_FLOW_CONTEXT_SHARD_COUNT 64
+
+/**
+ * @brief Flow contexts of a filter context that were created on a subset of the CPUs. A flow is added to the shard of
+ * the CPU it is established on, and removed from the same shard, usually by the same CPU, when it is deleted.
+ */
+__declspec(align(EBPF_CACHE_LINE_SIZE)) typedef struct _net_ebpf_extension_sock_ops_wfp_flow_context_shard
 {
-    uint32_t count;       ///< Number of flow contexts in the list.
-    LIST_ENTRY list_head; ///< Head to the list of WFP flow contexts.
-} net_ebpf_extension_sock_ops_wfp_flow_context_list_t;
+    KSPIN_LOCK lock;                         ///< Lock for synchronization.
+    _Guarded_by_(lock) uint32_t count;       ///< Number of flow contexts in the list.
+    _Guarded_by_(lock) LIST_ENTRY list_head; ///< Head to the list of WFP flow contexts.
+} net_ebpf_extension_sock_ops_wfp_flow_context_shard_t;
 
 const net_ebpf_extension_wfp_filter_parameters_t _net_ebpf_extension_sock_ops_wfp_filter_parameters[] = {
     {&FWPM_LAYER_ALE_FLOW_ESTABLISHED_V4,
@@ -57,13 +66,25 @@ const net_ebpf_extension_wfp_filter_parameters_t _net_ebpf_extension_sock_ops_wf
 
 #define NET_EBPF_SOCK_OPS_FILTER_COUNT EBPF_COUNT_OF(_net_ebpf_extension_sock_ops_wfp_filter_parameters)
 
+// Maximum number of free flow contexts cached per CPU. Flows are created and deleted at connection rate, so the cache
+// only needs to absorb bursts of churn on each CPU.
+#define NET_EBPF_SOCK_OPS_FLOW_CONTEXT_CACHE_DEPTH 256
+
+// Maximum number of free test-run contexts cached per CPU.
+#define NET_EBPF_SOCK_OPS_TEST_RUN_CONTEXT_CACHE_DEPTH 16
+
+// Cache of flow contexts. Initialized with the WFP callouts, since flow contexts are freed from flowDeleteFn.
+static net_ebpf_extension_lookaside_t _net_ebpf_sock_ops_flow_context_cache = {0};
+
+// Cache of program test-run contexts. Initialized with the NPI providers.
+static net_ebpf_extension_lookaside_t _net_ebpf_sock_ops_test_run_context_cache = {0};
+
 typedef struct _net_ebpf_extension_sock_ops_wfp_filter_context
 {
     net_ebpf_extension_wfp_filter_context_t base;
     uint32_t compartment_id; ///< Compartment Id condition value for the filters (if any).
-    KSPIN_LOCK lock;         ///< Lock for synchronization.
-    _Guarded_by_(lock) net_ebpf_extension_sock_ops_wfp_flow_context_list_t
-        flow_context_list; ///< List of flow contexts associated with WFP flows.
+    net_ebpf_extension_sock_ops_wfp_flow_context_shard_t
+        flow_context_shards[NET_EBPF_SOCK_OPS_FLOW_CONTEXT_SHARD_COUNT]; ///< Flow contexts associated with WFP flows.
 } net_ebpf_extension_sock_ops_wfp_filter_context_t;
 
 //
@@ -211,8 +232,10 @@ _net_ebpf_extension_sock_ops_create_filter_context(
 
     local_filter_context->compartment_id = compartment_id;
     local_filter_context->base.filter_ids_count = NET_EBPF_SOCK_OPS_FILTER_COUNT;
-    KeInitializeSpinLock(&local_filter_context->lock);
-    InitializeListHead(&local_filter_context->flow_context_list.list_head);
+    for (uint32_t i = 0; i < NET_EBPF_SOCK_OPS_FLOW_CONTEXT_SHARD_COUNT; i++) {
+        KeInitializeSpinLock(&local_filter_context->flow_context_shards[i].lock);
+        InitializeListHead(&local_filter_context->flow_context_shards[i].list_head);
+    }
 
     // Add WFP filters at appropriate layers and set the hook NPI client as the filter's raw context.
     filter_count = NET_EBPF_SOCK_OPS_FILTER_COUNT;
@@ -294,17 +317,21 @@ _net_ebpf_extension_sock_ops_delete_filter_context(
         local_filter_context->base.filter_ids_count,
         local_filter_context->base.filter_ids);
 
-    KeAcquireSpinLock(&local_filter_context->lock, &irql);
-    if (local_filter_context->flow_context_list.count > 0) {
+    // Sweep the flow contexts out of every shard.
+    for (uint32_t i = 0; i < NET_EBPF_SOCK_OPS_FLOW_CONTEXT_SHARD_COUNT; i++) {
+        net_ebpf_extension_sock_ops_wfp_flow_context_shard_t* shard = &local_filter_context->flow_context_shards[i];
+        KeAcquireSpinLock(&shard->lock, &irql);
+        if (shard->count > 0) {
 
-        LIST_ENTRY* entry = local_filter_context->flow_context_list.list_head.Flink;
-        RemoveEntryList(&local_filter_context->flow_context_list.list_head);
-        InitializeListHead(&local_filter_context->flow_context_list.list_head);
-        AppendTailList(&local_list_head, entry);
+            LIST_ENTRY* entry = shard->list_head.Flink;
+            RemoveEntryList(&shard->list_head);
+            InitializeListHead(&shard->list_head);
+            AppendTailList(&local_list_head, entry);
 
-        local_filter_context->flow_context_list.count = 0;
+            shard->count = 0;
+        }
+        KeReleaseSpinLock(&shard->lock, irql);
     }
-    KeReleaseSpinLock(&local_filter_context->lock, irql);
 
     // Remove the flow context associated with the WFP flows.
     while (!IsListEmpty(&local_list_head)) {
@@ -349,6 +376,14 @@ net_ebpf_ext_sock_ops_register_providers()
 
     EBPF_EXT_LOG_ENTRY();
 
+    status = net_ebpf_extension_lookaside_initialize(
+        &_net_ebpf_sock_ops_test_run_context_cache,
+        sizeof(net_ebpf_sock_ops_t),
+        NET_EBPF_SOCK_OPS_TEST_RUN_CONTEXT_CACHE_DEPTH);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
     status = net_ebpf_extension_program_info_provider_register(
         &program_info_provider_parameters, &_ebpf_sock_ops_program_info_provider_context);
     if (!NT_SUCCESS(status)) {
@@ -395,6 +430,28 @@ net_ebpf_ext_sock_ops_unregister_providers()
         net_ebpf_extension_program_info_provider_unregister(_ebpf_sock_ops_program_info_provider_context);
         _ebpf_sock_ops_program_info_provider_context = NULL;
     }
+    net_ebpf_extension_lookaside_uninitialize(&_net_ebpf_sock_ops_test_run_context_cache);
+}
+
+NTSTATUS
+net_ebpf_ext_sock_ops_initialize_flow_context_cache()
+{
+    return net_ebpf_extension_lookaside_initialize(
+        &_net_ebpf_sock_ops_flow_context_cache,
+        sizeof(net_ebpf_extension_sock_ops_wfp_flow_context_t),
+        NET_EBPF_SOCK_OPS_FLOW_CONTEXT_CACHE_DEPTH);
+}
+
+void
+net_ebpf_ext_sock_ops_uninitialize_flow_context_cache()
+{
+    net_ebpf_extension_lookaside_uninitialize(&_net_ebpf_sock_ops_flow_context_cache);
+}
+
+void
+net_ebpf_ext_sock_ops_get_flow_context_cache_statistics(_Out_ net_ebpf_extension_lookaside_statistics_t* statistics)
+{
+    net_ebpf_extension_lookaside_get_statistics(&_net_ebpf_sock_ops_flow_context_cache, statistics);
 }
 
 wfp_ale_layer_fields_t wfp_flow_established_fields[] = {
@@ -487,8 +544,11 @@ net_ebpf_extension_sock_ops_flow_established_classify(
     net_ebpf_extension_sock_ops_wfp_flow_context_t* local_flow_context = NULL;
     bpf_sock_ops_t* sock_ops_context = NULL;
     uint32_t client_compartment_id = UNSPECIFIED_COMPARTMENT_ID;
+    uint32_t flow_compartment_id;
     net_ebpf_extension_hook_id_t hook_id =
         net_ebpf_extension_get_hook_id_from_wfp_layer_id(incoming_fixed_values->layerId);
+    const wfp_ale_layer_fields_t* fields;
+    net_ebpf_extension_sock_ops_wfp_flow_context_shard_t* shard = NULL;
     KIRQL old_irql = PASSIVE_LEVEL;
     ebpf_result_t program_result;
 
@@ -513,8 +573,23 @@ net_ebpf_extension_sock_ops_flow_established_classify(
         goto Exit;
     }
 
-    local_flow_context = (net_ebpf_extension_sock_ops_wfp_flow_context_t*)ExAllocatePoolUninitialized(
-        NonPagedPoolNx, sizeof(net_ebpf_extension_sock_ops_wfp_flow_context_t), NET_EBPF_EXTENSION_POOL_TAG);
+    // Reject flows in compartments the client is not interested in before allocating a flow context for them.
+    fields = &wfp_flow_established_fields[hook_id - EBPF_HOOK_ALE_FLOW_ESTABLISHED_V4];
+    flow_compartment_id = incoming_fixed_values->incomingValue[fields->compartment_id_field].value.uint32;
+    client_compartment_id = filter_context->compartment_id;
+    ASSERT((client_compartment_id == UNSPECIFIED_COMPARTMENT_ID) || (client_compartment_id == flow_compartment_id));
+    if (client_compartment_id != UNSPECIFIED_COMPARTMENT_ID && client_compartment_id != flow_compartment_id) {
+        // The client is not interested in this compartment Id.
+        EBPF_EXT_LOG_MESSAGE_UINT32(
+            EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
+            EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS,
+            "The cgroup_sock_ops eBPF program is not interested in this compartmentId",
+            flow_compartment_id);
+        goto Exit;
+    }
+
+    local_flow_context = (net_ebpf_extension_sock_ops_wfp_flow_context_t*)net_ebpf_extension_lookaside_allocate(
+        &_net_ebpf_sock_ops_flow_context_cache);
     EBPF_EXT_BAIL_ON_ALLOC_FAILURE_RESULT(
         EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS, local_flow_context, "flow_context", result);
     memset(local_flow_context, 0, sizeof(net_ebpf_extension_sock_ops_wfp_flow_context_t));
@@ -527,21 +602,6 @@ net_ebpf_extension_sock_ops_flow_established_classify(
     _net_ebpf_extension_sock_ops_copy_wfp_connection_fields(
         incoming_fixed_values, incoming_metadata_values, &local_flow_context->context);
 
-    client_compartment_id = filter_context->compartment_id;
-    ASSERT(
-        (client_compartment_id == UNSPECIFIED_COMPARTMENT_ID) ||
-        (client_compartment_id == sock_ops_context->compartment_id));
-    if (client_compartment_id != UNSPECIFIED_COMPARTMENT_ID &&
-        client_compartment_id != sock_ops_context->compartment_id) {
-        // The client is not interested in this compartment Id.
-        EBPF_EXT_LOG_MESSAGE_UINT32(
-            EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS,
-            "The cgroup_sock_ops eBPF program is not interested in this compartmentId",
-            sock_ops_context->compartment_id);
-        goto Exit;
-    }
-
     local_flow_context->parameters.flow_id = incoming_metadata_values->flowHandle;
     local_flow_context->parameters.layer_id = incoming_fixed_values->layerId;
     local_flow_context->parameters.callout_id = net_ebpf_extension_get_callout_id_for_hook(hook_id);
@@ -582,10 +642,13 @@ net_ebpf_extension_sock_ops_flow_established_classify(
         "New flow created.",
         local_flow_context->parameters.flow_id);
 
-    KeAcquireSpinLock(&filter_context->lock, &old_irql);
-    InsertTailList(&filter_context->flow_context_list.list_head, &local_flow_context->link);
-    filter_context->flow_context_list.count++;
-    KeReleaseSpinLock(&filter_context->lock, old_irql);
+    local_flow_context->shard_index =
+        KeGetCurrentProcessorNumberEx(NULL) & (NET_EBPF_SOCK_OPS_FLOW_CONTEXT_SHARD_COUNT - 1);
+    shard = &filter_context->flow_context_shards[local_flow_context->shard_index];
+    KeAcquireSpinLock(&shard->lock, &old_irql);
+    InsertTailList(&shard->list_head, &local_flow_context->link);
+    shard->count++;
+    KeReleaseSpinLock(&shard->lock, old_irql);
     local_flow_context = NULL;
 
     classify_output->actionType = (result == 0) ? FWP_ACTION_PERMIT : FWP_ACTION_BLOCK;
@@ -598,7 +661,7 @@ Exit:
         if (local_flow_context->filter_context != NULL) {
             DEREFERENCE_FILTER_CONTEXT(&local_flow_context->filter_context->base);
         }
-        ExFreePool(local_flow_context);
+        net_ebpf_extension_lookaside_free(&_net_ebpf_sock_ops_flow_context_cache, local_flow_context);
     }
 }
 
@@ -610,6 +673,7 @@ net_ebpf_extension_sock_ops_flow_delete(uint16_t layer_id, uint32_t callout_id,
     net_ebpf_extension_sock_ops_wfp_filter_context_t* filter_context = NULL;
     bpf_sock_ops_t* sock_ops_context = NULL;
     uint32_t result;
+    net_ebpf_extension_sock_ops_wfp_flow_context_shard_t* shard = NULL;
     KIRQL irql = 0;
 
     UNREFERENCED_PARAMETER(layer_id);
@@ -629,10 +693,11 @@ net_ebpf_extension_sock_ops_flow_delete(uint16_t layer_id, uint32_t callout_id,
         goto Exit;
     }
 
-    KeAcquireSpinLock(&filter_context->lock, &irql);
+    shard = &filter_context->flow_context_shards[local_flow_context->shard_index];
+    KeAcquireSpinLock(&shard->lock, &irql);
     RemoveEntryList(&local_flow_context->link);
-    filter_context->flow_context_list.count--;
-    KeReleaseSpinLock(&filter_context->lock, irql);
+    shard->count--;
+    KeReleaseSpinLock(&shard->lock, irql);
 
     EBPF_EXT_LOG_MESSAGE_UINT64(
         EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
@@ -653,7 +718,7 @@ Exit:
     }
 
     if (local_flow_context != NULL) {
-        ExFreePool(local_flow_context);
+        net_ebpf_extension_lookaside_free(&_net_ebpf_sock_ops_flow_context_cache, local_flow_context);
     }
 }
 
@@ -686,8 +751,8 @@ _ebpf_sock_ops_context_create(
         goto Exit;
     }
 
-    context_header = (net_ebpf_sock_ops_t*)ExAllocatePoolUninitialized(
-        NonPagedPoolNx, sizeof(net_ebpf_sock_ops_t), NET_EBPF_EXTENSION_POOL_TAG);
+    context_header =
+        (net_ebpf_sock_ops_t*)net_ebpf_extension_lookaside_allocate(&_net_ebpf_sock_ops_test_run_context_cache);
 
     if (context_header == NULL) {
         result = EBPF_NO_MEMORY;
@@ -703,7 +768,7 @@ _ebpf_sock_ops_context_create(
 
 Exit:
     if (context_header != NULL) {
-        ExFreePool(context_header);
+        net_ebpf_extension_lookaside_free(&_net_ebpf_sock_ops_test_run_context_cache, context_header);
     }
 
     EBPF_EXT_RETURN_RESULT(result);
@@ -737,7 +802,7 @@ _ebpf_sock_ops_context_destroy(
         *context_size_out = 0;
     }
 
-    ExFreePool(context_header);
+    net_ebpf_extension_lookaside_free(&_net_ebpf_sock_ops_test_run_context_cache, context_header);
 Exit:
     EBPF_EXT_LOG_EXIT();
 }
@@ -71,3 +71,29 @@ net_ebpf_ext_sock_ops_unregister_providers();
  */
 NTSTATUS
 net_ebpf_ext_sock_ops_register_providers();
+
+/**
+ * @brief Initialize the cache that SOCK_OPS flow contexts are allocated from. Flow contexts are freed by the WFP
+ * flowDeleteFn callback, which can run until the callouts are unregistered, so the cache is tied to the lifetime of
+ * the WFP callouts instead of the NPI providers.
+ *
+ * @retval STATUS_SUCCESS Operation succeeded.
+ * @retval STATUS_INSUFFICIENT_RESOURCES Unable to allocate the cache. Flow contexts are allocated from the pool.
+ */
+NTSTATUS
+net_ebpf_ext_sock_ops_initialize_flow_context_cache();
+
+/**
+ * @brief Free the cache that SOCK_OPS flow contexts are allocated from. Must be called after the WFP callouts are
+ * unregistered.
+ */
+void
+net_ebpf_ext_sock_ops_uninitialize_flow_context_cache();
+
+/**
+ * @brief Get the allocation statistics of the SOCK_OPS flow context cache.
+ *
+ * @param[out] statistics Allocation and cache hit counts.
+ */
+void
+net_ebpf_ext_sock_ops_get_flow_context_cache_statistics(_Out_ net_ebpf_extension_lookaside_statistics_t* statistics);
@@ -113,8 +113,14 @@ typedef struct _net_ebpf_extension_hook_client
     const void* client_binding_context;            ///< Client supplied context to be passed when invoking eBPF program.
     const ebpf_extension_data_t* client_data;      ///< Client supplied attach parameters.
     ebpf_program_invoke_function_t invoke_program; ///< Pointer to function to invoke eBPF program.
+    ebpf_program_batch_begin_invoke_function_t batch_begin; ///< (Optional) Function to begin a batch invocation.
+    ebpf_program_batch_invoke_function_t batch_invoke;      ///< (Optional) Function to invoke eBPF program in a batch.
+    ebpf_program_batch_end_invoke_function_t batch_end;     ///< (Optional) Function to end a batch invocation.
+    ebpf_program_get_map_update_generation_function_t
+        get_map_update_generation;   ///< (Optional) Function to get the map update generation.
     void* provider_data;             ///< Opaque pointer to hook specific data associated with this client.
     PIO_WORKITEM detach_work_item;   ///< Pointer to IO work item that is invoked to detach the client.
+    struct _net_ebpf_extension_hook_client_snapshot* detach_snapshot; ///< Preallocated snapshot used on detach.
     ebpf_ext_hook_rundown_t rundown; ///< Pointer to rundown object used to synchronize detach operation.
     ebpf_attach_type_t attach_type;  ///< Attach type of the eBPF program.
 } net_ebpf_extension_hook_client_t;
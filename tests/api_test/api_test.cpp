@@ -25,6 +25,7 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <io.h>
@@ -3879,6 +3880,270 @@ TEST_CASE("ebpf_program_info_from_verifier_api", "[ebpf_api]")
 }
 
 // Test eBPF memory-based verification APIs.
+// Compare the throughput of single-element updates through the IOCTL path with the shared-memory map operation queue.
+TEST_CASE("ebpf_map_op_queue_throughput", "[ebpf_api]")
+{
+    const uint32_t max_entries = 1024 * 16;
+    const uint32_t iterations = 8;
+    const size_t ring_size = 1024 * 1024;
+    fd_t map_fd =
+        bpf_map_create(BPF_MAP_TYPE_HASH, "op_queue_perf", sizeof(uint32_t), sizeof(uint64_t), max_entries, nullptr);
+    REQUIRE(map_fd > 0);
+
+    ebpf_map_op_queue_t* queue = nullptr;
+    REQUIRE(ebpf_map_op_queue_create(ring_size, &queue) == EBPF_SUCCESS);
+    auto cleanup = std::unique_ptr<void, std::function<void(void*)>>(reinterpret_cast<void*>(1), [&](void*) {
+        ebpf_map_op_queue_destroy(queue);
+        _close(map_fd);
+    });
+
+    const size_t operation_count = (size_t)max_entries * iterations;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t key = 0; key < max_entries; key++) {
+            uint64_t value = (uint64_t)i * key;
+            REQUIRE(bpf_map_update_elem(map_fd, &key, &value, BPF_ANY) == 0);
+        }
+    }
+    std::chrono::duration<double> ioctl_duration = std::chrono::high_resolution_clock::now() - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t queued = 0;
+    size_t completed = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t key = 0; key < max_entries; key++) {
+            uint64_t value = (uint64_t)i * key;
+            ebpf_result_t result;
+            for (;;) {
+                result = ebpf_map_op_queue_update_elem(
+                    queue, map_fd, &key, sizeof(key), &value, sizeof(value), BPF_ANY, queued);
+                if (result != EBPF_NO_MEMORY) {
+                    break;
+                }
+                // The submission ring is full: publish it and reap results until there is room again.
+                REQUIRE(ebpf_map_op_queue_submit(queue) == EBPF_SUCCESS);
+                ebpf_map_op_result_t op_result;
+                REQUIRE(ebpf_map_op_queue_get_result(queue, &op_result, nullptr, 0, INFINITE) == EBPF_SUCCESS);
+                REQUIRE(op_result.result == EBPF_SUCCESS);
+                completed++;
+            }
+            REQUIRE(result == EBPF_SUCCESS);
+            queued++;
+        }
+    }
+    REQUIRE(ebpf_map_op_queue_submit(queue) == EBPF_SUCCESS);
+    while (completed < queued) {
+        ebpf_map_op_result_t op_result;
+        REQUIRE(ebpf_map_op_queue_get_result(queue, &op_result, nullptr, 0, INFINITE) == EBPF_SUCCESS);
+        REQUIRE(op_result.result == EBPF_SUCCESS);
+        completed++;
+    }
+    std::chrono::duration<double> queue_duration = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << "bpf_map_update_elem: " << (uint64_t)(operation_count / ioctl_duration.count()) << " ops/sec\n";
+    std::cout << "ebpf_map_op_queue_update_elem: " << (uint64_t)(operation_count / queue_duration.count())
+              << " ops/sec\n";
+
+    uint32_t key = max_entries - 1;
+    uint64_t value = 0;
+    REQUIRE(bpf_map_lookup_elem(map_fd, &key, &value) == 0);
+    REQUIRE(value == (uint64_t)(iterations - 1) * key);
+}
+
+TEST_CASE("ebpf_map_mmap_latency", "[ebpf_api]")
+{
+    const uint32_t max_entries = 1024;
+    const uint32_t iterations = 64;
+    bpf_map_create_opts opts = {.sz = sizeof(opts), .map_flags = BPF_F_MMAPABLE};
+    fd_t map_fd =
+        bpf_map_create(BPF_MAP_TYPE_ARRAY, "mmap_perf", sizeof(uint32_t), sizeof(uint64_t), max_entries, &opts);
+    REQUIRE(map_fd > 0);
+
+    void* data = nullptr;
+    size_t size = 0;
+    REQUIRE(ebpf_map_mmap(map_fd, true, &data, &size) == EBPF_SUCCESS);
+    auto cleanup = std::unique_ptr<void, std::function<void(void*)>>(reinterpret_cast<void*>(1), [&](void*) {
+        (void)ebpf_map_munmap(map_fd, data);
+        _close(map_fd);
+    });
+    auto values = static_cast<volatile uint64_t*>(data);
+
+    for (uint32_t key = 0; key < max_entries; key++) {
+        uint64_t value = key;
+        REQUIRE(bpf_map_update_elem(map_fd, &key, &value, BPF_ANY) == 0);
+    }
+
+    const size_t operation_count = (size_t)max_entries * iterations;
+    uint64_t ioctl_sum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t key = 0; key < max_entries; key++) {
+            uint64_t value = 0;
+            REQUIRE(bpf_map_lookup_elem(map_fd, &key, &value) == 0);
+            ioctl_sum += value;
+        }
+    }
+    std::chrono::duration<double, std::nano> ioctl_duration = std::chrono::high_resolution_clock::now() - start;
+
+    uint64_t mapped_sum = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t key = 0; key < max_entries; key++) {
+            mapped_sum += values[key];
+        }
+    }
+    std::chrono::duration<double, std::nano> mapped_duration = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << "bpf_map_lookup_elem: " << ioctl_duration.count() / operation_count << " ns/op\n";
+    std::cout << "ebpf_map_mmap read: " << mapped_duration.count() / operation_count << " ns/op\n";
+    REQUIRE(mapped_sum == ioctl_sum);
+}
+
+#if !defined(CONFIG_BPF_JIT_DISABLED)
+TEST_CASE("bpf_object_load_time", "[ebpf_api]")
+{
+    // The largest sample objects, and an object with 50 programs.
+    const char* file_names[] = {
+        "bindmonitor_tailcall.o", "cgroup_sock_addr2.o", "cgroup_sock_addr_helpers.o", "many_programs.o"};
+    const int iterations = 4;
+
+    for (const char* file_name : file_names) {
+        CAPTURE(file_name);
+        size_t program_count = 0;
+        std::chrono::duration<double, std::milli> total_duration{0};
+        for (int i = 0; i < iterations; i++) {
+            struct bpf_object* object = bpf_object__open(file_name);
+            REQUIRE(object != nullptr);
+            REQUIRE(ebpf_object_set_execution_type(object, EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            int error = bpf_object__load(object);
+            total_duration += std::chrono::high_resolution_clock::now() - start;
+            REQUIRE(error == 0);
+
+            program_count = 0;
+            struct bpf_program* program;
+            bpf_object__for_each_program(program, object)
+            {
+                REQUIRE(bpf_program__fd(program) > 0);
+                program_count++;
+            }
+            bpf_object__close(object);
+        }
+        std::cout << file_name << ": " << program_count << " programs loaded in "
+                  << total_duration.count() / iterations << " ms\n";
+    }
+}
+#endif
+
+TEST_CASE("ebpf_map_iterator_dump_throughput", "[ebpf_api]")
+{
+    const uint32_t max_entries = 64 * 1024;
+    fd_t map_fd =
+        bpf_map_create(BPF_MAP_TYPE_HASH, "iterator_perf", sizeof(uint32_t), sizeof(uint64_t), max_entries, nullptr);
+    REQUIRE(map_fd > 0);
+    auto cleanup =
+        std::unique_ptr<void, std::function<void(void*)>>(reinterpret_cast<void*>(1), [&](void*) { _close(map_fd); });
+
+    uint64_t expected_sum = 0;
+    for (uint32_t key = 0; key < max_entries; key++) {
+        uint64_t value = key;
+        REQUIRE(bpf_map_update_elem(map_fd, &key, &value, BPF_ANY) == 0);
+        expected_sum += value;
+    }
+
+    // Dump the map one entry at a time.
+    uint64_t next_key_sum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    uint32_t key;
+    int error = bpf_map_get_next_key(map_fd, nullptr, &key);
+    while (error == 0) {
+        uint64_t value = 0;
+        REQUIRE(bpf_map_lookup_elem(map_fd, &key, &value) == 0);
+        next_key_sum += value;
+        error = bpf_map_get_next_key(map_fd, &key, &key);
+    }
+    std::chrono::duration<double, std::nano> next_key_duration = std::chrono::high_resolution_clock::now() - start;
+
+    // Dump the map a page at a time.
+    uint64_t iterator_sum = 0;
+    std::vector<uint8_t> entries(32 * 1024);
+    const size_t entry_size = sizeof(uint32_t) + sizeof(uint64_t);
+    start = std::chrono::high_resolution_clock::now();
+    ebpf_map_iterator_t* iterator = nullptr;
+    REQUIRE(ebpf_map_iterator_create(map_fd, false, 0, &iterator) == EBPF_SUCCESS);
+    for (;;) {
+        size_t size = entries.size();
+        ebpf_result_t result = ebpf_map_iterator_next(iterator, entries.data(), &size);
+        if (result == EBPF_NO_MORE_KEYS) {
+            break;
+        }
+        REQUIRE(result == EBPF_SUCCESS);
+        for (size_t offset = 0; offset < size; offset += entry_size) {
+            uint64_t value;
+            memcpy(&value, entries.data() + offset + sizeof(uint32_t), sizeof(value));
+            iterator_sum += value;
+        }
+    }
+    ebpf_map_iterator_destroy(iterator);
+    std::chrono::duration<double, std::nano> iterator_duration = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << "bpf_map_get_next_key + bpf_map_lookup_elem: " << next_key_duration.count() / max_entries
+              << " ns/entry\n";
+    std::cout << "ebpf_map_iterator_next: " << iterator_duration.count() / max_entries << " ns/entry\n";
+    REQUIRE(next_key_sum == expected_sum);
+    REQUIRE(iterator_sum == expected_sum);
+}
+
+TEST_CASE("bpf_map_lookup_elem_multithreaded_throughput", "[ebpf_api]")
+{
+    const uint32_t max_entries = 1024;
+    const uint32_t lookups_per_thread = 64 * 1024;
+    fd_t map_fd =
+        bpf_map_create(BPF_MAP_TYPE_HASH, "lookup_perf", sizeof(uint32_t), sizeof(uint64_t), max_entries, nullptr);
+    REQUIRE(map_fd > 0);
+    auto cleanup =
+        std::unique_ptr<void, std::function<void(void*)>>(reinterpret_cast<void*>(1), [&](void*) { _close(map_fd); });
+
+    for (uint32_t key = 0; key < max_entries; key++) {
+        uint64_t value = key;
+        REQUIRE(bpf_map_update_elem(map_fd, &key, &value, BPF_ANY) == 0);
+    }
+
+    // Measure 1, 2, 4, ... threads, up to one thread per processor.
+    uint32_t max_thread_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> thread_counts;
+    for (uint32_t thread_count = 1; thread_count < max_thread_count; thread_count *= 2) {
+        thread_counts.push_back(thread_count);
+    }
+    thread_counts.push_back(max_thread_count);
+
+    for (uint32_t thread_count : thread_counts) {
+        std::atomic<size_t> failures = 0;
+        std::vector<std::thread> threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < thread_count; i++) {
+            threads.emplace_back([&, i]() {
+                for (uint32_t j = 0; j < lookups_per_thread; j++) {
+                    uint32_t key = (i + j) % max_entries;
+                    uint64_t value = 0;
+                    if (bpf_map_lookup_elem(map_fd, &key, &value) != 0 || value != key) {
+                        failures++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+
+        REQUIRE(failures == 0);
+        std::cout << "bpf_map_lookup_elem with " << thread_count << " threads: "
+                  << (uint64_t)((size_t)thread_count * lookups_per_thread / duration.count()) << " ops/sec\n";
+    }
+}
+
 TEST_CASE("ebpf_verification_memory_apis", "[ebpf_api]")
 {
     // Test memory-based verification with minimal data.
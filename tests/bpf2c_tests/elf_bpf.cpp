@@ -15,6 +15,7 @@
 #include <map>
 #include <optional>
 #include <regex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -312,6 +313,178 @@ TEST_CASE("bad --hash", "[bpf2c_cli]")
     REQUIRE(!err.empty());
 }
 
+TEST_CASE("bad --jobs", "[bpf2c_cli]")
+{
+    std::vector<const char*> argv;
+    argv.push_back("bpf2c.exe");
+    argv.push_back("--bpf");
+    argv.push_back("bindmonitor.o");
+    argv.push_back("--jobs");
+    argv.push_back("0");
+
+    auto [out, err, result_value] = run_test_main(argv);
+    REQUIRE(result_value != 0);
+    REQUIRE(!err.empty());
+}
+
+TEST_CASE("--jobs output is deterministic", "[bpf2c_cli]")
+{
+    auto generate = [](const char* job_count) {
+        std::vector<const char*> argv;
+        argv.push_back("bpf2c.exe");
+        argv.push_back("--bpf");
+        argv.push_back("bindmonitor_mt_tailcall.o");
+        argv.push_back("--jobs");
+        argv.push_back(job_count);
+
+        auto [out, err, result_value] = run_test_main(argv);
+        REQUIRE(result_value == 0);
+        return out;
+    };
+
+    std::string sequential_output = generate("1");
+    REQUIRE(!sequential_output.empty());
+    REQUIRE(generate("4") == sequential_output);
+    REQUIRE(generate("64") == sequential_output);
+}
+
+TEST_CASE("--split", "[bpf2c_cli]")
+{
+    auto output_path = std::filesystem::temp_directory_path() / "bpf2c_split";
+    std::filesystem::remove_all(output_path);
+    REQUIRE(std::filesystem::create_directories(output_path));
+    std::string output_file = (output_path / "bindmonitor_mt_tailcall_sys.c").string();
+
+    std::vector<const char*> argv;
+    argv.push_back("bpf2c.exe");
+    argv.push_back("--bpf");
+    argv.push_back("bindmonitor_mt_tailcall.o");
+    argv.push_back("--split");
+
+    // An output file name is required.
+    {
+        auto [out, err, result_value] = run_test_main(argv);
+        REQUIRE(result_value != 0);
+        REQUIRE(!err.empty());
+    }
+
+    argv.push_back("--sys");
+    argv.push_back(output_file.c_str());
+    auto run = [&]() {
+        auto [out, err, result_value] = run_test_main(argv);
+        REQUIRE(result_value == 0);
+
+        std::map<std::string, std::filesystem::file_time_type> program_files;
+        for (const auto& entry : std::filesystem::directory_iterator(output_path)) {
+            if (entry.path().string() != output_file) {
+                program_files[entry.path().filename().string()] = entry.last_write_time();
+            }
+        }
+        return program_files;
+    };
+
+    auto program_files = run();
+
+    // The metadata file references the programs, which are defined in their own files.
+    std::string metadata = load_file_to_memory(output_file);
+    REQUIRE(metadata.find("metadata_table_t bindmonitor_mt_tailcall_metadata_table") != std::string::npos);
+    REQUIRE(metadata.find("static program_entry_t _programs[]") != std::string::npos);
+    REQUIRE(metadata.find("#pragma code_seg(push") == std::string::npos);
+    REQUIRE(program_files.size() > 1);
+    REQUIRE(program_files.contains("bindmonitor_mt_tailcall_sys_BindMonitor_Caller.c"));
+    for (const auto& [name, _] : program_files) {
+        std::string code = load_file_to_memory((output_path / name).string());
+        REQUIRE(code.find("#include \"bpf2c.h\"") != std::string::npos);
+        REQUIRE(code.find("#pragma code_seg(push") != std::string::npos);
+        REQUIRE(code.find("static uint64_t") == std::string::npos);
+    }
+
+    // Files of programs that didn't change are not rewritten.
+    REQUIRE(run() == program_files);
+
+    std::filesystem::remove_all(output_path);
+}
+
+TEST_CASE("--profile-branches and --branch-profile", "[bpf2c_cli]")
+{
+    auto generate = [](std::vector<const char*> options) {
+        std::vector<const char*> argv;
+        argv.push_back("bpf2c.exe");
+        argv.push_back("--bpf");
+        argv.push_back("cgroup_sock_addr.o");
+        argv.insert(argv.end(), options.begin(), options.end());
+        return run_test_main(argv);
+    };
+
+    // The instrumented code increments each counter of the profile map in exactly one place.
+    auto [instrumented_code, instrumented_err, instrumented_result] = generate({"--profile-branches"});
+    REQUIRE(instrumented_result == 0);
+    REQUIRE(instrumented_code.find("\"bpf2c_branch_profile\"") != std::string::npos);
+    std::regex counter_regex(R"(array_data\)\[(\d+)\]\+\+;)");
+    std::set<size_t> counters;
+    size_t increment_count = 0;
+    for (auto it = std::sregex_iterator(instrumented_code.begin(), instrumented_code.end(), counter_regex);
+         it != std::sregex_iterator();
+         it++) {
+        counters.insert(std::stoull((*it)[1].str()));
+        increment_count++;
+    }
+    REQUIRE(counters.size() > 1);
+    REQUIRE(increment_count == counters.size());
+    REQUIRE(*counters.rbegin() == counters.size() - 1);
+
+    // Fall-through counters are incremented right after the block that jumps to the branch target.
+    std::regex fall_through_regex(R"(\}\n(?:#line [^\n]*\n)? *\(\(uint64_t\*\)[^\n]*array_data\)\[(\d+)\]\+\+;)");
+    std::set<size_t> fall_through_counters;
+    for (auto it = std::sregex_iterator(instrumented_code.begin(), instrumented_code.end(), fall_through_regex);
+         it != std::sregex_iterator();
+         it++) {
+        fall_through_counters.insert(std::stoull((*it)[1].str()));
+    }
+    REQUIRE(fall_through_counters.size() > 0);
+
+    // Write a profile in which every function ran and every branch was always taken.
+    auto profile_path = (std::filesystem::temp_directory_path() / "bpf2c_branch_profile.txt").string();
+    auto write_profile = [&](size_t counter_count) {
+        std::ofstream profile(profile_path, std::ios::out | std::ios::trunc);
+        REQUIRE(profile.is_open());
+        for (size_t counter = 0; counter < counter_count; counter++) {
+            profile << (fall_through_counters.contains(counter) ? 0 : 100) << std::endl;
+        }
+    };
+
+    write_profile(counters.size());
+    auto [optimized_code, optimized_err, optimized_result] = generate({"--branch-profile", profile_path.c_str()});
+    REQUIRE(optimized_result == 0);
+    REQUIRE(optimized_code.find("bpf2c_branch_profile") == std::string::npos);
+    REQUIRE(optimized_code.find("if (BPF2C_LIKELY(") != std::string::npos);
+    REQUIRE(optimized_code.find("if (BPF2C_UNLIKELY(") == std::string::npos);
+
+    // Code on the fall-through path of the branches never ran, so it is moved out of line.
+    std::regex cold_jump_regex(R"(goto (cold_label_\d+);)");
+    size_t cold_jump_count = 0;
+    for (auto it = std::sregex_iterator(optimized_code.begin(), optimized_code.end(), cold_jump_regex);
+         it != std::sregex_iterator();
+         it++) {
+        REQUIRE(optimized_code.find("\n" + (*it)[1].str() + ":\n") != std::string::npos);
+        cold_jump_count++;
+    }
+    REQUIRE(cold_jump_count > 0);
+
+    // The profile must match the programs.
+    write_profile(counters.size() - 1);
+    auto [mismatched_code, mismatched_err, mismatched_result] = generate({"--branch-profile", profile_path.c_str()});
+    REQUIRE(mismatched_result != 0);
+    REQUIRE(mismatched_err.find("branch profile") != std::string::npos);
+
+    auto [combined_code, combined_err, combined_result] =
+        generate({"--profile-branches", "--branch-profile", profile_path.c_str()});
+    REQUIRE(combined_result != 0);
+    REQUIRE(!combined_err.empty());
+
+    std::filesystem::remove(profile_path);
+}
+
 static std::string
 _normalize_verifier_error(std::string error)
 {
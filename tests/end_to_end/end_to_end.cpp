@@ -14,8 +14,11 @@
 #include "catch_wrapper.hpp"
 #include "common_tests.h"
 #include "ebpf_core.h"
+#include "ebpf_program.h"
 #include "ebpf_store_helper.h"
 #include "ebpf_tracelog.h"
+#include "elf_image.h"
+#include "elfio_wrapper.hpp"
 #include "end_to_end_jit.h"
 #include "helpers.h"
 #include "ioctl_helper.h"
@@ -31,6 +34,12 @@ namespace ebpf {
 #include "test_helper.hpp"
 #include "usersim/ke.h"
 #include "watchdog.h"
+#pragma warning(push)
+#pragma warning(disable : 26495) // Always initialize a member variable
+#define ebpf_inst ebpf_inst_btf
+#include "libbtf/btf_type_data.h"
+#undef ebpf_inst
+#pragma warning(pop)
 
 #include <WinSock2.h>
 #include <in6addr.h>
@@ -38,10 +47,12 @@ namespace ebpf {
 #include <atomic>
 #include <cguid.h>
 #include <chrono>
+#include <fstream>
 #include <lsalookup.h>
 #include <mutex>
 #define _NTDEF_ // UNICODE_STRING is already defined
 #include <ntsecapi.h>
+#include <sstream>
 #include <thread>
 
 using namespace Platform;
@@ -340,6 +351,240 @@ droppacket_test(ebpf_execution_type_t execution_type)
     bpf_object__close(unique_object.release());
 }
 
+void
+droppacket_test_run_batch_test(ebpf_execution_type_t execution_type)
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    int result;
+    const char* error_message = nullptr;
+    bpf_object_ptr unique_object;
+    fd_t program_fd;
+
+    program_info_provider_t xdp_program_info;
+    REQUIRE(xdp_program_info.initialize(EBPF_PROGRAM_TYPE_XDP) == EBPF_SUCCESS);
+
+    const char* file_name = (execution_type == EBPF_EXECUTION_NATIVE ? "droppacket_um.dll" : "droppacket.o");
+    result =
+        ebpf_program_load(file_name, BPF_PROG_TYPE_UNSPEC, execution_type, &unique_object, &program_fd, &error_message);
+
+    if (error_message) {
+        printf("ebpf_program_load failed with %s\n", error_message);
+        ebpf_free((void*)error_message);
+    }
+    REQUIRE(result == 0);
+    fd_t dropped_packet_map_fd = bpf_object__find_map_fd_by_name(unique_object.get(), "dropped_packet_map");
+
+    // Tell the program which interface to filter on.
+    fd_t interface_index_map_fd = bpf_object__find_map_fd_by_name(unique_object.get(), "interface_index_map");
+    uint32_t key = 0;
+    uint32_t if_index = TEST_IFINDEX;
+    REQUIRE(bpf_map_update_elem(interface_index_map_fd, &key, &if_index, EBPF_ANY) == EBPF_SUCCESS);
+
+    // 0-byte UDP packets are dropped, everything else is passed.
+    std::vector<std::vector<uint8_t>> packets = {
+        prepare_udp_packet(0, ETHERNET_TYPE_IPV4),
+        prepare_udp_packet(10, ETHERNET_TYPE_IPV4),
+        prepare_udp_packet(0, ETHERNET_TYPE_IPV4)};
+    const uint64_t expected_results[] = {XDP_DROP, XDP_PASS, XDP_DROP};
+
+    xdp_md_t context_in = {0};
+    context_in.ingress_ifindex = TEST_IFINDEX;
+    std::vector<xdp_md_t> contexts_out(packets.size());
+    std::vector<std::vector<uint8_t>> data_out(packets.size());
+    std::vector<ebpf_test_run_options_t> options(packets.size());
+    for (size_t i = 0; i < packets.size(); i++) {
+        data_out[i].resize(packets[i].size());
+        options[i].data_in = packets[i].data();
+        options[i].data_size_in = packets[i].size();
+        options[i].data_out = data_out[i].data();
+        options[i].data_size_out = data_out[i].size();
+        options[i].context_in = reinterpret_cast<const uint8_t*>(&context_in);
+        options[i].context_size_in = sizeof(context_in);
+        options[i].context_out = reinterpret_cast<uint8_t*>(&contexts_out[i]);
+        options[i].context_size_out = sizeof(contexts_out[i]);
+        options[i].repeat_count = 1;
+    }
+
+    ebpf_test_run_batch_summary_t summary;
+    REQUIRE(ebpf_program_test_run_batch(program_fd, options.size(), options.data(), &summary) == EBPF_SUCCESS);
+    REQUIRE(summary.input_count == packets.size());
+    REQUIRE(summary.min_duration <= summary.p50_duration);
+    REQUIRE(summary.p50_duration <= summary.p99_duration);
+    REQUIRE(summary.p99_duration <= summary.max_duration);
+    for (size_t i = 0; i < packets.size(); i++) {
+        REQUIRE(options[i].return_value == expected_results[i]);
+    }
+
+    uint64_t value = 0;
+    REQUIRE(bpf_map_lookup_elem(dropped_packet_map_fd, &key, &value) == EBPF_SUCCESS);
+    REQUIRE(value == 2);
+
+    // Replay the same packets from a classic pcap file.
+    std::string pcap_file_name = "droppacket_test_run_batch.pcap";
+    {
+        std::ofstream pcap_file(pcap_file_name, std::ios::binary);
+        const uint32_t file_header[] = {0xa1b2c3d4, 0x00040002, 0, 0, 0xffff, 1};
+        pcap_file.write(reinterpret_cast<const char*>(file_header), sizeof(file_header));
+        for (const auto& packet : packets) {
+            const uint32_t record_header[] = {
+                0, 0, static_cast<uint32_t>(packet.size()), static_cast<uint32_t>(packet.size())};
+            pcap_file.write(reinterpret_cast<const char*>(record_header), sizeof(record_header));
+            pcap_file.write(reinterpret_cast<const char*>(packet.data()), packet.size());
+        }
+    }
+
+    ebpf_test_run_options_t* pcap_options = nullptr;
+    size_t pcap_input_count = 0;
+    REQUIRE(
+        ebpf_test_run_options_from_pcap(pcap_file_name.c_str(), 0, &pcap_options, &pcap_input_count) == EBPF_SUCCESS);
+    REQUIRE(pcap_input_count == packets.size());
+    for (size_t i = 0; i < pcap_input_count; i++) {
+        REQUIRE(pcap_options[i].data_size_in == packets[i].size());
+        // The output buffer has room for a program to grow the packet.
+        REQUIRE(pcap_options[i].data_size_out > packets[i].size());
+        pcap_options[i].context_in = reinterpret_cast<const uint8_t*>(&context_in);
+        pcap_options[i].context_size_in = sizeof(context_in);
+    }
+    REQUIRE(ebpf_program_test_run_batch(program_fd, pcap_input_count, pcap_options, nullptr) == EBPF_SUCCESS);
+    for (size_t i = 0; i < pcap_input_count; i++) {
+        REQUIRE(pcap_options[i].return_value == expected_results[i]);
+    }
+    ebpf_free_test_run_options(pcap_options);
+
+    REQUIRE(bpf_map_lookup_elem(dropped_packet_map_fd, &key, &value) == EBPF_SUCCESS);
+    REQUIRE(value == 4);
+
+    // The caller can choose the size of the output buffers.
+    const size_t data_size_out = 1024;
+    REQUIRE(
+        ebpf_test_run_options_from_pcap(pcap_file_name.c_str(), data_size_out, &pcap_options, &pcap_input_count) ==
+        EBPF_SUCCESS);
+    for (size_t i = 0; i < pcap_input_count; i++) {
+        REQUIRE(pcap_options[i].data_size_out == data_size_out);
+    }
+    ebpf_free_test_run_options(pcap_options);
+
+    // Negative test: output buffers larger than a test run can return.
+    REQUIRE(
+        ebpf_test_run_options_from_pcap(pcap_file_name.c_str(), MAXUINT16, &pcap_options, &pcap_input_count) ==
+        EBPF_INVALID_ARGUMENT);
+
+    // Negative test: missing capture file.
+    REQUIRE(
+        ebpf_test_run_options_from_pcap("not_a_file.pcap", 0, &pcap_options, &pcap_input_count) == EBPF_FILE_NOT_FOUND);
+
+    std::remove(pcap_file_name.c_str());
+    bpf_object__close(unique_object.release());
+}
+
+void
+droppacket_test_run_parallel_test(ebpf_execution_type_t execution_type)
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    int result;
+    const char* error_message = nullptr;
+    bpf_object_ptr unique_object;
+    fd_t program_fd;
+
+    program_info_provider_t xdp_program_info;
+    REQUIRE(xdp_program_info.initialize(EBPF_PROGRAM_TYPE_XDP) == EBPF_SUCCESS);
+
+    const char* file_name = (execution_type == EBPF_EXECUTION_NATIVE ? "droppacket_um.dll" : "droppacket.o");
+    result =
+        ebpf_program_load(file_name, BPF_PROG_TYPE_UNSPEC, execution_type, &unique_object, &program_fd, &error_message);
+
+    if (error_message) {
+        printf("ebpf_program_load failed with %s\n", error_message);
+        ebpf_free((void*)error_message);
+    }
+    REQUIRE(result == 0);
+    fd_t dropped_packet_map_fd = bpf_object__find_map_fd_by_name(unique_object.get(), "dropped_packet_map");
+
+    // Tell the program which interface to filter on.
+    fd_t interface_index_map_fd = bpf_object__find_map_fd_by_name(unique_object.get(), "interface_index_map");
+    uint32_t key = 0;
+    uint32_t if_index = TEST_IFINDEX;
+    REQUIRE(bpf_map_update_elem(interface_index_map_fd, &key, &if_index, EBPF_ANY) == EBPF_SUCCESS);
+
+    // Run on up to 4 CPUs spread across all processor groups, all contending for the same dropped_packet_map entry.
+    uint32_t possible_cpu_count = static_cast<uint32_t>(libbpf_num_possible_cpus());
+    uint32_t cpu_stride = (possible_cpu_count > 4) ? possible_cpu_count / 4 : 1;
+    std::vector<uint32_t> cpus;
+    for (uint32_t cpu = 0; cpu < possible_cpu_count && cpus.size() < 4; cpu += cpu_stride) {
+        cpus.push_back(cpu);
+    }
+    uint32_t cpu_count = static_cast<uint32_t>(cpus.size());
+    const size_t repeat_count = 1000;
+
+    auto packet0 = prepare_udp_packet(0, ETHERNET_TYPE_IPV4);
+    std::vector<uint8_t> data_out(packet0.size());
+    xdp_md_t context_in = {0};
+    context_in.ingress_ifindex = TEST_IFINDEX;
+    xdp_md_t context_out = {0};
+
+    ebpf_test_run_options_t options = {0};
+    options.data_in = packet0.data();
+    options.data_size_in = packet0.size();
+    options.data_out = data_out.data();
+    options.data_size_out = data_out.size();
+    options.context_in = reinterpret_cast<const uint8_t*>(&context_in);
+    options.context_size_in = sizeof(context_in);
+    options.context_out = reinterpret_cast<uint8_t*>(&context_out);
+    options.context_size_out = sizeof(context_out);
+    options.repeat_count = repeat_count;
+
+    std::vector<ebpf_test_run_cpu_result_t> cpu_results(cpu_count);
+    uint64_t runs_per_second = 0;
+
+    // Negative test: empty CPU set.
+    REQUIRE(
+        ebpf_program_test_run_parallel(program_fd, cpus.data(), 0, &options, cpu_results.data(), &runs_per_second) ==
+        EBPF_INVALID_ARGUMENT);
+
+    // Negative test: CPU that does not exist.
+    uint32_t missing_cpu = possible_cpu_count;
+    REQUIRE(
+        ebpf_program_test_run_parallel(program_fd, &missing_cpu, 1, &options, cpu_results.data(), &runs_per_second) ==
+        EBPF_INVALID_ARGUMENT);
+
+    // Negative test: CPUs out of order.
+    if (cpu_count > 1) {
+        std::vector<uint32_t> reversed_cpus(cpus.rbegin(), cpus.rend());
+        REQUIRE(
+            ebpf_program_test_run_parallel(
+                program_fd, reversed_cpus.data(), cpu_count, &options, cpu_results.data(), &runs_per_second) ==
+            EBPF_INVALID_ARGUMENT);
+    }
+
+    REQUIRE(
+        ebpf_program_test_run_parallel(
+            program_fd, cpus.data(), cpu_count, &options, cpu_results.data(), &runs_per_second) == EBPF_SUCCESS);
+    REQUIRE(options.return_value == XDP_DROP);
+    REQUIRE(options.data_size_out == packet0.size());
+    REQUIRE(context_out.ingress_ifindex == TEST_IFINDEX);
+
+    uint64_t total_runs_per_second = 0;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        REQUIRE(cpu_results[i].cpu == cpus[i]);
+        REQUIRE(cpu_results[i].return_value == XDP_DROP);
+        REQUIRE(cpu_results[i].run_count == repeat_count);
+        total_runs_per_second += cpu_results[i].runs_per_second;
+    }
+    REQUIRE(runs_per_second == total_runs_per_second);
+
+    // The program increments the counter without atomics, so concurrent updates may be lost.
+    uint64_t value = 0;
+    REQUIRE(bpf_map_lookup_elem(dropped_packet_map_fd, &key, &value) == EBPF_SUCCESS);
+    REQUIRE(value > 0);
+    REQUIRE(value <= repeat_count * cpu_count);
+
+    bpf_object__close(unique_object.release());
+}
+
 // See also divide_by_zero_test_km in api_test.cpp for the kernel-mode equivalent.
 void
 divide_by_zero_test_um(ebpf_execution_type_t execution_type)
@@ -1128,6 +1373,77 @@ _utility_helper_functions_test(ebpf_execution_type_t execution_type)
     verify_utility_helper_results(object, true);
 }
 
+// Computes the Internet checksum of a header in host order, as the header fields are laid out in memory.
+static uint16_t
+_compute_checksum(_In_reads_(count) const uint16_t* words, size_t count)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += words[i];
+    }
+    while (sum >> 16) {
+        sum = (sum & UINT16_MAX) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+static void
+_csum_replace_helper_functions_test(ebpf_execution_type_t execution_type)
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+    single_instance_hook_t hook(EBPF_PROGRAM_TYPE_SAMPLE, EBPF_ATTACH_TYPE_SAMPLE);
+    REQUIRE(hook.initialize() == EBPF_SUCCESS);
+    program_info_provider_t sample_program_info;
+    REQUIRE(sample_program_info.initialize(EBPF_PROGRAM_TYPE_SAMPLE) == EBPF_SUCCESS);
+    const char* file_name =
+        (execution_type == EBPF_EXECUTION_NATIVE ? "test_sample_csum_replace_um.dll" : "test_sample_csum_replace.o");
+    program_load_attach_helper_t program_helper;
+    program_helper.initialize(
+        file_name, BPF_PROG_TYPE_SAMPLE, "test_sample_csum_replace", execution_type, nullptr, 0, hook);
+    bpf_object* object = program_helper.get_object();
+
+    // Matches csum_replace_value_t in test_sample_csum_replace.c.
+    typedef struct _csum_replace_value
+    {
+        uint16_t l3_checksum;
+        uint16_t l4_checksum;
+        uint32_t from;
+        uint32_t to;
+        int32_t l3_result;
+        int32_t l4_result;
+    } csum_replace_value_t;
+
+    // IPv4 headers that differ only in the source address (words 6 and 7).
+    uint16_t from_header[] = {0x4500, 0x0073, 0x0000, 0x4000, 0x4011, 0x0000, 0x2000, 0x0001, 0xc0a8, 0x00c7};
+    uint16_t to_header[] = {0x4500, 0x0073, 0x0000, 0x4000, 0x4011, 0x0000, 0xc0a8, 0x0001, 0xc0a8, 0x00c7};
+
+    csum_replace_value_t value = {};
+    value.l3_checksum = _compute_checksum(from_header, _countof(from_header));
+    value.l4_checksum = value.l3_checksum;
+    memcpy(&value.from, &from_header[6], sizeof(value.from));
+    memcpy(&value.to, &to_header[6], sizeof(value.to));
+
+    fd_t map_fd = bpf_object__find_map_fd_by_name(object, "csum_replace_map");
+    REQUIRE(map_fd > 0);
+    uint32_t key = 0;
+    REQUIRE(bpf_map_update_elem(map_fd, &key, &value, BPF_ANY) == 0);
+
+    // Dummy context (not used by the eBPF program).
+    INITIALIZE_SAMPLE_CONTEXT
+
+    uint32_t hook_result = 0;
+    REQUIRE(hook.fire(ctx, &hook_result) == EBPF_SUCCESS);
+    REQUIRE(hook_result == 0);
+
+    REQUIRE(bpf_map_lookup_elem(map_fd, &key, &value) == 0);
+    REQUIRE(value.l3_result == 0);
+    REQUIRE(value.l4_result == 0);
+    uint16_t expected_checksum = _compute_checksum(to_header, _countof(to_header));
+    REQUIRE(value.l3_checksum == expected_checksum);
+    REQUIRE(value.l4_checksum == expected_checksum);
+}
+
 void
 map_test(ebpf_execution_type_t execution_type)
 {
@@ -1228,6 +1544,21 @@ global_variable_test(ebpf_execution_type_t execution_type)
     REQUIRE(value[0] == 20);
     REQUIRE(value[1] == 40);
 
+    // The .rodata map is frozen, so user mode can only read it.
+    value[0] = 11;
+    REQUIRE(bpf_map_update_elem(rodata_fd, &key, value, BPF_ANY) < 0);
+    void* mapped_data = nullptr;
+    size_t mapped_size = 0;
+    REQUIRE(ebpf_map_mmap(rodata_fd, true, &mapped_data, &mapped_size) == EBPF_ACCESS_DENIED);
+    REQUIRE(ebpf_map_mmap(rodata_fd, false, &mapped_data, &mapped_size) == EBPF_SUCCESS);
+    REQUIRE(static_cast<const volatile uint32_t*>(mapped_data)[0] == 10);
+    REQUIRE(ebpf_map_munmap(rodata_fd, mapped_data) == EBPF_SUCCESS);
+
+    // The other global variables can be mapped writable.
+    REQUIRE(ebpf_map_mmap(data_fd, true, &mapped_data, &mapped_size) == EBPF_SUCCESS);
+    REQUIRE(static_cast<const volatile uint32_t*>(mapped_data)[1] == 40);
+    REQUIRE(ebpf_map_munmap(data_fd, mapped_data) == EBPF_SUCCESS);
+
     REQUIRE(hook.attach_link(program_fd, nullptr, 0, &link) == EBPF_SUCCESS);
     uint32_t hook_result = 0;
     INITIALIZE_SAMPLE_CONTEXT
@@ -1332,6 +1663,8 @@ global_variable_and_map_test(ebpf_execution_type_t execution_type)
 }
 
 DECLARE_ALL_TEST_CASES("droppacket", "[end_to_end]", droppacket_test);
+DECLARE_ALL_TEST_CASES("droppacket_test_run_batch", "[end_to_end]", droppacket_test_run_batch_test);
+DECLARE_ALL_TEST_CASES("droppacket_test_run_parallel", "[end_to_end]", droppacket_test_run_parallel_test);
 DECLARE_ALL_TEST_CASES("divide_by_zero", "[end_to_end]", divide_by_zero_test_um);
 DECLARE_NATIVE_TEST("map-annotation-collision", "[end_to_end]", map_annotation_collision_native_test);
 DECLARE_NATIVE_TEST("map-sequential-lookup-inline", "[end_to_end]", map_sequential_lookup_inline_test);
@@ -1423,6 +1756,7 @@ DECLARE_ALL_TEST_CASES("bindmonitor-tailcall", "[end_to_end]", bindmonitor_tailc
 DECLARE_ALL_TEST_CASES("bindmonitor-ringbuf", "[end_to_end]", bindmonitor_ring_buffer_test);
 DECLARE_ALL_TEST_CASES("negative_ring_buffer_test", "[end_to_end]", negative_ring_buffer_test);
 DECLARE_ALL_TEST_CASES("utility-helpers", "[end_to_end]", _utility_helper_functions_test);
+DECLARE_ALL_TEST_CASES("csum-replace-helpers", "[end_to_end]", _csum_replace_helper_functions_test);
 DECLARE_ALL_TEST_CASES("map", "[end_to_end]", map_test);
 DECLARE_ALL_TEST_CASES("bad_map_name", "[end_to_end]", bad_map_name_um);
 DECLARE_ALL_TEST_CASES("global_variable", "[end_to_end]", global_variable_test);
@@ -1451,6 +1785,175 @@ TEST_CASE("enum programs", "[end_to_end]")
     ebpf_free_string(error_message);
 }
 
+// Enumerate, disassemble and verify every program of a large object, so that the time spent reading and parsing
+// the ELF file for each of these operations can be compared across changes.
+static void
+_elf_processing_benchmark(_In_z_ const char* file)
+{
+    const char* error_message = nullptr;
+    ebpf_api_program_info_t* program_data = nullptr;
+    uint32_t result;
+
+    std::ifstream stream(file, std::ios::binary);
+    REQUIRE(stream);
+    std::vector<char> elf_data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    REQUIRE(
+        (result = ebpf_enumerate_programs(file, true, &program_data, &error_message),
+         ebpf_free_string(error_message),
+         error_message = nullptr,
+         result == 0));
+    auto enumerate_time = std::chrono::high_resolution_clock::now() - start;
+
+    size_t program_count = 0;
+    std::chrono::high_resolution_clock::duration disassemble_time{};
+    std::chrono::high_resolution_clock::duration verify_file_time{};
+    std::chrono::high_resolution_clock::duration verify_memory_time{};
+    for (auto program = program_data; program != nullptr; program = program->next) {
+        const char* disassembly = nullptr;
+        const char* report = nullptr;
+        ebpf_api_verifier_stats_t stats;
+        program_count++;
+
+        start = std::chrono::high_resolution_clock::now();
+        REQUIRE(
+            (result = ebpf_api_elf_disassemble_program(
+                 file, program->section_name, program->program_name, &disassembly, &error_message),
+             ebpf_free_string(error_message),
+             error_message = nullptr,
+             result == 0));
+        disassemble_time += std::chrono::high_resolution_clock::now() - start;
+        ebpf_free_string(disassembly);
+
+        start = std::chrono::high_resolution_clock::now();
+        REQUIRE(
+            (result = ebpf_api_elf_verify_program_from_file(
+                 file,
+                 program->section_name,
+                 program->program_name,
+                 nullptr,
+                 EBPF_VERIFICATION_VERBOSITY_NORMAL,
+                 &report,
+                 &error_message,
+                 &stats),
+             ebpf_free_string(error_message),
+             error_message = nullptr,
+             result == 0));
+        verify_file_time += std::chrono::high_resolution_clock::now() - start;
+        ebpf_free_string(report);
+
+        start = std::chrono::high_resolution_clock::now();
+        REQUIRE(
+            (result = ebpf_api_elf_verify_program_from_memory(
+                 elf_data.data(),
+                 elf_data.size(),
+                 program->section_name,
+                 program->program_name,
+                 nullptr,
+                 EBPF_VERIFICATION_VERBOSITY_NORMAL,
+                 &report,
+                 &error_message,
+                 &stats),
+             ebpf_free_string(error_message),
+             error_message = nullptr,
+             result == 0));
+        verify_memory_time += std::chrono::high_resolution_clock::now() - start;
+        ebpf_free_string(report);
+    }
+    ebpf_free_programs(program_data);
+    REQUIRE(program_count > 0);
+
+    auto to_ms = [](std::chrono::high_resolution_clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    };
+    printf(
+        "%s: %zu programs, enumerate %lld ms, disassemble %lld ms, verify from file %lld ms, verify from memory %lld "
+        "ms\n",
+        file,
+        program_count,
+        to_ms(enumerate_time),
+        to_ms(disassemble_time),
+        to_ms(verify_file_time),
+        to_ms(verify_memory_time));
+}
+
+// Read and parse the ELF file the way each API call did before elf_image_t: copy the file into a string and a
+// stringstream, load all sections with ELFIO and copy the .BTF section out of ELFIO before parsing it.
+static size_t
+_elf_parse_with_copies(_In_z_ const char* file)
+{
+    std::ifstream file_stream(file, std::ios::binary);
+    REQUIRE(file_stream);
+    std::vector<char> elf_data((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+    std::stringstream elf_stream(std::string(elf_data.begin(), elf_data.end()));
+
+    ELFIO::elfio reader;
+    REQUIRE(reader.load(elf_stream));
+    const ELFIO::section* btf_section = reader.sections[".BTF"];
+    REQUIRE(btf_section != nullptr);
+    const std::byte* btf_data = reinterpret_cast<const std::byte*>(btf_section->get_data());
+    libbtf::btf_type_data btf(std::vector<std::byte>(btf_data, btf_data + btf_section->get_size()));
+    return reader.sections.size();
+}
+
+// Read and parse the ELF file through elf_image_t.
+static size_t
+_elf_parse_with_image(_In_z_ const char* file)
+{
+    std::unique_ptr<elf_image_t> image = elf_image_t::open_file(file);
+    REQUIRE(image->btf() != nullptr);
+    return image->reader().sections.size();
+}
+
+// Compare the time taken to read and parse an ELF file by the current path and the path it replaced. Both are
+// followed by prevail::read_elf, which parses the stream again in either case, so it is not included.
+static void
+_elf_parsing_benchmark(_In_z_ const char* file)
+{
+    const size_t iterations = 100;
+    REQUIRE(_elf_parse_with_copies(file) == _elf_parse_with_image(file));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        (void)_elf_parse_with_copies(file);
+    }
+    auto copies_time = std::chrono::high_resolution_clock::now() - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        (void)_elf_parse_with_image(file);
+    }
+    auto image_time = std::chrono::high_resolution_clock::now() - start;
+
+    auto to_us = [](std::chrono::high_resolution_clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    };
+    printf(
+        "%s: %zu parses, with copies %lld us, with elf_image_t %lld us\n",
+        file,
+        iterations,
+        to_us(copies_time),
+        to_us(image_time));
+}
+
+TEST_CASE("elf processing benchmark", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    program_info_provider_t bind_program_info;
+    REQUIRE(bind_program_info.initialize(EBPF_PROGRAM_TYPE_BIND) == EBPF_SUCCESS);
+    program_info_provider_t cgroup_sock_addr_program_info;
+    REQUIRE(cgroup_sock_addr_program_info.initialize(EBPF_PROGRAM_TYPE_CGROUP_SOCK_ADDR) == EBPF_SUCCESS);
+
+    _elf_processing_benchmark(SAMPLE_PATH "bindmonitor_mt_tailcall.o");
+    _elf_processing_benchmark(SAMPLE_PATH "cgroup_sock_addr_helpers.o");
+
+    _elf_parsing_benchmark(SAMPLE_PATH "bindmonitor_mt_tailcall.o");
+    _elf_parsing_benchmark(SAMPLE_PATH "cgroup_sock_addr_helpers.o");
+}
+
 TEST_CASE("verify program", "[end_to_end]")
 {
     _test_helper_end_to_end test_helper;
@@ -2186,6 +2689,79 @@ TEST_CASE("link_tests", "[end_to_end]")
 }
 #endif
 
+#if !defined(CONFIG_BPF_INTERPRETER_DISABLED)
+// Run droppacket.o in the interpreter with a 0-byte (dropped) and a 10-byte (passed) UDP packet and return the results
+// and the average duration of each run.
+static void
+_droppacket_interpret_test_run(
+    bool use_predecoded_interpreter, _Out_writes_(2) uint32_t* return_values, _Out_writes_(2) uint32_t* durations)
+{
+    const char* error_message = nullptr;
+    bpf_object_ptr unique_object;
+    fd_t program_fd;
+
+    // The interpreter is selected when the program is loaded.
+    ebpf_program_set_use_predecoded_interpreter(use_predecoded_interpreter);
+    int result = ebpf_program_load(
+        "droppacket.o", BPF_PROG_TYPE_UNSPEC, EBPF_EXECUTION_INTERPRET, &unique_object, &program_fd, &error_message);
+    ebpf_program_set_use_predecoded_interpreter(false);
+    if (error_message) {
+        printf("ebpf_program_load failed with %s\n", error_message);
+        ebpf_free((void*)error_message);
+    }
+    REQUIRE(result == 0);
+
+    fd_t interface_index_map_fd = bpf_object__find_map_fd_by_name(unique_object.get(), "interface_index_map");
+    uint32_t key = 0;
+    uint32_t if_index = TEST_IFINDEX;
+    REQUIRE(bpf_map_update_elem(interface_index_map_fd, &key, &if_index, EBPF_ANY) == EBPF_SUCCESS);
+
+    const size_t payload_sizes[] = {0, 10};
+    for (size_t i = 0; i < _countof(payload_sizes); i++) {
+        auto packet = prepare_udp_packet(payload_sizes[i], ETHERNET_TYPE_IPV4);
+        xdp_md_t context = {0};
+        context.ingress_ifindex = TEST_IFINDEX;
+        bpf_test_run_opts opts = {};
+        opts.data_in = packet.data();
+        opts.data_size_in = static_cast<uint32_t>(packet.size());
+        opts.ctx_in = &context;
+        opts.ctx_size_in = sizeof(context);
+        opts.repeat = 100000;
+        REQUIRE(bpf_prog_test_run_opts(program_fd, &opts) == 0);
+        return_values[i] = opts.retval;
+        durations[i] = opts.duration;
+    }
+
+    bpf_object__close(unique_object.release());
+}
+
+TEST_CASE("predecoded_interpreter", "[end_to_end][performance]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+    program_info_provider_t xdp_program_info;
+    REQUIRE(xdp_program_info.initialize(EBPF_PROGRAM_TYPE_XDP) == EBPF_SUCCESS);
+
+    uint32_t byte_code_results[2];
+    uint32_t byte_code_durations[2];
+    uint32_t predecoded_results[2];
+    uint32_t predecoded_durations[2];
+    _droppacket_interpret_test_run(false, byte_code_results, byte_code_durations);
+    _droppacket_interpret_test_run(true, predecoded_results, predecoded_durations);
+
+    REQUIRE(byte_code_results[0] == XDP_DROP);
+    REQUIRE(byte_code_results[1] == XDP_PASS);
+    for (size_t i = 0; i < _countof(predecoded_results); i++) {
+        REQUIRE(predecoded_results[i] == byte_code_results[i]);
+        printf(
+            "droppacket input %zu: ubpf %u ns/run, pre-decoded %u ns/run\n",
+            i,
+            byte_code_durations[i],
+            predecoded_durations[i]);
+    }
+}
+#endif
+
 static void
 _map_reuse_test(ebpf_execution_type_t execution_type)
 {
@@ -7,6 +7,7 @@
 #include "bpf/bpf.h"
 #include "bpf2c.h"
 #include "cxplat_fault_injection.h"
+#include "device_helper.hpp"
 #include "ebpf_async.h"
 #include "ebpf_core.h"
 #include "ebpf_error.h"
@@ -458,6 +459,44 @@ _Requires_lock_not_held_(_service_path_to_context_mutex) static void _preprocess
     }
 }
 
+// Emulate IOCTL_EBPF_CTL_METHOD_OUT_DIRECT. Unlike the buffered IOCTL, the driver gets distinct input and output
+// buffers, so the request is copied to its own buffer and the reply is written directly to the caller's buffer.
+static bool
+_glue_device_io_control_large(
+    _In_reads_bytes_(input_buffer_size) const void* input_buffer,
+    unsigned long input_buffer_size,
+    _Out_writes_bytes_to_(output_buffer_size, *bytes_returned) void* output_buffer,
+    unsigned long output_buffer_size,
+    _Out_ unsigned long* bytes_returned)
+{
+    ebpf_result_t result;
+    const ebpf_operation_large_header_t* user_request = reinterpret_cast<decltype(user_request)>(input_buffer);
+    ebpf_operation_large_header_t* user_reply = reinterpret_cast<decltype(user_reply)>(output_buffer);
+    std::vector<uint8_t> local_input_buffer;
+    *bytes_returned = 0;
+
+    if (!user_request || input_buffer_size < sizeof(*user_request) || !user_reply) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Fail;
+    }
+
+    local_input_buffer.resize(input_buffer_size);
+    memcpy(local_input_buffer.data(), input_buffer, input_buffer_size);
+
+    result = ebpf_core_invoke_large_protocol_handler(
+        user_request->id, local_input_buffer.data(), input_buffer_size, output_buffer, output_buffer_size);
+    if (result != EBPF_SUCCESS) {
+        goto Fail;
+    }
+
+    *bytes_returned = (static_cast<unsigned long>(user_reply->length_high) << 16) | user_reply->length;
+    return TRUE;
+
+Fail:
+    SetLastError(ebpf_result_to_win32_error_code(result));
+    return FALSE;
+}
+
 bool
 GlueDeviceIoControl(
     HANDLE device_handle,
@@ -470,7 +509,16 @@ GlueDeviceIoControl(
     _Inout_ OVERLAPPED* overlapped)
 {
     UNREFERENCED_PARAMETER(device_handle);
-    UNREFERENCED_PARAMETER(io_control_code);
+
+    if (io_control_code == IOCTL_EBPF_CTL_METHOD_OUT_DIRECT) {
+        // Large messages are only used for synchronous batch map operations.
+        if (overlapped) {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return FALSE;
+        }
+        return _glue_device_io_control_large(
+            input_buffer, input_buffer_size, output_buffer, output_buffer_size, bytes_returned);
+    }
 
     ebpf_result_t result;
     const ebpf_operation_header_t* user_request = reinterpret_cast<decltype(user_request)>(input_buffer);
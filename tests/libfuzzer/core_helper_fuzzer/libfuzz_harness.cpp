@@ -5,12 +5,115 @@
 
 #include "fuzz_helper_function.hpp"
 
+#include <errno.h>
+#include <stdexcept>
+
 typedef fuzz_helper_function<bpf_sock_addr_t> fuzz_helper_function_sock_addr_t;
 std::unique_ptr<fuzz_helper_function_sock_addr_t> _fuzz_helper_function_sock_addr;
 
 typedef fuzz_helper_function<bpf_sock_ops_t> fuzz_helper_function_sock_ops_t;
 std::unique_ptr<fuzz_helper_function_sock_ops_t> _fuzz_helper_function_sock_ops;
 
+// Reference implementation of bpf_csum_diff, one 16-bit word at a time.
+static int
+_reference_csum_diff(const uint8_t* from, int from_size, const uint8_t* to, int to_size, int seed)
+{
+    if ((from_size % 4 != 0) || (to_size % 4 != 0)) {
+        return -EINVAL;
+    }
+    uint32_t csum_diff = seed;
+    for (int i = 0; i < to_size; i += 2) {
+        csum_diff += static_cast<uint16_t>(to[i] | (to[i + 1] << 8));
+    }
+    for (int i = 0; i < from_size; i += 2) {
+        csum_diff += static_cast<uint16_t>(~(from[i] | (from[i + 1] << 8)));
+    }
+    return (static_cast<int>(csum_diff) < 0) ? -EINVAL : static_cast<int>(csum_diff);
+}
+
+// Compute the 16-bit Internet checksum of a buffer from scratch.
+static uint16_t
+_reference_checksum(const std::vector<uint8_t>& buffer)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i + 1 < buffer.size(); i += 2) {
+        sum += static_cast<uint16_t>(buffer[i] | (buffer[i + 1] << 8));
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+static bool
+_checksums_equal(uint16_t left, uint16_t right)
+{
+    // 0x0000 and 0xffff are both representations of zero in one's complement.
+    return (left == right) || ((left == 0 || left == 0xffff) && (right == 0 || right == 0xffff));
+}
+
+/**
+ * @brief Check the vectorized bpf_csum_diff against the reference implementation, and the incremental checksum
+ * helpers against a checksum recomputed from scratch.
+ *
+ * The input is split into a header whose first word is overwritten with its checksum, and the replacement bytes
+ * for a field in it.
+ */
+static int
+_fuzz_csum(const uint8_t* data, size_t size)
+{
+    if (size < 4) {
+        return 0;
+    }
+    int seed = static_cast<int>(data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
+    data += 4;
+    size -= 4;
+
+    // Split the rest of the input in two. Sizes that are not multiples of 4 must be rejected by both.
+    int from_size = static_cast<int>(size / 2);
+    int to_size = static_cast<int>(size - from_size);
+    if (ebpf_core_csum_diff(data, from_size, data + from_size, to_size, seed) !=
+        _reference_csum_diff(data, from_size, data + from_size, to_size, seed)) {
+        throw std::runtime_error("bpf_csum_diff does not match the reference implementation");
+    }
+
+    // Replace a 2 or 4 byte field of an even-length header and check the updated checksum.
+    size_t field_size = (size % 2 == 0) ? sizeof(uint16_t) : sizeof(uint32_t);
+    if (size < 2 * sizeof(uint16_t) + 2 * field_size) {
+        return 0;
+    }
+    std::vector<uint8_t> header(data, data + ((size - field_size) & ~static_cast<size_t>(1)));
+    const uint8_t* new_field = data + size - field_size;
+    size_t field_offset = (seed & 0xffff) % ((header.size() - sizeof(uint16_t) - field_size) / 2 + 1) * 2 +
+                          sizeof(uint16_t);
+
+    header[0] = header[1] = 0;
+    uint16_t checksum = _reference_checksum(header);
+    uint64_t from = 0;
+    uint64_t to = 0;
+    memcpy(&from, header.data() + field_offset, field_size);
+    memcpy(&to, new_field, field_size);
+    memcpy(header.data() + field_offset, new_field, field_size);
+
+    uint16_t l3_checksum = checksum;
+    if (ebpf_core_l3_csum_replace_s(&l3_checksum, sizeof(l3_checksum), from, to, field_size) != 0) {
+        throw std::runtime_error("bpf_l3_csum_replace_s failed");
+    }
+
+    // Apply the same change as a delta from bpf_csum_diff.
+    uint16_t l4_checksum = checksum;
+    int diff = ebpf_core_csum_diff(&from, static_cast<int>(field_size), &to, static_cast<int>(field_size), 0);
+    if (ebpf_core_l4_csum_replace_s(&l4_checksum, sizeof(l4_checksum), 0, static_cast<uint32_t>(diff), 0) != 0) {
+        throw std::runtime_error("bpf_l4_csum_replace_s failed");
+    }
+
+    uint16_t expected = _reference_checksum(header);
+    if (!_checksums_equal(l3_checksum, expected) || !_checksums_equal(l4_checksum, expected)) {
+        throw std::runtime_error("Incremental checksum update does not match the recomputed checksum");
+    }
+    return 0;
+}
+
 int selected_program_type = 0;
 FUZZ_EXPORT int __cdecl LLVMFuzzerInitialize(int* argc, char*** argv)
 {
@@ -21,6 +124,8 @@ FUZZ_EXPORT int __cdecl LLVMFuzzerInitialize(int* argc, char*** argv)
                 selected_program_type = 1;
             } else if (strcmp(helper_arg, "sockops") == 0) {
                 selected_program_type = 2;
+            } else if (strcmp(helper_arg, "csum") == 0) {
+                selected_program_type = 3;
             }
 
             // Remove the flag and its argument from argv.
@@ -40,6 +145,8 @@ FUZZ_EXPORT int __cdecl LLVMFuzzerInitialize(int* argc, char*** argv)
         _fuzz_helper_function_sock_ops =
             std::make_unique<fuzz_helper_function_sock_ops_t>(ebpf_general_helper_function_module_id.Guid);
         atexit([]() { _fuzz_helper_function_sock_ops.reset(); });
+    } else if (selected_program_type == 3) {
+        // The checksum helpers are called directly, so no helper function provider is needed.
     } else {
         // default
         _fuzz_helper_function_sock_addr =
@@ -60,6 +167,8 @@ FUZZ_EXPORT int __cdecl LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
         return _fuzz_helper_function_sock_addr->fuzz(data, size);
     } else if (selected_program_type == 2) {
         return _fuzz_helper_function_sock_ops->fuzz(data, size);
+    } else if (selected_program_type == 3) {
+        return _fuzz_csum(data, size);
     } else {
         // default
         int ret = 0;
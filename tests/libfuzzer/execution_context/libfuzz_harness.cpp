@@ -376,7 +376,7 @@ class fuzz_wrapper
                 inner_map_handle = map_to_handle[BPF_MAP_TYPE_HASH];
             }
 
-            if (ebpf_core_create_map(&utf8_name, &modified_def, inner_map_handle, &handle) == EBPF_SUCCESS) {
+            if (ebpf_core_create_map(&utf8_name, &modified_def, 0, inner_map_handle, &handle) == EBPF_SUCCESS) {
                 handles.push_back(handle);
             } else {
                 throw std::runtime_error("create of map " + name + " failed");
@@ -535,6 +535,15 @@ fuzz_ioctl(std::vector<uint8_t>& random_buffer)
             }
         }
     }
+    if (operation_id == EBPF_OPERATION_PROGRAM_TEST_RUN_PARALLEL) {
+        ebpf_operation_program_test_run_parallel_request_t* test_request =
+            reinterpret_cast<ebpf_operation_program_test_run_parallel_request_t*>(random_buffer.data());
+        if (header->length >= EBPF_OFFSET_OF(ebpf_operation_program_test_run_parallel_request_t, data)) {
+            if (test_request->repeat_count > 1024) {
+                test_request->repeat_count = 1024;
+            }
+        }
+    }
 
     // Intentionally ignoring minimum_request_size and minimum_reply_size.
     result = ebpf_core_invoke_protocol_handler(
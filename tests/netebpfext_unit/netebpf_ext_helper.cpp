@@ -100,6 +100,8 @@ _netebpf_ext_helper::_netebpf_ext_helper(
 
 _netebpf_ext_helper::~_netebpf_ext_helper()
 {
+    nmr_additional_hook_client_handles.clear();
+
     if (nmr_hook_client_handle) {
         nmr_hook_client_handle.reset(nullptr);
     }
@@ -204,8 +206,15 @@ _netebpf_ext_helper::_hook_client_attach_provider(
     if (base_client_context == nullptr) {
         return STATUS_INVALID_PARAMETER;
     }
-    const ebpf_extension_dispatch_table_t client_dispatch_table = {
-        .version = 1, .count = 1, .function = base_client_context->helper->hook_invoke_function};
+    const ebpf_extension_program_dispatch_table_t client_dispatch_table = {
+        .version = EBPF_LINK_DISPATCH_TABLE_VERSION_CURRENT,
+        .count = EBPF_LINK_DISPATCH_TABLE_FUNCTION_COUNT_CURRENT,
+        .ebpf_program_invoke_function =
+            (ebpf_program_invoke_function_t)base_client_context->helper->hook_invoke_function,
+        .ebpf_program_batch_begin_invoke_function = _hook_client_batch_begin,
+        .ebpf_program_batch_invoke_function = _hook_client_batch_invoke,
+        .ebpf_program_batch_end_invoke_function = _hook_client_batch_end,
+        .ebpf_program_get_map_update_generation_function = _hook_client_get_map_update_generation};
     auto provider_data = (const ebpf_attach_provider_data_t*)provider_registration_instance->NpiSpecificCharacteristics;
     if (!base_client_context->desired_attach_types.empty() &&
         base_client_context->desired_attach_types.find(provider_data->bpf_attach_type) ==
@@ -235,3 +244,59 @@ _netebpf_ext_helper::_hook_client_cleanup_binding_context(_In_ void* client_bind
 {
     UNREFERENCED_PARAMETER(client_binding_context);
 }
+
+ebpf_result_t
+_netebpf_ext_helper::_hook_client_batch_begin(size_t state_size, _Out_writes_(state_size) void* state)
+{
+    if (state_size < sizeof(ebpf_execution_context_state_t)) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+    memset(state, 0, sizeof(ebpf_execution_context_state_t));
+    return EBPF_SUCCESS;
+}
+
+ebpf_result_t
+_netebpf_ext_helper::_hook_client_batch_invoke(
+    _In_ const void* client_binding_context,
+    _Inout_ void* program_context,
+    _Out_ uint32_t* result,
+    _In_ const void* state)
+{
+    UNREFERENCED_PARAMETER(state);
+    auto base_client_context = reinterpret_cast<const netebpfext_helper_base_client_context_t*>(client_binding_context);
+    auto invoke_function = (ebpf_program_invoke_function_t)base_client_context->helper->hook_invoke_function;
+    return invoke_function(client_binding_context, program_context, result);
+}
+
+ebpf_result_t
+_netebpf_ext_helper::_hook_client_batch_end(_Inout_ void* state)
+{
+    UNREFERENCED_PARAMETER(state);
+    return EBPF_SUCCESS;
+}
+
+volatile int64_t _netebpf_ext_helper::map_update_generation = 0;
+
+ebpf_result_t
+_netebpf_ext_helper::_hook_client_get_map_update_generation(
+    _In_ const void* client_binding_context, _Out_ uint64_t* generation)
+{
+    UNREFERENCED_PARAMETER(client_binding_context);
+    *generation = (uint64_t)ReadAcquire64(&map_update_generation);
+    return EBPF_SUCCESS;
+}
+
+bool
+_netebpf_ext_helper::add_hook_client(_Inout_ netebpfext_helper_base_client_context_t* client_context)
+{
+    if (hook_invoke_function == nullptr || !provider_registered) {
+        return false;
+    }
+    client_context->helper = this;
+    client_context->provider_binding_context = nullptr;
+    auto registration = std::make_unique<nmr_client_registration_t>(&hook_client, client_context);
+    bool attached = (registration->nmr_client_handle != INVALID_HANDLE_VALUE &&
+                     client_context->provider_binding_context != nullptr);
+    nmr_additional_hook_client_handles.push_back(std::move(registration));
+    return attached;
+}
@@ -48,6 +48,18 @@ typedef class _netebpf_ext_helper
     ebpf_program_data_t*
     get_program_info_provider_data(_In_ const GUID& program_info_provider);
 
+    // Register an additional hook client with the same attach parameters and dispatch function as the one passed to
+    // the constructor. Returns true if the client attached to at least one hook provider.
+    bool
+    add_hook_client(_Inout_ netebpfext_helper_base_client_context_t* client_context);
+
+    // Simulate an update of a map used by the hook clients.
+    void
+    update_map()
+    {
+        InterlockedIncrement64(&map_update_generation);
+    }
+
     FWP_ACTION_TYPE
     test_bind_ipv4(_In_ const fwp_classify_parameters_t* parameters)
     {
@@ -225,6 +237,24 @@ typedef class _netebpf_ext_helper
     static void
     _hook_client_cleanup_binding_context(_In_ void* client_binding_context);
 
+    static ebpf_result_t
+    _hook_client_batch_begin(size_t state_size, _Out_writes_(state_size) void* state);
+
+    static ebpf_result_t
+    _hook_client_batch_invoke(
+        _In_ const void* client_binding_context,
+        _Inout_ void* program_context,
+        _Out_ uint32_t* result,
+        _In_ const void* state);
+
+    static ebpf_result_t
+    _hook_client_batch_end(_Inout_ void* state);
+
+    static ebpf_result_t
+    _hook_client_get_map_update_generation(_In_ const void* client_binding_context, _Out_ uint64_t* generation);
+
+    static volatile int64_t map_update_generation;
+
     NPI_CLIENT_CHARACTERISTICS hook_client{
         1,
         sizeof(NPI_PROVIDER_CHARACTERISTICS),
@@ -245,6 +275,7 @@ typedef class _netebpf_ext_helper
 
     std::unique_ptr<nmr_client_registration_t> nmr_program_info_client_handle;
     std::unique_ptr<nmr_client_registration_t> nmr_hook_client_handle;
+    std::vector<std::unique_ptr<nmr_client_registration_t>> nmr_additional_hook_client_handles;
 
 } netebpf_ext_helper_t;
 
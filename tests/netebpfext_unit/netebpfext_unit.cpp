@@ -7,6 +7,8 @@
 #include "cxplat_fault_injection.h"
 #include "cxplat_passed_test_log.h"
 #include "ebpf_platform.h"
+#include "net_ebpf_ext_sock_addr.h"
+#include "net_ebpf_ext_sock_ops.h"
 #include "netebpf_ext_helper.h"
 #include "watchdog.h"
 
@@ -760,6 +762,335 @@ TEST_CASE("sock_addr_invoke_concurrent3", "[netebpfext_concurrent]")
     REQUIRE(failure_count == 0);
 }
 
+// Measure connect throughput when every connection caches a verdict at the connect_redirect layer for the connect
+// layer, with one thread per CPU using a distinct range of destination ports.
+TEST_CASE("sock_addr_connect_redirect_throughput", "[netebpfext_performance]")
+{
+    ebpf_extension_data_t npi_specific_characteristics = {
+        .header = EBPF_ATTACH_CLIENT_DATA_HEADER_VERSION,
+    };
+    test_sock_addr_client_context_header_t client_context_header = {0};
+    test_sock_addr_client_context_t* client_context = &client_context_header.context;
+    std::vector<fwp_classify_parameters_t> parameters;
+    std::atomic<size_t> failure_count = 0;
+    std::atomic<uint64_t> connect_count = 0;
+
+    // Declare helper before threads to ensure threads are joined before helper is destroyed.
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_sock_addr_program,
+        (netebpfext_helper_base_client_context_t*)client_context);
+
+    std::vector<std::jthread> threads;
+
+    // Hard permit verdicts are cached in the connection context table.
+    client_context->sock_addr_action = SOCK_ADDR_TEST_ACTION_PERMIT_HARD;
+    client_context->validate_sock_addr_entries = false;
+
+    uint32_t thread_count = ebpf_get_cpu_count();
+    parameters.resize(thread_count);
+
+    for (uint32_t i = 0; i < thread_count; i++) {
+        netebpfext_initialize_fwp_classify_parameters(&parameters[i]);
+        threads.emplace_back(
+            [&](std::stop_token token, fwp_classify_parameters_t* thread_parameters, uint16_t start_port) {
+                uint64_t local_connect_count = 0;
+                uint16_t port_number = start_port;
+                while (!token.stop_requested()) {
+                    thread_parameters->destination_port = htons(port_number);
+                    port_number = (port_number == start_port + 999) ? start_port : port_number + 1;
+                    if (helper.test_cgroup_inet4_connect(thread_parameters) != FWP_ACTION_PERMIT) {
+                        failure_count++;
+                        break;
+                    }
+                    local_connect_count++;
+                }
+                connect_count += local_connect_count;
+            },
+            &parameters[i],
+            (uint16_t)(i * 1000 + 1));
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(CONCURRENT_THREAD_RUN_TIME_IN_SECONDS));
+
+    // Stop all threads.
+    for (auto& thread : threads) {
+        thread.request_stop();
+    }
+
+    // Wait for all threads to stop.
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto duration =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+
+    REQUIRE(failure_count == 0);
+    REQUIRE(connect_count > 0);
+    std::cout << "sock_addr connect_redirect with " << thread_count
+              << " thread(s): " << (connect_count * 1000) / (duration.count() + 1) << " connects per second"
+              << std::endl;
+}
+
+typedef struct test_sock_addr_counting_client_context_t
+{
+    netebpfext_helper_base_client_context_t base;
+    uint64_t invocation_count;
+} test_sock_addr_counting_client_context_t;
+
+typedef struct test_sock_addr_counting_client_context_header_t
+{
+    EBPF_CONTEXT_HEADER;
+    test_sock_addr_counting_client_context_t context;
+} test_sock_addr_counting_client_context_header_t;
+
+_Must_inspect_result_ ebpf_result_t
+netebpfext_unit_count_sock_addr_program(
+    _In_ const void* client_binding_context, _In_ const void* context, _Out_ uint32_t* result)
+{
+    UNREFERENCED_PARAMETER(context);
+    auto client_context = (test_sock_addr_counting_client_context_t*)client_binding_context;
+    client_context->invocation_count++;
+    *result = BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT;
+    return EBPF_SUCCESS;
+}
+
+// Measure the cost of dispatching a SOCK_ADDR_CONNECT classify to 1, 4 and 16 attached programs.
+TEST_CASE("sock_addr_invoke_multi_attach_performance", "[netebpfext_performance]")
+{
+    const uint32_t iteration_count = 100000;
+
+    for (uint32_t client_count : {1u, 4u, (uint32_t)NET_EBPF_EXT_MAX_CLIENTS_PER_HOOK_MULTI_ATTACH}) {
+        ebpf_extension_data_t npi_specific_characteristics = {
+            .header = EBPF_ATTACH_CLIENT_DATA_HEADER_VERSION,
+        };
+        std::vector<test_sock_addr_counting_client_context_header_t> client_context_headers(client_count);
+        for (auto& client_context_header : client_context_headers) {
+            client_context_header.context.base.desired_attach_types = {BPF_CGROUP_INET4_CONNECT};
+        }
+        fwp_classify_parameters_t parameters = {};
+
+        netebpf_ext_helper_t helper(
+            &npi_specific_characteristics,
+            (_ebpf_extension_dispatch_function)netebpfext_unit_count_sock_addr_program,
+            (netebpfext_helper_base_client_context_t*)&client_context_headers[0].context);
+        for (uint32_t i = 1; i < client_count; i++) {
+            REQUIRE(helper.add_hook_client(
+                (netebpfext_helper_base_client_context_t*)&client_context_headers[i].context));
+        }
+
+        netebpfext_initialize_fwp_classify_parameters(&parameters);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < iteration_count; i++) {
+            REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start);
+
+        // Every attached program must have been invoked for every classify.
+        uint64_t expected_invocation_count = client_context_headers[0].context.invocation_count;
+        REQUIRE(expected_invocation_count >= iteration_count);
+        for (auto& client_context_header : client_context_headers) {
+            REQUIRE(client_context_header.context.invocation_count == expected_invocation_count);
+        }
+
+        std::cout << "sock_addr connect classify with " << client_count
+                  << " program(s): " << duration.count() / iteration_count << " ns per classify" << std::endl;
+    }
+}
+
+_Must_inspect_result_ ebpf_result_t
+netebpfext_unit_cacheable_sock_addr_program(
+    _In_ const void* client_binding_context, _In_ const void* context, _Out_ uint32_t* result)
+{
+    UNREFERENCED_PARAMETER(context);
+    auto client_context = (test_sock_addr_counting_client_context_t*)client_binding_context;
+    client_context->invocation_count++;
+    *result = BPF_SOCK_ADDR_VERDICT_PROCEED_SOFT | BPF_SOCK_ADDR_VERDICT_CACHEABLE;
+    return EBPF_SUCCESS;
+}
+
+// Connects with the same process, destination, protocol and compartment are given the cached verdict of a connect
+// program that allows caching. Attaching another program discards the cached verdicts.
+TEST_CASE("sock_addr_verdict_cache", "[netebpfext]")
+{
+    ebpf_extension_data_t npi_specific_characteristics = {
+        .header = EBPF_ATTACH_CLIENT_DATA_HEADER_VERSION,
+    };
+    test_sock_addr_counting_client_context_header_t client_context_header = {0};
+    test_sock_addr_counting_client_context_header_t second_client_context_header = {0};
+    client_context_header.context.base.desired_attach_types = {BPF_CGROUP_INET4_CONNECT};
+    second_client_context_header.context.base.desired_attach_types = {BPF_CGROUP_INET4_CONNECT};
+    fwp_classify_parameters_t parameters = {};
+    net_ebpf_ext_sock_addr_verdict_cache_statistics_t start_statistics;
+    net_ebpf_ext_sock_addr_verdict_cache_statistics_t end_statistics;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_cacheable_sock_addr_program,
+        (netebpfext_helper_base_client_context_t*)&client_context_header.context);
+
+    netebpfext_initialize_fwp_classify_parameters(&parameters);
+    net_ebpf_ext_sock_addr_get_verdict_cache_statistics(&start_statistics);
+
+    // The first cacheable verdict only turns the cache on, and the next connect invokes the program and caches its
+    // verdict.
+    REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+    uint64_t invocation_count = client_context_header.context.invocation_count;
+    REQUIRE(invocation_count > 0);
+    REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+    REQUIRE(client_context_header.context.invocation_count > invocation_count);
+    invocation_count = client_context_header.context.invocation_count;
+
+    // Repeated connects are given the cached verdict.
+    for (uint32_t i = 0; i < 10; i++) {
+        REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+    }
+    REQUIRE(client_context_header.context.invocation_count == invocation_count);
+
+    net_ebpf_ext_sock_addr_get_verdict_cache_statistics(&end_statistics);
+    REQUIRE(end_statistics.hit_count - start_statistics.hit_count == 10);
+
+    // A different destination port is not in the cache.
+    parameters.destination_port = htons(ntohs(parameters.destination_port) + 1);
+    REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+    REQUIRE(client_context_header.context.invocation_count > invocation_count);
+    invocation_count = client_context_header.context.invocation_count;
+
+    // A map update discards the cached verdicts, and the next verdict is cached again.
+    helper.update_map();
+    REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+    REQUIRE(client_context_header.context.invocation_count > invocation_count);
+    invocation_count = client_context_header.context.invocation_count;
+    REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+    REQUIRE(client_context_header.context.invocation_count == invocation_count);
+
+    // Attaching another program discards the cached verdicts, so both programs are invoked.
+    REQUIRE(helper.add_hook_client((netebpfext_helper_base_client_context_t*)&second_client_context_header.context));
+    REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+    REQUIRE(client_context_header.context.invocation_count > invocation_count);
+    REQUIRE(second_client_context_header.context.invocation_count > 0);
+}
+
+// Connect classifies for another compartment, or for the address family of the other connect attach type, bail out
+// without invoking the program and without leaving a verdict behind for the CONNECT_AUTHORIZATION layer.
+TEST_CASE("sock_addr_connect_redirect_bail_out", "[netebpfext]")
+{
+    fwp_classify_parameters_t parameters = {};
+    netebpfext_initialize_fwp_classify_parameters(&parameters);
+
+    SECTION("compartment")
+    {
+        uint32_t compartment_id = parameters.compartment_id + 1;
+        ebpf_extension_data_t npi_specific_characteristics = {
+            .header = EBPF_ATTACH_CLIENT_DATA_HEADER_VERSION,
+            .data = &compartment_id,
+            .data_size = sizeof(compartment_id),
+        };
+        test_sock_addr_counting_client_context_header_t client_context_header = {0};
+        client_context_header.context.base.desired_attach_types = {BPF_CGROUP_INET4_CONNECT, BPF_CGROUP_INET6_CONNECT};
+
+        netebpf_ext_helper_t helper(
+            &npi_specific_characteristics,
+            (_ebpf_extension_dispatch_function)netebpfext_unit_count_sock_addr_program,
+            (netebpfext_helper_base_client_context_t*)&client_context_header.context);
+
+        REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+        REQUIRE(helper.test_cgroup_inet6_connect(&parameters) == FWP_ACTION_PERMIT);
+        REQUIRE(client_context_header.context.invocation_count == 0);
+
+        parameters.compartment_id = compartment_id;
+        REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+        REQUIRE(client_context_header.context.invocation_count > 0);
+    }
+
+    SECTION("v4-mapped destination and attach type")
+    {
+        ebpf_extension_data_t npi_specific_characteristics = {
+            .header = EBPF_ATTACH_CLIENT_DATA_HEADER_VERSION,
+        };
+        test_sock_addr_counting_client_context_header_t v4_client_context_header = {0};
+        test_sock_addr_counting_client_context_header_t v6_client_context_header = {0};
+        v4_client_context_header.context.base.desired_attach_types = {BPF_CGROUP_INET4_CONNECT};
+        v6_client_context_header.context.base.desired_attach_types = {BPF_CGROUP_INET6_CONNECT};
+
+        netebpf_ext_helper_t helper(
+            &npi_specific_characteristics,
+            (_ebpf_extension_dispatch_function)netebpfext_unit_count_sock_addr_program,
+            (netebpfext_helper_base_client_context_t*)&v4_client_context_header.context);
+        REQUIRE(helper.add_hook_client((netebpfext_helper_base_client_context_t*)&v6_client_context_header.context));
+
+        // A pure v6 destination is only of interest to the program of the v6 attach type.
+        REQUIRE(helper.test_cgroup_inet6_connect(&parameters) == FWP_ACTION_PERMIT);
+        REQUIRE(v4_client_context_header.context.invocation_count == 0);
+        uint64_t v6_invocation_count = v6_client_context_header.context.invocation_count;
+        REQUIRE(v6_invocation_count > 0);
+
+        // A v4-mapped destination (::ffff:1.2.3.4) is only of interest to the program of the v4 attach type.
+        FWP_BYTE_ARRAY16 v4_mapped_address = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 1, 2, 3, 4};
+        parameters.destination_ipv6_address = v4_mapped_address;
+        REQUIRE(helper.test_cgroup_inet6_connect(&parameters) == FWP_ACTION_PERMIT);
+        REQUIRE(v4_client_context_header.context.invocation_count > 0);
+        REQUIRE(v6_client_context_header.context.invocation_count == v6_invocation_count);
+    }
+}
+
+// Measure the cost of a SOCK_ADDR_CONNECT classify given a cached verdict against one that invokes the program.
+TEST_CASE("sock_addr_verdict_cache_performance", "[netebpfext_performance]")
+{
+    const uint32_t iteration_count = 100000;
+    uint64_t duration_per_classify[2] = {};
+
+    for (bool cacheable : {false, true}) {
+        ebpf_extension_data_t npi_specific_characteristics = {
+            .header = EBPF_ATTACH_CLIENT_DATA_HEADER_VERSION,
+        };
+        test_sock_addr_counting_client_context_header_t client_context_header = {0};
+        client_context_header.context.base.desired_attach_types = {BPF_CGROUP_INET4_CONNECT};
+        fwp_classify_parameters_t parameters = {};
+        net_ebpf_ext_sock_addr_verdict_cache_statistics_t start_statistics;
+        net_ebpf_ext_sock_addr_verdict_cache_statistics_t end_statistics;
+
+        netebpf_ext_helper_t helper(
+            &npi_specific_characteristics,
+            cacheable ? (_ebpf_extension_dispatch_function)netebpfext_unit_cacheable_sock_addr_program
+                      : (_ebpf_extension_dispatch_function)netebpfext_unit_count_sock_addr_program,
+            (netebpfext_helper_base_client_context_t*)&client_context_header.context);
+
+        netebpfext_initialize_fwp_classify_parameters(&parameters);
+        net_ebpf_ext_sock_addr_get_verdict_cache_statistics(&start_statistics);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < iteration_count; i++) {
+            REQUIRE(helper.test_cgroup_inet4_connect(&parameters) == FWP_ACTION_PERMIT);
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start);
+        duration_per_classify[cacheable] = duration.count() / iteration_count;
+
+        net_ebpf_ext_sock_addr_get_verdict_cache_statistics(&end_statistics);
+        uint64_t hit_count = end_statistics.hit_count - start_statistics.hit_count;
+        uint64_t lookup_count = hit_count + end_statistics.miss_count - start_statistics.miss_count;
+        if (cacheable) {
+            REQUIRE(hit_count > 0);
+            REQUIRE(client_context_header.context.invocation_count < iteration_count);
+        } else {
+            REQUIRE(hit_count == 0);
+            REQUIRE(client_context_header.context.invocation_count >= iteration_count);
+        }
+
+        std::cout << "sock_addr connect classify with " << (cacheable ? "cacheable" : "uncacheable")
+                  << " verdict: " << duration_per_classify[cacheable] << " ns per classify, "
+                  << ((lookup_count == 0) ? 0 : (hit_count * 100) / lookup_count) << "% cache hit rate" << std::endl;
+    }
+
+    std::cout << "sock_addr verdict cache saved "
+              << (int64_t)duration_per_classify[false] - (int64_t)duration_per_classify[true] << " ns per classify"
+              << std::endl;
+}
+
 TEST_CASE("sock_addr_context", "[netebpfext]")
 {
     netebpf_ext_helper_t helper;
@@ -1248,6 +1579,85 @@ TEST_CASE("sock_ops_invoke_concurrent2", "[netebpfext_concurrent]")
     REQUIRE(failure_count == 0);
 }
 
+// Create and delete SOCK_OPS flows as fast as possible on every CPU, and report the flow rate and how often the flow
+// context was recycled from the per-CPU cache instead of the pool.
+TEST_CASE("sock_ops_flow_churn_performance", "[netebpfext_performance]")
+{
+    ebpf_extension_data_t npi_specific_characteristics = {
+        .header = EBPF_ATTACH_CLIENT_DATA_HEADER_VERSION,
+    };
+    test_sock_ops_client_context_header_t client_context_header = {0};
+    test_sock_ops_client_context_t* client_context = &client_context_header.context;
+    std::vector<fwp_classify_parameters_t> parameters;
+    std::atomic<size_t> failure_count = 0;
+    std::atomic<uint64_t> flow_count = 0;
+
+    // Declare helper before threads to ensure threads are joined before helper is destroyed.
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_sock_ops_program,
+        (netebpfext_helper_base_client_context_t*)client_context);
+
+    std::vector<std::jthread> threads;
+
+    client_context->sock_ops_action = SOCK_OPS_TEST_ACTION_PERMIT;
+    uint32_t thread_count = ebpf_get_cpu_count();
+    parameters.resize(thread_count);
+
+    net_ebpf_extension_lookaside_statistics_t start_statistics;
+    net_ebpf_ext_sock_ops_get_flow_context_cache_statistics(&start_statistics);
+
+    for (uint32_t i = 0; i < thread_count; i++) {
+        netebpfext_initialize_fwp_classify_parameters(&parameters[i]);
+        threads.emplace_back(
+            [&](std::stop_token token, fwp_classify_parameters_t* thread_parameters, uint16_t start_port) {
+                uint64_t local_flow_count = 0;
+                uint16_t port_number = start_port;
+                while (!token.stop_requested()) {
+                    uint64_t flow_id = 0;
+                    thread_parameters->destination_port = htons(port_number);
+                    port_number = (port_number == start_port + 999) ? start_port : port_number + 1;
+                    if (helper.test_sock_ops_v4(thread_parameters, &flow_id) != FWP_ACTION_PERMIT || flow_id == 0) {
+                        failure_count++;
+                        break;
+                    }
+                    helper.test_sock_ops_v4_remove_flow_context(flow_id);
+                    local_flow_count++;
+                }
+                flow_count += local_flow_count;
+            },
+            &parameters[i],
+            (uint16_t)(i * 1000 + 1));
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(CONCURRENT_THREAD_RUN_TIME_IN_SECONDS));
+
+    // Stop all threads.
+    for (auto& thread : threads) {
+        thread.request_stop();
+    }
+
+    // Wait for all threads to stop.
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto duration =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+
+    net_ebpf_extension_lookaside_statistics_t end_statistics;
+    net_ebpf_ext_sock_ops_get_flow_context_cache_statistics(&end_statistics);
+    uint64_t allocate_count = end_statistics.allocate_count - start_statistics.allocate_count;
+    uint64_t hit_count = end_statistics.hit_count - start_statistics.hit_count;
+
+    REQUIRE(failure_count == 0);
+    REQUIRE(flow_count > 0);
+    REQUIRE(allocate_count >= flow_count);
+    std::cout << "sock_ops flow churn with " << thread_count
+              << " thread(s): " << (flow_count * 1000) / (duration.count() + 1) << " flows per second, "
+              << (hit_count * 100) / (allocate_count + 1) << "% flow context cache hits" << std::endl;
+}
+
 TEST_CASE("sock_addr_listen_invoke", "[netebpfext]")
 {
     ebpf_extension_data_t npi_specific_characteristics = {
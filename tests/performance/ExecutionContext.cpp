@@ -5,6 +5,7 @@
 
 #define TEST_AREA "ExecutionContext"
 
+#include "ebpf_handle.h"
 #include "performance.h"
 
 extern "C"
@@ -490,6 +491,358 @@ test_lpm_trie_ipv4(bool preemptible)
     measure.run_test();
 }
 
+// Buffers for the checksum tests, sized for a full Ethernet frame.
+static uint8_t _csum_from_buffer[1500];
+static uint8_t _csum_to_buffer[1500];
+static size_t _csum_buffer_size;
+static volatile int64_t _csum_result;
+
+static void
+_csum_diff_test()
+{
+    _csum_result = ebpf_core_csum_diff(
+        _csum_from_buffer,
+        static_cast<int>(_csum_buffer_size),
+        _csum_to_buffer,
+        static_cast<int>(_csum_buffer_size),
+        0);
+}
+
+static void
+_l4_csum_replace_s_test()
+{
+    // Rewrite a 4 byte address covered by the checksum, as a NAT would.
+    uint16_t checksum = static_cast<uint16_t>(_csum_result);
+    (void)ebpf_core_l4_csum_replace_s(
+        &checksum, sizeof(checksum), 0x0100a8c0, 0x0200a8c0, sizeof(uint32_t) | BPF_F_MARK_MANGLED_0);
+    _csum_result = checksum;
+}
+
+template <size_t buffer_size>
+void
+test_csum_diff(bool preemptible)
+{
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT;
+    static_assert(buffer_size <= sizeof(_csum_from_buffer));
+    std::iota(std::begin(_csum_from_buffer), std::end(_csum_from_buffer), static_cast<uint8_t>(0));
+    std::iota(std::begin(_csum_to_buffer), std::end(_csum_to_buffer), static_cast<uint8_t>(1));
+    _csum_buffer_size = buffer_size;
+    std::string name = __FUNCTION__;
+    name += "<";
+    name += std::to_string(buffer_size);
+    name += ">";
+
+    _performance_measure measure(name.c_str(), preemptible, _csum_diff_test, iterations);
+    measure.run_test();
+}
+
+void
+test_l4_csum_replace_s(bool preemptible)
+{
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT;
+    _csum_result = 0x1234;
+
+    _performance_measure measure(__FUNCTION__, preemptible, _l4_csum_replace_s_test, iterations);
+    measure.run_test();
+}
+
+typedef struct _per_cpu_counters
+{
+    uint64_t packets;
+    uint64_t bytes;
+} per_cpu_counters_t;
+
+#define PER_CPU_DUMP_BATCH_RECORD_COUNT 1024
+
+typedef class _ebpf_map_per_cpu_dump_test_state
+{
+  public:
+    _ebpf_map_per_cpu_dump_test_state(uint32_t entry_count)
+        : cpu_count(ebpf_get_cpu_count()), buffers(cpu_count), totals(cpu_count)
+    {
+        cxplat_utf8_string_t name{(uint8_t*)"counters", 8};
+        REQUIRE(ebpf_core_initiate() == EBPF_SUCCESS);
+        ebpf_map_definition_in_memory_t definition{
+            BPF_MAP_TYPE_PERCPU_HASH, sizeof(uint32_t), sizeof(per_cpu_counters_t), entry_count};
+        REQUIRE(ebpf_map_create(&name, &definition, ebpf_handle_invalid, &map) == EBPF_SUCCESS);
+
+        std::vector<per_cpu_counters_t> value(cpu_count, {1, 1500});
+        for (uint32_t key = 0; key < entry_count; key++) {
+            REQUIRE(
+                ebpf_map_update_entry(
+                    map,
+                    sizeof(key),
+                    (uint8_t*)&key,
+                    (uint32_t)(value.size() * sizeof(per_cpu_counters_t)),
+                    (uint8_t*)value.data(),
+                    EBPF_ANY,
+                    0) == EBPF_SUCCESS);
+        }
+        for (auto& buffer : buffers) {
+            buffer.resize(
+                PER_CPU_DUMP_BATCH_RECORD_COUNT * (sizeof(uint32_t) + cpu_count * sizeof(per_cpu_counters_t)));
+        }
+    }
+    ~_ebpf_map_per_cpu_dump_test_state()
+    {
+        EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)map);
+        ebpf_core_terminate();
+    }
+
+    // Dump the map and total the counters of every entry. Without kernel aggregation the per-CPU values are copied
+    // out and reduced by the caller, as a user mode dump would have to.
+    void
+    test_dump(uint32_t cpu_id, int flags)
+    {
+        std::vector<uint8_t>& buffer = buffers[cpu_id];
+        size_t value_size = flags ? sizeof(per_cpu_counters_t) : cpu_count * sizeof(per_cpu_counters_t);
+        size_t record_size = sizeof(uint32_t) + value_size;
+        per_cpu_counters_t total = {};
+        uint32_t previous_key = 0;
+        size_t previous_key_length = 0;
+        for (;;) {
+            size_t length = PER_CPU_DUMP_BATCH_RECORD_COUNT * record_size;
+            ebpf_epoch_state_t epoch_state;
+            ebpf_epoch_enter(&epoch_state);
+            ebpf_result_t result = ebpf_map_get_next_key_and_value_batch(
+                map, previous_key_length, (uint8_t*)&previous_key, &length, buffer.data(), flags);
+            ebpf_epoch_exit(&epoch_state);
+            if (result != EBPF_SUCCESS) {
+                break;
+            }
+            for (size_t offset = 0; offset < length; offset += record_size) {
+                const per_cpu_counters_t* values =
+                    (const per_cpu_counters_t*)(buffer.data() + offset + sizeof(uint32_t));
+                for (size_t cpu = 0; cpu < value_size / sizeof(per_cpu_counters_t); cpu++) {
+                    total.packets += values[cpu].packets;
+                    total.bytes += values[cpu].bytes;
+                }
+            }
+            previous_key = *(uint32_t*)(buffer.data() + length - record_size);
+            previous_key_length = sizeof(previous_key);
+        }
+        totals[cpu_id] = total;
+    }
+
+  private:
+    uint32_t cpu_count;
+    ebpf_map_t* map;
+    std::vector<std::vector<uint8_t>> buffers;
+    std::vector<per_cpu_counters_t> totals;
+} ebpf_map_per_cpu_dump_test_state_t;
+
+static ebpf_map_per_cpu_dump_test_state_t* _ebpf_map_per_cpu_dump_test_state_instance = nullptr;
+
+static void
+_map_per_cpu_dump_test(uint32_t cpu_id)
+{
+    _ebpf_map_per_cpu_dump_test_state_instance->test_dump(cpu_id, 0);
+}
+
+static void
+_map_per_cpu_dump_sum_test(uint32_t cpu_id)
+{
+    _ebpf_map_per_cpu_dump_test_state_instance->test_dump(cpu_id, EBPF_MAP_FLAG_PERCPU_SUM);
+}
+
+template <typename T>
+static void
+_map_per_cpu_dump_measure(_In_z_ const char* function, uint32_t entry_count, bool preemptible, T worker)
+{
+    size_t iterations = 100;
+    ebpf_map_per_cpu_dump_test_state_t test_state(entry_count);
+    _ebpf_map_per_cpu_dump_test_state_instance = &test_state;
+    std::string name = function;
+    name += "<";
+    name += std::to_string(entry_count);
+    name += ">";
+
+    // Each iteration dumps the whole map, so the reported time is per entry.
+    _performance_measure measure(name.c_str(), preemptible, worker, iterations);
+    measure.run_test(entry_count);
+}
+
+template <uint32_t entry_count>
+void
+test_map_per_cpu_dump(bool preemptible)
+{
+    _map_per_cpu_dump_measure(__FUNCTION__, entry_count, preemptible, _map_per_cpu_dump_test);
+}
+
+template <uint32_t entry_count>
+void
+test_map_per_cpu_dump_sum(bool preemptible)
+{
+    _map_per_cpu_dump_measure(__FUNCTION__, entry_count, preemptible, _map_per_cpu_dump_sum_test);
+}
+
+#define MAP_DUMP_VALUE_SIZE 64
+
+typedef class _ebpf_map_dump_message_test_state
+{
+  public:
+    _ebpf_map_dump_message_test_state(uint32_t entry_count)
+        : entry_count(entry_count), record_size(sizeof(uint32_t) + MAP_DUMP_VALUE_SIZE),
+          requests(ebpf_get_cpu_count()), replies(ebpf_get_cpu_count()), counts(ebpf_get_cpu_count())
+    {
+        cxplat_utf8_string_t name{(uint8_t*)"dump", 4};
+        REQUIRE(ebpf_core_initiate() == EBPF_SUCCESS);
+        ebpf_map_definition_in_memory_t definition{
+            BPF_MAP_TYPE_HASH, sizeof(uint32_t), MAP_DUMP_VALUE_SIZE, entry_count};
+        REQUIRE(ebpf_core_create_map(&name, &definition, 0, ebpf_handle_invalid, &map_handle) == EBPF_SUCCESS);
+
+        // Populate the map with a single large update request.
+        std::vector<uint8_t> request(
+            EBPF_OFFSET_OF(ebpf_operation_map_update_element_batch_request_t, data) + entry_count * record_size);
+        auto update = (ebpf_operation_map_update_element_batch_request_t*)request.data();
+        auto header = (ebpf_operation_large_header_t*)request.data();
+        header->length = (uint16_t)request.size();
+        header->length_high = (uint16_t)(request.size() >> 16);
+        header->id = EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH;
+        update->handle = map_handle;
+        update->option = EBPF_ANY;
+        for (uint32_t key = 0; key < entry_count; key++) {
+            memcpy(update->data + key * record_size, &key, sizeof(key));
+        }
+        ebpf_operation_map_update_element_batch_reply_t reply;
+        REQUIRE(
+            ebpf_core_invoke_large_protocol_handler(
+                EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH,
+                request.data(),
+                (uint32_t)request.size(),
+                &reply,
+                sizeof(reply)) == EBPF_SUCCESS);
+
+        for (auto& buffer : requests) {
+            buffer.resize(EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_request_t, previous_key) +
+                          sizeof(uint32_t));
+        }
+        for (auto& buffer : replies) {
+            buffer.resize(EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_reply_t, data) +
+                          entry_count * record_size);
+        }
+    }
+    ~_ebpf_map_dump_message_test_state()
+    {
+        for (auto count : counts) {
+            REQUIRE((count == 0 || count == entry_count));
+        }
+        (void)ebpf_handle_close(map_handle);
+        ebpf_core_terminate();
+    }
+
+    // Dump the map through the protocol handler, either with regular messages, whose reply is limited to 64 KB, or
+    // with large messages that return the whole map at once.
+    void
+    test_dump(uint32_t cpu_id, bool large_message)
+    {
+        std::vector<uint8_t>& request = requests[cpu_id];
+        std::vector<uint8_t>& reply = replies[cpu_id];
+        const size_t reply_header_length = EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_reply_t, data);
+        size_t reply_buffer_length = reply.size();
+        if (!large_message) {
+            size_t records_per_reply = (UINT16_MAX - reply_header_length) / record_size;
+            reply_buffer_length = std::min(reply_buffer_length, reply_header_length + records_per_reply * record_size);
+        }
+        auto dump = (ebpf_operation_map_get_next_key_value_batch_request_t*)request.data();
+        auto request_header = (ebpf_operation_large_header_t*)request.data();
+        auto reply_header = (const ebpf_operation_large_header_t*)reply.data();
+        size_t request_length = EBPF_OFFSET_OF(ebpf_operation_map_get_next_key_value_batch_request_t, previous_key);
+        size_t count = 0;
+        for (;;) {
+            request_header->length = (uint16_t)request_length;
+            request_header->length_high = 0;
+            request_header->id = EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH;
+            dump->handle = map_handle;
+            dump->flags = 0;
+            ebpf_result_t result;
+            if (large_message) {
+                result = ebpf_core_invoke_large_protocol_handler(
+                    EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH,
+                    request.data(),
+                    (uint32_t)request_length,
+                    reply.data(),
+                    (uint32_t)reply_buffer_length);
+            } else {
+                result = ebpf_core_invoke_protocol_handler(
+                    EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH,
+                    request.data(),
+                    (uint16_t)request_length,
+                    reply.data(),
+                    (uint16_t)reply_buffer_length,
+                    nullptr,
+                    nullptr);
+            }
+            if (result != EBPF_SUCCESS) {
+                break;
+            }
+            size_t reply_length = reply_header->length;
+            if (large_message) {
+                reply_length |= (size_t)reply_header->length_high << 16;
+            }
+            count += (reply_length - reply_header_length) / record_size;
+
+            // Continue after the last key returned.
+            memcpy(dump->previous_key, reply.data() + reply_length - record_size, sizeof(uint32_t));
+            request_length = request.size();
+        }
+        counts[cpu_id] = count;
+    }
+
+  private:
+    uint32_t entry_count;
+    size_t record_size;
+    ebpf_handle_t map_handle;
+    std::vector<std::vector<uint8_t>> requests;
+    std::vector<std::vector<uint8_t>> replies;
+    std::vector<size_t> counts;
+} ebpf_map_dump_message_test_state_t;
+
+static ebpf_map_dump_message_test_state_t* _ebpf_map_dump_message_test_state_instance = nullptr;
+
+static void
+_map_dump_regular_message_test(uint32_t cpu_id)
+{
+    _ebpf_map_dump_message_test_state_instance->test_dump(cpu_id, false);
+}
+
+static void
+_map_dump_large_message_test(uint32_t cpu_id)
+{
+    _ebpf_map_dump_message_test_state_instance->test_dump(cpu_id, true);
+}
+
+template <typename T>
+static void
+_map_dump_message_measure(_In_z_ const char* function, uint32_t entry_count, bool preemptible, T worker)
+{
+    size_t iterations = 100;
+    ebpf_map_dump_message_test_state_t test_state(entry_count);
+    _ebpf_map_dump_message_test_state_instance = &test_state;
+    std::string name = function;
+    name += "<";
+    name += std::to_string(entry_count);
+    name += ">";
+
+    // Each iteration dumps the whole map, so the reported time is per entry.
+    _performance_measure measure(name.c_str(), preemptible, worker, iterations);
+    measure.run_test(entry_count);
+}
+
+template <uint32_t entry_count>
+void
+test_map_dump_regular_message(bool preemptible)
+{
+    _map_dump_message_measure(__FUNCTION__, entry_count, preemptible, _map_dump_regular_message_test);
+}
+
+template <uint32_t entry_count>
+void
+test_map_dump_large_message(bool preemptible)
+{
+    _map_dump_message_measure(__FUNCTION__, entry_count, preemptible, _map_dump_large_message_test);
+}
+
 #if !defined(CONFIG_BPF_JIT_DISABLED)
 PERF_TEST(test_program_invoke_jit);
 #endif
@@ -521,3 +874,15 @@ PERF_TEST(test_lpm_trie_ipv4<1024>);
 PERF_TEST(test_lpm_trie_ipv4<1024 * 16>);
 PERF_TEST(test_lpm_trie_ipv4<1024 * 256>);
 PERF_TEST(test_lpm_trie_ipv4<1024 * 1024>);
+
+PERF_TEST(test_csum_diff<4>);
+PERF_TEST(test_csum_diff<20>);
+PERF_TEST(test_csum_diff<64>);
+PERF_TEST(test_csum_diff<1500>);
+PERF_TEST(test_l4_csum_replace_s);
+
+PERF_TEST(test_map_per_cpu_dump<1024 * 64>);
+PERF_TEST(test_map_per_cpu_dump_sum<1024 * 64>);
+
+PERF_TEST(test_map_dump_regular_message<1024 * 64>);
+PERF_TEST(test_map_dump_large_message<1024 * 64>);
@@ -0,0 +1,83 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+// Whenever this sample program changes, bpf2c_tests will fail unless the
+// expected files in tests\bpf2c_tests\expected are updated. The following
+// script can be used to regenerate the expected files:
+//     generate_expected_bpf2c_output.ps1
+//
+// Usage:
+// .\scripts\generate_expected_bpf2c_output.ps1 <build_output_path>
+// Example:
+// .\scripts\generate_expected_bpf2c_output.ps1 .\x64\Debug\
+
+// Object with a large number of independent programs that share their maps, used to measure the time taken to
+// verify and load all programs of an object.
+
+#include "bpf_helpers.h"
+#include "ebpf_nethooks.h"
+
+#define APP_ID_SCAN_LENGTH 32
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __type(key, uint64_t);
+    __type(value, uint64_t);
+    __uint(max_entries, 1024);
+} process_map SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint64_t);
+    __uint(max_entries, 64);
+} counter_map SEC(".maps");
+
+// Each program hashes the start of the app ID, so that the verifier has some work to do for each of them.
+#define DECLARE_PROGRAM(INDEX)                                                 \
+    SEC("bind")                                                                \
+    bind_action_t program##INDEX(bind_md_t* ctx)                               \
+    {                                                                          \
+        uint64_t key = ctx->process_id;                                        \
+        uint64_t hash = INDEX;                                                 \
+        uint32_t counter_index = INDEX;                                        \
+        uint8_t* app_id = ctx->app_id_start;                                   \
+        _Pragma("unroll") for (int i = 0; i < APP_ID_SCAN_LENGTH; i++)         \
+        {                                                                      \
+            if (app_id + i + 1 > ctx->app_id_end) {                            \
+                break;                                                         \
+            }                                                                  \
+            hash = (hash * 31) + app_id[i];                                    \
+        }                                                                      \
+        uint64_t* count = bpf_map_lookup_elem(&counter_map, &counter_index);   \
+        if (count) {                                                           \
+            *count += 1;                                                       \
+        }                                                                      \
+        uint64_t* previous = bpf_map_lookup_elem(&process_map, &key);          \
+        if (previous && *previous == hash) {                                   \
+            return BIND_PERMIT_SOFT;                                           \
+        }                                                                      \
+        bpf_map_update_elem(&process_map, &key, &hash, 0);                     \
+        return (ctx->operation == BIND_OPERATION_BIND) ? BIND_PERMIT_SOFT      \
+                                                       : BIND_PERMIT_HARD;     \
+    }
+
+#define DECLARE_10_PROGRAMS(PREFIX) \
+    DECLARE_PROGRAM(PREFIX##0)      \
+    DECLARE_PROGRAM(PREFIX##1)      \
+    DECLARE_PROGRAM(PREFIX##2)      \
+    DECLARE_PROGRAM(PREFIX##3)      \
+    DECLARE_PROGRAM(PREFIX##4)      \
+    DECLARE_PROGRAM(PREFIX##5)      \
+    DECLARE_PROGRAM(PREFIX##6)      \
+    DECLARE_PROGRAM(PREFIX##7)      \
+    DECLARE_PROGRAM(PREFIX##8)      \
+    DECLARE_PROGRAM(PREFIX##9)
+
+DECLARE_10_PROGRAMS(1)
+DECLARE_10_PROGRAMS(2)
+DECLARE_10_PROGRAMS(3)
+DECLARE_10_PROGRAMS(4)
+DECLARE_10_PROGRAMS(5)
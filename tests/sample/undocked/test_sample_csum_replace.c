@@ -0,0 +1,57 @@
+// Copyright (c) eBPF for Windows contributors
+// SPDX-License-Identifier: MIT
+
+// Whenever this sample program changes, bpf2c_tests will fail unless the
+// expected files in tests\bpf2c_tests\expected are updated. The following
+// script can be used to regenerate the expected files:
+//     generate_expected_bpf2c_output.ps1
+//
+// Usage:
+// .\scripts\generate_expected_bpf2c_output.ps1 <build_output_path>
+// Example:
+// .\scripts\generate_expected_bpf2c_output.ps1 .\x64\Debug\
+
+// Test eBPF program for EBPF_PROGRAM_TYPE_SAMPLE implemented in
+// the Sample eBPF extension. It rewrites a 4 byte field covered by two
+// checksums, using bpf_l3_csum_replace_s and bpf_l4_csum_replace_s.
+
+#include "bpf_helpers.h"
+#include "sample_ext_helpers.h"
+
+typedef struct _csum_replace_value
+{
+    uint16_t l3_checksum;
+    uint16_t l4_checksum;
+    uint32_t from;
+    uint32_t to;
+    int32_t l3_result;
+    int32_t l4_result;
+} csum_replace_value_t;
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, csum_replace_value_t);
+    __uint(max_entries, 1);
+} csum_replace_map SEC(".maps");
+
+SEC("sample_ext")
+int
+test_sample_csum_replace(sample_program_context_t* context)
+{
+    (void)context;
+
+    uint32_t key = 0;
+    csum_replace_value_t* value = bpf_map_lookup_elem(&csum_replace_map, &key);
+    if (value == NULL) {
+        return 1;
+    }
+
+    value->l3_result =
+        (int32_t)bpf_l3_csum_replace_s(&value->l3_checksum, sizeof(uint16_t), value->from, value->to, sizeof(uint32_t));
+    value->l4_result = (int32_t)bpf_l4_csum_replace_s(
+        &value->l4_checksum, sizeof(uint16_t), value->from, value->to, sizeof(uint32_t) | BPF_F_PSEUDO_HDR);
+
+    return 0;
+}
@@ -82,6 +82,7 @@ struct thread_context
     std::vector<object_table_entry>& object_table;
     std::string extension_name{};
     bool succeeded{true};
+    uint64_t operation_count{};
 };
 
 // This call is called by the common test initialization code to get a list of programs supported by the user mode
@@ -1309,6 +1310,132 @@ _mt_sockaddr_invoke_program_test(ebpf_execution_type_t program_type, const test_
         extension_restart_thread_context_table);
 }
 
+static void
+_invoke_mt_sock_ops_flow_churn_thread_function(thread_context& context)
+{
+    SOCKADDR_IN local_endpoint{};
+    local_endpoint.sin_family = AF_INET;
+    local_endpoint.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    local_endpoint.sin_port = htons(SOCKET_TEST_PORT + static_cast<uint16_t>(context.thread_index));
+
+    SOCKET listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_socket == INVALID_SOCKET ||
+        bind(listen_socket, reinterpret_cast<SOCKADDR*>(&local_endpoint), sizeof(local_endpoint)) != 0 ||
+        listen(listen_socket, SOMAXCONN) != 0) {
+        LOG_ERROR(
+            "{}({}) - FATAL ERROR: listen socket setup failed. errno:{}",
+            __func__,
+            context.thread_index,
+            WSAGetLastError());
+        context.succeeded = false;
+        if (listen_socket != INVALID_SOCKET) {
+            closesocket(listen_socket);
+        }
+        return;
+    }
+
+    using sc = std::chrono::steady_clock;
+    auto endtime = sc::now() + std::chrono::minutes(context.duration_minutes);
+    while (sc::now() < endtime) {
+
+        // Each iteration establishes a loopback connection, which creates an outbound and an inbound flow, and then
+        // closes both ends, which deletes them.
+        SOCKET client_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (client_socket == INVALID_SOCKET) {
+            LOG_ERROR(
+                "{}({}) - FATAL ERROR: socket() failed. errno:{}", __func__, context.thread_index, WSAGetLastError());
+            context.succeeded = false;
+            break;
+        }
+
+        // Connect failures are tolerated, since the extension may be restarting.
+        if (connect(client_socket, reinterpret_cast<SOCKADDR*>(&local_endpoint), sizeof(local_endpoint)) == 0) {
+            SOCKET accepted_socket = accept(listen_socket, nullptr, nullptr);
+            if (accepted_socket != INVALID_SOCKET) {
+                closesocket(accepted_socket);
+                context.operation_count++;
+            }
+        }
+        closesocket(client_socket);
+    }
+
+    closesocket(listen_socket);
+    LOG_VERBOSE("Thread[{}] Done. connections:{}", context.thread_index, context.operation_count);
+}
+
+static void
+_mt_sock_ops_flow_churn_test(ebpf_execution_type_t program_type, const test_control_info& test_control_info)
+{
+    WSAData data{};
+    auto error = WSAStartup(MAKEWORD(2, 2), &data);
+    REQUIRE(error == 0);
+
+    bool is_native = (program_type == EBPF_EXECUTION_NATIVE);
+#pragma warning(suppress : 28193) // 'file_name' holds a value that must be examined.
+    std::string file_name = is_native ? _make_unique_file_copy("sockops.sys") : "sockops.o";
+
+    std::vector<object_table_entry> dummy_table(1);
+    thread_context program_load_context = {
+        {}, {}, false, {}, thread_role_type::ROLE_NOT_SET, 0, 0, 0, false, 0, 0, dummy_table};
+    program_load_context.file_name = file_name;
+    program_load_context.thread_index = 0;
+    auto [program_object, _] = _load_attach_program(program_load_context, BPF_CGROUP_SOCK_OPS);
+    REQUIRE(program_load_context.succeeded == true);
+
+    size_t total_threads = test_control_info.threads_count;
+    std::vector<thread_context> thread_context_table(
+        total_threads, {{}, {}, false, {}, thread_role_type::ROLE_NOT_SET, 0, 0, 0, false, 0, 0, dummy_table});
+    std::vector<std::thread> test_thread_table(total_threads);
+    auto start_time = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < total_threads; i++) {
+
+        // First, prepare the context for this thread.
+        auto& context_entry = thread_context_table[i];
+        context_entry.is_native_program = is_native;
+        context_entry.role = thread_role_type::MONITOR_IPV4;
+        context_entry.thread_index = i;
+        context_entry.duration_minutes = test_control_info.duration_minutes;
+        context_entry.extension_restart_enabled = test_control_info.extension_restart_enabled;
+
+        // Now create the thread.
+        auto& thread_entry = test_thread_table[i];
+        thread_entry = std::move(std::thread(_invoke_mt_sock_ops_flow_churn_thread_function, std::ref(context_entry)));
+    }
+
+    // Another table for the 'extension restart' threads.
+    std::vector<std::string> extension_names = {"netebpfext"};
+    std::vector<std::thread> extension_restart_thread_table{};
+    std::vector<thread_context> extension_restart_thread_context_table{};
+
+    if (test_control_info.extension_restart_enabled) {
+        configure_extension_restart(
+            test_control_info,
+            extension_names,
+            extension_restart_thread_table,
+            extension_restart_thread_context_table,
+            dummy_table);
+    }
+
+    wait_and_verify_test_threads(
+        test_control_info,
+        test_thread_table,
+        thread_context_table,
+        extension_restart_thread_table,
+        extension_restart_thread_context_table);
+
+    auto elapsed_seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start_time).count();
+    uint64_t connection_count = 0;
+    for (const auto& context : thread_context_table) {
+        connection_count += context.operation_count;
+    }
+    LOG_INFO(
+        "sock_ops flow churn with {} thread(s): {} connections, {} connections per second",
+        total_threads,
+        connection_count,
+        connection_count / (elapsed_seconds + 1));
+}
+
 static void
 _print_test_control_info(const test_control_info& test_control_info)
 {
@@ -1744,6 +1871,28 @@ TEST_CASE("sockaddr_invoke_program_test", "[native_mt_stress_test]")
     _mt_sockaddr_invoke_program_test(EBPF_EXECUTION_NATIVE, local_test_control_info);
 }
 
+TEST_CASE("sock_ops_flow_churn_test", "[native_mt_stress_test]")
+{
+    // Test layout:
+    // 1. Load the "sockops.sys" native ebpf program and attach it to the sock_ops hook.
+    //
+    // 2. Create the specified # of threads. For the duration of the test, each thread listens on the loopback endpoint
+    //    127.0.0.1:<target_port + thread_context.thread_index> and repeatedly connects to it, accepts the connection
+    //    and closes both ends. Every connection creates and deletes two sock_ops flows, so all threads continuously
+    //    add and remove flow contexts of the same sock_ops filter context.
+    //
+    // 3. If specified, start the 'extension restart' thread as well to continuously restart the netebpf extension.
+    //
+    // The aggregate connection rate is logged so it can be compared across thread counts.
+
+    _km_test_init();
+    LOG_INFO("\nStarting test *** sock_ops_flow_churn_test ***");
+    test_control_info local_test_control_info = _global_test_control_info;
+
+    _print_test_control_info(local_test_control_info);
+    _mt_sock_ops_flow_churn_test(EBPF_EXECUTION_NATIVE, local_test_control_info);
+}
+
 TEST_CASE("bindmonitor_tail_call_invoke_program_test", "[native_mt_stress_test]")
 {
     // Test layout:
@@ -12,16 +12,20 @@
 #include "common_tests.h"
 #include "ebpf_platform.h"
 #include "ebpf_tracelog.h"
+#include "hash.h"
 #include "helpers.h"
 #include "libbpf_test_jit.h"
 #include "platform.h"
 #include "program_helper.h"
 #include "spec/vm_isa.hpp"
 #include "test_helper.hpp"
+#include "verification_cache.h"
 
+#include <algorithm>
 #include <chrono>
 #include <crtdbg.h>
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <mutex>
 #include <stop_token>
@@ -1174,6 +1178,334 @@ TEST_CASE("ring buffer memory mapping APIs", "[libbpf][ring_buffer]")
     Platform::_close(map_fd);
 }
 
+TEST_CASE("array map memory mapping APIs", "[libbpf]")
+{
+    _test_helper_libbpf test_helper;
+    test_helper.initialize();
+
+    const uint32_t max_entries = 16;
+    bpf_map_create_opts opts = {.sz = sizeof(opts), .map_flags = BPF_F_MMAPABLE};
+    int map_fd =
+        bpf_map_create(BPF_MAP_TYPE_ARRAY, "TestMmapArray", sizeof(uint32_t), sizeof(uint64_t), max_entries, &opts);
+    REQUIRE(map_fd > 0);
+
+    SECTION("writes through the mapping and through the map are visible to each other")
+    {
+        void* data = nullptr;
+        size_t size = 0;
+        REQUIRE(ebpf_map_mmap(map_fd, true, &data, &size) == EBPF_SUCCESS);
+        REQUIRE(data != nullptr);
+        REQUIRE(size >= max_entries * sizeof(uint64_t));
+
+        auto* values = static_cast<volatile uint64_t*>(data);
+        REQUIRE(values[3] == 0);
+        values[3] = 0x1234;
+
+        uint32_t key = 3;
+        uint64_t value = 0;
+        REQUIRE(bpf_map_lookup_elem(map_fd, &key, &value) == 0);
+        REQUIRE(value == 0x1234);
+
+        key = 7;
+        value = 0x5678;
+        REQUIRE(bpf_map_update_elem(map_fd, &key, &value, BPF_ANY) == 0);
+        REQUIRE(values[7] == 0x5678);
+
+        // Several mappings of the same map can exist at once and share the values.
+        void* second_data = nullptr;
+        size_t second_size = 0;
+        REQUIRE(ebpf_map_mmap(map_fd, false, &second_data, &second_size) == EBPF_SUCCESS);
+        REQUIRE(second_data != data);
+        REQUIRE(second_size == size);
+        REQUIRE(static_cast<const volatile uint64_t*>(second_data)[7] == 0x5678);
+        REQUIRE(ebpf_map_munmap(map_fd, second_data) == EBPF_SUCCESS);
+
+        // The mapping can only be removed by its address.
+        REQUIRE(ebpf_map_munmap(map_fd, values + 1) == EBPF_INVALID_ARGUMENT);
+        REQUIRE(ebpf_map_munmap(map_fd, data) == EBPF_SUCCESS);
+        REQUIRE(ebpf_map_munmap(map_fd, data) == EBPF_INVALID_ARGUMENT);
+
+        // The map can be mapped again once unmapped and keeps its values.
+        REQUIRE(ebpf_map_mmap(map_fd, false, &data, &size) == EBPF_SUCCESS);
+        REQUIRE(static_cast<const uint64_t*>(data)[3] == 0x1234);
+        REQUIRE(ebpf_map_munmap(map_fd, data) == EBPF_SUCCESS);
+    }
+
+    SECTION("closing the last handle to the map removes the mapping")
+    {
+        void* data = nullptr;
+        size_t size = 0;
+        REQUIRE(ebpf_map_mmap(map_fd, true, &data, &size) == EBPF_SUCCESS);
+        static_cast<volatile uint64_t*>(data)[0] = 1;
+
+        bpf_map_info info = {};
+        uint32_t info_size = sizeof(info);
+        REQUIRE(bpf_obj_get_info_by_fd(map_fd, &info, &info_size) == 0);
+        REQUIRE(info.map_flags == BPF_F_MMAPABLE);
+
+        // The mapping stays in place while another handle to the map is open.
+        int second_fd = bpf_map_get_fd_by_id(info.id);
+        REQUIRE(second_fd > 0);
+        Platform::_close(map_fd);
+
+        uint32_t key = 0;
+        uint64_t value = 0;
+        REQUIRE(bpf_map_lookup_elem(second_fd, &key, &value) == 0);
+        REQUIRE(value == 1);
+
+        // Closing the last handle also removes mappings made through another handle.
+        void* second_data = nullptr;
+        size_t second_size = 0;
+        REQUIRE(ebpf_map_mmap(second_fd, false, &second_data, &second_size) == EBPF_SUCCESS);
+        REQUIRE(static_cast<const volatile uint64_t*>(second_data)[0] == 1);
+
+        // The mapping does not hold a reference on the map, so closing the last handle frees the map.
+        Platform::_close(second_fd);
+        map_fd = bpf_map_get_fd_by_id(info.id);
+        REQUIRE(map_fd < 0);
+
+        // Recreate the map so that the common cleanup below has a map to close.
+        map_fd = bpf_map_create(
+            BPF_MAP_TYPE_ARRAY, "TestMmapArray", sizeof(uint32_t), sizeof(uint64_t), max_entries, &opts);
+        REQUIRE(map_fd > 0);
+    }
+
+    SECTION("only maps created with BPF_F_MMAPABLE can be mapped")
+    {
+        int hash_fd = bpf_map_create(BPF_MAP_TYPE_HASH, "TestHash", sizeof(uint32_t), sizeof(uint64_t), 4, nullptr);
+        REQUIRE(hash_fd > 0);
+        int array_fd =
+            bpf_map_create(BPF_MAP_TYPE_ARRAY, "TestArray", sizeof(uint32_t), sizeof(uint64_t), max_entries, nullptr);
+        REQUIRE(array_fd > 0);
+
+        void* data = nullptr;
+        size_t size = 0;
+        REQUIRE(ebpf_map_mmap(hash_fd, false, &data, &size) == EBPF_OPERATION_NOT_SUPPORTED);
+        REQUIRE(ebpf_map_mmap(array_fd, false, &data, &size) == EBPF_OPERATION_NOT_SUPPORTED);
+        REQUIRE(ebpf_map_mmap(-1, false, &data, &size) == EBPF_INVALID_FD);
+
+        // BPF_F_MMAPABLE is only valid for array maps.
+        int invalid_fd = bpf_map_create(BPF_MAP_TYPE_HASH, "TestHash", sizeof(uint32_t), sizeof(uint64_t), 4, &opts);
+        REQUIRE(invalid_fd < 0);
+        REQUIRE(errno == EINVAL);
+
+        Platform::_close(array_fd);
+        Platform::_close(hash_fd);
+    }
+
+    Platform::_close(map_fd);
+}
+
+#if !defined(CONFIG_BPF_JIT_DISABLED)
+TEST_CASE("libbpf load object with many programs", "[libbpf]")
+{
+    _test_helper_libbpf test_helper;
+    test_helper.initialize();
+
+    // The programs of the object are verified and loaded in parallel.
+    struct bpf_object* object = bpf_object__open("many_programs.o");
+    REQUIRE(object != nullptr);
+    REQUIRE(ebpf_object_set_execution_type(object, EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+    REQUIRE(bpf_object__load(object) == 0);
+
+    for (int index = 10; index < 60; index++) {
+        std::string name = "program" + std::to_string(index);
+        struct bpf_program* program = bpf_object__find_program_by_name(object, name.c_str());
+        REQUIRE(program != nullptr);
+        REQUIRE(bpf_program__fd(program) > 0);
+    }
+
+    bpf_object__close(object);
+}
+
+static std::chrono::duration<double, std::milli>
+_load_many_programs()
+{
+    struct bpf_object* object = bpf_object__open("many_programs.o");
+    REQUIRE(object != nullptr);
+    REQUIRE(ebpf_object_set_execution_type(object, EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    int error = bpf_object__load(object);
+    std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+    REQUIRE(error == 0);
+
+    bpf_object__close(object);
+    return duration;
+}
+
+TEST_CASE("libbpf load object with verification cache", "[libbpf]")
+{
+    _test_helper_libbpf test_helper;
+    test_helper.initialize();
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "ebpf_verification_cache_test";
+    std::filesystem::remove_all(directory);
+    REQUIRE(ebpf_verification_cache_initialize(directory.c_str()) == EBPF_SUCCESS);
+    auto cleanup = std::unique_ptr<void, std::function<void(void*)>>(reinterpret_cast<void*>(1), [&](void*) {
+        ebpf_verification_cache_cleanup();
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+    });
+
+    auto entry_paths = [&]() {
+        std::vector<std::filesystem::path> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (entry.path().extension() == ".entry") {
+                paths.push_back(entry.path());
+            }
+        }
+        return paths;
+    };
+    auto count_entries = [&]() { return entry_paths().size(); };
+
+    // A cold start verifies every program and adds an entry for each of them.
+    auto cold_duration = _load_many_programs();
+    REQUIRE(count_entries() == 50);
+
+    // A warm start finds all programs in the cache.
+    auto warm_duration = _load_many_programs();
+    REQUIRE(count_entries() == 50);
+
+    // Entries that fail the integrity check are ignored, and replaced once the programs are verified again.
+    for (const auto& path : entry_paths()) {
+        std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(sizeof(uint32_t));
+        stream.put('\xff');
+    }
+    auto corrupted_duration = _load_many_programs();
+    REQUIRE(count_entries() == 50);
+
+    // Entries are authenticated with a secret key, so an entry whose trailer is recomputed without it is rejected and
+    // rewritten with a valid MAC.
+    const size_t mac_length = 32;
+    std::filesystem::path forged_path = entry_paths().front();
+    std::vector<uint8_t> original_entry;
+    {
+        std::ifstream stream(forged_path, std::ios::binary);
+        original_entry.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+    REQUIRE(original_entry.size() > mac_length);
+    std::vector<uint8_t> forged_entry = original_entry;
+    hash_t hash("SHA256");
+    std::vector<uint8_t> unkeyed_hash =
+        hash.hash_byte_ranges({{forged_entry.data(), forged_entry.size() - mac_length}});
+    std::copy(unkeyed_hash.begin(), unkeyed_hash.end(), forged_entry.end() - mac_length);
+    {
+        std::ofstream stream(forged_path, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(forged_entry.data()), forged_entry.size());
+    }
+    (void)_load_many_programs();
+    std::vector<uint8_t> rewritten_entry;
+    {
+        std::ifstream stream(forged_path, std::ios::binary);
+        rewritten_entry.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+    REQUIRE(rewritten_entry == original_entry);
+
+    printf(
+        "many_programs.o: cold start %.2f ms, warm start %.2f ms, corrupted cache %.2f ms\n",
+        cold_duration.count(),
+        warm_duration.count(),
+        corrupted_duration.count());
+}
+#endif
+
+TEST_CASE("map iterator APIs", "[libbpf]")
+{
+    _test_helper_libbpf test_helper;
+    test_helper.initialize();
+
+    const uint32_t entry_count = 1000;
+    int map_fd =
+        bpf_map_create(BPF_MAP_TYPE_HASH, "TestIterator", sizeof(uint32_t), sizeof(uint64_t), entry_count, nullptr);
+    REQUIRE(map_fd > 0);
+    for (uint32_t key = 0; key < entry_count; key++) {
+        uint64_t value = key * 2ull;
+        REQUIRE(bpf_map_update_elem(map_fd, &key, &value, BPF_ANY) == 0);
+    }
+
+#pragma pack(push, 1)
+    struct entry_t
+    {
+        uint32_t key;
+        uint64_t value;
+    };
+#pragma pack(pop)
+
+    // Read all entries with the iterator, in pages of up to 10 entries, deleting each page once it is read.
+    auto read_all = [&](ebpf_map_iterator_t* iterator, bool delete_entries) {
+        std::vector<bool> found(entry_count);
+        entry_t entries[10];
+        for (;;) {
+            size_t size = sizeof(entries);
+            ebpf_result_t result = ebpf_map_iterator_next(iterator, entries, &size);
+            if (result == EBPF_NO_MORE_KEYS) {
+                break;
+            }
+            REQUIRE(result == EBPF_SUCCESS);
+            REQUIRE(size > 0);
+            REQUIRE(size % sizeof(entry_t) == 0);
+            for (size_t index = 0; index < size / sizeof(entry_t); index++) {
+                REQUIRE(entries[index].key < entry_count);
+                REQUIRE(entries[index].value == entries[index].key * 2ull);
+                REQUIRE(!found[entries[index].key]);
+                found[entries[index].key] = true;
+                if (delete_entries) {
+                    REQUIRE(bpf_map_delete_elem(map_fd, &entries[index].key) == 0);
+                }
+            }
+        }
+        return static_cast<uint32_t>(std::count(found.begin(), found.end(), true));
+    };
+
+    SECTION("a live iterator returns each entry once while entries are deleted")
+    {
+        ebpf_map_iterator_t* iterator = nullptr;
+        REQUIRE(ebpf_map_iterator_create(map_fd, false, 0, &iterator) == EBPF_SUCCESS);
+        REQUIRE(read_all(iterator, true) == entry_count);
+        ebpf_map_iterator_destroy(iterator);
+
+        uint32_t key;
+        REQUIRE(bpf_map_get_next_key(map_fd, nullptr, &key) < 0);
+    }
+
+    SECTION("a snapshot iterator does not see later changes")
+    {
+        ebpf_map_iterator_t* iterator = nullptr;
+        REQUIRE(ebpf_map_iterator_create(map_fd, true, 0, &iterator) == EBPF_SUCCESS);
+        for (uint32_t key = 0; key < entry_count; key++) {
+            REQUIRE(bpf_map_delete_elem(map_fd, &key) == 0);
+        }
+        REQUIRE(read_all(iterator, false) == entry_count);
+        ebpf_map_iterator_destroy(iterator);
+    }
+
+    SECTION("invalid parameters")
+    {
+        ebpf_map_iterator_t* iterator = nullptr;
+        REQUIRE(ebpf_map_iterator_create(-1, false, 0, &iterator) == EBPF_INVALID_FD);
+        REQUIRE(ebpf_map_iterator_create(map_fd, false, BPF_NOEXIST, &iterator) == EBPF_INVALID_ARGUMENT);
+        // Per-CPU aggregation is only valid for per-CPU maps.
+        REQUIRE(ebpf_map_iterator_create(map_fd, false, EBPF_F_PERCPU_SUM, &iterator) == EBPF_INVALID_ARGUMENT);
+
+        int array_fd =
+            bpf_map_create(BPF_MAP_TYPE_ARRAY, "TestArray", sizeof(uint32_t), sizeof(uint64_t), entry_count, nullptr);
+        REQUIRE(array_fd > 0);
+        REQUIRE(ebpf_map_iterator_create(array_fd, false, 0, &iterator) == EBPF_OPERATION_NOT_SUPPORTED);
+        Platform::_close(array_fd);
+
+        REQUIRE(ebpf_map_iterator_create(map_fd, false, 0, &iterator) == EBPF_SUCCESS);
+        entry_t entry;
+        size_t size = sizeof(entry) - 1;
+        REQUIRE(ebpf_map_iterator_next(iterator, &entry, &size) == EBPF_INSUFFICIENT_BUFFER);
+        REQUIRE(size == 0);
+        ebpf_map_iterator_destroy(iterator);
+    }
+
+    Platform::_close(map_fd);
+}
+
 TEST_CASE("ring buffer manager APIs", "[libbpf][ring_buffer]")
 {
 #pragma warning(push)
@@ -4342,6 +4674,124 @@ TEST_CASE("libbpf percpu hash map batch", "[libbpf]") { _test_maps_batch(BPF_MAP
 
 TEST_CASE("libbpf lru percpu hash map batch", "[libbpf]") { _test_maps_batch(BPF_MAP_TYPE_LRU_PERCPU_HASH); }
 
+TEST_CASE("map operation queue", "[libbpf]")
+{
+    _test_helper_libbpf test_helper;
+    test_helper.initialize();
+
+    const uint32_t max_entries = 64;
+    const size_t ring_size = 4096;
+    fd_t map_fd =
+        bpf_map_create(BPF_MAP_TYPE_HASH, "op_queue_map", sizeof(uint32_t), sizeof(uint64_t), max_entries, nullptr);
+    REQUIRE(map_fd > 0);
+
+    ebpf_map_op_queue_t* queue = nullptr;
+    REQUIRE(ebpf_map_op_queue_create(ring_size + 1, &queue) == EBPF_INVALID_ARGUMENT);
+    REQUIRE(queue == nullptr);
+    REQUIRE(ebpf_map_op_queue_create(ring_size, &queue) == EBPF_SUCCESS);
+    REQUIRE(queue != nullptr);
+
+    ebpf_map_op_result_t result;
+    uint64_t value = 0;
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, &value, sizeof(value), 0) == EBPF_TIMEOUT);
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, &value, sizeof(value), 10) == EBPF_TIMEOUT);
+
+    // Invalid parameters are rejected when the operation is queued.
+    uint32_t key = 0;
+    REQUIRE(
+        ebpf_map_op_queue_update_elem(queue, ebpf_fd_invalid, &key, sizeof(key), &value, sizeof(value), 0, 0) ==
+        EBPF_INVALID_FD);
+    REQUIRE(
+        ebpf_map_op_queue_update_elem(queue, map_fd, &key, sizeof(key), &value, sizeof(value), UINT32_MAX, 0) ==
+        EBPF_INVALID_ARGUMENT);
+    REQUIRE(
+        ebpf_map_op_queue_lookup_elem(queue, map_fd, &key, sizeof(key), sizeof(value), UINT32_MAX, 0) ==
+        EBPF_INVALID_ARGUMENT);
+
+    // Submitting an empty queue is a no-op.
+    REQUIRE(ebpf_map_op_queue_submit(queue) == EBPF_SUCCESS);
+
+    // Insert every key in one batch.
+    for (key = 0; key < max_entries; key++) {
+        value = key * 10;
+        REQUIRE(
+            ebpf_map_op_queue_update_elem(
+                queue, map_fd, &key, sizeof(key), &value, sizeof(value), BPF_NOEXIST, key) == EBPF_SUCCESS);
+    }
+    REQUIRE(ebpf_map_op_queue_submit(queue) == EBPF_SUCCESS);
+    for (key = 0; key < max_entries; key++) {
+        REQUIRE(ebpf_map_op_queue_get_result(queue, &result, nullptr, 0, INFINITE) == EBPF_SUCCESS);
+        REQUIRE(result.user_data == key);
+        REQUIRE(result.result == EBPF_SUCCESS);
+        REQUIRE(result.value_size == 0);
+    }
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, nullptr, 0, 0) == EBPF_TIMEOUT);
+
+    // The updates are visible through the IOCTL path.
+    for (key = 0; key < max_entries; key++) {
+        REQUIRE(bpf_map_lookup_elem(map_fd, &key, &value) == 0);
+        REQUIRE(value == key * 10);
+    }
+
+    // Results carry the status of each operation.
+    key = 0;
+    REQUIRE(
+        ebpf_map_op_queue_update_elem(queue, map_fd, &key, sizeof(key), &value, sizeof(value), BPF_NOEXIST, 1) ==
+        EBPF_SUCCESS);
+    REQUIRE(ebpf_map_op_queue_delete_elem(queue, map_fd, &key, sizeof(key), 2) == EBPF_SUCCESS);
+    REQUIRE(ebpf_map_op_queue_lookup_elem(queue, map_fd, &key, sizeof(key), sizeof(value), 0, 3) == EBPF_SUCCESS);
+    key = 1;
+    REQUIRE(ebpf_map_op_queue_lookup_elem(queue, map_fd, &key, sizeof(key), sizeof(value), 0, 4) == EBPF_SUCCESS);
+    REQUIRE(ebpf_map_op_queue_submit(queue) == EBPF_SUCCESS);
+
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, nullptr, 0, INFINITE) == EBPF_SUCCESS);
+    REQUIRE(result.user_data == 1);
+    REQUIRE(result.result == EBPF_OBJECT_ALREADY_EXISTS);
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, nullptr, 0, INFINITE) == EBPF_SUCCESS);
+    REQUIRE(result.user_data == 2);
+    REQUIRE(result.result == EBPF_SUCCESS);
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, &value, sizeof(value), INFINITE) == EBPF_SUCCESS);
+    REQUIRE(result.user_data == 3);
+    REQUIRE(result.result == EBPF_KEY_NOT_FOUND);
+
+    // A buffer that is too small leaves the result in the queue.
+    uint32_t small_value;
+    REQUIRE(
+        ebpf_map_op_queue_get_result(queue, &result, &small_value, sizeof(small_value), INFINITE) ==
+        EBPF_INSUFFICIENT_BUFFER);
+    REQUIRE(result.value_size == sizeof(value));
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, &value, sizeof(value), INFINITE) == EBPF_SUCCESS);
+    REQUIRE(result.user_data == 4);
+    REQUIRE(result.result == EBPF_SUCCESS);
+    REQUIRE(result.value_size == sizeof(value));
+    REQUIRE(value == 10);
+
+    // Queue operations until the submission ring is full, then drain it.
+    size_t queued = 0;
+    key = 1;
+    for (;;) {
+        ebpf_result_t queue_result =
+            ebpf_map_op_queue_lookup_elem(queue, map_fd, &key, sizeof(key), sizeof(value), 0, queued);
+        if (queue_result == EBPF_NO_MEMORY) {
+            break;
+        }
+        REQUIRE(queue_result == EBPF_SUCCESS);
+        queued++;
+    }
+    REQUIRE(queued > 0);
+    REQUIRE(ebpf_map_op_queue_submit(queue) == EBPF_SUCCESS);
+    for (size_t i = 0; i < queued; i++) {
+        REQUIRE(ebpf_map_op_queue_get_result(queue, &result, &value, sizeof(value), INFINITE) == EBPF_SUCCESS);
+        REQUIRE(result.user_data == i);
+        REQUIRE(result.result == EBPF_SUCCESS);
+        REQUIRE(value == 10);
+    }
+    REQUIRE(ebpf_map_op_queue_get_result(queue, &result, &value, sizeof(value), 0) == EBPF_TIMEOUT);
+
+    ebpf_map_op_queue_destroy(queue);
+    Platform::_close(map_fd);
+}
+
 void
 _hash_of_map_initial_value_test(ebpf_execution_type_t execution_type)
 {
@@ -9,13 +9,19 @@
 
 #include <Windows.h>
 #include <ElfWrapper.h>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -60,6 +66,73 @@ load_file_to_memory(const std::string& path)
     throw std::runtime_error(std::string("Failed to read file: ") + path);
 }
 
+/**
+ * @brief Read a branch profile, which holds the values of the counters in the bpf2c_branch_profile map of the
+ * instrumented code as decimal numbers separated by white space, in the order of their keys.
+ *
+ * @param[in] path Path of the profile.
+ * @return Values of the counters.
+ */
+std::vector<uint64_t>
+load_branch_profile(const std::string& path)
+{
+    std::ifstream stream{path, std::ios::in};
+    if (!stream) {
+        throw std::runtime_error(std::string("Failed to read file: ") + path);
+    }
+    std::vector<uint64_t> counters;
+    std::string value;
+    while (stream >> value) {
+        char* end = nullptr;
+        errno = 0;
+        unsigned long long counter = strtoull(value.c_str(), &end, 10);
+        if (!isdigit(static_cast<unsigned char>(value[0])) || *end != '\0' || errno == ERANGE) {
+            throw std::runtime_error(std::string("Invalid counter ") + value + " in branch profile " + path);
+        }
+        counters.push_back(counter);
+    }
+    return counters;
+}
+
+/**
+ * @brief Write a file unless it already has the given contents, so that its timestamp only changes when its contents
+ * do and build systems can skip compiling it again.
+ *
+ * @param[in] path Path of the file.
+ * @param[in] contents Contents of the file.
+ */
+void
+write_file_if_changed(const std::string& path, const std::string& contents)
+{
+    if (std::ifstream existing_stream{path, std::ios::in}) {
+        std::string existing_contents(
+            (std::istreambuf_iterator<char>(existing_stream)), std::istreambuf_iterator<char>());
+        if (existing_contents == contents) {
+            return;
+        }
+    }
+    std::ofstream output_file(path, std::ios::out | std::ios::trunc);
+    if (!output_file.is_open() || !output_file.write(contents.data(), contents.size())) {
+        throw std::runtime_error(std::string("Failed to write file: ") + path);
+    }
+}
+
+/**
+ * @brief Get the name of the file that holds the code of a program when the output is split, which is the output
+ * file name with the C identifier of the program appended to its stem.
+ *
+ * @param[in] output_file_name Name of the output file.
+ * @param[in] program_name C identifier of the program.
+ * @return Name of the file of the program.
+ */
+std::string
+get_program_file_name(const std::string& output_file_name, const std::string& program_name)
+{
+    std::filesystem::path path(output_file_name);
+    path.replace_filename(path.stem().string() + "_" + program_name + path.extension().string());
+    return path.string();
+}
+
 extern "C" void
 elf_everparse_error(_In_ const char* struct_name, _In_ const char* field_name, _In_ const char* reason);
 
@@ -155,6 +228,176 @@ get_program_info_type_hash(
     return hash.hash_byte_ranges(byte_range);
 }
 
+/**
+ * @brief Verify a program. The results of the verification are left in the thread local storage of the verifier.
+ *
+ * @throws std::runtime_error The program failed verification.
+ */
+void
+verify_program(
+    const std::string& data,
+    _In_ const ebpf_api_program_info_t* program,
+    const ebpf_program_type_t& program_type,
+    ebpf_verification_verbosity_t verbosity)
+{
+    const char* report = nullptr;
+    const char* error_message = nullptr;
+    ebpf_api_verifier_stats_t stats;
+    if (ebpf_api_elf_verify_program_from_memory(
+            data.c_str(),
+            data.size(),
+            program->section_name,
+            program->program_name,
+            &program_type,
+            verbosity,
+            &report,
+            &error_message,
+            &stats) != 0) {
+        std::string message = std::string("Verification failed for ") + std::string(program->program_name) +
+                              std::string(" with error ") + std::string(error_message ? error_message : "") +
+                              std::string("\n Report:\n") + std::string(report ? report : "");
+        ebpf_free_string(report);
+        ebpf_free_string(error_message);
+        throw std::runtime_error(message);
+    }
+    ebpf_free_string(report);
+    ebpf_free_string(error_message);
+}
+
+/**
+ * @brief Add a program that was verified on the calling thread to the code generator. This reads the program
+ * information, map annotations and BTF-resolved functions that the verification left in thread local storage.
+ */
+void
+parse_program(
+    bpf_code_generator& generator,
+    _In_ const ebpf_api_program_info_t* program,
+    _In_ const ebpf_api_program_info_t* infos,
+    const ebpf_program_type_t& program_type,
+    const ebpf_attach_type_t& attach_type,
+    const std::string& hash_algorithm)
+{
+    const ebpf_program_info_t* program_info = nullptr;
+    ebpf_result_t result = ebpf_get_program_info_from_verifier(&program_info);
+    if (result != EBPF_SUCCESS) {
+        throw std::runtime_error(std::string("Failed to get program information"));
+    }
+
+    // Retrieve map annotations from the verifier's abstract domain analysis.
+    const ebpf_verifier_map_info_t* map_annotations = nullptr;
+    size_t map_annotation_count = 0;
+    result = ebpf_get_map_annotations_from_verifier(&map_annotations, &map_annotation_count);
+    if (result != EBPF_SUCCESS) {
+        throw std::runtime_error(std::string("Failed to get map annotations from verifier"));
+    }
+    generator.set_map_annotations(program->program_name, map_annotations, map_annotation_count);
+
+    generator.parse(program, program_info, program_type, attach_type, hash_algorithm, infos);
+
+    if (hash_algorithm != "none") {
+        std::vector<int32_t> helper_ids = generator.get_helper_ids(program->program_name);
+        auto btf_resolved_functions = generator.get_btf_resolved_function_dependencies(program->program_name);
+        std::optional<std::vector<uint8_t>> program_info_hash =
+            get_program_info_type_hash(helper_ids, btf_resolved_functions, hash_algorithm);
+        generator.set_program_hash_info(program->program_name, program_info_hash);
+    }
+}
+
+/**
+ * @brief Verify programs on a pool of threads and add them to the code generator. Verification dominates the time
+ * taken to generate code and the verifier state is thread local, so the programs are verified in parallel. Each
+ * program is then added to the code generator on the thread that verified it, in the order of the programs, so that
+ * the generated code is the same regardless of the order in which the threads ran.
+ *
+ * @param[in] generator Code generator to add the programs to.
+ * @param[in] programs Programs to verify, in object order.
+ * @param[in] infos All programs in the ELF file, including subprograms.
+ * @param[in] data Contents of the ELF file.
+ * @param[in] global_program_type Program type to use for all programs, or null to use the type of each program.
+ * @param[in] global_attach_type Attach type to use for all programs, or null to use the type of each program.
+ * @param[in] verbosity Verbosity of the verifier.
+ * @param[in] hash_algorithm Algorithm used to hash the program information, or "none".
+ * @param[in] job_count Maximum number of programs to verify at the same time.
+ * @throws std::runtime_error The error of the first program in object order that failed.
+ */
+void
+generate_programs(
+    bpf_code_generator& generator,
+    const std::vector<const ebpf_api_program_info_t*>& programs,
+    _In_ const ebpf_api_program_info_t* infos,
+    const std::string& data,
+    _In_opt_ const ebpf_program_type_t* global_program_type,
+    _In_opt_ const ebpf_attach_type_t* global_attach_type,
+    ebpf_verification_verbosity_t verbosity,
+    const std::string& hash_algorithm,
+    size_t job_count)
+{
+    std::vector<std::exception_ptr> errors(programs.size());
+    std::atomic<size_t> next_index = 0;
+    std::atomic<bool> failed = false;
+    std::mutex generator_mutex;
+    std::condition_variable generator_turn;
+    size_t next_index_to_parse = 0;
+
+    auto generate = [&]() noexcept {
+        for (;;) {
+            size_t index = next_index++;
+            if (index >= programs.size()) {
+                break;
+            }
+            const ebpf_api_program_info_t* program = programs[index];
+            const ebpf_program_type_t& program_type =
+                (global_program_type != nullptr) ? *global_program_type : program->program_type;
+            const ebpf_attach_type_t& attach_type =
+                (global_attach_type != nullptr) ? *global_attach_type : program->expected_attach_type;
+
+            // Programs after one that failed are not verified.
+            if (!failed) {
+                try {
+                    verify_program(data, program, program_type, verbosity);
+                } catch (...) {
+                    errors[index] = std::current_exception();
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(generator_mutex);
+            generator_turn.wait(lock, [&]() { return next_index_to_parse == index; });
+            if (!failed && !errors[index]) {
+                try {
+                    parse_program(generator, program, infos, program_type, attach_type, hash_algorithm);
+                } catch (...) {
+                    errors[index] = std::current_exception();
+                }
+            }
+            if (errors[index]) {
+                failed = true;
+            }
+            next_index_to_parse++;
+            generator_turn.notify_all();
+        }
+    };
+
+    {
+        // This thread is one of the workers.
+        std::vector<std::jthread> threads;
+        for (size_t i = 1; i < job_count && i < programs.size(); i++) {
+            try {
+                threads.emplace_back(generate);
+            } catch (const std::system_error&) {
+                // Continue with the threads that were started.
+                break;
+            }
+        }
+        generate();
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
 int
 main(int argc, char** argv)
 {
@@ -169,6 +412,14 @@ main(int argc, char** argv)
         std::string output_file_name;
         std::string type_string = "";
         std::string hash_algorithm = EBPF_HASH_ALGORITHM;
+        // hardware_concurrency returns 0 if the number of processors is not known.
+        size_t job_count = std::thread::hardware_concurrency();
+        if (job_count == 0) {
+            job_count = 1;
+        }
+        bool split_output = false;
+        bool profile_branches = false;
+        std::string branch_profile_file;
         ebpf_verification_verbosity_t verbosity = EBPF_VERIFICATION_VERBOSITY_NORMAL;
         std::vector<std::string> parameters(argv + 1, argv + argc);
         auto iter = parameters.begin();
@@ -240,6 +491,45 @@ main(int argc, char** argv)
                       return true;
                   }
               }}},
+            {"--jobs",
+             {"Number of programs to verify in parallel, default is the number of processors",
+              [&]() {
+                  ++iter;
+                  char* end = nullptr;
+                  unsigned long value = (iter == iter_end) ? 0 : strtoul(iter->c_str(), &end, 10);
+                  if (value == 0 || *end != '\0') {
+                      std::cerr << "Invalid --jobs option" << std::endl;
+                      return false;
+                  }
+                  job_count = value;
+                  return true;
+              }}},
+            {"--split",
+             {"Generate the code of each program in its own file next to the output file, which then only holds "
+              "the metadata. Files of programs whose code didn't change are not rewritten",
+              [&]() {
+                  split_output = true;
+                  return true;
+              }}},
+            {"--profile-branches",
+             {"Instrument the code to count the executions of each function and branch in the bpf2c_branch_profile "
+              "map",
+              [&]() {
+                  profile_branches = true;
+                  return true;
+              }}},
+            {"--branch-profile",
+             {"Lay out the code using the values of the bpf2c_branch_profile map collected from instrumented code",
+              [&]() {
+                  ++iter;
+                  if (iter == iter_end) {
+                      std::cerr << "Invalid --branch-profile option" << std::endl;
+                      return false;
+                  } else {
+                      branch_profile_file = *iter;
+                      return true;
+                  }
+              }}},
             {"--help",
              {"This help menu",
               [&]() {
@@ -292,6 +582,16 @@ main(int argc, char** argv)
             return 1;
         }
 
+        if (split_output && output_file_name.empty()) {
+            std::cerr << "--split requires an output file name" << std::endl;
+            return 1;
+        }
+
+        if (profile_branches && !branch_profile_file.empty()) {
+            std::cerr << "Cannot combine --profile-branches with --branch-profile" << std::endl;
+            return 1;
+        }
+
         std::string c_name = file.substr(file.find_last_of("\\") + 1);
         c_name = c_name.substr(0, c_name.find("."));
         auto data = load_file_to_memory(file);
@@ -336,71 +636,37 @@ main(int argc, char** argv)
             global_program_type_set = true;
         }
 
-        // Parse per-program data.
+        // Gather the programs to generate code for. Skip subprograms. A subprogram is defined by libbpf as any
+        // program in the .text section when multiple programs exist.
+        std::vector<const ebpf_api_program_info_t*> programs;
         for (const ebpf_api_program_info_t* program = infos; program; program = program->next) {
-            // Skip if a subprogram.  A subprogram is defined by libbpf as any
-            // program in the .text section when multiple programs exist.
             if (!strcmp(program->section_name, ".text") && infos->next != nullptr) {
                 continue;
             }
-
-            const char* report = nullptr;
-            ebpf_api_verifier_stats_t stats;
-            if (ebpf_api_elf_verify_program_from_memory(
-                    data.c_str(),
-                    data.size(),
-                    program->section_name,
-                    program->program_name,
-                    (global_program_type_set) ? &program_type : &program->program_type,
-                    verbosity,
-                    &report,
-                    &error_message,
-                    &stats) != 0) {
-                report = ((report == nullptr) ? "" : report);
-                throw std::runtime_error(
-                    std::string("Verification failed for ") + std::string(program->program_name) +
-                    std::string(" with error ") + std::string(error_message) + std::string("\n Report:\n") +
-                    std::string(report));
-            }
-            ebpf_free_string(report);
-            ebpf_free_string(error_message);
-            error_message = nullptr;
-
-            const ebpf_program_info_t* program_info = nullptr;
-            result = ebpf_get_program_info_from_verifier(&program_info);
-            if (result != EBPF_SUCCESS) {
-                throw std::runtime_error(std::string("Failed to get program information"));
-            }
-
-            // Retrieve map annotations from the verifier's abstract domain analysis.
-            const ebpf_verifier_map_info_t* map_annotations = nullptr;
-            size_t map_annotation_count = 0;
-            result = ebpf_get_map_annotations_from_verifier(&map_annotations, &map_annotation_count);
-            if (result != EBPF_SUCCESS) {
-                throw std::runtime_error(std::string("Failed to get map annotations from verifier"));
-            }
-            generator.set_map_annotations(program->program_name, map_annotations, map_annotation_count);
-
-            generator.parse(
-                program,
-                program_info,
-                (global_program_type_set) ? program_type : program->program_type,
-                (global_program_type_set) ? attach_type : program->expected_attach_type,
-                hash_algorithm,
-                infos);
-
-            if (hash_algorithm != "none") {
-                std::vector<int32_t> helper_ids = generator.get_helper_ids(program->program_name);
-                auto btf_resolved_functions = generator.get_btf_resolved_function_dependencies(program->program_name);
-                std::optional<std::vector<uint8_t>> program_info_hash =
-                    get_program_info_type_hash(helper_ids, btf_resolved_functions, hash_algorithm);
-                generator.set_program_hash_info(program->program_name, program_info_hash);
-            }
+            programs.push_back(program);
         }
 
+        // Verify and parse per-program data.
+        generate_programs(
+            generator,
+            programs,
+            infos,
+            data,
+            (global_program_type_set) ? &program_type : nullptr,
+            (global_program_type_set) ? &attach_type : nullptr,
+            verbosity,
+            hash_algorithm,
+            job_count);
+
         ebpf_free_programs(infos);
         ebpf_free_string(error_message);
 
+        if (profile_branches) {
+            generator.enable_branch_profiling();
+        } else if (!branch_profile_file.empty()) {
+            generator.set_branch_profile(load_branch_profile(branch_profile_file));
+        }
+
         std::ofstream output_file;
         if (!output_file_name.empty()) {
             output_file.open(output_file_name, std::ios::out | std::ios::trunc);
@@ -426,7 +692,20 @@ main(int argc, char** argv)
         default:
             throw std::runtime_error("Invalid output type");
         }
-        generator.emit_c_code(out_stream);
+        if (!split_output) {
+            generator.emit_c_code(out_stream);
+        } else {
+            std::map<std::string, std::string> program_translation_units;
+            generator.emit_c_code(out_stream, program_translation_units);
+            for (const auto& [program_name, code] : program_translation_units) {
+                std::ostringstream program_stream;
+                program_stream << copyright_notice << std::endl;
+                program_stream << "// Do not alter this generated file." << std::endl;
+                program_stream << "// This file was generated from " << file << std::endl << std::endl;
+                program_stream << code;
+                write_file_if_changed(get_program_file_name(output_file_name, program_name), program_stream.str());
+            }
+        }
     } catch (std::runtime_error err) {
         std::cerr << err.what() << std::endl;
         return 1;
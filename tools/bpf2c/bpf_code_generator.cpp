@@ -50,6 +50,12 @@ using namespace prevail;
 #define INDENT "    "
 #define LINE_BREAK_WIDTH 120
 
+// Name of the map that holds the counters of code instrumented to collect a branch profile.
+#define BRANCH_PROFILE_MAP_NAME "bpf2c_branch_profile"
+
+// Share of the executions in which a branch must go the same way to be annotated as likely or unlikely.
+#define BRANCH_PROFILE_BIAS_THRESHOLD 0.9
+
 #define EBPF_MODE_ATOMIC 0xc0
 
 // Sign-extending load opcodes (RFC 9669)
@@ -111,6 +117,16 @@ _btf_resolved_function_key(const GUID& module_guid, const std::string& name)
 
 static const GUID _guid_null = {0, 0, 0, {0, 0, 0, 0, 0, 0, 0, 0}};
 
+// Returns true if the instruction is a conditional jump.
+static bool
+_is_conditional_jump(const ebpf_inst& instruction)
+{
+    return ((instruction.opcode & INST_CLS_MASK) == INST_CLS_JMP ||
+            (instruction.opcode & INST_CLS_MASK) == INST_CLS_JMP32) &&
+           instruction.opcode != INST_OP_JA16 && instruction.opcode != INST_OP_JA32 &&
+           instruction.opcode != INST_OP_CALL && instruction.opcode != INST_OP_EXIT;
+}
+
 enum class AluOperations
 {
     Add,
@@ -409,6 +425,49 @@ bpf_code_generator::set_map_annotations(
     }
 }
 
+void
+bpf_code_generator::enable_branch_profiling()
+{
+    if (map_definitions.contains(BRANCH_PROFILE_MAP_NAME)) {
+        throw bpf_code_generator_exception("map " BRANCH_PROFILE_MAP_NAME " already exists");
+    }
+    size_t counter_count = assign_profile_counters();
+    if (counter_count > UINT32_MAX) {
+        throw bpf_code_generator_exception("too many branches to profile");
+    }
+
+    // The counters are stored in an array map, which the generated code accesses directly.
+    map_info_t& map = map_definitions[BRANCH_PROFILE_MAP_NAME];
+    map.definition.type = BPF_MAP_TYPE_ARRAY;
+    map.definition.key_size = sizeof(uint32_t);
+    map.definition.value_size = sizeof(uint64_t);
+    map.definition.max_entries = static_cast<uint32_t>(counter_count);
+    map.definition.pinning = LIBBPF_PIN_NONE;
+    map.index = map_definitions.size() - 1;
+
+    for (auto& [_, program] : programs) {
+        if (program.output_instructions.size() > 0) {
+            program.profile_map_index = map.index;
+        }
+    }
+}
+
+void
+bpf_code_generator::set_branch_profile(const std::vector<uint64_t>& counters)
+{
+    size_t counter_count = assign_profile_counters();
+    if (counters.size() != counter_count) {
+        throw bpf_code_generator_exception(
+            "branch profile has " + std::to_string(counters.size()) + " counters, expected " +
+            std::to_string(counter_count));
+    }
+
+    for (auto& [_, program] : programs) {
+        auto first = counters.begin() + program.profile_counter_base;
+        program.branch_profile.assign(first, first + program.profile_counter_count());
+    }
+}
+
 void
 bpf_code_generator::generate(const bpf_code_generator::unsafe_string& program_name)
 {
@@ -1043,6 +1102,17 @@ bpf_code_generator::get_reachable_subprograms(const unsafe_string& entry_name) c
     return reachable;
 }
 
+size_t
+bpf_code_generator::assign_profile_counters()
+{
+    size_t counter_count = 0;
+    for (auto& [_, program] : programs) {
+        program.profile_counter_base = counter_count;
+        counter_count += program.profile_counter_count();
+    }
+    return counter_count;
+}
+
 void
 bpf_code_generator::build_global_helper_index()
 {
@@ -1374,6 +1444,87 @@ bpf_code_generator::bpf_code_generator_program::build_function_table()
     }
 }
 
+size_t
+bpf_code_generator::bpf_code_generator_program::profile_counter_count() const
+{
+    if (output_instructions.size() == 0) {
+        return 0;
+    }
+    size_t counter_count = 1;
+    for (const auto& output : output_instructions) {
+        if (_is_conditional_jump(output.instruction)) {
+            counter_count += 2;
+        }
+    }
+    return counter_count;
+}
+
+std::string
+bpf_code_generator::bpf_code_generator_program::profile_counter_increment(size_t counter) const
+{
+    // The increment isn't atomic, so concurrent executions may lose counts, which is fine for a profile.
+    return std::format(
+        "((uint64_t*)runtime_context->map_data[{}].array_data)[{}]++;",
+        profile_map_index.value(),
+        profile_counter_base + counter);
+}
+
+bool
+bpf_code_generator::bpf_code_generator_program::is_cold() const
+{
+    return !branch_profile.empty() && branch_profile[0] == 0;
+}
+
+void
+bpf_code_generator::bpf_code_generator_program::move_cold_blocks_out_of_line()
+{
+    std::vector<output_instruction_t>& program_output = output_instructions;
+    size_t branch_index = 0;
+    size_t cold_label_index = 1;
+    for (size_t i = 0; i < program_output.size(); i++) {
+        if (!_is_conditional_jump(program_output[i].instruction)) {
+            continue;
+        }
+        uint64_t fall_through_count = branch_profile[1 + 2 * branch_index];
+        uint64_t taken_count = branch_profile[2 + 2 * branch_index];
+        branch_index++;
+
+        // Only move blocks that never ran, that are only reached by falling through the branch, and that aren't
+        // part of a block that was already moved.
+        if (program_output[i].out_of_line || fall_through_count != 0 || taken_count == 0 ||
+            i + 1 >= program_output.size() || program_output[i + 1].jump_target) {
+            continue;
+        }
+
+        // The block ends at an exit or unconditional jump, or before the next jump target, which it then jumps to.
+        size_t end = i + 1;
+        std::string next_label;
+        for (; end < program_output.size(); end++) {
+            auto opcode = program_output[end].instruction.opcode;
+            if (opcode == INST_OP_EXIT || opcode == INST_OP_JA16 || opcode == INST_OP_JA32) {
+                break;
+            }
+            if (end + 1 < program_output.size() && program_output[end + 1].jump_target) {
+                next_label = program_output[end + 1].label;
+                break;
+            }
+        }
+        if (end == program_output.size()) {
+            continue;
+        }
+
+        std::string cold_label = "cold_label_" + std::to_string(cold_label_index++);
+        program_output[i].lines.push_back("goto " + cold_label + ";");
+        program_output[i + 1].out_of_line_label = cold_label;
+        for (size_t j = i + 1; j <= end; j++) {
+            program_output[j].out_of_line = true;
+        }
+        if (!next_label.empty()) {
+            program_output[end].lines.push_back("goto " + next_label + ";");
+        }
+    }
+}
+
 static bool
 is_optimized_array_lookup(const ebpf_verifier_map_info_t& ann)
 {
@@ -1396,6 +1547,11 @@ bpf_code_generator::bpf_code_generator_program::encode_instructions(
     auto effective_program_name = !program_name.empty() ? program_name : elf_section_name;
     auto helper_array_prefix = "runtime_context->helper_data[{}]";
     auto btf_resolved_function_array_prefix = "runtime_context->btf_resolved_function_data[{}]";
+    if (profile_map_index.has_value()) {
+        referenced_map_indices.insert(profile_map_index.value());
+    }
+    // Index of the next conditional branch, which selects its profile counters.
+    size_t branch_index = 0;
 
     // Encode instructions.
     for (size_t i = 0; i < program_output.size(); i++) {
@@ -2017,9 +2173,33 @@ bpf_code_generator::bpf_code_generator_program::encode_instructions(
 
                 std::string predicate =
                     vformat(format, make_format_args(destination_cast, destination, source_cast, source));
+                std::optional<size_t> fall_through_counter;
+                std::optional<size_t> taken_counter;
+                if (_is_conditional_jump(inst)) {
+                    fall_through_counter = 1 + 2 * branch_index;
+                    taken_counter = 2 + 2 * branch_index;
+                    branch_index++;
+                }
+                if (!branch_profile.empty() && taken_counter.has_value()) {
+                    // Tell the compiler which way the branch usually goes, if it mostly went one way.
+                    double fall_through_count = static_cast<double>(branch_profile[fall_through_counter.value()]);
+                    double taken_count = static_cast<double>(branch_profile[taken_counter.value()]);
+                    double total_count = fall_through_count + taken_count;
+                    if (total_count > 0 && taken_count >= total_count * BRANCH_PROFILE_BIAS_THRESHOLD) {
+                        predicate = "BPF2C_LIKELY(" + predicate + ")";
+                    } else if (total_count > 0 && fall_through_count >= total_count * BRANCH_PROFILE_BIAS_THRESHOLD) {
+                        predicate = "BPF2C_UNLIKELY(" + predicate + ")";
+                    }
+                }
                 output.lines.push_back(vformat("if ({}) {{", make_format_args(predicate)));
+                if (profile_map_index.has_value() && taken_counter.has_value()) {
+                    output.lines.push_back(INDENT + profile_counter_increment(taken_counter.value()));
+                }
                 output.lines.push_back(vformat(INDENT "goto {};", make_format_args(target)));
                 output.lines.push_back("}");
+                if (profile_map_index.has_value() && fall_through_counter.has_value()) {
+                    output.lines.push_back(profile_counter_increment(fall_through_counter.value()));
+                }
             }
         } break;
 
@@ -2028,6 +2208,10 @@ bpf_code_generator::bpf_code_generator_program::encode_instructions(
         }
     }
 
+    if (!branch_profile.empty()) {
+        move_cold_blocks_out_of_line();
+    }
+
     instructions_encoded = true;
 }
 
@@ -2036,8 +2220,10 @@ bpf_code_generator::emit_subprogram(std::ostream& output_stream, const bpf_code_
 {
     std::string prolog_line_info;
 
-    // Emit entry point.
-    output_stream << prolog_line_info << "static uint64_t\n"
+    // Emit entry point. A subprogram that was never called according to the branch profile is kept out of the way
+    // of the code that runs.
+    output_stream << prolog_line_info << function_storage_class() << (subprogram.is_cold() ? "BPF2C_COLD " : "")
+                  << "uint64_t\n"
                   << subprogram.program_name.c_identifier()
                   << "(uint64_t r1, uint64_t r2, uint64_t r3, uint64_t r4, uint64_t r5, uint64_t r10, void* context, "
                      "const program_runtime_context_t* runtime_context)"
@@ -2083,7 +2269,29 @@ bpf_code_generator::bpf_code_generator_program::emit_instructions(
 {
     std::string prolog_line_info;
 
+    if (profile_map_index.has_value()) {
+        output_stream << INDENT << profile_counter_increment(0) << std::endl;
+    }
+
+    // Blocks that never ran according to the branch profile are emitted after the rest of the function.
+    std::vector<const output_instruction_t*> ordered_output;
+    ordered_output.reserve(output_instructions.size());
+    for (const auto& output : output_instructions) {
+        if (!output.out_of_line) {
+            ordered_output.push_back(&output);
+        }
+    }
     for (const auto& output : output_instructions) {
+        if (output.out_of_line) {
+            ordered_output.push_back(&output);
+        }
+    }
+
+    for (const auto* output_pointer : ordered_output) {
+        const auto& output = *output_pointer;
+        if (!output.out_of_line_label.empty()) {
+            output_stream << output.out_of_line_label << ":" << std::endl;
+        }
         if (output.lines.empty()) {
             continue;
         }
@@ -2115,8 +2323,36 @@ bpf_code_generator::bpf_code_generator_program::emit_instructions(
     }
 }
 
+const char*
+bpf_code_generator::function_storage_class() const
+{
+    return split_translation_units ? "" : "static ";
+}
+
 void
 bpf_code_generator::emit_c_code(std::ostream& output_stream)
+{
+    emit_translation_units(output_stream, nullptr);
+}
+
+void
+bpf_code_generator::emit_c_code(
+    std::ostream& output_stream, std::map<std::string, std::string>& program_translation_units)
+{
+    std::map<std::string, std::ostringstream> program_streams;
+    split_translation_units = true;
+    emit_translation_units(output_stream, &program_streams);
+    split_translation_units = false;
+
+    program_translation_units.clear();
+    for (const auto& [name, program_stream] : program_streams) {
+        program_translation_units[name] = program_stream.str();
+    }
+}
+
+void
+bpf_code_generator::emit_translation_units(
+    std::ostream& output_stream, std::map<std::string, std::ostringstream>* program_streams)
 {
     // Emit C file.
     output_stream << "#include \"bpf2c.h\"" << std::endl << std::endl;
@@ -2348,6 +2584,17 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
             continue;
         }
 
+        // The code of the program goes in its own translation unit if the output is split. Everything the runtime
+        // reads through the metadata table stays in the output stream.
+        std::ostream* code_stream = &output_stream;
+        if (program_streams != nullptr) {
+            auto [program_stream, inserted] = program_streams->try_emplace(program_name.c_identifier());
+            if (inserted) {
+                program_stream->second << "#include \"bpf2c.h\"" << std::endl << std::endl;
+            }
+            code_stream = &program_stream->second;
+        }
+
         // Emit the helper function array for this entry program.
         // When subprograms exist, emit the full global helper array for every entry
         // program so helper_data[] indices stay dense and consistent with encoded calls.
@@ -2492,17 +2739,18 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
         }
 
         if (programs.size() > program_count) {
-            output_stream << "// Forward references for local functions." << std::endl;
+            // Only the program calls the subprograms, so the references go with its code.
+            *code_stream << "// Forward references for local functions." << std::endl;
             for (auto& [_, subprogram] : programs) {
                 if (is_subprogram(subprogram)) {
-                    output_stream << "static uint64_t" << std::endl;
-                    output_stream << subprogram.program_name.c_identifier()
-                                  << "(uint64_t r1, uint64_t r2, uint64_t r3, uint64_t r4, uint64_t r5, uint64_t r10, "
-                                     "void* context, const program_runtime_context_t* runtime_context);"
-                                  << std::endl;
+                    *code_stream << function_storage_class() << "uint64_t" << std::endl;
+                    *code_stream << subprogram.program_name.c_identifier()
+                                 << "(uint64_t r1, uint64_t r2, uint64_t r3, uint64_t r4, uint64_t r5, uint64_t r10, "
+                                    "void* context, const program_runtime_context_t* runtime_context);"
+                                 << std::endl;
                 }
             }
-            output_stream << std::endl;
+            *code_stream << std::endl;
         }
 
         // Emit the program and attach type GUID.
@@ -2570,31 +2818,32 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
         });
 
         // Emit entry point.
-        output_stream << "#pragma code_seg(push, " << program.pe_section_name.quoted() << ")" << std::endl;
-        output_stream << std::format(
-                             "static uint64_t\n{}(void* context, const program_runtime_context_t* runtime_context)",
-                             program_name.c_identifier())
-                      << std::endl;
-        output_stream << prolog_line_info << "{" << std::endl;
+        *code_stream << "#pragma code_seg(push, " << program.pe_section_name.quoted() << ")" << std::endl;
+        *code_stream << std::format(
+                            "{}uint64_t\n{}(void* context, const program_runtime_context_t* runtime_context)",
+                            function_storage_class(),
+                            program_name.c_identifier())
+                     << std::endl;
+        *code_stream << prolog_line_info << "{" << std::endl;
 
         // Emit prologue.
         program.get_register_name(0);
         program.get_register_name(1);
         program.get_register_name(10);
-        output_stream << prolog_line_info << INDENT "// Prologue." << std::endl;
-        output_stream << prolog_line_info << INDENT "uint64_t stack[(UBPF_STACK_SIZE + 7) / 8];" << std::endl;
+        *code_stream << prolog_line_info << INDENT "// Prologue." << std::endl;
+        *code_stream << prolog_line_info << INDENT "uint64_t stack[(UBPF_STACK_SIZE + 7) / 8];" << std::endl;
         for (const auto& r : _register_names) {
             // Skip unused registers.
             if (program.referenced_registers.find(r) == program.referenced_registers.end()) {
                 continue;
             }
-            output_stream << prolog_line_info << INDENT "register uint64_t " << r.c_str() << " = 0;" << std::endl;
+            *code_stream << prolog_line_info << INDENT "register uint64_t " << r.c_str() << " = 0;" << std::endl;
         }
-        output_stream << std::endl;
-        output_stream << prolog_line_info << INDENT "" << program.get_register_name(1) << " = (uintptr_t)context;"
-                      << std::endl;
-        output_stream << prolog_line_info << INDENT "" << program.get_register_name(10)
-                      << " = (uintptr_t)((uint8_t*)stack + sizeof(stack));" << std::endl;
+        *code_stream << std::endl;
+        *code_stream << prolog_line_info << INDENT "" << program.get_register_name(1) << " = (uintptr_t)context;"
+                     << std::endl;
+        *code_stream << prolog_line_info << INDENT "" << program.get_register_name(10)
+                     << " = (uintptr_t)((uint8_t*)stack + sizeof(stack));" << std::endl;
         size_t entry_helper_count = 0;
         size_t entry_btf_resolved_function_count = 0;
         if (!global_helpers_ordered.empty()) {
@@ -2617,17 +2866,17 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
         }
         if (program.referenced_map_indices.size() == 0 && entry_helper_count == 0 &&
             entry_btf_resolved_function_count == 0) {
-            output_stream << prolog_line_info << INDENT "UNREFERENCED_PARAMETER(runtime_context);" << std::endl;
+            *code_stream << prolog_line_info << INDENT "UNREFERENCED_PARAMETER(runtime_context);" << std::endl;
         }
-        output_stream << std::endl;
+        *code_stream << std::endl;
 
         // Emit encoded instructions.
-        program.emit_instructions(output_stream, line_info);
+        program.emit_instructions(*code_stream, line_info);
 
         // Emit epilogue.
-        output_stream << prolog_line_info << "}" << std::endl;
-        output_stream << "#pragma code_seg(pop)" << std::endl;
-        output_stream << "#line __LINE__ __FILE__" << std::endl << std::endl;
+        *code_stream << prolog_line_info << "}" << std::endl;
+        *code_stream << "#pragma code_seg(pop)" << std::endl;
+        *code_stream << "#line __LINE__ __FILE__" << std::endl << std::endl;
 
         // Emit subprograms once. Multiple entry programs can share the same
         // local-call graph, so re-emitting every subprogram per entry creates
@@ -2635,7 +2884,7 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
         if (!subprograms_emitted) {
             for (auto& [_, subprogram] : programs) {
                 if (is_subprogram(subprogram)) {
-                    emit_subprogram(output_stream, subprogram);
+                    emit_subprogram(*code_stream, subprogram);
                 }
             }
             subprograms_emitted = true;
@@ -2643,6 +2892,19 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
     }
 
     if (program_count != 0) {
+        if (program_streams != nullptr) {
+            output_stream << "// Forward references for programs." << std::endl;
+            for (auto& [name, program] : programs) {
+                if (is_subprogram(program)) {
+                    continue;
+                }
+                auto program_name = !program.program_name.empty() ? program.program_name : name;
+                output_stream << "uint64_t" << std::endl
+                              << program_name.c_identifier()
+                              << "(void* context, const program_runtime_context_t* runtime_context);" << std::endl;
+            }
+            output_stream << std::endl;
+        }
         output_stream << "#pragma data_seg(push, \"programs\")" << std::endl;
         output_stream << "static program_entry_t _programs[] = {" << std::endl;
         for (auto& [name, program] : programs) {
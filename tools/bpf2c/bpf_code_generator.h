@@ -14,6 +14,7 @@
 #include <map>
 #include <optional>
 #include <set>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -287,6 +288,18 @@ class bpf_code_generator
     void
     emit_c_code(std::ostream& output);
 
+    /**
+     * @brief Emit the C code as a metadata translation unit plus one translation unit per program, so that the
+     * programs can be compiled in parallel and a program whose code didn't change doesn't have to be recompiled.
+     * Programs and subprograms have external linkage in this mode so that they can be referenced from the metadata.
+     *
+     * @param[in] output Output stream to write the metadata translation unit to.
+     * @param[out] program_translation_units Code of the translation unit of each program, keyed by the C identifier
+     * of the program.
+     */
+    void
+    emit_c_code(std::ostream& output, std::map<std::string, std::string>& program_translation_units);
+
     /**
      * @brief Get the helper function ids used by the current program.
      *
@@ -327,6 +340,29 @@ class bpf_code_generator
         _In_reads_opt_(count) const ebpf_verifier_map_info_t* annotations,
         size_t count);
 
+    /**
+     * @brief Instrument the generated code to collect a branch profile. Each function counts how often it is
+     * entered and how often each of its conditional branches falls through and is taken, in an array map named
+     * bpf2c_branch_profile that is added to the module. The counters can be read through the map after running the
+     * programs with test-run or while they handle live traffic. Must be called after all programs are parsed.
+     *
+     * @throws bpf_code_generator_exception The module already has a map with that name.
+     */
+    void
+    enable_branch_profiling();
+
+    /**
+     * @brief Lay out the generated code using a branch profile collected from code instrumented by
+     * enable_branch_profiling. Branches are annotated with the direction they usually take, code that never ran on
+     * the fall-through path of a branch is moved to the end of the function, and subprograms that were never
+     * called are marked as cold. Must be called after all programs are parsed.
+     *
+     * @param[in] counters Values of the counters, in the order of the keys of the bpf2c_branch_profile map.
+     * @throws bpf_code_generator_exception The number of counters doesn't match the programs.
+     */
+    void
+    set_branch_profile(const std::vector<uint64_t>& counters);
+
   private:
     typedef struct _helper_function
     {
@@ -353,6 +389,10 @@ class bpf_code_generator
         uint32_t instruction_offset;
         bool jump_target = false;
         std::string label;
+        // Whether the instruction is in a block that is emitted at the end of the function as it never ran.
+        bool out_of_line = false;
+        // Label of the out-of-line block that starts at this instruction, if any.
+        std::string out_of_line_label;
         std::vector<std::string> lines;
         unsafe_string relocation;
     } output_instruction_t;
@@ -400,6 +440,40 @@ class bpf_code_generator
         std::map<int32_t, btf_resolved_function_t> btf_resolved_functions;
         std::string program_info_hash_type{};
         const ebpf_program_info_t* program_info = nullptr;
+        // Index of the map holding the branch profile counters, if the code is instrumented.
+        std::optional<size_t> profile_map_index;
+        // Index of the first profile counter of this program in the map. The first counter counts how often the
+        // program is entered, followed by a fall-through and a taken counter for each conditional branch.
+        size_t profile_counter_base{0};
+        // Profile counters of this program to lay out the code with, in the same order as in the map.
+        std::vector<uint64_t> branch_profile;
+
+        /**
+         * @brief Get the number of profile counters of this program.
+         */
+        size_t
+        profile_counter_count() const;
+
+        /**
+         * @brief Get the C statement that increments a profile counter of this program.
+         *
+         * @param[in] counter Index of the counter relative to the first counter of the program.
+         */
+        std::string
+        profile_counter_increment(size_t counter) const;
+
+        /**
+         * @brief Check whether the branch profile shows that the program was never entered.
+         */
+        bool
+        is_cold() const;
+
+        /**
+         * @brief Move the blocks on the fall-through path of conditional branches that only ever took the branch
+         * according to the branch profile to the end of the function, so that the code that runs stays together.
+         */
+        void
+        move_cold_blocks_out_of_line();
 
         /**
          * @brief Assign a label to each jump target.
@@ -513,6 +587,24 @@ class bpf_code_generator
     void
     emit_subprogram(std::ostream& output, const bpf_code_generator_program& subprogram);
 
+    /**
+     * @brief Emit the C code, optionally with the code of each program in its own translation unit.
+     *
+     * @param[in] output Output stream to write the metadata, or all of the code, to.
+     * @param[out] program_streams Translation unit of each program, keyed by the C identifier of the program. If
+     * null, the code of the programs is written to the output stream.
+     */
+    void
+    emit_translation_units(std::ostream& output, std::map<std::string, std::ostringstream>* program_streams);
+
+    /**
+     * @brief Get the storage class to declare generated functions with.
+     *
+     * @return "static " unless the code is split into multiple translation units.
+     */
+    const char*
+    function_storage_class() const;
+
 #if defined(_MSC_VER)
     /**
      * @brief Format a GUID as a string.
@@ -572,6 +664,14 @@ class bpf_code_generator
     std::set<unsafe_string>
     get_reachable_subprograms(const unsafe_string& entry_name) const;
 
+    /**
+     * @brief Assign the branch profile counters of each program a range in the profile map, in program name order.
+     *
+     * @return Total number of counters.
+     */
+    size_t
+    assign_profile_counters();
+
     int pe_section_name_counter{};
     std::map<unsafe_string, bpf_code_generator_program> programs;
     ELFIO::elfio reader;
@@ -598,4 +698,7 @@ class bpf_code_generator
     // pointers remain valid after verifier TLS data is updated by subsequent program verifies.
     std::map<unsafe_string, std::deque<std::string>> _program_map_annotation_names;
     std::vector<btf_resolved_function_t> global_btf_resolved_functions_ordered;
+
+    // Whether the code being emitted is split into multiple translation units.
+    bool split_translation_units{};
 };
@@ -37,6 +37,7 @@ DllMain(HMODULE moduleHandle, unsigned long reasonForCall, void* reserved)
 #define CMD_GROUP_ADD L"add"
 #define CMD_GROUP_DELETE L"delete"
 #define CMD_GROUP_PIN L"pin"
+#define CMD_GROUP_RUN L"run"
 #define CMD_GROUP_SET L"set"
 #define CMD_GROUP_SHOW L"show"
 #define CMD_GROUP_UNPIN L"unpin"
@@ -51,6 +52,7 @@ DllMain(HMODULE moduleHandle, unsigned long reasonForCall, void* reserved)
 
 #define CMD_EBPF_ADD_PROGRAM L"program"
 #define CMD_EBPF_DELETE_PROGRAM L"program"
+#define CMD_EBPF_RUN_PROGRAM L"program"
 #define CMD_EBPF_SET_PROGRAM L"program"
 #define CMD_EBPF_SHOW_PROGRAMS L"programs"
 
@@ -73,6 +75,9 @@ CMD_ENTRY g_EbpfAddCommandTable[] = {
 CMD_ENTRY g_EbpfDeleteCommandTable[] = {
     CREATE_CMD_ENTRY(EBPF_DELETE_PROGRAM, handle_ebpf_delete_program),
 };
+CMD_ENTRY g_EbpfRunCommandTable[] = {
+    CREATE_CMD_ENTRY(EBPF_RUN_PROGRAM, handle_ebpf_run_program),
+};
 CMD_ENTRY g_EbpfSetCommandTable[] = {
     CREATE_CMD_ENTRY(EBPF_SET_PROGRAM, handle_ebpf_set_program),
 };
@@ -125,6 +130,12 @@ CMD_ENTRY_ORIGINAL g_EbpfDeleteCommandTableOriginal[] = {
 CMD_ENTRY_LONG g_EbpfDeleteCommandTableLong[] = {
     CREATE_CMD_ENTRY_LONG(EBPF_DELETE_PROGRAM, handle_ebpf_delete_program),
 };
+CMD_ENTRY_ORIGINAL g_EbpfRunCommandTableOriginal[] = {
+    CREATE_CMD_ENTRY_ORIGINAL(EBPF_RUN_PROGRAM, handle_ebpf_run_program),
+};
+CMD_ENTRY_LONG g_EbpfRunCommandTableLong[] = {
+    CREATE_CMD_ENTRY_LONG(EBPF_RUN_PROGRAM, handle_ebpf_run_program),
+};
 CMD_ENTRY_ORIGINAL g_EbpfSetCommandTableOriginal[] = {
     CREATE_CMD_ENTRY_ORIGINAL(EBPF_SET_PROGRAM, handle_ebpf_set_program),
 };
@@ -186,12 +197,15 @@ CMD_ENTRY_LONG g_EbpfUnpinCommandTableLong[] = {
 #define HLP_GROUP_PIN_EX 1109
 #define HLP_GROUP_UNPIN 1110
 #define HLP_GROUP_UNPIN_EX 1111
+#define HLP_GROUP_RUN 1112
+#define HLP_GROUP_RUN_EX 1113
 
 #ifndef WINDOWS_NETSH_BUG_WORKAROUND
 static CMD_GROUP_ENTRY g_EbpfGroupCommands[] = {
     CREATE_CMD_GROUP_ENTRY(GROUP_ADD, g_EbpfAddCommandTable),
     CREATE_CMD_GROUP_ENTRY(GROUP_DELETE, g_EbpfDeleteCommandTable),
     CREATE_CMD_GROUP_ENTRY(GROUP_PIN, g_EbpfPinCommandTable),
+    CREATE_CMD_GROUP_ENTRY(GROUP_RUN, g_EbpfRunCommandTable),
     CREATE_CMD_GROUP_ENTRY(GROUP_SET, g_EbpfSetCommandTable),
     CREATE_CMD_GROUP_ENTRY(GROUP_SHOW, g_EbpfShowCommandTable),
     CREATE_CMD_GROUP_ENTRY(GROUP_UNPIN, g_EbpfUnpinCommandTable),
@@ -204,6 +218,7 @@ static CMD_GROUP_ENTRY g_EbpfGroupCommandsOriginal[] = {
     CREATE_CMD_GROUP_ENTRY_ORIGINAL(GROUP_ADD, g_EbpfAddCommandTableOriginal),
     CREATE_CMD_GROUP_ENTRY_ORIGINAL(GROUP_DELETE, g_EbpfDeleteCommandTableOriginal),
     CREATE_CMD_GROUP_ENTRY_ORIGINAL(GROUP_PIN, g_EbpfPinCommandTableOriginal),
+    CREATE_CMD_GROUP_ENTRY_ORIGINAL(GROUP_RUN, g_EbpfRunCommandTableOriginal),
     CREATE_CMD_GROUP_ENTRY_ORIGINAL(GROUP_SET, g_EbpfSetCommandTableOriginal),
     CREATE_CMD_GROUP_ENTRY_ORIGINAL(GROUP_SHOW, g_EbpfShowCommandTableOriginal),
     CREATE_CMD_GROUP_ENTRY_ORIGINAL(GROUP_UNPIN, g_EbpfUnpinCommandTableOriginal),
@@ -212,6 +227,7 @@ static CMD_GROUP_ENTRY g_EbpfGroupCommandsLong[] = {
     CREATE_CMD_GROUP_ENTRY_LONG(GROUP_ADD, g_EbpfAddCommandTableLong),
     CREATE_CMD_GROUP_ENTRY_LONG(GROUP_DELETE, g_EbpfDeleteCommandTableLong),
     CREATE_CMD_GROUP_ENTRY_LONG(GROUP_PIN, g_EbpfPinCommandTableLong),
+    CREATE_CMD_GROUP_ENTRY_LONG(GROUP_RUN, g_EbpfRunCommandTableLong),
     CREATE_CMD_GROUP_ENTRY_LONG(GROUP_SET, g_EbpfSetCommandTableLong),
     CREATE_CMD_GROUP_ENTRY_LONG(GROUP_SHOW, g_EbpfShowCommandTableLong),
     CREATE_CMD_GROUP_ENTRY_LONG(GROUP_UNPIN, g_EbpfUnpinCommandTableLong),
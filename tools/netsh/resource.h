@@ -34,6 +34,8 @@
 #define HLP_EBPF_UNPIN_PROGRAM_EX 130
 #define HLP_EBPF_SHOW_HASH 131
 #define HLP_EBPF_SHOW_HASH_EX 132
+#define HLP_EBPF_RUN_PROGRAM 133
+#define HLP_EBPF_RUN_PROGRAM_EX 134
 
 #define EBPF_FILE_DESCRIPTION "eBPF for Windows Netsh Helper"
 #define EBPF_FILE_NAME "ebpfnetsh.dll"
@@ -42,7 +44,7 @@
 //
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE 133
+#define _APS_NEXT_RESOURCE_VALUE 135
 #define _APS_NEXT_COMMAND_VALUE 40001
 #define _APS_NEXT_CONTROL_VALUE 1001
 #define _APS_NEXT_SYMED_VALUE 101